@@ -3,6 +3,12 @@
 #    This modules content is executed whenever a module required or suggests dune-istl!
 #
 
+# the threaded matrix kernels use std::thread
+find_package(Threads)
+if(CMAKE_THREAD_LIBS_INIT)
+  dune_register_package_flags(LIBRARIES "${CMAKE_THREAD_LIBS_INIT}")
+endif()
+
 find_package(METIS)
 find_package(ParMETIS)
 include(AddParMETISFlags)
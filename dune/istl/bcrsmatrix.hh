@@ -12,14 +12,21 @@
 #include <numeric>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 #include "istlexception.hh"
 #include "bvector.hh"
 #include "matrixutils.hh"
+#include "threadexecutor.hh"
+#include "blockkernels.hh"
+#include "memoryusage.hh"
 #include <dune/common/stdstreams.hh>
 #include <dune/common/iteratorfacades.hh>
 #include <dune/common/typetraits.hh>
 #include <dune/common/ftraits.hh>
+#include <dune/common/unused.hh>
 
 /*! \file
  * \brief Implementation of the BCRSMatrix class
@@ -69,6 +76,11 @@ namespace Dune {
   template<typename M>
   struct MatrixDimension;
 
+  namespace Imp {
+    template<class M>
+    struct COOImport;
+  }
+
   //! Statistics about compression achieved in implicit mode.
   /**
    * To enable the user to tune parameters of the implicit build mode of a
@@ -218,6 +230,223 @@ namespace Dune {
 
   };
 
+  //! Concurrent assembly of a BCRSMatrix in implicit build mode.
+  /**
+   * Several threads may insert entries at the same time, into disjoint
+   * or overlapping rows. Each thread works through its own Inserter,
+   * obtained from inserter(k) with a thread number k that is unique
+   * among the threads running concurrently. The row windows of the
+   * matrix are guarded by a set of row locks, entries that do not fit
+   * into their row window go into an overflow area private to the
+   * inserter, so the threads never wait for each other on the overflow.
+   *
+   * compress() merges the overflow areas and sorts the columns of all
+   * rows in parallel. Entries created by different inserters for the
+   * same position are summed up there. Values should therefore be
+   * accumulated with Inserter::add(), which updates the block while
+   * holding the row lock. Inserter::entry() returns a reference to the
+   * block; it can be used to create the pattern, or to write values
+   * into rows no other thread touches.
+   *
+   * \code
+   * typedef BCRSMatrix<FieldMatrix<double,2,2> > M;
+   * M A;
+   * ConcurrentImplicitMatrixBuilder<M> builder(A,n,n,7,0.1,threads);
+   * // in thread k:
+   * auto inserter = builder.inserter(k);
+   * inserter.add(i,j,localBlock);
+   * // after all threads are done:
+   * builder.compress(exec);
+   * \endcode
+   *
+   * \tparam M_ the matrix type
+   */
+  template<class M_>
+  class ConcurrentImplicitMatrixBuilder
+  {
+
+  public:
+
+    //! The underlying matrix.
+    typedef M_ Matrix;
+
+    //! The block_type of the underlying matrix.
+    typedef typename Matrix::block_type block_type;
+
+    //! The size_type of the underlying matrix.
+    typedef typename Matrix::size_type size_type;
+
+    //! The type for the statistics object returned by compress().
+    typedef typename Matrix::CompressionStatistics CompressionStatistics;
+
+    //! Entry access for a single thread.
+    class Inserter
+    {
+
+    public:
+
+      //! Returns entry (row,col), creating it if it does not exist yet.
+      block_type& entry(size_type row, size_type col) const
+      {
+        block_type* aptr = _builder.find(row,col);
+        if (aptr)
+          return *aptr;
+        return (*_overflow)[std::make_pair(row,col)];
+      }
+
+      //! Adds v to entry (row,col), creating it if it does not exist yet.
+      void add(size_type row, size_type col, const block_type& v) const
+      {
+        _builder.check(row,col);
+        {
+          std::lock_guard<std::mutex> guard(_builder.lock(row));
+          block_type* aptr = _builder._m.implicitEntry(row,col);
+          if (aptr)
+          {
+            *aptr += v;
+            return;
+          }
+        }
+        (*_overflow)[std::make_pair(row,col)] += v;
+      }
+
+#ifndef DOXYGEN
+
+      Inserter(ConcurrentImplicitMatrixBuilder& builder, typename Matrix::OverflowType& overflow)
+        : _builder(builder)
+        , _overflow(&overflow)
+      {}
+
+#endif
+
+    private:
+
+      ConcurrentImplicitMatrixBuilder& _builder;
+      typename Matrix::OverflowType* _overflow;
+
+    };
+
+    //! Creates a ConcurrentImplicitMatrixBuilder for matrix m and the given number of threads.
+    /**
+     * \note All of setBuildMode(), setImplicitBuildModeParameters() and
+     *       setSize() must have been called for m with the correct values.
+     */
+    ConcurrentImplicitMatrixBuilder(Matrix& m, size_type threads)
+      : _m(m)
+      , _overflows(std::max(threads,size_type(1)))
+      , _locks(lockCount)
+    {
+      if (m.buildMode() != Matrix::implicit)
+        DUNE_THROW(BCRSMatrixError,"You can only create a ConcurrentImplicitMatrixBuilder for a matrix in implicit build mode");
+      if (m.buildStage() != Matrix::building)
+        DUNE_THROW(BCRSMatrixError,"You can only create a ConcurrentImplicitMatrixBuilder for a matrix with set size that has not been compressed() yet");
+    }
+
+    //! Sets up matrix m for implicit construction and creates a ConcurrentImplicitMatrixBuilder for it.
+    /**
+     * \param m                 the matrix to be built
+     * \param rows              the number of matrix rows
+     * \param cols              the number of matrix columns
+     * \param avg_cols_per_row  the average number of non-zero columns per row
+     * \param overflow_fraction the amount of overflow to reserve in the matrix
+     * \param threads           the number of threads inserting entries
+     *
+     * \sa ImplicitMatrixBuilder
+     */
+    ConcurrentImplicitMatrixBuilder(Matrix& m, size_type rows, size_type cols, size_type avg_cols_per_row,
+                                    double overflow_fraction, size_type threads)
+      : _m(m)
+      , _overflows(std::max(threads,size_type(1)))
+      , _locks(lockCount)
+    {
+      if (m.buildStage() != Matrix::notAllocated)
+        DUNE_THROW(BCRSMatrixError,"You can only set up a matrix for this ConcurrentImplicitMatrixBuilder if it has no memory allocated yet");
+      m.setBuildMode(Matrix::implicit);
+      m.setImplicitBuildModeParameters(avg_cols_per_row,overflow_fraction);
+      m.setSize(rows,cols);
+    }
+
+    //! Returns the inserter for thread k.
+    Inserter inserter(size_type k)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (k >= _overflows.size())
+        DUNE_THROW(BCRSMatrixError,"thread number exceeds the number of threads of the builder");
+#endif
+      return Inserter(*this,_overflows[k]);
+    }
+
+    //! The number of threads that may insert concurrently.
+    size_type threads() const
+    {
+      return _overflows.size();
+    }
+
+    //! Finishes the build stage, merging the overflow areas in parallel.
+    /**
+     * Must not be called while entries are inserted.
+     *
+     * \sa BCRSMatrix::compress(const ThreadExecutor&)
+     */
+    CompressionStatistics compress(const ThreadExecutor& exec = ThreadExecutor::global())
+    {
+      std::vector<const typename Matrix::OverflowType*> overflows(1,&_m.overflow);
+      for (const auto& o : _overflows)
+        overflows.push_back(&o);
+      CompressionStatistics stats = _m.compressParallel(exec,overflows);
+      for (auto& o : _overflows)
+        o.clear();
+      return stats;
+    }
+
+    //! The number of rows in the matrix.
+    size_type N() const
+    {
+      return _m.N();
+    }
+
+    //! The number of columns in the matrix.
+    size_type M() const
+    {
+      return _m.M();
+    }
+
+  private:
+
+    // number of row locks, rows are mapped to them cyclically
+    static const size_type lockCount = 4096;
+
+    std::mutex& lock(size_type row)
+    {
+      return _locks[row % lockCount];
+    }
+
+    void check(size_type row, size_type col) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (row >= _m.N())
+        DUNE_THROW(BCRSMatrixError,"row index exceeds matrix size");
+      if (col >= _m.M())
+        DUNE_THROW(BCRSMatrixError,"column index exceeds matrix size");
+#else
+      DUNE_UNUSED_PARAMETER(row);
+      DUNE_UNUSED_PARAMETER(col);
+#endif
+    }
+
+    block_type* find(size_type row, size_type col)
+    {
+      check(row,col);
+      std::lock_guard<std::mutex> guard(lock(row));
+      return _m.implicitEntry(row,col);
+    }
+
+    Matrix& _m;
+    std::vector<typename Matrix::OverflowType> _overflows;
+    std::vector<std::mutex> _locks;
+
+  };
+
   /**
      \brief A sparse block matrix with compressed row storage
 
@@ -422,6 +651,9 @@ namespace Dune {
   class BCRSMatrix
   {
     friend struct MatrixDimension<BCRSMatrix>;
+    template<class, class> friend class BCRSMatrix;
+    template<class> friend class ConcurrentImplicitMatrixBuilder;
+    template<class> friend struct Imp::COOImport;
   public:
     enum BuildStage {
       /** @brief Matrix is not built at all, no memory has been allocated, build mode and size can still be set. */
@@ -780,13 +1012,86 @@ namespace Dune {
           _nnz += Mat.r[i].getsize();
       }
 
-      j_ = Mat.j_; // enable column index sharing, release array in case of row-wise allocation
+      // enable column index sharing, release array in case of row-wise allocation,
+      // but make copies of external indices
+      if (!Mat.externalIndices_)
+        j_ = Mat.j_;
+      placementExec_ = Mat.placementExec_;
       allocate(Mat.n, Mat.m, _nnz, true, true);
 
       // build window structure
       copyWindowStructure(Mat);
     }
 
+    /**
+     * @brief Copy a matrix with a different block type.
+     *
+     * The blocks are converted, e.g. from FieldMatrix<double,n,m> to
+     * FieldMatrix<float,n,m>. The column indices are shared with Mat,
+     * as in the copy constructor, so only the values are duplicated.
+     * A float copy of a double matrix can then be applied to vectors of
+     * doubles, with all sums computed in double:
+     * \code
+     * BCRSMatrix<FieldMatrix<double,3,3> > A;
+     * // ... assemble A
+     * BCRSMatrix<FieldMatrix<float,3,3> > Af(A);
+     * Af.mv(x,y); // x, y are BlockVector<FieldVector<double,3> >
+     * \endcode
+     */
+    template<class OtherB, class OtherA>
+    explicit BCRSMatrix (const BCRSMatrix<OtherB,OtherA>& Mat)
+      : build_mode(BuildMode(Mat.build_mode)), ready(notAllocated), n(0), m(0), nnz_(0),
+        allocationSize_(0), r(0), a(0),
+        avg(Mat.avg), overflowsize(Mat.overflowsize)
+    {
+      static_assert(std::is_same<size_type,typename BCRSMatrix<OtherB,OtherA>::size_type>::value,
+                    "The column indices can only be shared for the same size_type");
+      if (!(Mat.ready == Mat.notAllocated || Mat.ready == Mat.built))
+        DUNE_THROW(InvalidStateException,"BCRSMatrix can only be converted when source matrix is completely empty (size not set) or fully built)");
+
+      size_type _nnz = Mat.nnz_;
+      if (_nnz<=0)
+      {
+        _nnz = 0;
+        for (size_type i=0; i<Mat.n; i++)
+          _nnz += Mat.r[i].getsize();
+      }
+
+      if (!Mat.externalIndices_)
+        j_ = Mat.j_;
+      placementExec_ = Mat.placementExec_;
+      allocate(Mat.n, Mat.m, _nnz, true, true);
+      setWindowPointers(Mat.begin());
+
+      // convert the values, the indices only need a copy if they are not shared
+      const bool shared = (j_ == Mat.j_);
+      for (size_type i=0; i<n; i++)
+        for (size_type k=0; k<r[i].getsize(); k++)
+        {
+          r[i].getptr()[k] = Mat.r[i].getptr()[k];
+          if (!shared)
+            r[i].getindexptr()[k] = Mat.r[i].getindexptr()[k];
+        }
+
+      build_mode = row_wise; // dummy
+      ready = built;
+      placeIfRequested();
+    }
+
+    /**
+     * @brief move constructor
+     *
+     * Takes over the memory of Mat in constant time, including shared
+     * column indices and the cached transposed pattern. Mat is left
+     * empty as if default constructed and can be set up again.
+     */
+    BCRSMatrix (BCRSMatrix&& Mat) noexcept
+      : build_mode(unknown), ready(notAllocated), n(0), m(0), nnz_(0),
+        allocationSize_(0), r(0), a(0), avg(0), overflowsize(-1.0)
+    {
+      moveFrom(Mat);
+    }
+
     //! destructor
     ~BCRSMatrix ()
     {
@@ -810,6 +1115,40 @@ namespace Dune {
         DUNE_THROW(InvalidStateException, "Matrix structure cannot be changed at this stage anymore (ready == "<<ready<<").");
     }
 
+    /**
+     * @brief Distribute the memory of the matrix over the threads of exec.
+     *
+     * The rows, values and column indices are split with
+     * nnzBalancedPartition() and each chunk is first touched by the
+     * thread that processes it in the threaded matrix-vector products.
+     * On NUMA systems the memory of each chunk thus ends up close to
+     * the thread working on it.
+     *
+     * If the matrix is built already, its memory is redistributed
+     * immediately. Otherwise this happens when the build is finished.
+     * Copies of the matrix are distributed the same way. Placing the
+     * memory replaces the column indices by a private copy, so they
+     * are no longer shared with other matrices.
+     *
+     * The executor has to outlive the matrix.
+     */
+    void setPlacement(const ThreadExecutor& exec)
+    {
+      placementExec_ = &exec;
+      if (ready == built)
+        placeMemory();
+    }
+
+    /**
+     * @brief The partition the memory of the matrix was distributed with.
+     *
+     * Has zero chunks if the memory was not placed explicitly.
+     */
+    const RowPartition& placement() const
+    {
+      return placement_;
+    }
+
     /**
      *  @brief Set the size of the matrix.
      *
@@ -902,8 +1241,10 @@ namespace Dune {
           nnz_ += Mat.r[i].getsize();
       }
 
-      // allocate a, share j_
-      j_ = Mat.j_;
+      // allocate a, share j_ unless it is external
+      if (!Mat.externalIndices_)
+        j_ = Mat.j_;
+      placementExec_ = Mat.placementExec_;
       allocate(Mat.n, Mat.m, nnz_, n!=Mat.n, true);
 
       // build window structure
@@ -911,6 +1252,23 @@ namespace Dune {
       return *this;
     }
 
+    /**
+     * @brief move assignment
+     *
+     * Frees the memory of this matrix and takes over the one of Mat,
+     * which is left empty. Other than copying, this works in any build
+     * stage of Mat.
+     */
+    BCRSMatrix& operator= (BCRSMatrix&& Mat) noexcept
+    {
+      if (&Mat!=this)
+      {
+        deallocate();
+        moveFrom(Mat);
+      }
+      return *this;
+    }
+
     //! Assignment from a scalar
     BCRSMatrix& operator= (const field_type& k)
     {
@@ -1006,6 +1364,7 @@ namespace Dune {
             Mat.allocateData();
             Mat.setDataPointers();
           }
+          Mat.placeIfRequested();
         }
         // done
         return *this;
@@ -1245,6 +1604,7 @@ namespace Dune {
 
       // if not, set matrix to built
       ready = built;
+      placeIfRequested();
     }
 
     //===== implicit creation interface
@@ -1279,39 +1639,12 @@ namespace Dune {
         DUNE_THROW(BCRSMatrixError,"column index exceeds matrix size");
 #endif
 
-      size_type* begin = r[row].getindexptr();
-      size_type* end = begin + r[row].getsize();
-
-      size_type* pos = std::find(begin, end, col);
-
-      //treat the case that there was a match in the array
-      if (pos != end)
-        if (*pos == col)
-        {
-          std::ptrdiff_t offset = pos - r[row].getindexptr();
-          B* aptr = r[row].getptr() + offset;
-
-          return *aptr;
-        }
-
-      //determine whether overflow has to be taken into account or not
-      if (r[row].getsize() == avg)
-        return overflow[std::make_pair(row,col)];
-      else
-      {
-        //modify index array
-        *end = col;
-
-        //do simulatenous operations on data array a
-        std::ptrdiff_t offset = end - r[row].getindexptr();
-        B* apos = r[row].getptr() + offset;
-
-        //increase rowsize
-        r[row].setsize(r[row].getsize()+1);
+      B* aptr = implicitEntry(row,col);
+      if (aptr)
+        return *aptr;
 
-        //return reference to the newly created entry
-        return *apos;
-      }
+      //the row window is full, use the overflow area
+      return overflow[std::make_pair(row,col)];
     }
 
     //! Finishes the buildstage in implicit mode.
@@ -1327,14 +1660,7 @@ namespace Dune {
      */
     CompressionStatistics compress()
     {
-      if (build_mode!=implicit)
-        DUNE_THROW(BCRSMatrixError,"requires implicit build mode");
-      if (ready==built)
-        DUNE_THROW(BCRSMatrixError,"matrix already built up, no more need for compression");
-      if (ready==notAllocated)
-        DUNE_THROW(BCRSMatrixError,"matrix size not set and no memory allocated yet");
-      if (ready!=building)
-        DUNE_THROW(InvalidStateException,"You may only call compress() at the end of the 'building' stage");
+      checkCompress();
 
       //calculate statistics
       CompressionStatistics stats;
@@ -1442,10 +1768,29 @@ namespace Dune {
 
       //matrix is now built
       ready = built;
+      placeIfRequested();
 
       return stats;
     }
 
+    //! Finishes the buildstage in implicit mode using the threads of exec.
+    /**
+     * The rows are sorted and merged with the overflow area in
+     * parallel. Unlike compress(), the compressed matrix is written to
+     * newly allocated arrays, so the overflow area can never be
+     * exhausted, but the memory for the nonzeroes is needed twice
+     * while compressing.
+     *
+     * \returns An object with some statistics about the compression for
+     *          future optimization.
+     *
+     * \sa ConcurrentImplicitMatrixBuilder
+     */
+    CompressionStatistics compress(const ThreadExecutor& exec)
+    {
+      return compressParallel(exec,std::vector<const OverflowType*>(1,&overflow));
+    }
+
     //===== vector space arithmetic
 
     //! vector space multiplication with scalar
@@ -1587,38 +1932,35 @@ namespace Dune {
       if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,
                                  "Size mismatch: M: " << N() << "x" << M() << " y: " << y.N());
 #endif
-      ConstRowIterator endi=end();
-      for (ConstRowIterator i=begin(); i!=endi; ++i)
-      {
-        y[i.index()]=0;
-        ConstColIterator endj = (*i).end();
-        for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).umv(x[j.index()],y[i.index()]);
-      }
+      mvRows(x,y,0,n);
     }
 
-    //! y += A x
+    /** \brief y = A x, with the rows distributed over the threads of exec
+     *
+     * The rows are split into chunks holding roughly the same number of
+     * nonzero blocks. As every row is computed by exactly one thread the
+     * result is identical to the one of mv(const X&, Y&).
+     */
     template<class X, class Y>
-    void umv (const X& x, Y& y) const
+    void mv (const X& x, Y& y, const ThreadExecutor& exec) const
     {
 #ifdef DUNE_ISTL_WITH_CHECKING
       if (ready != built)
         DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
-      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
-      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,
+                                 "Size mismatch: M: " << N() << "x" << M() << " x: " << x.N());
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,
+                                 "Size mismatch: M: " << N() << "x" << M() << " y: " << y.N());
 #endif
-      ConstRowIterator endi=end();
-      for (ConstRowIterator i=begin(); i!=endi; ++i)
-      {
-        ConstColIterator endj = (*i).end();
-        for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).umv(x[j.index()],y[i.index()]);
-      }
+      if (!exec.parallel(n))
+        return mvRows(x,y,0,n);
+      exec.run(kernelPartition(exec.threads()),
+               [&](size_type begin, size_type end) { mvRows(x,y,begin,end); });
     }
 
-    //! y -= A x
+    //! y += A x
     template<class X, class Y>
-    void mmv (const X& x, Y& y) const
+    void umv (const X& x, Y& y) const
     {
 #ifdef DUNE_ISTL_WITH_CHECKING
       if (ready != built)
@@ -1626,18 +1968,12 @@ namespace Dune {
       if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
       if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
 #endif
-      ConstRowIterator endi=end();
-      for (ConstRowIterator i=begin(); i!=endi; ++i)
-      {
-        ConstColIterator endj = (*i).end();
-        for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).mmv(x[j.index()],y[i.index()]);
-      }
+      umvRows(x,y,0,n);
     }
 
-    //! y += alpha A x
-    template<class X, class Y, class F>
-    void usmv (F&& alpha, const X& x, Y& y) const
+    //! y += A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void umv (const X& x, Y& y, const ThreadExecutor& exec) const
     {
 #ifdef DUNE_ISTL_WITH_CHECKING
       if (ready != built)
@@ -1645,18 +1981,142 @@ namespace Dune {
       if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
       if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
 #endif
-      ConstRowIterator endi=end();
-      for (ConstRowIterator i=begin(); i!=endi; ++i)
-      {
-        ConstColIterator endj = (*i).end();
-        for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).usmv(alpha,x[j.index()],y[i.index()]);
-      }
+      if (!exec.parallel(n))
+        return umvRows(x,y,0,n);
+      exec.run(kernelPartition(exec.threads()),
+               [&](size_type begin, size_type end) { umvRows(x,y,begin,end); });
     }
 
-    //! y = A^T x
+    //! y -= A x
     template<class X, class Y>
-    void mtv (const X& x, Y& y) const
+    void mmv (const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      mmvRows(x,y,0,n);
+    }
+
+    //! y -= A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void mmv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      if (!exec.parallel(n))
+        return mmvRows(x,y,0,n);
+      exec.run(kernelPartition(exec.threads()),
+               [&](size_type begin, size_type end) { mmvRows(x,y,begin,end); });
+    }
+
+    //! y += alpha A x
+    template<class X, class Y, class F>
+    void usmv (F&& alpha, const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      usmvRows(alpha,x,y,0,n);
+    }
+
+    //! y += alpha A x, with the rows distributed over the threads of exec
+    template<class X, class Y, class F>
+    void usmv (F&& alpha, const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      if (!exec.parallel(n))
+        return usmvRows(alpha,x,y,0,n);
+      exec.run(kernelPartition(exec.threads()),
+               [&](size_type begin, size_type end) { usmvRows(alpha,x,y,begin,end); });
+    }
+
+    /**
+     * @brief y = A x, returning the scalar product \f$ x^H y \f$
+     *
+     * The scalar product is accumulated while the rows of y are
+     * computed, so y does not have to be read again. The matrix has to
+     * be square. The result equals x.dot(y) computed after mv(x,y).
+     */
+    template<class X, class Y>
+    typename Y::field_type mvdot (const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (N()!=M()) DUNE_THROW(BCRSMatrixError,"mvdot requires a square matrix");
+#endif
+      return mvdotRows(x,y,Imp::UnitWeights(),0,n);
+    }
+
+    /**
+     * @brief y = A x, returning the weighted scalar product \f$ \sum_i w_i x_i^H y_i \f$
+     *
+     * Used by parallel operators to compute the local part of a global
+     * scalar product, with w masking the indices not owned by the process.
+     */
+    template<class X, class Y, class W>
+    typename Y::field_type mvdot (const X& x, Y& y, const W& w) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (N()!=M()) DUNE_THROW(BCRSMatrixError,"mvdot requires a square matrix");
+#endif
+      return mvdotRows(x,y,w,0,n);
+    }
+
+    /**
+     * @brief y = A x, returning \f$ x^H y \f$, with the rows distributed over the threads of exec
+     *
+     * The partial sums of the chunks are added in chunk order, so the
+     * result only depends on the number of threads.
+     */
+    template<class X, class Y>
+    typename Y::field_type mvdot (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (N()!=M()) DUNE_THROW(BCRSMatrixError,"mvdot requires a square matrix");
+#endif
+      if (!exec.parallel(n))
+        return mvdotRows(x,y,Imp::UnitWeights(),0,n);
+
+      const RowPartition partition = kernelPartition(exec.threads());
+      std::vector<typename Y::field_type> partial(partition.chunks());
+      exec.runIndexed(partition, [&](size_type k, size_type begin, size_type end) {
+          partial[k] = mvdotRows(x,y,Imp::UnitWeights(),begin,end);
+        });
+      typename Y::field_type sum(0);
+      for (const auto& p : partial)
+        sum += p;
+      return sum;
+    }
+
+    //! y = A^T x
+    template<class X, class Y>
+    void mtv (const X& x, Y& y) const
     {
 #ifdef DUNE_ISTL_WITH_CHECKING
       if (ready != built)
@@ -1684,7 +2144,7 @@ namespace Dune {
       {
         ConstColIterator endj = (*i).end();
         for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).umtv(x[i.index()],y[j.index()]);
+          Kernel<X,Y>::umtv(*j,x[i.index()],y[j.index()]);
       }
     }
 
@@ -1701,7 +2161,7 @@ namespace Dune {
       {
         ConstColIterator endj = (*i).end();
         for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).mmtv(x[i.index()],y[j.index()]);
+          Kernel<X,Y>::mmtv(*j,x[i.index()],y[j.index()]);
       }
     }
 
@@ -1720,10 +2180,89 @@ namespace Dune {
       {
         ConstColIterator endj = (*i).end();
         for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-          (*j).usmtv(alpha,x[i.index()],y[j.index()]);
+          Kernel<X,Y>::usmtv(alpha,*j,x[i.index()],y[j.index()]);
       }
     }
 
+    /**
+     * @brief y = A^T x, with the work distributed over the threads of exec
+     *
+     * \sa umtv(const X&, Y&, const ThreadExecutor&)
+     */
+    template<class X, class Y>
+    void mtv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      for(size_type i=0; i<y.N(); ++i)
+        y[i]=0;
+      umtv(x,y,exec);
+    }
+
+    /**
+     * @brief y += A^T x, with the work distributed over the threads of exec
+     *
+     * The transposed product scatters into y, so the rows cannot simply
+     * be split between the threads. Depending on the size of the matrix
+     * and the number of threads one of two strategies is used:
+     *
+     * - If one copy of y per thread is not larger than the matrix, each
+     *   chunk of rows accumulates into a private copy of y and the
+     *   copies are added to y afterwards, split by columns. The result
+     *   only depends on the number of threads.
+     * - Otherwise the threads gather the columns of A using the
+     *   transposed pattern, which is built on the first call and cached
+     *   until the pattern of the matrix changes. The result is identical
+     *   to the one of umtv(const X&, Y&).
+     */
+    template<class X, class Y>
+    void umtv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      transposedProduct(x,y,exec,[](const B& a, const auto& xi, auto& yj) {
+          Kernel<X,Y>::umtv(a,xi,yj);
+        });
+    }
+
+    //! y -= A^T x, with the work distributed over the threads of exec
+    template<class X, class Y>
+    void mmtv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      transposedProduct(x,y,exec,[](const B& a, const auto& xi, auto& yj) {
+          Kernel<X,Y>::mmtv(a,xi,yj);
+        });
+    }
+
+    //! y += alpha A^T x, with the work distributed over the threads of exec
+    template<class X, class Y>
+    void usmtv (const field_type& alpha, const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built)
+        DUNE_THROW(BCRSMatrixError,"You can only call arithmetic operations on fully built BCRSMatrix instances");
+      if (x.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      transposedProduct(x,y,exec,[&](const B& a, const auto& xi, auto& yj) {
+          Kernel<X,Y>::usmtv(alpha,a,xi,yj);
+        });
+    }
+
     //! y += A^H x
     template<class X, class Y>
     void umhv (const X& x, Y& y) const
@@ -1911,6 +2450,50 @@ namespace Dune {
       return m;
     }
 
+    /**
+     * @brief The memory allocated and used by the matrix in bytes.
+     *
+     * Includes the row structures, the blocks and their column indices,
+     * the overflow area while building in implicit mode and the pattern
+     * cached by the threaded transposed products. In implicit mode the
+     * space reserved for the overflow remains allocated after compress(),
+     * it is reported as allocated but unused, in the same proportion as
+     * CompressionStatistics::mem_ratio. Column indices shared by copies of
+     * the matrix are counted for every copy. Blocks count with sizeof(B),
+     * memory they allocate themselves is not included. For a
+     * BCRSMatrixView only the memory owned by the matrix is reported.
+     */
+    MemoryUsage memoryUsage () const
+    {
+      MemoryUsage usage;
+      if (ready == notAllocated)
+        return usage;
+
+      // external arrays are not counted
+      const std::size_t entry = (externalValues_ ? 0 : sizeof(B))
+                                + (externalIndices_ ? 0 : sizeof(size_type));
+      std::size_t blocks = 0;
+      if (r)
+      {
+        usage += MemoryUsage(n*sizeof(row_type), n*sizeof(row_type));
+        for (size_type i=0; i<n; ++i)
+          blocks += r[i].getsize();
+      }
+      // rows allocated one by one hold exactly their blocks
+      usage += MemoryUsage((allocationSize_>0 ? allocationSize_ : blocks)*entry, blocks*entry);
+
+      // the nodes of the std::map hold the key, the block and the tree links
+      const std::size_t node = sizeof(typename OverflowType::value_type) + 4*sizeof(void*);
+      usage += MemoryUsage(overflow.size()*node, overflow.size()*entry);
+
+      if (const std::shared_ptr<const TransposedPattern> t = std::atomic_load(&transposed_))
+        usage += MemoryUsage((t->start.capacity()+t->rows.capacity())*sizeof(size_type)
+                             + t->blocks.capacity()*sizeof(const B*),
+                             (t->start.size()+t->rows.size())*sizeof(size_type)
+                             + t->blocks.size()*sizeof(const B*));
+      return usage;
+    }
+
     //! number of blocks that are stored (the number of blocks that possibly are nonzero)
     size_type nonzeroes () const
     {
@@ -1941,6 +2524,45 @@ namespace Dune {
       return (r[i].size() && r[i].find(j) != r[i].end());
     }
 
+    /**
+     * @brief The position of block (i,j) in the array returned by values().
+     *
+     * The offsets only depend on the sparsity pattern, they stay valid
+     * as long as the pattern is not rebuilt and also apply to copies of
+     * the matrix.
+     *
+     * @throw BCRSMatrixError if (i,j) is not in the pattern or the blocks
+     * are not stored in one array (row-wise build without number of nonzeroes).
+     */
+    size_type valueOffset (size_type i, size_type j) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (ready != built) DUNE_THROW(BCRSMatrixError,"value offsets require a fully built matrix");
+      if (i<0 || i>=n) DUNE_THROW(BCRSMatrixError,"row index out of range");
+      if (j<0 || j>=m) DUNE_THROW(BCRSMatrixError,"column index out of range");
+#endif
+      if (!a)
+        DUNE_THROW(BCRSMatrixError,"value offsets require the blocks to be stored in one array");
+      const size_type* begin = r[i].getindexptr();
+      const size_type* end = begin + r[i].getsize();
+      const size_type* pos = std::lower_bound(begin, end, j);
+      if (pos == end || *pos != j)
+        DUNE_THROW(BCRSMatrixError,"entry (" << i << "," << j << ") is not in the sparsity pattern");
+      return (r[i].getptr() - a) + (pos - begin);
+    }
+
+    //! The blocks of the matrix, stored row after row, or nullptr if they are allocated per row.
+    B* values ()
+    {
+      return a;
+    }
+
+    //! The blocks of the matrix, stored row after row, or nullptr if they are allocated per row.
+    const B* values () const
+    {
+      return a;
+    }
+
 
   protected:
     // state information
@@ -1977,7 +2599,411 @@ namespace Dune {
     typedef std::map<std::pair<size_type,size_type>, B> OverflowType;
     OverflowType overflow;
 
-    void setWindowPointers(ConstRowIterator row)
+    // the executor whose threads first touch the memory, if any
+    const ThreadExecutor* placementExec_ = nullptr;
+    // the partition used for the placement
+    RowPartition placement_;
+
+    // a, or j_, point into arrays owned by the caller, see BCRSMatrixView
+    bool externalValues_ = false;
+    bool externalIndices_ = false;
+
+    /**
+     * @brief The blocks of the matrix ordered by columns.
+     *
+     * The blocks of column j are blocks[k] in the rows rows[k] for
+     * start[j] <= k < start[j+1], ordered by row.
+     */
+    struct TransposedPattern
+    {
+      std::vector<size_type> start;
+      std::vector<size_type> rows;
+      std::vector<const B*> blocks;
+    };
+
+    // built by the first threaded transposed product, reset with the pattern
+    mutable std::shared_ptr<const TransposedPattern> transposed_;
+
+    //! Throws if the matrix is not ready for compress().
+    void checkCompress () const
+    {
+      if (build_mode!=implicit)
+        DUNE_THROW(BCRSMatrixError,"requires implicit build mode");
+      if (ready==built)
+        DUNE_THROW(BCRSMatrixError,"matrix already built up, no more need for compression");
+      if (ready==notAllocated)
+        DUNE_THROW(BCRSMatrixError,"matrix size not set and no memory allocated yet");
+      if (ready!=building)
+        DUNE_THROW(InvalidStateException,"You may only call compress() at the end of the 'building' stage");
+    }
+
+    /**
+     * @brief Find entry (row,col) in the row window or append it there.
+     *
+     * Returns nullptr if the entry is not present and the row window
+     * is full, the entry then belongs into an overflow area.
+     */
+    B* implicitEntry (size_type row, size_type col)
+    {
+      size_type* begin = r[row].getindexptr();
+      size_type* end = begin + r[row].getsize();
+
+      size_type* pos = std::find(begin, end, col);
+
+      //treat the case that there was a match in the array
+      if (pos != end)
+        return r[row].getptr() + (pos - begin);
+
+      //determine whether overflow has to be taken into account or not
+      if (r[row].getsize() == avg)
+        return nullptr;
+
+      //modify index array and increase rowsize
+      *end = col;
+      r[row].setsize(r[row].getsize()+1);
+
+      //return pointer to the newly created entry
+      return r[row].getptr() + (end - begin);
+    }
+
+    /**
+     * @brief Compress the matrix in parallel, merging several overflow areas.
+     *
+     * Entries for the same position in different overflow areas are
+     * summed up.
+     */
+    CompressionStatistics compressParallel (const ThreadExecutor& exec,
+                                            const std::vector<const OverflowType*>& overflows)
+    {
+      checkCompress();
+
+      CompressionStatistics stats;
+      stats.overflow_total = 0;
+      for (const OverflowType* o : overflows)
+        stats.overflow_total += o->size();
+      stats.maximum = 0;
+
+      const RowPartition partition(n, exec.parallel(n) ? exec.threads() : 1);
+      typedef typename OverflowType::const_iterator OverflowIterator;
+      typedef std::pair<size_type,const B*> Entry;
+
+      // collect the entries of row i sorted by column, entries with the
+      // same column from different overflow areas end up next to each other
+      auto gather = [&](size_type i, std::vector<Entry>& entries, std::vector<OverflowIterator>& cursors)
+      {
+        entries.clear();
+        const size_type* jptr = r[i].getindexptr();
+        const B* aptr = r[i].getptr();
+        for (size_type k=0; k<r[i].getsize(); ++k)
+          entries.emplace_back(jptr[k],aptr+k);
+        for (size_type o=0; o<overflows.size(); ++o)
+          for (OverflowIterator& it = cursors[o]; it!=overflows[o]->end() && it->first.first==i; ++it)
+            entries.emplace_back(it->first.second,&it->second);
+        std::stable_sort(entries.begin(),entries.end(),
+                         [](const Entry& x, const Entry& y) { return x.first < y.first; });
+      };
+      auto startCursors = [&](size_type begin, std::vector<OverflowIterator>& cursors)
+      {
+        cursors.resize(overflows.size());
+        for (size_type o=0; o<overflows.size(); ++o)
+          cursors[o] = overflows[o]->lower_bound(std::make_pair(begin,size_type(0)));
+      };
+
+      // count the distinct columns of each row
+      std::vector<size_type> start(n+1,0);
+      exec.run(partition, [&](size_type begin, size_type end) {
+          std::vector<Entry> entries;
+          std::vector<OverflowIterator> cursors;
+          startCursors(begin,cursors);
+          for (size_type i=begin; i<end; ++i)
+          {
+            gather(i,entries,cursors);
+            size_type size = 0;
+            for (size_type k=0; k<entries.size(); ++k)
+              if (k==0 || entries[k].first!=entries[k-1].first)
+                ++size;
+            start[i+1] = size;
+          }
+        });
+      for (size_type i=0; i<n; ++i)
+      {
+        stats.maximum = std::max(stats.maximum,start[i+1]);
+        start[i+1] += start[i];
+      }
+      const size_type total = start[n];
+
+      B* newA = total>0 ? allocator_.allocate(total) : nullptr;
+      size_type* newJ = total>0 ? sizeAllocator_.allocate(total) : nullptr;
+
+      // copy the sorted rows, the old row windows stay valid until the
+      // row has been copied
+      exec.run(partition, [&](size_type begin, size_type end) {
+          std::vector<Entry> entries;
+          std::vector<OverflowIterator> cursors;
+          startCursors(begin,cursors);
+          for (size_type i=begin; i<end; ++i)
+          {
+            gather(i,entries,cursors);
+            size_type pos = start[i];
+            for (size_type k=0; k<entries.size(); ++pos)
+            {
+              newJ[pos] = entries[k].first;
+              allocator_.construct(newA+pos,*entries[k].second);
+              for (++k; k<entries.size() && entries[k].first==newJ[pos]; ++k)
+                newA[pos] += *entries[k].second;
+            }
+            r[i].set(start[i+1]-start[i],newA+start[i],newJ+start[i]);
+          }
+        });
+
+      // release the old arrays but keep the rows
+      const size_type oldAllocationSize = allocationSize_;
+      const BuildMode mode = build_mode;
+      deallocate(false);
+      a = newA;
+      if (total>0)
+        j_.reset(newJ,Deallocator(sizeAllocator_));
+      nnz_ = allocationSize_ = total;
+      build_mode = mode;
+
+      // overflow area may be cleared
+      overflow.clear();
+
+      stats.avg = n>0 ? (double) (nnz_) / (double) n : 0.0;
+      stats.mem_ratio = oldAllocationSize>0 ? (double) (nnz_) / (double) oldAllocationSize : 1.0;
+
+      //matrix is now built
+      ready = built;
+      placeIfRequested();
+
+      return stats;
+    }
+
+    //! The partition used by the threaded kernels, the placement partition if it fits.
+    RowPartition kernelPartition (size_type threads) const
+    {
+      if (placement_.chunks() == threads && placement_.size() == n)
+        return placement_;
+      return nnzBalancedPartition(*this,threads);
+    }
+
+    void placeIfRequested ()
+    {
+      if (placementExec_)
+        placeMemory();
+      else
+        placement_ = RowPartition();
+    }
+
+    //! Move rows, values and column indices into memory first touched by the placement threads.
+    void placeMemory ()
+    {
+      const ThreadExecutor& exec = *placementExec_;
+      placement_ = nnzBalancedPartition(*this,exec.threads());
+      if (exec.threads() <= 1 || n == 0)
+        return;
+
+      // the positions of the rows in the new arrays
+      std::vector<size_type> start(n+1,0);
+      for (size_type i=0; i<n; ++i)
+        start[i+1] = start[i] + r[i].getsize();
+      const size_type total = start[n];
+
+      row_type* newR = rowAllocator_.allocate(n);
+      B* newA = total>0 ? allocator_.allocate(total) : nullptr;
+      size_type* newJ = total>0 ? sizeAllocator_.allocate(total) : nullptr;
+
+      exec.run(placement_, [&](size_type begin, size_type end) {
+          for (size_type i=begin; i<end; ++i)
+          {
+            rowAllocator_.construct(newR+i, row_type());
+            const size_type s = r[i].getsize();
+            if (s == 0)
+            {
+              newR[i].set(0,nullptr,nullptr);
+              continue;
+            }
+            for (size_type k=0; k<s; ++k)
+            {
+              allocator_.construct(newA+start[i]+k, r[i].getptr()[k]);
+              newJ[start[i]+k] = r[i].getindexptr()[k];
+            }
+            newR[i].set(s,newA+start[i],newJ+start[i]);
+          }
+        });
+
+      const BuildMode mode = build_mode;
+      deallocate();
+      r = newR;
+      a = newA;
+      if (total>0)
+        j_.reset(newJ,Deallocator(sizeAllocator_));
+      nnz_ = allocationSize_ = total;
+      build_mode = mode;
+      ready = built;
+    }
+
+    //! Apply op(A_ij, x_i, y_j) to all blocks of the rows [begin,end).
+    template<class X, class Y, class Op>
+    void transposedRows (const X& x, Y& y, const Op& op, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        const B* a = r[i].getptr();
+        const size_type* j = r[i].getindexptr();
+        for (size_type k=0; k<r[i].getsize(); ++k)
+          op(a[k],x[i],y[j[k]]);
+      }
+    }
+
+    //! Apply op(A_ij, x_i, y_j) to all blocks of A without races on y.
+    template<class X, class Y, class Op>
+    void transposedProduct (const X& x, Y& y, const ThreadExecutor& exec, const Op& op) const
+    {
+      if (!exec.parallel(n) || m == 0)
+        return transposedRows(x,y,op,0,n);
+
+      const size_type threads = exec.threads();
+      size_type blocks = 0;
+      for (size_type i=0; i<n; ++i)
+        blocks += r[i].getsize();
+
+      if (threads*m <= blocks)
+      {
+        // private copies of y, chunk 0 works on y itself
+        typedef typename std::decay<decltype(y[0])>::type YBlock;
+        const RowPartition partition = kernelPartition(threads);
+        std::vector<std::vector<YBlock> > partial(partition.chunks());
+        YBlock zero(y[0]);
+        zero = 0;
+        exec.runIndexed(partition, [&](size_type k, size_type begin, size_type end) {
+            if (k == 0)
+              return transposedRows(x,y,op,begin,end);
+            partial[k].assign(m,zero);
+            transposedRows(x,partial[k],op,begin,end);
+          });
+        exec.run(RowPartition(m,threads), [&](size_type begin, size_type end) {
+            for (size_type k=1; k<partial.size(); ++k)
+              for (size_type j=begin; j<end; ++j)
+                y[j] += partial[k][j];
+          });
+        return;
+      }
+
+      const std::shared_ptr<const TransposedPattern> t = transposedPattern();
+      // split the columns such that every thread gets the same number of blocks
+      std::vector<size_type> offsets(threads+1,m);
+      offsets[0] = 0;
+      for (size_type k=1; k<threads; ++k)
+        offsets[k] = std::lower_bound(t->start.begin()+offsets[k-1], t->start.end()-1,
+                                      (t->start[m]*k)/threads) - t->start.begin();
+      exec.run(RowPartition(std::move(offsets)), [&](size_type begin, size_type end) {
+          for (size_type j=begin; j<end; ++j)
+            for (size_type k=t->start[j]; k<t->start[j+1]; ++k)
+              op(*t->blocks[k],x[t->rows[k]],y[j]);
+        });
+    }
+
+    //! The cached transposed pattern, built if necessary.
+    std::shared_ptr<const TransposedPattern> transposedPattern () const
+    {
+      std::shared_ptr<const TransposedPattern> t = std::atomic_load(&transposed_);
+      if (t)
+        return t;
+
+      auto p = std::make_shared<TransposedPattern>();
+      p->start.assign(m+1,0);
+      for (size_type i=0; i<n; ++i)
+        for (size_type k=0; k<r[i].getsize(); ++k)
+          ++p->start[r[i].getindexptr()[k]+1];
+      for (size_type j=0; j<m; ++j)
+        p->start[j+1] += p->start[j];
+
+      p->rows.resize(p->start[m]);
+      p->blocks.resize(p->start[m]);
+      std::vector<size_type> next(p->start.begin(), p->start.end()-1);
+      for (size_type i=0; i<n; ++i)
+        for (size_type k=0; k<r[i].getsize(); ++k)
+        {
+          const size_type pos = next[r[i].getindexptr()[k]]++;
+          p->rows[pos] = i;
+          p->blocks[pos] = r[i].getptr()+k;
+        }
+
+      // if another thread was faster, both patterns are the same
+      t = std::move(p);
+      std::atomic_store(&transposed_,t);
+      return t;
+    }
+
+    //! The row kernels used for vectors of type X and Y.
+    template<class X, class Y>
+    using Kernel = Imp::BlockKernel<B,
+                                    typename std::decay<decltype(std::declval<const X&>()[0])>::type,
+                                    typename std::decay<decltype(std::declval<Y&>()[0])>::type>;
+
+    //! y = A x restricted to the rows [begin,end)
+    template<class X, class Y>
+    void mvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        y[i]=0;
+        const row_type& row = r[i];
+        Kernel<X,Y>::umvRow(row.getptr(),row.getindexptr(),row.getsize(),x,y[i]);
+      }
+    }
+
+    //! y += A x restricted to the rows [begin,end)
+    template<class X, class Y>
+    void umvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        const row_type& row = r[i];
+        Kernel<X,Y>::umvRow(row.getptr(),row.getindexptr(),row.getsize(),x,y[i]);
+      }
+    }
+
+    //! y -= A x restricted to the rows [begin,end)
+    template<class X, class Y>
+    void mmvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        const row_type& row = r[i];
+        Kernel<X,Y>::mmvRow(row.getptr(),row.getindexptr(),row.getsize(),x,y[i]);
+      }
+    }
+
+    //! y += alpha A x restricted to the rows [begin,end)
+    template<class X, class Y, class F>
+    void usmvRows (const F& alpha, const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        const row_type& row = r[i];
+        Kernel<X,Y>::usmvRow(alpha,row.getptr(),row.getindexptr(),row.getsize(),x,y[i]);
+      }
+    }
+
+    //! y = A x restricted to the rows [begin,end), returning the weighted x^H y on these rows
+    template<class X, class Y, class W>
+    typename Y::field_type mvdotRows (const X& x, Y& y, const W& w, size_type begin, size_type end) const
+    {
+      typename Y::field_type sum(0);
+      for (size_type i=begin; i<end; ++i)
+      {
+        y[i]=0;
+        const row_type& row = r[i];
+        Kernel<X,Y>::umvRow(row.getptr(),row.getindexptr(),row.getsize(),x,y[i]);
+        sum += Imp::weighted(w,i,x[i].dot(y[i]));
+      }
+      return sum;
+    }
+
+    template<class Iter>
+    void setWindowPointers(Iter row)
     {
       row_type current_row(a,j_.get(),0); // Pointers to current row data
       for (size_type i=0; i<n; i++, ++row) {
@@ -2057,6 +3083,117 @@ namespace Dune {
       // finish off
       build_mode = row_wise; // dummy
       ready = built;
+      placeIfRequested();
+    }
+
+    /**
+     * @brief Use external CSR arrays as rows, column indices and values.
+     *
+     * The values are used in place. So are the column indices if they
+     * are stored as size_type, otherwise they are converted into an own
+     * array. Only the row structures are allocated.
+     */
+    template<class RowIndex, class ColIndex>
+    void setExternalCSR (size_type rows, size_type cols, const RowIndex* rowStart,
+                         ColIndex* colIndices, B* values)
+    {
+      for (size_type i=0; i<rows; ++i)
+      {
+        if (rowStart[i+1] < rowStart[i])
+          DUNE_THROW(BCRSMatrixError,"The row start " << rowStart[i+1] << " of row " << i+1
+                     << " is before the one of row " << i);
+#ifdef DUNE_ISTL_WITH_CHECKING
+        for (RowIndex k=rowStart[i]; k<rowStart[i+1]; ++k)
+          if (size_type(colIndices[k])>=cols || (k>rowStart[i] && colIndices[k]<=colIndices[k-1]))
+            DUNE_THROW(BCRSMatrixError,"The columns of row " << i << " are not sorted or out of range");
+#endif
+      }
+
+      deallocate();
+      const size_type offset = rowStart[0];
+      n = rows;
+      m = cols;
+      nnz_ = allocationSize_ = size_type(rowStart[rows]) - offset;
+      a = values + offset;
+      externalValues_ = true;
+      setExternalIndices(colIndices + offset);
+
+      r = n>0 ? rowAllocator_.allocate(n) : nullptr;
+      for (size_type i=0; i<n; ++i)
+      {
+        rowAllocator_.construct(r+i, row_type());
+        const size_type begin = size_type(rowStart[i]) - offset;
+        const size_type size = size_type(rowStart[i+1]) - size_type(rowStart[i]);
+        if (size>0)
+          r[i].set(size, a+begin, j_.get()+begin);
+        else
+          r[i].set(0,nullptr,nullptr);
+      }
+
+      build_mode = row_wise; // dummy
+      ready = built;
+      placement_ = RowPartition();
+    }
+
+    //! Use column indices of size_type in place.
+    void setExternalIndices (size_type* colIndices)
+    {
+      j_.reset(colIndices, [](size_type*) {});
+      externalIndices_ = true;
+    }
+
+    //! Convert column indices of another type into an own array.
+    template<class ColIndex>
+    void setExternalIndices (const ColIndex* colIndices)
+    {
+      if (nnz_>0)
+      {
+        j_.reset(sizeAllocator_.allocate(nnz_),Deallocator(sizeAllocator_));
+        std::copy(colIndices, colIndices+nnz_, j_.get());
+      }
+      externalIndices_ = false;
+    }
+
+    //! Take over the memory and the state of Mat and leave it empty. The own memory must be freed.
+    void moveFrom (BCRSMatrix& Mat)
+    {
+      build_mode = Mat.build_mode;
+      ready = Mat.ready;
+      allocator_ = std::move(Mat.allocator_);
+      rowAllocator_ = std::move(Mat.rowAllocator_);
+      sizeAllocator_ = std::move(Mat.sizeAllocator_);
+      n = Mat.n;
+      m = Mat.m;
+      nnz_ = Mat.nnz_;
+      allocationSize_ = Mat.allocationSize_;
+      r = Mat.r;
+      a = Mat.a;
+      j_ = std::move(Mat.j_);
+      avg = Mat.avg;
+      overflowsize = Mat.overflowsize;
+      overflow = std::move(Mat.overflow);
+      placementExec_ = Mat.placementExec_;
+      placement_ = std::move(Mat.placement_);
+      externalValues_ = Mat.externalValues_;
+      externalIndices_ = Mat.externalIndices_;
+      // the cached pattern points into a and stays valid
+      std::atomic_store(&transposed_,std::atomic_exchange(&Mat.transposed_,std::shared_ptr<const TransposedPattern>()));
+
+      Mat.build_mode = unknown;
+      Mat.ready = notAllocated;
+      Mat.n = 0;
+      Mat.m = 0;
+      Mat.nnz_ = 0;
+      Mat.allocationSize_ = 0;
+      Mat.r = nullptr;
+      Mat.a = nullptr;
+      Mat.avg = 0;
+      Mat.overflowsize = -1.0;
+      Mat.overflow.clear();
+      Mat.placementExec_ = nullptr;
+      Mat.placement_ = RowPartition();
+      Mat.externalValues_ = false;
+      Mat.externalIndices_ = false;
     }
 
     /**
@@ -2066,11 +3203,19 @@ namespace Dune {
      */
     void deallocate(bool deallocateRows=true)
     {
+      std::atomic_store(&transposed_,std::shared_ptr<const TransposedPattern>());
 
       if (notAllocated)
         return;
 
-      if (allocationSize_>0)
+      if (externalValues_)
+      {
+        // the values belong to the caller, j_ knows whether the indices do
+        j_.reset();
+        a = nullptr;
+        externalValues_ = externalIndices_ = false;
+      }
+      else if (allocationSize_>0)
       {
         // a,j_ have been allocated as one long vector
         j_.reset();
@@ -2229,6 +3374,70 @@ namespace Dune {
     }
   };
 
+  /**
+   * @brief A BCRSMatrix working on CSR arrays owned by someone else.
+   *
+   * Row i of the matrix consists of the blocks
+   * values[rowStart[i]],...,values[rowStart[i+1]-1] in the columns
+   * colIndices[rowStart[i]],...,colIndices[rowStart[i+1]-1], which have to
+   * be sorted within each row. The values are used in place, and so are
+   * the column indices if they are stored as BCRSMatrix::size_type. Column
+   * indices of another type, e.g. int, are converted into an array owned
+   * by the view. Only the n row structures are allocated. The arrays have
+   * to outlive the view, changes of the values are visible on both sides.
+   *
+   * Like BlockVectorWindow for vectors, the view is a BCRSMatrix and can be
+   * passed wherever one is expected. Use BCRSMatrix<B,A> as the matrix type
+   * of operators, preconditioners and AMG, as some of them are specialized
+   * for it:
+   * \code
+   * typedef BCRSMatrix<FieldMatrix<double,1,1> > M;
+   * // the legacy arrays, scalars are layout compatible with 1x1 blocks
+   * BCRSMatrixView<FieldMatrix<double,1,1> > A(n, n, rowptr, colind,
+   *     reinterpret_cast<FieldMatrix<double,1,1>*>(val));
+   * MatrixAdapter<M,V,V> op(A);
+   * SeqILU0<M,V,V> ilu(A,1.0);
+   * \endcode
+   * Copies of the view are ordinary BCRSMatrix objects with their own
+   * memory. The pattern of the view cannot be changed, setting up a new
+   * pattern through the BCRSMatrix interface releases the external arrays.
+   */
+  template<class B, class A=std::allocator<B> >
+  class BCRSMatrixView : public BCRSMatrix<B,A>
+  {
+  public:
+    //! The type for the index access and the size.
+    typedef typename BCRSMatrix<B,A>::size_type size_type;
+
+    using BCRSMatrix<B,A>::operator=;
+
+    //! An empty view.
+    BCRSMatrixView () = default;
+
+    /**
+     * @brief Refer to the given CSR arrays.
+     * @param rows The number of block rows.
+     * @param cols The number of block columns.
+     * @param rowStart The rows+1 offsets of the rows in the other arrays.
+     * @param colIndices The column index of each block.
+     * @param values The blocks.
+     */
+    template<class RowIndex, class ColIndex>
+    BCRSMatrixView (size_type rows, size_type cols, const RowIndex* rowStart,
+                    ColIndex* colIndices, B* values)
+    {
+      this->setExternalCSR(rows, cols, rowStart, colIndices, values);
+    }
+
+    //! Refer to other CSR arrays, see the constructor.
+    template<class RowIndex, class ColIndex>
+    void set (size_type rows, size_type cols, const RowIndex* rowStart,
+              ColIndex* colIndices, B* values)
+    {
+      this->setExternalCSR(rows, cols, rowStart, colIndices, values);
+    }
+  };
+
 
   /** @} end documentation */
 
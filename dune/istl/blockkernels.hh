@@ -0,0 +1,370 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_BLOCKKERNELS_HH
+#define DUNE_ISTL_BLOCKKERNELS_HH
+
+#include <cstddef>
+#include <type_traits>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#if !defined(DUNE_ISTL_NO_SIMD_KERNELS) && defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define DUNE_ISTL_HAVE_AVX2_KERNELS 1
+#if defined(__AVX512F__)
+#define DUNE_ISTL_HAVE_AVX512_KERNELS 1
+#endif
+#endif
+
+/*! \file
+ * \brief Kernels for the products of a sparse block row with a vector.
+ *
+ * The sparse matrices call these kernels for each row instead of
+ * looping over the blocks themselves. For small square blocks of
+ * doubles or floats acting on vectors of doubles the kernels keep the
+ * partial sums of a whole row in registers and use AVX2 or AVX-512
+ * instructions if the compiler targets them. Define DUNE_ISTL_NO_SIMD_KERNELS to use the portable
+ * implementation only.
+ */
+
+namespace Dune {
+  namespace Imp {
+
+    /**
+     * @brief Products of small dense n x n blocks stored row-wise with
+     * vectors of doubles.
+     *
+     * The entries of the blocks are of type K, i.e. double or float. All
+     * sums are computed in double. The generic version is plain C++.
+     * Specializations for AVX2 and AVX-512 follow below.
+     */
+    template<class K, int n>
+    struct SmallBlockOps
+    {
+      //! t = sum_k a_k x_{j_k}, with a_k the k-th block of n*n entries
+      template<class X, class S>
+      static void rowProduct (const K* a, const S* j, S count, const X& x, double* t)
+      {
+        for (int r=0; r<n; ++r)
+          t[r] = 0;
+        for (S k=0; k<count; ++k, a+=n*n)
+        {
+          const double* xk = &x[j[k]][0];
+          for (int r=0; r<n; ++r)
+            for (int c=0; c<n; ++c)
+              t[r] += a[r*n+c]*xk[c];
+        }
+      }
+
+      //! y += a^T x for a single block
+      static void transposedProduct (const K* a, const double* x, double* y)
+      {
+        for (int r=0; r<n; ++r)
+          for (int c=0; c<n; ++c)
+            y[c] += a[r*n+c]*x[r];
+      }
+    };
+
+#ifdef DUNE_ISTL_HAVE_AVX2_KERNELS
+    // load four entries and convert them to double if necessary
+    inline __m256d load4 (const double* a)
+    {
+      return _mm256_loadu_pd(a);
+    }
+
+    inline __m256d load4 (const float* a)
+    {
+      return _mm256_cvtps_pd(_mm_loadu_ps(a));
+    }
+
+    // load three entries, without touching the memory behind them
+    inline __m256d load3 (const double* a)
+    {
+      return _mm256_maskload_pd(a,_mm256_set_epi64x(0,-1,-1,-1));
+    }
+
+    inline __m256d load3 (const float* a)
+    {
+      return _mm256_cvtps_pd(_mm_maskload_ps(a,_mm_set_epi32(0,-1,-1,-1)));
+    }
+
+#ifdef DUNE_ISTL_HAVE_AVX512_KERNELS
+    inline __m512d load8 (const double* a)
+    {
+      return _mm512_loadu_pd(a);
+    }
+
+    inline __m512d load8 (const float* a)
+    {
+      return _mm512_cvtps_pd(_mm256_loadu_ps(a));
+    }
+#endif
+
+    // sum up the lanes of each of the four registers: t[i] = sum(ti)
+    inline void horizontalSum (__m256d t0, __m256d t1, __m256d t2, __m256d t3, double* t)
+    {
+      const __m256d s01 = _mm256_hadd_pd(t0,t1);
+      const __m256d s23 = _mm256_hadd_pd(t2,t3);
+      const __m256d lo = _mm256_permute2f128_pd(s01,s23,0x20);
+      const __m256d hi = _mm256_permute2f128_pd(s01,s23,0x31);
+      _mm256_storeu_pd(t,_mm256_add_pd(lo,hi));
+    }
+
+    template<class K>
+    struct SmallBlockOps<K,2>
+    {
+      // A whole block [a00 a01 a10 a11] fits into one register.
+      template<class X, class S>
+      static void rowProduct (const K* a, const S* j, S count, const X& x, double* t)
+      {
+        __m256d acc = _mm256_setzero_pd();
+        for (S k=0; k<count; ++k, a+=4)
+        {
+          const __m256d xk = _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(&x[j[k]][0]));
+          acc = _mm256_fmadd_pd(load4(a),xk,acc);
+        }
+        const __m256d s = _mm256_hadd_pd(acc,acc);
+        t[0] = _mm256_cvtsd_f64(s);
+        t[1] = _mm_cvtsd_f64(_mm256_extractf128_pd(s,1));
+      }
+
+      static void transposedProduct (const K* a, const double* x, double* y)
+      {
+        const __m256d xr = _mm256_set_pd(x[1],x[1],x[0],x[0]);
+        const __m256d p = _mm256_mul_pd(load4(a),xr);
+        const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(p),_mm256_extractf128_pd(p,1));
+        _mm_storeu_pd(y,_mm_add_pd(_mm_loadu_pd(y),s));
+      }
+    };
+
+    template<class K>
+    struct SmallBlockOps<K,3>
+    {
+      // Rows of three entries are loaded with a mask, so that no memory
+      // beyond the last block is touched.
+      template<class X, class S>
+      static void rowProduct (const K* a, const S* j, S count, const X& x, double* t)
+      {
+        __m256d t0 = _mm256_setzero_pd();
+        __m256d t1 = _mm256_setzero_pd();
+        __m256d t2 = _mm256_setzero_pd();
+        for (S k=0; k<count; ++k, a+=9)
+        {
+          const __m256d xk = load3(&x[j[k]][0]);
+          t0 = _mm256_fmadd_pd(load3(a),xk,t0);
+          t1 = _mm256_fmadd_pd(load3(a+3),xk,t1);
+          t2 = _mm256_fmadd_pd(load3(a+6),xk,t2);
+        }
+        double s[4];
+        horizontalSum(t0,t1,t2,_mm256_setzero_pd(),s);
+        t[0] = s[0];
+        t[1] = s[1];
+        t[2] = s[2];
+      }
+
+      static void transposedProduct (const K* a, const double* x, double* y)
+      {
+        __m256d yv = load3(y);
+        yv = _mm256_fmadd_pd(load3(a),_mm256_broadcast_sd(x),yv);
+        yv = _mm256_fmadd_pd(load3(a+3),_mm256_broadcast_sd(x+1),yv);
+        yv = _mm256_fmadd_pd(load3(a+6),_mm256_broadcast_sd(x+2),yv);
+        _mm256_maskstore_pd(y,_mm256_set_epi64x(0,-1,-1,-1),yv);
+      }
+    };
+
+    template<class K>
+    struct SmallBlockOps<K,4>
+    {
+      template<class X, class S>
+      static void rowProduct (const K* a, const S* j, S count, const X& x, double* t)
+      {
+#ifdef DUNE_ISTL_HAVE_AVX512_KERNELS
+        // two rows per register
+        __m512d t01 = _mm512_setzero_pd();
+        __m512d t23 = _mm512_setzero_pd();
+        for (S k=0; k<count; ++k, a+=16)
+        {
+          const __m512d xk = _mm512_broadcast_f64x4(_mm256_loadu_pd(&x[j[k]][0]));
+          t01 = _mm512_fmadd_pd(load8(a),xk,t01);
+          t23 = _mm512_fmadd_pd(load8(a+8),xk,t23);
+        }
+        horizontalSum(_mm512_castpd512_pd256(t01),_mm512_extractf64x4_pd(t01,1),
+                      _mm512_castpd512_pd256(t23),_mm512_extractf64x4_pd(t23,1),t);
+#else
+        __m256d t0 = _mm256_setzero_pd();
+        __m256d t1 = _mm256_setzero_pd();
+        __m256d t2 = _mm256_setzero_pd();
+        __m256d t3 = _mm256_setzero_pd();
+        for (S k=0; k<count; ++k, a+=16)
+        {
+          const __m256d xk = _mm256_loadu_pd(&x[j[k]][0]);
+          t0 = _mm256_fmadd_pd(load4(a),xk,t0);
+          t1 = _mm256_fmadd_pd(load4(a+4),xk,t1);
+          t2 = _mm256_fmadd_pd(load4(a+8),xk,t2);
+          t3 = _mm256_fmadd_pd(load4(a+12),xk,t3);
+        }
+        horizontalSum(t0,t1,t2,t3,t);
+#endif
+      }
+
+      static void transposedProduct (const K* a, const double* x, double* y)
+      {
+        __m256d yv = _mm256_loadu_pd(y);
+        yv = _mm256_fmadd_pd(load4(a),_mm256_broadcast_sd(x),yv);
+        yv = _mm256_fmadd_pd(load4(a+4),_mm256_broadcast_sd(x+1),yv);
+        yv = _mm256_fmadd_pd(load4(a+8),_mm256_broadcast_sd(x+2),yv);
+        yv = _mm256_fmadd_pd(load4(a+12),_mm256_broadcast_sd(x+3),yv);
+        _mm256_storeu_pd(y,yv);
+      }
+    };
+#endif // DUNE_ISTL_HAVE_AVX2_KERNELS
+
+    /**
+     * @brief The products of a sparse block row with a vector.
+     *
+     * A row consists of count blocks a[k] in the columns j[k]. This
+     * generic version uses the products of the block type.
+     *
+     * \tparam B The block type of the matrix.
+     * \tparam XB The block type of the vector x.
+     * \tparam YB The block type of the vector y.
+     */
+    template<class B, class XB, class YB, class = void>
+    struct BlockKernel
+    {
+      //! y += sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void umvRow (const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          a[k].umv(x[j[k]],y);
+      }
+
+      //! y -= sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void mmvRow (const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          a[k].mmv(x[j[k]],y);
+      }
+
+      //! y += alpha sum_k a[k] x[j[k]]
+      template<class F, class X, class S>
+      static void usmvRow (const F& alpha, const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          a[k].usmv(alpha,x[j[k]],y);
+      }
+
+      //! y += a^T x
+      static void umtv (const B& a, const XB& x, YB& y)
+      {
+        a.umtv(x,y);
+      }
+
+      //! y -= a^T x
+      static void mmtv (const B& a, const XB& x, YB& y)
+      {
+        a.mmtv(x,y);
+      }
+
+      //! y += alpha a^T x
+      template<class F>
+      static void usmtv (const F& alpha, const B& a, const XB& x, YB& y)
+      {
+        a.usmtv(alpha,x,y);
+      }
+    };
+
+    /**
+     * @brief Kernels for FieldMatrix<K,n,n> blocks and vectors of doubles.
+     *
+     * The sum over a row is accumulated separately and added to y at
+     * the end, so the rounding differs slightly from the generic kernels.
+     * With K=float the matrix entries are converted on the fly and all
+     * arithmetic is done in double.
+     */
+    template<class K, int n>
+    struct SmallBlockKernel
+    {
+      typedef FieldMatrix<K,n,n> B;
+      typedef FieldVector<double,n> V;
+
+      static_assert(sizeof(B) == n*n*sizeof(K) && sizeof(V) == n*sizeof(double),
+                    "The blocks have to be stored without padding");
+
+      template<class X, class S>
+      static void umvRow (const B* a, const S* j, S count, const X& x, V& y)
+      {
+        double t[n];
+        SmallBlockOps<K,n>::rowProduct(&a[0][0][0],j,count,x,t);
+        for (int r=0; r<n; ++r)
+          y[r] += t[r];
+      }
+
+      template<class X, class S>
+      static void mmvRow (const B* a, const S* j, S count, const X& x, V& y)
+      {
+        double t[n];
+        SmallBlockOps<K,n>::rowProduct(&a[0][0][0],j,count,x,t);
+        for (int r=0; r<n; ++r)
+          y[r] -= t[r];
+      }
+
+      template<class F, class X, class S>
+      static void usmvRow (const F& alpha, const B* a, const S* j, S count, const X& x, V& y)
+      {
+        double t[n];
+        SmallBlockOps<K,n>::rowProduct(&a[0][0][0],j,count,x,t);
+        for (int r=0; r<n; ++r)
+          y[r] += alpha*t[r];
+      }
+
+      static void umtv (const B& a, const V& x, V& y)
+      {
+        SmallBlockOps<K,n>::transposedProduct(&a[0][0],&x[0],&y[0]);
+      }
+
+      static void mmtv (const B& a, const V& x, V& y)
+      {
+        usmtv(-1.0,a,x,y);
+      }
+
+      template<class F>
+      static void usmtv (const F& alpha, const B& a, const V& x, V& y)
+      {
+        V ax;
+        for (int r=0; r<n; ++r)
+          ax[r] = alpha*x[r];
+        umtv(a,ax,y);
+      }
+    };
+
+    template<class K, int n>
+    struct BlockKernel<FieldMatrix<K,n,n>, FieldVector<double,n>, FieldVector<double,n>,
+                       typename std::enable_if<(n>=2 && n<=4)
+                                               && (std::is_same<K,double>::value
+                                                   || std::is_same<K,float>::value)>::type>
+      : public SmallBlockKernel<K,n>
+    {};
+
+    //! The weights of an unweighted scalar product, see BCRSMatrix::mvdot
+    struct UnitWeights {};
+
+    template<class T>
+    const T& weighted (const UnitWeights&, std::size_t, const T& d)
+    {
+      return d;
+    }
+
+    template<class W, class T>
+    T weighted (const W& w, std::size_t i, const T& d)
+    {
+      return d*w[i];
+    }
+
+  } // end namespace Imp
+} // end namespace Dune
+
+#endif
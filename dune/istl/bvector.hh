@@ -4,17 +4,23 @@
 #ifndef DUNE_ISTL_BVECTOR_HH
 #define DUNE_ISTL_BVECTOR_HH
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <memory>
 #include <limits>
+#include <vector>
 
 #include <dune/common/promotiontraits.hh>
 #include <dune/common/dotproduct.hh>
 #include <dune/common/ftraits.hh>
+#include <dune/common/unused.hh>
 
 #include "istlexception.hh"
 #include "basearray.hh"
+#include "memoryusage.hh"
+#include "reduction.hh"
+#include "threadexecutor.hh"
 
 /*! \file
 
@@ -174,6 +180,29 @@ namespace Imp {
       return sum;
     }
 
+    /**
+     * @brief vector dot product \f$\left (x^H \cdot y \right)\f$, with the blocks distributed over the threads of exec
+     *
+     * The result is bitwise the same for any number of threads, but
+     * may differ from dot(y) by rounding, see Imp::reproducibleSum().
+     * @param y other (compatible) vector
+     * @param exec The threads to use.
+     * @param summation Plain or compensated summation.
+     */
+    template<class OtherB, class OtherA>
+    typename PromotionTraits<field_type,typename OtherB::field_type>::PromotedType
+    dot (const block_vector_unmanaged<OtherB,OtherA>& y, const ThreadExecutor& exec,
+         Summation summation = Summation::plain) const
+    {
+      typedef typename PromotionTraits<field_type,typename OtherB::field_type>::PromotedType PromotedType;
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (this->n!=y.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+      return Imp::reproducibleSum<PromotedType>(this->n, [&](size_type i) {
+          return ((*this)[i]).dot(y[i]);
+        }, exec, summation);
+    }
+
     //===== norms
 
     //! one norm (sum over absolute values of entries)
@@ -208,6 +237,32 @@ namespace Imp {
       return sum;
     }
 
+    //! one norm, with the blocks distributed over the threads of exec, reproducible as dot()
+    typename FieldTraits<field_type>::real_type
+    one_norm (const ThreadExecutor& exec, Summation summation = Summation::plain) const
+    {
+      return Imp::reproducibleSum<typename FieldTraits<field_type>::real_type>(this->n, [&](size_type i) {
+          return (*this)[i].one_norm();
+        }, exec, summation);
+    }
+
+    //! two norm, with the blocks distributed over the threads of exec, reproducible as dot()
+    typename FieldTraits<field_type>::real_type
+    two_norm (const ThreadExecutor& exec, Summation summation = Summation::plain) const
+    {
+      using std::sqrt;
+      return sqrt(two_norm2(exec,summation));
+    }
+
+    //! Square of the two-norm, with the blocks distributed over the threads of exec, reproducible as dot()
+    typename FieldTraits<field_type>::real_type
+    two_norm2 (const ThreadExecutor& exec, Summation summation = Summation::plain) const
+    {
+      return Imp::reproducibleSum<typename FieldTraits<field_type>::real_type>(this->n, [&](size_type i) {
+          return (*this)[i].two_norm2();
+        }, exec, summation);
+    }
+
     //! infinity norm (maximum of absolute values of entries)
     template <typename ft = field_type,
               typename std::enable_if<!has_nan<ft>::value, int>::type = 0>
@@ -274,6 +329,45 @@ namespace Imp {
       return norm * isNaN;
     }
 
+    /**
+     * @brief infinity norm, with the blocks distributed over the threads of exec
+     *
+     * The maximum does not depend on the order of the blocks, so the
+     * result is the same as that of infinity_norm(), including NaN.
+     */
+    typename FieldTraits<field_type>::real_type infinity_norm (const ThreadExecutor& exec) const
+    {
+      typedef typename FieldTraits<field_type>::real_type real_type;
+      using std::max;
+
+      const RowPartition partition(this->n, exec.parallel(this->n) ? exec.threads() : 1);
+      std::vector<real_type> partial(partition.chunks(), real_type(0));
+      exec.runIndexed(partition, [&](size_type k, size_type begin, size_type end) {
+          real_type norm = 0;
+          for (size_type i=begin; i<end; ++i)
+          {
+            const real_type a = (*this)[i].infinity_norm();
+            // a NaN is kept, as max() would drop it
+            if (a != a)
+            {
+              norm = a;
+              break;
+            }
+            norm = max(a, norm);
+          }
+          partial[k] = norm;
+        });
+
+      real_type norm = 0;
+      for (const real_type& a : partial)
+      {
+        if (a != a)
+          return a;
+        norm = max(a, norm);
+      }
+      return norm;
+    }
+
     //===== sizes
 
     //! number of blocks in the vector (are of size 1 here)
@@ -422,6 +516,34 @@ namespace Imp {
     }
 
 
+    /**
+     * @brief Make vector with _n components placed in memory by the threads of exec.
+     *
+     * The blocks of chunk k of the partition are constructed, and thus
+     * first touched, by the thread running chunk k in exec. With the
+     * partition of the matrix the vector is used with, e.g.
+     * BCRSMatrix::placement(), each thread of the threaded products
+     * then works on memory local to its NUMA node.
+     *
+     * Copies of the vector are placed the same way, reserve() drops the
+     * placement. The executor has to outlive the vector.
+     */
+    BlockVector (size_type _n, const RowPartition& partition, const ThreadExecutor& exec)
+      : placement_(std::make_shared<RowPartition>(partition)), placementExec_(&exec)
+    {
+      if (partition.size() != _n)
+        DUNE_THROW(ISTLError,"the partition does not cover the vector");
+      this->n = _n;
+      capacity_ = _n;
+      if (capacity_>0)
+        placeBlocks(nullptr);
+      else
+      {
+        this->p = 0;
+        this->n = 0;
+      }
+    }
+
     /**
      * @brief Reserve space.
      *
@@ -472,9 +594,22 @@ namespace Imp {
         }
 
         capacity_ = capacity;
+        placement_.reset();
+        placementExec_ = nullptr;
       }
     }
 
+    /**
+     * @brief The partition the blocks were placed in memory with.
+     *
+     * Has zero chunks if the vector was not placed explicitly.
+     */
+    const RowPartition& placement() const
+    {
+      static const RowPartition none;
+      return placement_ ? *placement_ : none;
+    }
+
     /**
      * @brief Get the capacity of the vector.
      *
@@ -486,6 +621,16 @@ namespace Imp {
       return capacity_;
     }
 
+    /**
+     * @brief The memory allocated for the blocks and the part holding the N() blocks.
+     *
+     * Blocks count with sizeof(B), memory they allocate themselves is not included.
+     */
+    MemoryUsage memoryUsage () const
+    {
+      return MemoryUsage(capacity_*sizeof(B), this->n*sizeof(B));
+    }
+
     /**
      * @brief Resize the vector.
      *
@@ -513,12 +658,19 @@ namespace Imp {
 
     //! copy constructor
     BlockVector (const BlockVector& a) :
-      Imp::block_vector_unmanaged<B,A>(a)
+      Imp::block_vector_unmanaged<B,A>(a),
+      placement_(a.placement_), placementExec_(a.placementExec_)
     {
       // allocate memory with same size as a
       this->n = a.n;
       capacity_ = a.capacity_;
 
+      if (capacity_>0 && placement_) {
+        // copy elements in the threads owning them
+        placeBlocks(a.p);
+        return;
+      }
+
       if (capacity_>0) {
         this->p = this->allocator_.allocate(capacity_);
         new (this->p)B[capacity_];
@@ -532,6 +684,18 @@ namespace Imp {
       for (size_type i=0; i<this->n; i++) this->p[i]=a.p[i];
     }
 
+    /**
+     * @brief move constructor
+     *
+     * Takes over the blocks of a, which is left empty.
+     */
+    BlockVector (BlockVector&& a) noexcept :
+      Imp::block_vector_unmanaged<B,A>(),
+      capacity_(0)
+    {
+      moveFrom(a);
+    }
+
     //! free dynamic memory
     ~BlockVector ()
     {
@@ -558,6 +722,13 @@ namespace Imp {
             this->allocator_.deallocate(this->p,capacity_);                     // free old memory
           }
           capacity_ = a.capacity_;
+          placement_ = a.placement_;
+          placementExec_ = a.placementExec_;
+          if (capacity_>0 && placement_) {
+            this->n = a.n;
+            placeBlocks(a.p);
+            return *this;
+          }
           if (capacity_>0) {
             this->p = this->allocator_.allocate(capacity_);
             new (this->p)B[capacity_];
@@ -575,6 +746,22 @@ namespace Imp {
       return *this;
     }
 
+    //! move assignment, frees the own blocks and takes over the ones of a
+    BlockVector& operator= (BlockVector&& a) noexcept
+    {
+      if (&a!=this)
+      {
+        if (capacity_>0) {
+          int i=capacity_;
+          while (i)
+            this->p[--i].~B();
+          this->allocator_.deallocate(this->p,capacity_);
+        }
+        moveFrom(a);
+      }
+      return *this;
+    }
+
     //! assign from scalar
     BlockVector& operator= (const field_type& k)
     {
@@ -598,6 +785,46 @@ namespace Imp {
 
     A allocator_;
 
+  private:
+    //! Take over the blocks and the placement of a and leave it empty. The own blocks must be freed.
+    void moveFrom (BlockVector& a)
+    {
+      this->p = a.p;
+      this->n = a.n;
+      capacity_ = a.capacity_;
+      allocator_ = std::move(a.allocator_);
+      placement_ = std::move(a.placement_);
+      placementExec_ = a.placementExec_;
+      a.p = nullptr;
+      a.n = 0;
+      a.capacity_ = 0;
+      a.placement_.reset();
+      a.placementExec_ = nullptr;
+    }
+
+    //! Allocate capacity_ blocks and construct them chunk-wise in the placement threads.
+    void placeBlocks (const B* src)
+    {
+      B* p = this->allocator_.allocate(capacity_);
+      const size_type n = this->n;
+      auto construct = [&](size_type begin, size_type end) {
+        for (size_type i=begin; i<end; ++i)
+          if (src && i<n)
+            new (p+i) B(src[i]);
+          else
+            new (p+i) B();
+      };
+      const size_type placed = std::min(placement_->size(),capacity_);
+      placementExec_->run(*placement_, [&](size_type begin, size_type end) {
+          construct(std::min(begin,placed),std::min(end,placed));
+        });
+      construct(placed,capacity_);
+      this->p = p;
+    }
+
+    // the partition and the executor the blocks were placed with, if any
+    std::shared_ptr<const RowPartition> placement_;
+    const ThreadExecutor* placementExec_ = nullptr;
   };
 
   /** @} */
@@ -627,6 +854,220 @@ namespace Imp {
     return s;
   }
 
+  namespace Imp {
+
+    template<class B, class A>
+    std::true_type isBlockVector (const block_vector_unmanaged<B,A>*);
+    std::false_type isBlockVector (...);
+
+    //! Whether V is a BlockVector, or another vector derived from block_vector_unmanaged.
+    template<class V>
+    using IsBlockVector = decltype(isBlockVector(std::declval<V*>()));
+
+    //! Whether T is a scalar entry of a vector with field type K.
+    template<class T, class K>
+    using IsEntry = std::is_same<typename std::decay<T>::type,K>;
+
+    template<class K, class F, class V, class... Vs>
+    void fusedForEach (std::true_type, F& f, V&& v, Vs&&... vs)
+    {
+      f(v,vs...);
+    }
+
+    template<class K, class F, class V, class... Vs>
+    void fusedForEach (std::false_type, F& f, V&& v, Vs&&... vs)
+    {
+      for (std::size_t i=0; i<v.N(); ++i)
+        fusedForEach<K>(IsEntry<decltype(v[i]),K>(), f, v[i], vs[i]...);
+    }
+
+    template<class R, class K, class F, class V, class... Vs>
+    R fusedSum (std::true_type, F& f, V&& v, Vs&&... vs)
+    {
+      return f(v,vs...);
+    }
+
+    template<class R, class K, class F, class V, class... Vs>
+    R fusedSum (std::false_type, F& f, V&& v, Vs&&... vs)
+    {
+      R sum = 0;
+      for (std::size_t i=0; i<v.N(); ++i)
+        sum += fusedSum<R,K>(IsEntry<decltype(v[i]),K>(), f, v[i], vs[i]...);
+      return sum;
+    }
+
+    template<class V, class... Vs>
+    void checkFusedSizes (const V& v, const Vs&... vs)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      for (std::size_t n : std::initializer_list<std::size_t>{vs.N()...})
+        if (n!=v.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#else
+      DUNE_UNUSED_PARAMETER(v);
+      DUNE_UNUSED_PARAMETER(std::initializer_list<int>{(DUNE_UNUSED_PARAMETER(vs),0)...});
+#endif
+    }
+
+    //! The squared absolute value of a real or complex entry.
+    template<class K>
+    K absSquare (const K& x)
+    {
+      return x*x;
+    }
+
+    template<class K>
+    K absSquare (const std::complex<K>& x)
+    {
+      return x.real()*x.real() + x.imag()*x.imag();
+    }
+
+  } // end namespace Imp
+
+  /**
+   * @brief Apply f to the entries of several vectors in a single pass.
+   *
+   * Calls f(v_k,vs_k...) for every scalar entry v_k of v and the entries
+   * at the same position of the vectors vs, which must have the same
+   * block structure as v, e.g. BlockVectors of FieldVectors. Several
+   * BLAS-1 operations can be combined this way, so that each vector is
+   * streamed through memory only once:
+   * \code
+   * // x += a*p and r -= a*q
+   * fusedForEach([a](auto& x, const auto& p, auto& r, const auto& q) {
+   *     x += a*p;
+   *     r += (-a)*q;
+   *   }, x, p, r, q);
+   * \endcode
+   * The blocks are processed by simple loops without any dependencies
+   * between the entries, which the compiler can vectorize.
+   */
+  template<class F, class V, class... Vs>
+  void fusedForEach (F&& f, V&& v, Vs&&... vs)
+  {
+    typedef typename std::decay<V>::type::field_type K;
+    Imp::checkFusedSizes(v,vs...);
+    Imp::fusedForEach<K>(std::false_type(), f, v, vs...);
+  }
+
+  /**
+   * @brief Apply f to the entries of several vectors in a single pass and sum the results.
+   *
+   * Like fusedForEach(), but returns the sum of the values returned by f,
+   * converted to R. The partial sums of each block are added in the same
+   * order as by the norms and scalar products of the vectors, so e.g.
+   * \code
+   * fusedSum<double>([a](auto& r, const auto& q) {
+   *     r += (-a)*q;
+   *     return r*r;
+   *   }, r, q);
+   * \endcode
+   * returns r.two_norm2() of the updated real vector r.
+   */
+  template<class R, class F, class V, class... Vs>
+  R fusedSum (F&& f, V&& v, Vs&&... vs)
+  {
+    typedef typename std::decay<V>::type::field_type K;
+    Imp::checkFusedSizes(v,vs...);
+    return Imp::fusedSum<R,K>(std::false_type(), f, v, vs...);
+  }
+
+  /**
+   * @brief Compute x += a*p and r -= a*q in a single pass and return the new r.two_norm2().
+   *
+   * This is the update of the iterate and the defect in CG-like solvers
+   * together with the convergence check. For BlockVectors, the same
+   * floating point operations as in x.axpy(a,p), r.axpy(-a,q) and
+   * r.two_norm2() are done in the same order, so the results only differ
+   * if the compiler contracts them into fused multiply-adds.
+   */
+  template<class V>
+  typename FieldTraits<typename V::field_type>::real_type
+  fusedAxpyNorm2 (V& x, const typename V::field_type& a, const V& p, V& r, const V& q)
+  {
+    typedef typename V::field_type K;
+    const K minusA = -a;
+    return fusedSum<typename FieldTraits<K>::real_type>([a,minusA](K& xk, const K& pk, K& rk, const K& qk) {
+        xk += a*pk;
+        rk += minusA*qk;
+        return Imp::absSquare(rk);
+      }, x, p, r, q);
+  }
+
+  namespace Imp {
+
+    //! The number of blocks processed for all vectors by fusedDots() and fusedAxpys() at a time.
+    constexpr std::size_t fusedChunk = 256;
+
+    template<class V>
+    void checkFusedSizes (const std::vector<const V*>& vs, const V& y)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      for (const V* v : vs)
+        if (v->N()!=y.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#else
+      DUNE_UNUSED_PARAMETER(vs);
+      DUNE_UNUSED_PARAMETER(y);
+#endif
+    }
+
+  } // end namespace Imp
+
+  /**
+   * @brief Compute the dot products of all vectors vs with y in a single pass over y.
+   *
+   * Stores vs[k]->dot(y) in dots[k]. Like a dense transposed
+   * matrix-vector product with the vectors of vs as the columns, the
+   * blocks are processed in chunks, and each chunk of y is used for
+   * all vectors of vs while it is in the cache. The terms of each
+   * product are added in the same order as by dot(), so the results
+   * are bitwise the same.
+   */
+  template<class V>
+  void fusedDots (const std::vector<const V*>& vs, const V& y, std::vector<typename V::field_type>& dots)
+  {
+    typedef typename V::field_type K;
+    Imp::checkFusedSizes(vs,y);
+    dots.assign(vs.size(),K(0));
+    for (std::size_t begin=0; begin<y.N(); begin+=Imp::fusedChunk)
+    {
+      const std::size_t end = std::min(y.N(),begin+Imp::fusedChunk);
+      for (std::size_t k=0; k<vs.size(); ++k)
+      {
+        const V& v = *vs[k];
+        K sum = dots[k];
+        for (std::size_t i=begin; i<end; ++i)
+          sum += v[i].dot(y[i]);
+        dots[k] = sum;
+      }
+    }
+  }
+
+  /**
+   * @brief Compute y += sum_k a[k] vs[k] in a single pass over y.
+   *
+   * The counterpart of fusedDots(), e.g. for the projections of the
+   * Gram-Schmidt method. Each entry of y is updated by the vectors of
+   * vs in their order, so the result is bitwise that of the separate
+   * y.axpy(a[k],*vs[k]).
+   */
+  template<class V>
+  void fusedAxpys (V& y, const std::vector<typename V::field_type>& a, const std::vector<const V*>& vs)
+  {
+    typedef typename V::field_type K;
+    Imp::checkFusedSizes(vs,y);
+    for (std::size_t begin=0; begin<y.N(); begin+=Imp::fusedChunk)
+    {
+      const std::size_t end = std::min(y.N(),begin+Imp::fusedChunk);
+      for (std::size_t k=0; k<vs.size(); ++k)
+      {
+        const V& v = *vs[k];
+        const K ak = a[k];
+        for (std::size_t i=begin; i<end; ++i)
+          y[i].axpy(ak,v[i]);
+      }
+    }
+  }
+
 /** \brief Everything in this namespace is internal to dune-istl, and may change without warning */
 namespace Imp {
 
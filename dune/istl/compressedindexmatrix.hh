@@ -0,0 +1,380 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_COMPRESSEDINDEXMATRIX_HH
+#define DUNE_ISTL_COMPRESSEDINDEXMATRIX_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <dune/common/unused.hh>
+
+#include "istlexception.hh"
+#include "bcrsmatrix.hh"
+#include "blockkernels.hh"
+#include "threadexecutor.hh"
+
+/*! \file
+ * \brief A read-only copy of a BCRSMatrix with compressed column indices.
+ */
+
+namespace Dune {
+
+  namespace Imp {
+
+    /**
+     * @brief Access to a vector with indices relative to a fixed position.
+     *
+     * Lets the row kernels decode column indices given as offsets from
+     * the diagonal on the fly.
+     */
+    template<class X>
+    class ShiftedVector
+    {
+    public:
+      ShiftedVector (const X& x, std::size_t shift)
+        : x_(x), shift_(shift)
+      {}
+
+      const typename std::decay<decltype(std::declval<const X&>()[0])>::type&
+      operator[] (std::int16_t d) const
+      {
+        return x_[shift_+d];
+      }
+
+    private:
+      const X& x_;
+      std::size_t shift_;
+    };
+
+  } // end namespace Imp
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief A read-only sparse matrix storing compact column indices.
+   *
+   * BCRSMatrix stores one size_type, usually 8 bytes, per block as column
+   * index, which for scalar matrices is as much memory traffic as the
+   * values. This format stores the column indices of a row as 16 bit
+   * offsets from the diagonal if all of them fit, and as 32 bit column
+   * numbers otherwise. Banded matrices, e.g. from structured grids or
+   * after a bandwidth reducing reordering, thus need 2 bytes per index.
+   * The indices are decoded on the fly in the matrix-vector products,
+   * which use the same row kernels as BCRSMatrix.
+   *
+   * The matrix is built from a fully built BCRSMatrix and does not
+   * support changing the values or the pattern afterwards. It can be
+   * used with MatrixAdapter to obtain a LinearOperator.
+   *
+   * \tparam B The block type.
+   * \tparam A The allocator used for the blocks.
+   */
+  template<class B, class A=std::allocator<B> >
+  class CompressedIndexMatrix
+  {
+  public:
+    //! export the type representing the field
+    typedef typename B::field_type field_type;
+
+    //! export the type representing the components
+    typedef B block_type;
+
+    //! export the allocator type
+    typedef A allocator_type;
+
+    //! The type for the index access and the size
+    typedef typename A::size_type size_type;
+
+    //! The type of the column offsets relative to the diagonal.
+    typedef std::int16_t narrow_index_type;
+
+    //! The type of the column indices of rows whose offsets do not fit.
+    typedef std::uint32_t wide_index_type;
+
+    enum {
+      //! The number of blocklevels the matrix contains.
+      blocklevel = B::blocklevel+1
+    };
+
+    //! An empty matrix.
+    CompressedIndexMatrix ()
+      : n_(0), m_(0), rowStart_(1,0), wideStart_(1,0)
+    {}
+
+    //! Build from a BCRSMatrix, which has to be fully built.
+    template<class OtherA>
+    explicit CompressedIndexMatrix (const BCRSMatrix<B,OtherA>& mat)
+      : CompressedIndexMatrix()
+    {
+      assign(mat);
+    }
+
+    /**
+     * @brief Rebuild from a BCRSMatrix, discarding the previous content.
+     *
+     * @throw BCRSMatrixError if a column index does not fit into wide_index_type.
+     */
+    template<class OtherA>
+    void assign (const BCRSMatrix<B,OtherA>& mat)
+    {
+      typedef BCRSMatrix<B,OtherA> Matrix;
+      if (mat.buildStage() != Matrix::built)
+        DUNE_THROW(BCRSMatrixError,"CompressedIndexMatrix can only be built from a fully built BCRSMatrix");
+      if (mat.M() > size_type(std::numeric_limits<wide_index_type>::max())+1)
+        DUNE_THROW(BCRSMatrixError,"the column indices do not fit into 32 bits");
+
+      n_ = mat.N();
+      m_ = mat.M();
+      rowStart_.assign(1,0);
+      wideStart_.assign(1,0);
+      values_.clear();
+      narrow_.clear();
+      wide_.clear();
+
+      const std::ptrdiff_t lo = std::numeric_limits<narrow_index_type>::min();
+      const std::ptrdiff_t hi = std::numeric_limits<narrow_index_type>::max();
+      for (auto row = mat.begin(); row != mat.end(); ++row)
+      {
+        const std::ptrdiff_t i = row.index();
+        bool narrow = row->size() <= size_type(hi);
+        for (auto col = row->begin(); narrow && col != row->end(); ++col)
+        {
+          const std::ptrdiff_t d = std::ptrdiff_t(col.index()) - i;
+          narrow = lo <= d && d <= hi;
+        }
+
+        for (auto col = row->begin(); col != row->end(); ++col)
+        {
+          values_.push_back(*col);
+          if (narrow)
+            narrow_.push_back(narrow_index_type(std::ptrdiff_t(col.index()) - i));
+          else
+            wide_.push_back(wide_index_type(col.index()));
+        }
+        rowStart_.push_back(values_.size());
+        wideStart_.push_back(wide_.size());
+      }
+    }
+
+    //===== linear maps
+
+    //! y = A x
+    template<class X, class Y>
+    void mv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      mvRows(x,y,0,n_);
+    }
+
+    //! y = A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void mv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      if (!exec.parallel(n_))
+        return mvRows(x,y,0,n_);
+      exec.run(rowPartition(exec.threads()),
+               [&](size_type begin, size_type end) { mvRows(x,y,begin,end); });
+    }
+
+    //! y += A x
+    template<class X, class Y>
+    void umv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      umvRows(x,y,0,n_);
+    }
+
+    //! y += A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void umv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      if (!exec.parallel(n_))
+        return umvRows(x,y,0,n_);
+      exec.run(rowPartition(exec.threads()),
+               [&](size_type begin, size_type end) { umvRows(x,y,begin,end); });
+    }
+
+    //! y -= A x
+    template<class X, class Y>
+    void mmv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      mmvRows(x,y,0,n_);
+    }
+
+    //! y += alpha A x
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      usmvRows(alpha,x,y,0,n_);
+    }
+
+    //! y += alpha A x, with the rows distributed over the threads of exec
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      if (!exec.parallel(n_))
+        return usmvRows(alpha,x,y,0,n_);
+      exec.run(rowPartition(exec.threads()),
+               [&](size_type begin, size_type end) { usmvRows(alpha,x,y,begin,end); });
+    }
+
+    //===== sizes
+
+    //! number of rows (counted in blocks)
+    size_type N () const
+    {
+      return n_;
+    }
+
+    //! number of columns (counted in blocks)
+    size_type M () const
+    {
+      return m_;
+    }
+
+    //! number of nonzero blocks
+    size_type nonzeroes () const
+    {
+      return values_.size();
+    }
+
+    //! number of blocks whose column is stored with 32 bits
+    size_type wideEntries () const
+    {
+      return wide_.size();
+    }
+
+    //! the memory used for the column indices and row offsets in bytes
+    size_type indexBytes () const
+    {
+      return narrow_.size()*sizeof(narrow_index_type) + wide_.size()*sizeof(wide_index_type)
+             + (rowStart_.size()+wideStart_.size())*sizeof(size_type);
+    }
+
+  private:
+    //! The row kernels used for vectors of type X and Y.
+    template<class X, class Y>
+    using Kernel = Imp::BlockKernel<B,
+                                    typename std::decay<decltype(std::declval<const X&>()[0])>::type,
+                                    typename std::decay<decltype(std::declval<Y&>()[0])>::type>;
+
+    // Call f(a,j,count,xrow) with the blocks of row i, their decoded
+    // columns and the vector to index with them.
+    template<class X, class F>
+    void visitRow (size_type i, const X& x, F&& f) const
+    {
+      const B* a = values_.data() + rowStart_[i];
+      const size_type wideBegin = wideStart_[i];
+      const size_type wideCount = wideStart_[i+1] - wideBegin;
+      if (wideCount > 0)
+        f(a, wide_.data() + wideBegin, wide_index_type(wideCount), x);
+      else
+        // the narrow indices of row i start after all narrow indices of the rows before
+        f(a, narrow_.data() + (rowStart_[i] - wideBegin),
+          narrow_index_type(rowStart_[i+1] - rowStart_[i]), Imp::ShiftedVector<X>(x,i));
+    }
+
+    template<class X, class Y>
+    void mvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        y[i] = 0;
+        visitRow(i, x, [&](const B* a, const auto* j, auto count, const auto& xr) {
+            Kernel<X,Y>::umvRow(a,j,count,xr,y[i]);
+          });
+      }
+    }
+
+    template<class X, class Y>
+    void umvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+        visitRow(i, x, [&](const B* a, const auto* j, auto count, const auto& xr) {
+            Kernel<X,Y>::umvRow(a,j,count,xr,y[i]);
+          });
+    }
+
+    template<class X, class Y>
+    void mmvRows (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+        visitRow(i, x, [&](const B* a, const auto* j, auto count, const auto& xr) {
+            Kernel<X,Y>::mmvRow(a,j,count,xr,y[i]);
+          });
+    }
+
+    template<class F, class X, class Y>
+    void usmvRows (const F& alpha, const X& x, Y& y, size_type begin, size_type end) const
+    {
+      for (size_type i=begin; i<end; ++i)
+        visitRow(i, x, [&](const B* a, const auto* j, auto count, const auto& xr) {
+            Kernel<X,Y>::usmvRow(alpha,a,j,count,xr,y[i]);
+          });
+    }
+
+    template<class X, class Y>
+    void checkSizes (const X& x, const Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#else
+      DUNE_UNUSED_PARAMETER(x);
+      DUNE_UNUSED_PARAMETER(y);
+#endif
+    }
+
+    // split the rows such that every thread gets the same number of blocks,
+    // with every row weighted by its number of blocks plus one
+    RowPartition rowPartition (size_type threads) const
+    {
+      std::vector<size_type> offsets(threads+1,n_);
+      offsets[0] = 0;
+      auto work = [&](size_type i) { return rowStart_[i] + i; };
+      for (size_type t=1; t<threads; ++t)
+      {
+        const size_type target = (work(n_)*t)/threads;
+        size_type lo = offsets[t-1], hi = n_;
+        while (lo<hi)
+        {
+          const size_type mid = (lo+hi)/2;
+          if (work(mid)<target)
+            lo = mid+1;
+          else
+            hi = mid;
+        }
+        offsets[t] = lo;
+      }
+      return RowPartition(std::move(offsets));
+    }
+
+    size_type n_;
+    size_type m_;
+    // the blocks of row i are values_[rowStart_[i]] ... values_[rowStart_[i+1]-1]
+    std::vector<size_type> rowStart_;
+    // rows with wideStart_[i+1] > wideStart_[i] store their columns in wide_,
+    // all other rows store offsets from the diagonal in narrow_
+    std::vector<size_type> wideStart_;
+    std::vector<narrow_index_type> narrow_;
+    std::vector<wide_index_type> wide_;
+    std::vector<B,A> values_;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
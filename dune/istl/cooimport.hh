@@ -0,0 +1,257 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_COOIMPORT_HH
+#define DUNE_ISTL_COOIMPORT_HH
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+
+#include "bcrsmatrix.hh"
+#include "istlexception.hh"
+#include "threadexecutor.hh"
+
+/*! \file
+ * \brief Building a BCRSMatrix from coordinate (COO) triplets.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  //! How importCOO() treats several triplets for the same position.
+  enum class DuplicateEntries {
+    //! The values are summed up, in the order of the triplets.
+    sum,
+    //! A BCRSMatrixError is thrown.
+    error
+  };
+
+  namespace Imp {
+
+    /**
+     * @brief Stable parallel LSD radix sort of keys, carrying order along.
+     *
+     * Sorts one byte per pass. Each chunk of the partition counts its
+     * digits and scatters its entries to offsets computed from all
+     * counts, so equal keys keep their relative order for any number of
+     * threads. Passes in which all keys share the digit are skipped.
+     */
+    template<class K>
+    void radixSort (std::vector<K>& keys, std::vector<K>& order, K maxKey,
+                    const ThreadExecutor& exec)
+    {
+      typedef std::size_t size_type;
+      const size_type count = keys.size();
+      const RowPartition partition(count, exec.parallel(count) ? exec.threads() : 1);
+      const size_type chunks = partition.chunks();
+      std::vector<K> sortedKeys(count), sortedOrder(count);
+      std::vector<std::array<size_type,256> > offsets(chunks);
+
+      for (size_type shift=0; shift<8*sizeof(K) && (maxKey>>shift)>0; shift+=8)
+      {
+        auto digit = [shift](K key) { return size_type((key>>shift) & 255); };
+
+        exec.runIndexed(partition, [&](size_type c, size_type begin, size_type end) {
+            offsets[c].fill(0);
+            for (size_type k=begin; k<end; ++k)
+              ++offsets[c][digit(keys[k])];
+          });
+
+        // turn the counts into the first position of each chunk and digit
+        size_type position = 0;
+        bool trivial = false;
+        for (size_type d=0; d<256; ++d)
+          for (size_type c=0; c<chunks; ++c)
+          {
+            const size_type n = offsets[c][d];
+            trivial = trivial || n==count;
+            offsets[c][d] = position;
+            position += n;
+          }
+        if (trivial)
+          continue;
+
+        exec.runIndexed(partition, [&](size_type c, size_type begin, size_type end) {
+            std::array<size_type,256>& offset = offsets[c];
+            for (size_type k=begin; k<end; ++k)
+            {
+              const size_type pos = offset[digit(keys[k])]++;
+              sortedKeys[pos] = keys[k];
+              sortedOrder[pos] = order[k];
+            }
+          });
+        keys.swap(sortedKeys);
+        order.swap(sortedOrder);
+      }
+    }
+
+    //! Writes the rows, column indices and values of a BCRSMatrix from triplets.
+    template<class M>
+    struct COOImport
+    {
+      typedef typename M::size_type size_type;
+      typedef typename M::block_type block_type;
+
+      template<class I, class V>
+      static void apply (M& matrix, size_type rows, size_type cols,
+                         const I* rowIndices, const I* colIndices, const V* values, size_type count,
+                         DuplicateEntries duplicates, const ThreadExecutor& exec)
+      {
+        if (rows>0 && cols>std::numeric_limits<size_type>::max()/rows)
+          DUNE_THROW(BCRSMatrixError,"A " << rows << "x" << cols << " matrix is too large for importCOO()");
+
+        const RowPartition partition(count, exec.parallel(count) ? exec.threads() : 1);
+        const size_type chunks = partition.chunks();
+
+        // sort the positions i*cols+j, which orders by row and then by column
+        std::vector<size_type> keys(count), order(count);
+        exec.run(partition, [&](size_type begin, size_type end) {
+            for (size_type k=begin; k<end; ++k)
+            {
+              const size_type i = rowIndices[k], j = colIndices[k];
+              if (i>=rows || j>=cols)
+                DUNE_THROW(BCRSMatrixError,"Triplet " << k << " at (" << i << "," << j
+                           << ") is outside of the " << rows << "x" << cols << " matrix");
+              keys[k] = i*cols + j;
+              order[k] = k;
+            }
+          });
+        radixSort(keys, order, rows*cols>0 ? rows*cols-1 : 0, exec);
+
+        // number the distinct positions, the first triplet of each owns it
+        auto first = [&](size_type k) { return k==0 || keys[k]!=keys[k-1]; };
+        std::vector<size_type> distinct(chunks+1,0);
+        exec.runIndexed(partition, [&](size_type c, size_type begin, size_type end) {
+            for (size_type k=begin; k<end; ++k)
+              if (first(k))
+                ++distinct[c+1];
+              else if (duplicates==DuplicateEntries::error)
+                DUNE_THROW(BCRSMatrixError,"Duplicate triplet at (" << keys[k]/cols << ","
+                           << keys[k]%cols << ")");
+          });
+        for (size_type c=0; c<chunks; ++c)
+          distinct[c+1] += distinct[c];
+        const size_type nnz = distinct[chunks];
+
+        matrix.deallocate();
+        matrix.allocate(rows, cols, nnz, true, false);
+        block_type* a = nnz>0 ? matrix.allocator_.allocate(nnz) : nullptr;
+        matrix.a = a;
+        size_type* j = matrix.j_.get();
+
+        // write the blocks and the row starts, every start is set exactly once
+        std::vector<size_type> start(rows+1);
+        exec.runIndexed(partition, [&](size_type c, size_type begin, size_type end) {
+            size_type pos = distinct[c];
+            for (size_type k=begin; k<end; ++k)
+            {
+              if (!first(k))
+                continue;
+              const size_type row = keys[k]/cols;
+              const size_type previous = k==0 ? 0 : keys[k-1]/cols + 1;
+              for (size_type i=previous; i<=row; ++i)
+                start[i] = pos;
+
+              V value = values[order[k]];
+              for (size_type l=k+1; l<count && keys[l]==keys[k]; ++l)
+                value += values[order[l]];
+              matrix.allocator_.construct(a+pos, block_type());
+              a[pos] = value;
+              j[pos] = keys[k]%cols;
+              ++pos;
+            }
+          });
+        for (size_type i=(count>0 ? keys[count-1]/cols+1 : 0); i<=rows; ++i)
+          start[i] = nnz;
+
+        const RowPartition rowPartition(rows, exec.parallel(rows) ? exec.threads() : 1);
+        exec.run(rowPartition, [&](size_type begin, size_type end) {
+            for (size_type i=begin; i<end; ++i)
+            {
+              matrix.rowAllocator_.construct(matrix.r+i, typename M::row_type());
+              if (start[i+1]>start[i])
+                matrix.r[i].set(start[i+1]-start[i], a+start[i], j+start[i]);
+              else
+                matrix.r[i].set(0,nullptr,nullptr);
+            }
+          });
+
+        matrix.build_mode = M::row_wise; // dummy
+        matrix.ready = M::built;
+        matrix.placeIfRequested();
+      }
+    };
+
+  } // end namespace Imp
+
+  /**
+   * @brief Build a BCRSMatrix from coordinate triplets.
+   *
+   * Triplet k sets the block at (rowIndices[k],colIndices[k]) to
+   * values[k]. The triplets may come in any order. They are sorted by
+   * a parallel radix sort on the threads of exec, and rows, column
+   * indices and blocks are then written directly, each into a single
+   * allocation. Triplets for the same position are summed in their
+   * input order, so the result does not depend on the number of
+   * threads.
+   *
+   * A value may be a block or a scalar, which is assigned as in
+   * A[i][j] = value. Any previous content of the matrix is discarded.
+   *
+   * \code
+   * std::vector<std::size_t> i = {0, 1, 0, 1}, j = {0, 1, 1, 1};
+   * std::vector<double> v = {4.0, 4.0, -1.0, 1.0};
+   * BCRSMatrix<FieldMatrix<double,1,1> > A;
+   * importCOO(A, 2, 2, i.data(), j.data(), v.data(), v.size()); // A[1][1] == 5
+   * \endcode
+   *
+   * @param matrix The matrix to build.
+   * @param rows The number of block rows.
+   * @param cols The number of block columns.
+   * @param rowIndices The block row of each triplet.
+   * @param colIndices The block column of each triplet.
+   * @param values The value of each triplet.
+   * @param count The number of triplets.
+   * @param duplicates Whether duplicate positions are summed or rejected.
+   * @param exec The threads used for sorting and writing.
+   * @throws BCRSMatrixError if an index is out of range or a duplicate is rejected.
+   */
+  template<class B, class A, class I, class V>
+  void importCOO (BCRSMatrix<B,A>& matrix,
+                  typename BCRSMatrix<B,A>::size_type rows,
+                  typename BCRSMatrix<B,A>::size_type cols,
+                  const I* rowIndices, const I* colIndices, const V* values,
+                  typename BCRSMatrix<B,A>::size_type count,
+                  DuplicateEntries duplicates = DuplicateEntries::sum,
+                  const ThreadExecutor& exec = ThreadExecutor::global())
+  {
+    Imp::COOImport<BCRSMatrix<B,A> >::apply(matrix, rows, cols, rowIndices, colIndices,
+                                            values, count, duplicates, exec);
+  }
+
+  //! Build a BCRSMatrix from triplets stored in three vectors of the same length.
+  template<class B, class A, class I, class V, class VA>
+  void importCOO (BCRSMatrix<B,A>& matrix,
+                  typename BCRSMatrix<B,A>::size_type rows,
+                  typename BCRSMatrix<B,A>::size_type cols,
+                  const std::vector<I>& rowIndices, const std::vector<I>& colIndices,
+                  const std::vector<V,VA>& values,
+                  DuplicateEntries duplicates = DuplicateEntries::sum,
+                  const ThreadExecutor& exec = ThreadExecutor::global())
+  {
+    if (rowIndices.size()!=values.size() || colIndices.size()!=values.size())
+      DUNE_THROW(BCRSMatrixError,"importCOO() needs as many row and column indices as values");
+    importCOO(matrix, rows, cols, rowIndices.data(), colIndices.data(), values.data(),
+              values.size(), duplicates, exec);
+  }
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
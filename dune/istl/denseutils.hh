@@ -0,0 +1,407 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_DENSEUTILS_HH
+#define DUNE_ISTL_DENSEUTILS_HH
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/*! \file
+ * \brief Small dense factorizations and eigensolvers used by the Krylov solvers.
+ *
+ * The s-step, block and recycling solvers of solvers.hh work on small
+ * dense matrices, e.g. Gram matrices or projected operators, stored as
+ * vectors of rows. These helpers are internal and may change at any time.
+ */
+
+namespace Dune {
+
+  namespace Imp {
+
+    //! The complex conjugate of a real number, i.e. the number itself
+    template<class K>
+    K conjugate (const K& k)
+    {
+      return k;
+    }
+
+    template<class K>
+    std::complex<K> conjugate (const std::complex<K>& k)
+    {
+      return std::conj(k);
+    }
+
+    /*
+     * Cholesky factorization G = L L^H of the Hermitian positive
+     * semi-definite matrix G, in place into the lower triangle of G, the
+     * upper triangle is not used. The factorization stops at the first
+     * column whose squared pivot is not larger than tol times the largest
+     * diagonal entry. Returns the number of the columns factorized.
+     */
+    template<class K, class R>
+    std::size_t choleskyFactor (std::vector<std::vector<K> >& G, std::size_t n, const R& tol)
+    {
+      using std::max;
+      using std::real;
+      using std::sqrt;
+      R maxDiag(0);
+      for (std::size_t i=0; i<n; ++i)
+        maxDiag = max(maxDiag,R(real(G[i][i])));
+      for (std::size_t j=0; j<n; ++j)
+      {
+        R d = real(G[j][j]);
+        for (std::size_t k=0; k<j; ++k)
+          d -= real(G[j][k]*conjugate(G[j][k]));
+        if (!(d > tol*maxDiag))
+          return j;
+        G[j][j] = sqrt(d);
+        for (std::size_t i=j+1; i<n; ++i)
+        {
+          K sum = G[i][j];
+          for (std::size_t k=0; k<j; ++k)
+            sum -= G[i][k]*conjugate(G[j][k]);
+          G[i][j] = sum/G[j][j];
+        }
+      }
+      return n;
+    }
+
+    //! Solve L y = b with the leading n columns of a factor of choleskyFactor(), in place in b
+    template<class K>
+    void forwardSubstitution (const std::vector<std::vector<K> >& L, std::size_t n, std::vector<K>& b)
+    {
+      for (std::size_t i=0; i<n; ++i)
+      {
+        for (std::size_t k=0; k<i; ++k)
+          b[i] -= L[i][k]*b[k];
+        b[i] /= L[i][i];
+      }
+    }
+
+    //! Solve L^H y = b with the leading n columns of a factor of choleskyFactor(), in place in b
+    template<class K>
+    void backSubstitution (const std::vector<std::vector<K> >& L, std::size_t n, std::vector<K>& b)
+    {
+      for (std::size_t i=n; i-->0; )
+      {
+        for (std::size_t k=i+1; k<n; ++k)
+          b[i] -= conjugate(L[k][i])*b[k];
+        b[i] /= L[i][i];
+      }
+    }
+
+    //! Solve L L^H y = b with the leading n columns of a factor of choleskyFactor(), in place in b
+    template<class K>
+    void choleskySolve (const std::vector<std::vector<K> >& L, std::size_t n, std::vector<K>& b)
+    {
+      forwardSubstitution(L,n,b);
+      backSubstitution(L,n,b);
+    }
+
+    /*
+     * Eigenvalues and eigenvectors of the Hermitian n x n matrix A by the
+     * cyclic Jacobi method, A is overwritten. Column i of V is the
+     * normalized eigenvector of the eigenvalue lambda[i], the eigenvalues
+     * are not sorted.
+     */
+    template<class K, class R>
+    void hermitianEigen (std::vector<std::vector<K> >& A, std::size_t n,
+                         std::vector<R>& lambda, std::vector<std::vector<K> >& V)
+    {
+      using std::abs;
+      using std::real;
+      using std::sqrt;
+      V.assign(n,std::vector<K>(n,K(0)));
+      for (std::size_t i=0; i<n; ++i)
+        V[i][i] = K(1);
+
+      const R eps = std::numeric_limits<R>::epsilon();
+      for (int sweep=0; sweep<100; ++sweep)
+      {
+        R off = 0, diagonal = 0;
+        for (std::size_t p=0; p<n; ++p)
+          for (std::size_t q=0; q<n; ++q)
+            (p==q ? diagonal : off) += real(A[p][q]*conjugate(A[p][q]));
+        if (!(off > eps*eps*diagonal))
+          break;
+
+        for (std::size_t p=0; p<n; ++p)
+          for (std::size_t q=p+1; q<n; ++q)
+          {
+            const R apq = abs(A[p][q]);
+            if (apq==R(0))
+              continue;
+            // the rotation J = diag(1,conj(e)) [c s; -s c] annihilates A[p][q] in J^H A J,
+            // the phase e makes the rotated entry real
+            const K e = A[p][q]/apq;
+            const R theta = (real(A[q][q]) - real(A[p][p]))/(2*apq);
+            const R t = (theta<0 ? R(-1) : R(1))/(abs(theta) + sqrt(theta*theta + 1));
+            const R c = 1/sqrt(t*t + 1);
+            const R s = t*c;
+            for (std::size_t i=0; i<n; ++i)
+            {
+              const K aip = A[i][p], aiq = A[i][q];
+              A[i][p] = c*aip - s*conjugate(e)*aiq;
+              A[i][q] = s*aip + c*conjugate(e)*aiq;
+              const K vip = V[i][p], viq = V[i][q];
+              V[i][p] = c*vip - s*conjugate(e)*viq;
+              V[i][q] = s*vip + c*conjugate(e)*viq;
+            }
+            for (std::size_t i=0; i<n; ++i)
+            {
+              const K api = A[p][i], aqi = A[q][i];
+              A[p][i] = c*api - s*e*aqi;
+              A[q][i] = s*api + c*e*aqi;
+            }
+            A[p][q] = A[q][p] = K(0);
+          }
+      }
+
+      lambda.resize(n);
+      for (std::size_t i=0; i<n; ++i)
+        lambda[i] = real(A[i][i]);
+    }
+
+    //! The plane rotation [c s; -conj(s) c] with real c, that maps (a,b) to (r,0)
+    template<class K, class R>
+    void givensRotation (const K& a, const K& b, R& c, K& s)
+    {
+      using std::abs;
+      using std::sqrt;
+      const R na = abs(a), nb = abs(b);
+      if (nb==R(0))
+      {
+        c = 1;
+        s = 0;
+      }
+      else if (na==R(0))
+      {
+        c = 0;
+        s = conjugate(b)/nb;
+      }
+      else
+      {
+        const R scale = na + nb;
+        const R norm = scale*sqrt((na/scale)*(na/scale) + (nb/scale)*(nb/scale));
+        c = na/norm;
+        s = (a/na)*conjugate(b)/norm;
+      }
+    }
+
+    //! (x,y) = (c x + s y, -conj(s) x + c y)
+    template<class K, class R>
+    void applyGivens (K& x, K& y, const R& c, const K& s)
+    {
+      const K t = c*x + s*y;
+      y = c*y - conjugate(s)*x;
+      x = t;
+    }
+
+    /*
+     * Solve A X = B for the n x n matrices A and B by the LU
+     * factorization with partial pivoting, A is overwritten and X is
+     * returned in B. Returns false if A is singular.
+     */
+    template<class K>
+    bool luSolve (std::vector<std::vector<K> >& A, std::size_t n, std::vector<std::vector<K> >& B)
+    {
+      using std::abs;
+      using std::swap;
+      for (std::size_t j=0; j<n; ++j)
+      {
+        std::size_t p = j;
+        for (std::size_t i=j+1; i<n; ++i)
+          if (abs(A[i][j]) > abs(A[p][j]))
+            p = i;
+        if (A[p][j]==K(0))
+          return false;
+        swap(A[j],A[p]);
+        swap(B[j],B[p]);
+        for (std::size_t i=j+1; i<n; ++i)
+        {
+          const K l = A[i][j]/A[j][j];
+          for (std::size_t k=j+1; k<n; ++k)
+            A[i][k] -= l*A[j][k];
+          for (std::size_t k=0; k<n; ++k)
+            B[i][k] -= l*B[j][k];
+        }
+      }
+      for (std::size_t i=n; i-->0; )
+        for (std::size_t k=0; k<n; ++k)
+        {
+          for (std::size_t j=i+1; j<n; ++j)
+            B[i][k] -= A[i][j]*B[j][k];
+          B[i][k] /= A[i][i];
+        }
+      return true;
+    }
+
+    /*
+     * Eigenvalues and eigenvectors of the general complex n x n matrix A
+     * by the reduction to Hessenberg form and the shifted QR method, A is
+     * overwritten by its Schur form. Column i of V is the normalized
+     * eigenvector of the eigenvalue lambda[i], the eigenvalues are not
+     * sorted. Returns false if the QR method does not converge.
+     */
+    template<class R>
+    bool generalEigen (std::vector<std::vector<std::complex<R> > >& A, std::size_t n,
+                       std::vector<std::complex<R> >& lambda,
+                       std::vector<std::vector<std::complex<R> > >& V)
+    {
+      typedef std::complex<R> K;
+      using std::abs;
+      using std::norm;
+      using std::sqrt;
+      using std::min;
+      V.assign(n,std::vector<K>(n,K(0)));
+      for (std::size_t i=0; i<n; ++i)
+        V[i][i] = K(1);
+
+      // A = V H V^H by Householder reflections I - 2 u u^H / u^H u
+      std::vector<K> u(n);
+      for (std::size_t j=0; j+2<n; ++j)
+      {
+        R alpha = 0;
+        for (std::size_t i=j+1; i<n; ++i)
+          alpha += norm(A[i][j]);
+        alpha = sqrt(alpha);
+        if (alpha==R(0))
+          continue;
+        const K phase = abs(A[j+1][j])>R(0) ? A[j+1][j]/abs(A[j+1][j]) : K(1);
+        u[j+1] = A[j+1][j] + phase*alpha;
+        R uu = norm(u[j+1]);
+        for (std::size_t i=j+2; i<n; ++i)
+        {
+          u[i] = A[i][j];
+          uu += norm(u[i]);
+        }
+        for (std::size_t c=0; c<n; ++c)
+        {
+          K t = 0;
+          for (std::size_t i=j+1; i<n; ++i)
+            t += conjugate(u[i])*A[i][c];
+          t *= R(2)/uu;
+          for (std::size_t i=j+1; i<n; ++i)
+            A[i][c] -= u[i]*t;
+        }
+        for (std::size_t r=0; r<n; ++r)
+        {
+          K t = 0, tv = 0;
+          for (std::size_t i=j+1; i<n; ++i)
+          {
+            t += A[r][i]*u[i];
+            tv += V[r][i]*u[i];
+          }
+          t *= R(2)/uu;
+          tv *= R(2)/uu;
+          for (std::size_t i=j+1; i<n; ++i)
+          {
+            A[r][i] -= t*conjugate(u[i]);
+            V[r][i] -= tv*conjugate(u[i]);
+          }
+        }
+        for (std::size_t i=j+2; i<n; ++i)
+          A[i][j] = 0;
+      }
+
+      // single shift QR steps on the active block [lo,hi), deflating at the bottom
+      const R eps = std::numeric_limits<R>::epsilon();
+      R anorm = 0;
+      for (std::size_t i=0; i<n; ++i)
+        for (std::size_t j=0; j<n; ++j)
+          anorm += norm(A[i][j]);
+      const R tiny = eps*eps*sqrt(anorm);
+      int iterations = 0;
+      for (std::size_t hi=n; hi>1; )
+      {
+        std::size_t lo = hi-1;
+        while (lo>0 && abs(A[lo][lo-1]) > eps*(abs(A[lo][lo]) + abs(A[lo-1][lo-1]))
+               && abs(A[lo][lo-1]) > tiny)
+          --lo;
+        if (lo>0)
+          A[lo][lo-1] = 0;
+        if (lo==hi-1)
+        {
+          --hi;
+          iterations = 0;
+          continue;
+        }
+        if (++iterations>30)
+          return false;
+
+        // the Wilkinson shift, an exceptional shift against cycling
+        K mu;
+        if (iterations%10==0)
+          mu = A[hi-1][hi-1] + abs(A[hi-1][hi-2]);
+        else
+        {
+          const K a = A[hi-2][hi-2], b = A[hi-2][hi-1], c = A[hi-1][hi-2], d = A[hi-1][hi-1];
+          const K root = sqrt((a-d)*(a-d)/R(4) + b*c);
+          const K mu1 = (a+d)/R(2) + root, mu2 = (a+d)/R(2) - root;
+          mu = abs(mu1-d) < abs(mu2-d) ? mu1 : mu2;
+        }
+
+        // chase the bulge of the rotation of the shifted first column
+        for (std::size_t k=lo; k+1<hi; ++k)
+        {
+          R c;
+          K s;
+          if (k==lo)
+            givensRotation(A[k][k]-mu,A[k+1][k],c,s);
+          else
+            givensRotation(A[k][k-1],A[k+1][k-1],c,s);
+          for (std::size_t j=(k>lo ? k-1 : k); j<n; ++j)
+            applyGivens(A[k][j],A[k+1][j],c,s);
+          if (k>lo)
+            A[k+1][k-1] = 0;
+          const K cs = conjugate(s);
+          for (std::size_t i=0; i<=min(k+2,hi-1); ++i)
+            applyGivens(A[i][k],A[i][k+1],c,cs);
+          for (std::size_t i=0; i<n; ++i)
+            applyGivens(V[i][k],V[i][k+1],c,cs);
+        }
+      }
+
+      // the eigenvectors of the triangular Schur form, transformed by V
+      const R small = anorm>R(0) ? eps*sqrt(anorm) : R(1);
+      lambda.resize(n);
+      std::vector<std::vector<K> > Z(n,std::vector<K>(n,K(0)));
+      for (std::size_t i=0; i<n; ++i)
+      {
+        lambda[i] = A[i][i];
+        std::vector<K> y(i+1,K(0));
+        y[i] = 1;
+        for (std::size_t j=i; j-->0; )
+        {
+          K t = 0;
+          for (std::size_t l=j+1; l<=i; ++l)
+            t += A[j][l]*y[l];
+          K d = A[j][j] - A[i][i];
+          if (abs(d) < small)
+            d = small;
+          y[j] = -t/d;
+        }
+        R length = 0;
+        for (std::size_t r=0; r<n; ++r)
+        {
+          for (std::size_t l=0; l<=i; ++l)
+            Z[r][i] += V[r][l]*y[l];
+          length += norm(Z[r][i]);
+        }
+        length = sqrt(length);
+        for (std::size_t r=0; r<n; ++r)
+          Z[r][i] /= length;
+      }
+      std::swap(V,Z);
+      return true;
+    }
+
+  } // end namespace Imp
+} // end namespace Dune
+
+#endif
@@ -0,0 +1,143 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_FROZENPATTERN_HH
+#define DUNE_ISTL_FROZENPATTERN_HH
+
+#include <cstddef>
+#include <vector>
+
+#include "istlexception.hh"
+#include "bcrsmatrix.hh"
+
+/*! \file
+ * \brief Value-only reassembly of a BCRSMatrix with fixed sparsity pattern.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief Scatter element matrices into a BCRSMatrix without index lookups.
+   *
+   * For every element registered with addElement() the positions of its
+   * blocks in the value array of the matrix (see
+   * BCRSMatrix::valueOffset()) are computed once. Afterwards
+   * scatterAdd() adds an element matrix by direct offsets, without the
+   * binary search of operator[]. Neither the rows nor the column indices
+   * of the matrix are touched, so repeated reassembly in time-stepping
+   * or Newton loops only writes values:
+   * \code
+   * Dune::FrozenPattern<Matrix> frozen(A);
+   * for (const auto& element : elements)
+   *   frozen.addElement(element.indices);
+   * for (int step=0; step<steps; ++step)
+   * {
+   *   A = 0.0;
+   *   for (std::size_t e=0; e<elements.size(); ++e)
+   *     frozen.scatterAdd(e,localMatrix(e));
+   * }
+   * \endcode
+   *
+   * The offsets depend only on the pattern, so a FrozenPattern can also
+   * fill a copy of the matrix, see scatterAdd(M&,size_type,const L&).
+   * The matrix has to store its blocks in one array, which is the case
+   * for all build modes except the row-wise one without the number of
+   * nonzeroes given in advance.
+   *
+   * \tparam M The matrix type, a BCRSMatrix.
+   */
+  template<class M>
+  class FrozenPattern
+  {
+  public:
+    //! The matrix type.
+    typedef M matrix_type;
+
+    //! The type of the matrix blocks.
+    typedef typename M::block_type block_type;
+
+    //! The type used for indices and sizes.
+    typedef typename M::size_type size_type;
+
+    //! Prepare the reassembly of A, which has to be fully built.
+    explicit FrozenPattern (M& A)
+      : A_(A), nonzeroes_(A.nonzeroes()), start_(1,0)
+    {
+      if (A.buildStage() != M::built)
+        DUNE_THROW(BCRSMatrixError,"the pattern can only be frozen for a fully built matrix");
+    }
+
+    /**
+     * @brief Register an element coupling the given rows and columns.
+     *
+     * @return The number of the element to be used in scatterAdd().
+     * @throw BCRSMatrixError if a coupling is not in the pattern.
+     */
+    template<class RowIndices, class ColIndices>
+    size_type addElement (const RowIndices& rows, const ColIndices& cols)
+    {
+      for (const auto& i : rows)
+        for (const auto& j : cols)
+          offsets_.push_back(A_.valueOffset(i,j));
+      rowCount_.push_back(rows.size());
+      start_.push_back(offsets_.size());
+      return rowCount_.size()-1;
+    }
+
+    //! Register an element whose rows and columns both correspond to indices.
+    template<class Indices>
+    size_type addElement (const Indices& indices)
+    {
+      return addElement(indices,indices);
+    }
+
+    //! The number of registered elements.
+    size_type elements () const
+    {
+      return rowCount_.size();
+    }
+
+    //! Add the element matrix local of element e, local[k][l] is a block, to the matrix.
+    template<class L>
+    void scatterAdd (size_type e, const L& local) const
+    {
+      scatterAdd(A_,e,local);
+    }
+
+    //! Add the element matrix local of element e to a matrix B with the frozen pattern.
+    template<class L>
+    void scatterAdd (M& B, size_type e, const L& local) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (e >= elements())
+        DUNE_THROW(ISTLError,"element number out of range");
+      if (B.nonzeroes() != nonzeroes_)
+        DUNE_THROW(BCRSMatrixError,"the pattern of the matrix has changed");
+#endif
+      block_type* values = B.values();
+      const size_type* offset = offsets_.data() + start_[e];
+      const size_type rows = rowCount_[e];
+      const size_type cols = rows>0 ? (start_[e+1]-start_[e])/rows : 0;
+      for (size_type k=0; k<rows; ++k)
+        for (size_type l=0; l<cols; ++l, ++offset)
+          values[*offset] += local[k][l];
+    }
+
+  private:
+    M& A_;
+    size_type nonzeroes_;
+    // offsets of the blocks of element e, row by row, in [start_[e],start_[e+1])
+    std::vector<size_type> start_;
+    std::vector<size_type> offsets_;
+    std::vector<size_type> rowCount_;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
@@ -13,6 +13,7 @@
 #include <dune/common/ftraits.hh>
 
 #include <dune/istl/istlexception.hh>
+#include <dune/istl/blockkernels.hh>
 #include <dune/istl/bvector.hh>
 
 namespace Dune {
@@ -132,6 +133,13 @@ namespace MatrixImp
       rows_ = a.rows_;
     }
 
+    //! move constructor, takes over the entries of a and leaves it empty
+    DenseMatrixBase (DenseMatrixBase&& a) noexcept
+      : DenseMatrixBase()
+    {
+      moveFrom(a);
+    }
+
     //! free dynamic memory
     ~DenseMatrixBase ()
     {
@@ -216,6 +224,22 @@ namespace MatrixImp
       return *this;
     }
 
+    //! move assignment, frees the own entries and takes over the ones of a
+    DenseMatrixBase& operator= (DenseMatrixBase&& a) noexcept
+    {
+      if (&a!=this)
+      {
+        if (this->n>0) {
+          size_type i=this->n;
+          while (i)
+            this->p[--i].~B();
+          allocator_.deallocate(this->p,this->n);
+        }
+        moveFrom(a);
+      }
+      return *this;
+    }
+
 
     //===== assignment from scalar
 
@@ -537,6 +561,20 @@ namespace MatrixImp
 
 
   private:
+    //! Take over the entries of a and leave it empty. The own entries must be freed.
+    void moveFrom (DenseMatrixBase& a)
+    {
+      this->n = a.n;
+      this->p = a.p;
+      rows_ = a.rows_;
+      columns_ = a.columns_;
+      allocator_ = std::move(a.allocator_);
+      a.n = 0;
+      a.p = nullptr;
+      a.rows_ = 0;
+      a.columns_ = 0;
+    }
+
     size_type rows_;            // number of matrix rows
     size_type columns_;           // number of matrix columns
 
@@ -596,6 +634,31 @@ namespace MatrixImp
     Matrix(size_type rows, size_type cols) : data_(rows,cols), cols_(cols)
     {}
 
+    /** \brief Copy constructor, copies all entries */
+    Matrix(const Matrix&) = default;
+
+    /** \brief Move constructor, takes over the entries of other and leaves it empty */
+    Matrix(Matrix&& other) noexcept
+      : data_(std::move(other.data_)), cols_(other.cols_)
+    {
+      other.cols_ = 0;
+    }
+
+    /** \brief Copy assignment */
+    Matrix& operator= (const Matrix&) = default;
+
+    /** \brief Move assignment, takes over the entries of other and leaves it empty */
+    Matrix& operator= (Matrix&& other) noexcept
+    {
+      if (&other!=this)
+      {
+        data_ = std::move(other.data_);
+        cols_ = other.cols_;
+        other.cols_ = 0;
+      }
+      return *this;
+    }
+
     /** \brief Change the matrix size
      *
      * The way the data is handled is unpredictable.
@@ -1085,6 +1148,110 @@ namespace MatrixImp
     size_type cols_;
   };
 
+  namespace Imp {
+
+    //! Whether V is a BlockVector, or a window into one, of FieldVector<K,1>.
+    template<class V, class = void>
+    struct IsScalarBlockVector : std::false_type {};
+
+    template<class V>
+    struct IsScalarBlockVector<V, typename std::enable_if<IsBlockVector<V>::value>::type>
+      : std::is_same<typename V::block_type, FieldVector<typename V::field_type,1> >
+    {};
+
+    /**
+     * @brief Products of a sparse row of dense blocks with the blocks of a VariableBlockVector.
+     *
+     * A BCRSMatrix<Matrix<FieldMatrix<K,1,1> > > couples the blocks of
+     * variable size of VariableBlockVectors, e.g. for discretizations
+     * of mixed polynomial order. These kernels work on the arrays of
+     * the dense blocks and of the vector blocks directly instead of
+     * going through the row and block windows entry by entry. The
+     * entries are added up in the same order as by the generic
+     * kernels, so umv and mmv give identical results.
+     */
+    template<class K, class AM, class XB, class YB>
+    struct BlockKernel<Matrix<FieldMatrix<K,1,1>,AM>, XB, YB,
+                       typename std::enable_if<IsScalarBlockVector<XB>::value
+                                               && IsScalarBlockVector<YB>::value>::type>
+    {
+      typedef Matrix<FieldMatrix<K,1,1>,AM> B;
+      typedef typename XB::field_type XK;
+      typedef typename YB::field_type YK;
+
+      static_assert(sizeof(FieldMatrix<K,1,1>) == sizeof(K) && sizeof(FieldVector<XK,1>) == sizeof(XK)
+                    && sizeof(FieldVector<YK,1>) == sizeof(YK),
+                    "The blocks have to be stored without padding");
+
+      //! y += sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void umvRow (const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          apply(a[k],x[j[k]],y,[](YK& yr, const K& arc, const XK& xc) { yr += arc*xc; });
+      }
+
+      //! y -= sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void mmvRow (const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          apply(a[k],x[j[k]],y,[](YK& yr, const K& arc, const XK& xc) { yr -= arc*xc; });
+      }
+
+      //! y += alpha sum_k a[k] x[j[k]]
+      template<class F, class X, class S>
+      static void usmvRow (const F& alpha, const B* a, const S* j, S count, const X& x, YB& y)
+      {
+        for (S k=0; k<count; ++k)
+          apply(a[k],x[j[k]],y,[&alpha](YK& yr, const K& arc, const XK& xc) { yr += alpha*(arc*xc); });
+      }
+
+      //! y += a^T x
+      static void umtv (const B& a, const XB& x, YB& y)
+      {
+        a.umtv(x,y);
+      }
+
+      //! y -= a^T x
+      static void mmtv (const B& a, const XB& x, YB& y)
+      {
+        a.mmtv(x,y);
+      }
+
+      //! y += alpha a^T x
+      template<class F>
+      static void usmtv (const F& alpha, const B& a, const XB& x, YB& y)
+      {
+        a.usmtv(alpha,x,y);
+      }
+
+    private:
+      // f(y_r,a_rc,x_c) for all entries of the dense block a, row by row
+      template<class XV, class F>
+      static void apply (const B& a, const XV& x, YB& y, F&& f)
+      {
+#ifdef DUNE_ISTL_WITH_CHECKING
+        if (a.N()!=y.N() || a.M()!=x.N()) DUNE_THROW(ISTLError,"block size mismatch");
+#endif
+        const std::size_t rows = a.N(), cols = a.M();
+        if (rows==0 || cols==0)
+          return;
+        const K* ar = &a[0][0][0][0];
+        const XK* xp = &x[0][0];
+        YK* yp = &y[0][0];
+        for (std::size_t r=0; r<rows; ++r, ar+=cols)
+        {
+          YK yr = yp[r];
+          for (std::size_t c=0; c<cols; ++c)
+            f(yr,ar[c],xp[c]);
+          yp[r] = yr;
+        }
+      }
+    };
+
+  } // end namespace Imp
+
   /** \} */
 } // end namespace Dune
 
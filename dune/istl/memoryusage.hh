@@ -0,0 +1,96 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_MEMORYUSAGE_HH
+#define DUNE_ISTL_MEMORYUSAGE_HH
+
+#include <cstddef>
+#include <ostream>
+
+/*! \file
+ * \brief Reporting the memory held by matrices, vectors and preconditioners.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief The memory held by an object, in bytes.
+   *
+   * allocated is the memory obtained from the allocators, used the part
+   * of it that holds data. The difference is reserved but unused space,
+   * e.g. the capacity of a vector beyond its size.
+   */
+  struct MemoryUsage
+  {
+    //! The bytes obtained from the allocators.
+    std::size_t allocated;
+
+    //! The bytes holding data.
+    std::size_t used;
+
+    MemoryUsage (std::size_t allocatedBytes = 0, std::size_t usedBytes = 0)
+      : allocated(allocatedBytes), used(usedBytes)
+    {}
+
+    //! The bytes allocated but not used.
+    std::size_t wasted () const
+    {
+      return allocated - used;
+    }
+
+    MemoryUsage& operator+= (const MemoryUsage& other)
+    {
+      allocated += other.allocated;
+      used += other.used;
+      return *this;
+    }
+
+    friend MemoryUsage operator+ (MemoryUsage a, const MemoryUsage& b)
+    {
+      return a += b;
+    }
+
+    friend std::ostream& operator<< (std::ostream& s, const MemoryUsage& m)
+    {
+      return s << m.used << " of " << m.allocated << " bytes used";
+    }
+  };
+
+  namespace Imp {
+
+    template<class T>
+    auto memoryUsage (const T& t, int) -> decltype(MemoryUsage(t.memoryUsage()))
+    {
+      return t.memoryUsage();
+    }
+
+    template<class T>
+    MemoryUsage memoryUsage (const T&, long)
+    {
+      return MemoryUsage();
+    }
+
+  } // end namespace Imp
+
+  /**
+   * @brief The dynamic memory held by t.
+   *
+   * Returns t.memoryUsage() if T provides it and nothing otherwise, e.g.
+   * for preconditioners which only refer to a matrix. The memory of the
+   * object itself, sizeof(T), is not included.
+   */
+  template<class T>
+  MemoryUsage memoryUsage (const T& t)
+  {
+    return Imp::memoryUsage(t,0);
+  }
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
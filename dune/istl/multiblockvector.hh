@@ -0,0 +1,529 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_MULTIBLOCKVECTOR_HH
+#define DUNE_ISTL_MULTIBLOCKVECTOR_HH
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <dune/common/ftraits.hh>
+#include <dune/common/unused.hh>
+
+#include "blockkernels.hh"
+#include "istlexception.hh"
+#include "memoryusage.hh"
+
+/*! \file
+ * \brief Several block vectors of the same length, e.g. for many right-hand sides.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief The k blocks in one row of a MultiBlockVector.
+   *
+   * A light-weight reference returned by MultiBlockVector::operator[].
+   * B is const for rows of a const vector.
+   */
+  template<class B>
+  class MultiBlockVectorRow
+  {
+  public:
+    //! The type of the blocks, without const.
+    typedef typename std::remove_const<B>::type block_type;
+
+    //! The field type of the blocks.
+    typedef typename block_type::field_type field_type;
+
+    //! The type used for sizes.
+    typedef std::size_t size_type;
+
+    MultiBlockVectorRow (B* blocks, size_type columns)
+      : blocks_(blocks), columns_(columns)
+    {}
+
+    //! The number of columns.
+    size_type N () const
+    {
+      return columns_;
+    }
+
+    //! The block in column c.
+    B& operator[] (size_type c) const
+    {
+      return blocks_[c];
+    }
+
+    //! Set all blocks of the row to k.
+    const MultiBlockVectorRow& operator= (const field_type& k) const
+    {
+      for (size_type c=0; c<columns_; ++c)
+        blocks_[c] = k;
+      return *this;
+    }
+
+    //! The sum of the scalar products of the blocks in the same column.
+    template<class OtherB>
+    field_type dot (const MultiBlockVectorRow<OtherB>& y) const
+    {
+      field_type sum(0);
+      for (size_type c=0; c<columns_; ++c)
+        sum += blocks_[c].dot(y[c]);
+      return sum;
+    }
+
+  private:
+    B* blocks_;
+    size_type columns_;
+  };
+
+  /**
+   * @brief A vector of n blocks for each of k columns, e.g. k right-hand sides.
+   *
+   * The number of columns is chosen at run time. The blocks are stored
+   * row by row, so the k blocks of a row are contiguous. The products
+   * of a BCRSMatrix with a MultiBlockVector, like mv(), then load each
+   * matrix block once and apply it to all columns.
+   *
+   * As a vector, a MultiBlockVector is an element of the space of the
+   * n x k block matrices: the vector space operations act on all
+   * columns, dot() and the norms are those of all entries. The
+   * MatrixAdapter of a BCRSMatrix thus works with MultiBlockVectors.
+   * columnDots() and columnNorms2() return the results for each column,
+   * computed in a single pass. columnProducts() and addProduct() are
+   * the small dense products of block Krylov methods like BlockCGSolver.
+   *
+   * \tparam B The type of the blocks, e.g. FieldVector<double,2>.
+   * \tparam A The allocator of the blocks.
+   */
+  template<class B, class A=std::allocator<B> >
+  class MultiBlockVector
+  {
+  public:
+    //! export the type representing the field
+    typedef typename B::field_type field_type;
+
+    //! the type of the norms
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    //! export the type representing the components
+    typedef B block_type;
+
+    //! export the allocator type
+    typedef A allocator_type;
+
+    //! The size type for the index access
+    typedef typename A::size_type size_type;
+
+    //! The reference to a row returned by operator[]
+    typedef MultiBlockVectorRow<B> row_reference;
+
+    //! The reference to a row of a const vector
+    typedef MultiBlockVectorRow<const B> const_row_reference;
+
+    //! An empty vector without columns.
+    MultiBlockVector () = default;
+
+    //! A vector of n blocks for each of k columns.
+    MultiBlockVector (size_type n, size_type k)
+      : n_(n), k_(k), blocks_(n*k)
+    {}
+
+    //! Change the number of rows and columns, the values are lost.
+    void resize (size_type n, size_type k)
+    {
+      blocks_.assign(n*k,B());
+      n_ = n;
+      k_ = k;
+    }
+
+    //! The number of rows, i.e. the blocks of each column.
+    size_type N () const
+    {
+      return n_;
+    }
+
+    //! The number of columns.
+    size_type columns () const
+    {
+      return k_;
+    }
+
+    //! dimension of the vector space
+    size_type dim () const
+    {
+      size_type d = 0;
+      for (const B& b : blocks_)
+        d += b.dim();
+      return d;
+    }
+
+    //! The k blocks of row i.
+    row_reference operator[] (size_type i)
+    {
+      return row_reference(blocks_.data()+i*k_,k_);
+    }
+
+    //! The k blocks of row i.
+    const_row_reference operator[] (size_type i) const
+    {
+      return const_row_reference(blocks_.data()+i*k_,k_);
+    }
+
+    //! The block in row i and column c.
+    B& operator() (size_type i, size_type c)
+    {
+      return blocks_[i*k_+c];
+    }
+
+    //! The block in row i and column c.
+    const B& operator() (size_type i, size_type c) const
+    {
+      return blocks_[i*k_+c];
+    }
+
+    //! Copy column c into v, which is resized to N() blocks.
+    template<class V>
+    void getColumn (size_type c, V& v) const
+    {
+      v.resize(n_);
+      for (size_type i=0; i<n_; ++i)
+        v[i] = blocks_[i*k_+c];
+    }
+
+    //! Copy v, which has N() blocks, into column c.
+    template<class V>
+    void setColumn (size_type c, const V& v)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (v.N()!=n_) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+      for (size_type i=0; i<n_; ++i)
+        blocks_[i*k_+c] = v[i];
+    }
+
+    //===== vector space arithmetic
+
+    //! Assign k to all entries.
+    MultiBlockVector& operator= (const field_type& k)
+    {
+      for (B& b : blocks_)
+        b = k;
+      return *this;
+    }
+
+    //! vector space addition
+    MultiBlockVector& operator+= (const MultiBlockVector& y)
+    {
+      checkShape(y);
+      for (size_type l=0; l<blocks_.size(); ++l)
+        blocks_[l] += y.blocks_[l];
+      return *this;
+    }
+
+    //! vector space subtraction
+    MultiBlockVector& operator-= (const MultiBlockVector& y)
+    {
+      checkShape(y);
+      for (size_type l=0; l<blocks_.size(); ++l)
+        blocks_[l] -= y.blocks_[l];
+      return *this;
+    }
+
+    //! vector space multiplication with scalar
+    MultiBlockVector& operator*= (const field_type& k)
+    {
+      for (B& b : blocks_)
+        b *= k;
+      return *this;
+    }
+
+    //! vector space division by scalar
+    MultiBlockVector& operator/= (const field_type& k)
+    {
+      for (B& b : blocks_)
+        b /= k;
+      return *this;
+    }
+
+    //! vector space axpy operation
+    MultiBlockVector& axpy (const field_type& a, const MultiBlockVector& y)
+    {
+      checkShape(y);
+      for (size_type l=0; l<blocks_.size(); ++l)
+        blocks_[l].axpy(a,y.blocks_[l]);
+      return *this;
+    }
+
+    //===== reductions over all columns
+
+    //! The sum of the scalar products of all columns.
+    field_type dot (const MultiBlockVector& y) const
+    {
+      checkShape(y);
+      field_type sum(0);
+      for (size_type l=0; l<blocks_.size(); ++l)
+        sum += blocks_[l].dot(y.blocks_[l]);
+      return sum;
+    }
+
+    //! one norm of all entries
+    real_type one_norm () const
+    {
+      real_type sum = 0;
+      for (const B& b : blocks_)
+        sum += b.one_norm();
+      return sum;
+    }
+
+    //! two norm of all entries, the Frobenius norm of the columns
+    real_type two_norm () const
+    {
+      using std::sqrt;
+      return sqrt(two_norm2());
+    }
+
+    //! Square of the two-norm
+    real_type two_norm2 () const
+    {
+      real_type sum = 0;
+      for (const B& b : blocks_)
+        sum += b.two_norm2();
+      return sum;
+    }
+
+    //! infinity norm, NaN if any entry is NaN
+    real_type infinity_norm () const
+    {
+      using std::max;
+      real_type norm = 0;
+      for (const B& b : blocks_)
+      {
+        const real_type a = b.infinity_norm();
+        if (a != a)
+          return a;
+        norm = max(a,norm);
+      }
+      return norm;
+    }
+
+    //===== reductions for each column
+
+    /**
+     * @brief The scalar products of the columns with those of y, in one pass.
+     *
+     * Entry c is the same as x.dot(y) for the BlockVectors x and y
+     * holding column c.
+     */
+    std::vector<field_type> columnDots (const MultiBlockVector& y) const
+    {
+      checkShape(y);
+      std::vector<field_type> sums(k_,field_type(0));
+      for (size_type i=0; i<n_; ++i)
+        for (size_type c=0; c<k_; ++c)
+          sums[c] += blocks_[i*k_+c].dot(y.blocks_[i*k_+c]);
+      return sums;
+    }
+
+    //! The squared two norms of the columns, in one pass.
+    std::vector<real_type> columnNorms2 () const
+    {
+      std::vector<real_type> sums(k_,real_type(0));
+      for (size_type i=0; i<n_; ++i)
+        for (size_type c=0; c<k_; ++c)
+          sums[c] += blocks_[i*k_+c].two_norm2();
+      return sums;
+    }
+
+    //! The two norms of the columns, in one pass.
+    std::vector<real_type> columnNorms () const
+    {
+      using std::sqrt;
+      std::vector<real_type> norms = columnNorms2();
+      for (real_type& norm : norms)
+        norm = sqrt(norm);
+      return norms;
+    }
+
+    /**
+     * @brief The scalar products of all columns with all columns of y, in one pass.
+     *
+     * Entry [a][c] is the scalar product of column a with column c of
+     * y, as for columnDots(). y needs the same number of rows but may
+     * have a different number of columns. This is the small dense matrix
+     * X^H Y of block Krylov methods.
+     */
+    std::vector<std::vector<field_type> > columnProducts (const MultiBlockVector& y) const
+    {
+      checkRows(y);
+      std::vector<std::vector<field_type> > products(k_,std::vector<field_type>(y.k_,field_type(0)));
+      for (size_type i=0; i<n_; ++i)
+        for (size_type a=0; a<k_; ++a)
+        {
+          const B& xa = blocks_[i*k_+a];
+          for (size_type c=0; c<y.k_; ++c)
+            products[a][c] += xa.dot(y.blocks_[i*y.k_+c]);
+        }
+      return products;
+    }
+
+    //===== operations mixing the columns
+
+    /**
+     * @brief Add linear combinations of the columns of x, in one pass.
+     *
+     * Column c is incremented by the sum of m[a][c] times column a of x,
+     * i.e. this is Y += X M with the dense matrix M that has a row for
+     * each column of x and a column for each column of this vector. x
+     * must be a different vector.
+     */
+    MultiBlockVector& addProduct (const MultiBlockVector& x, const std::vector<std::vector<field_type> >& m)
+    {
+      checkRows(x);
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (&x==this) DUNE_THROW(ISTLError,"addProduct() of a vector with itself");
+      if (m.size()!=x.k_) DUNE_THROW(ISTLError,"matrix size mismatch");
+      for (const auto& row : m)
+        if (row.size()!=k_) DUNE_THROW(ISTLError,"matrix size mismatch");
+#endif
+      for (size_type i=0; i<n_; ++i)
+        for (size_type a=0; a<x.k_; ++a)
+        {
+          const B& xa = x.blocks_[i*x.k_+a];
+          for (size_type c=0; c<k_; ++c)
+            blocks_[i*k_+c].axpy(m[a][c],xa);
+        }
+      return *this;
+    }
+
+    /**
+     * @brief Keep only the given columns, e.g. to remove converged right-hand sides.
+     *
+     * The columns have to be in increasing order, column c of the
+     * result is the former column columns[c].
+     */
+    void selectColumns (const std::vector<size_type>& columns)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      for (size_type c=0; c<columns.size(); ++c)
+        if (columns[c]>=k_ || (c>0 && columns[c]<=columns[c-1]))
+          DUNE_THROW(ISTLError,"the columns are not increasing column indices");
+#endif
+      // the entries only move to lower indices
+      const size_type k = columns.size();
+      for (size_type i=0; i<n_; ++i)
+        for (size_type c=0; c<k; ++c)
+          blocks_[i*k+c] = blocks_[i*k_+columns[c]];
+      blocks_.resize(n_*k);
+      k_ = k;
+    }
+
+    //! The memory held by the blocks.
+    MemoryUsage memoryUsage () const
+    {
+      return MemoryUsage(blocks_.capacity()*sizeof(B), blocks_.size()*sizeof(B));
+    }
+
+  private:
+    void checkShape (const MultiBlockVector& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (y.n_!=n_ || y.k_!=k_) DUNE_THROW(ISTLError,"vector size mismatch");
+#else
+      DUNE_UNUSED_PARAMETER(y);
+#endif
+    }
+
+    void checkRows (const MultiBlockVector& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (y.n_!=n_) DUNE_THROW(ISTLError,"vector size mismatch");
+#else
+      DUNE_UNUSED_PARAMETER(y);
+#endif
+    }
+
+    size_type n_ = 0;
+    size_type k_ = 0;
+    std::vector<B,A> blocks_;
+  };
+
+  namespace Imp {
+
+    /**
+     * @brief The products of a sparse block row with the rows of a MultiBlockVector.
+     *
+     * Each block of the matrix row is loaded once and applied to the
+     * blocks of all columns before moving on to the next one. Column c
+     * of the result is the one of the generic kernel for the BlockVector
+     * of column c, which the kernels for small blocks only match up to
+     * rounding.
+     */
+    template<class B, class XB, class YB>
+    struct BlockKernel<B, MultiBlockVectorRow<const XB>, MultiBlockVectorRow<YB> >
+    {
+      typedef MultiBlockVectorRow<YB> Row;
+
+      //! y += sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void umvRow (const B* a, const S* j, S count, const X& x, const Row& y)
+      {
+        for (S k=0; k<count; ++k)
+        {
+          const auto xk = checkedRow(x[j[k]],y);
+          for (std::size_t c=0; c<y.N(); ++c)
+            a[k].umv(xk[c],y[c]);
+        }
+      }
+
+      //! y -= sum_k a[k] x[j[k]]
+      template<class X, class S>
+      static void mmvRow (const B* a, const S* j, S count, const X& x, const Row& y)
+      {
+        for (S k=0; k<count; ++k)
+        {
+          const auto xk = checkedRow(x[j[k]],y);
+          for (std::size_t c=0; c<y.N(); ++c)
+            a[k].mmv(xk[c],y[c]);
+        }
+      }
+
+      //! y += alpha sum_k a[k] x[j[k]]
+      template<class F, class X, class S>
+      static void usmvRow (const F& alpha, const B* a, const S* j, S count, const X& x, const Row& y)
+      {
+        for (S k=0; k<count; ++k)
+        {
+          const auto xk = checkedRow(x[j[k]],y);
+          for (std::size_t c=0; c<y.N(); ++c)
+            a[k].usmv(alpha,xk[c],y[c]);
+        }
+      }
+
+    private:
+      static const MultiBlockVectorRow<const XB>& checkedRow (const MultiBlockVectorRow<const XB>& x, const Row& y)
+      {
+#ifdef DUNE_ISTL_WITH_CHECKING
+        if (x.N()!=y.N()) DUNE_THROW(ISTLError,"the vectors have different numbers of columns");
+#else
+        DUNE_UNUSED_PARAMETER(y);
+#endif
+        return x;
+      }
+    };
+
+  } // end namespace Imp
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
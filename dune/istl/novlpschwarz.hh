@@ -293,6 +293,36 @@ namespace Dune {
       return communication.norm(x);
     }
 
+    /*! \brief Start computing the dot products of several pairs of vectors.
+
+       The local parts of all products are summed up over the processes
+       by a single reduction, which is nonblocking if the communication
+       object supports it, see OwnerOverlapCopyCommunication::startSum().
+     */
+    virtual void startDots (std::initializer_list<std::pair<const X*,const X*> > pairs,
+                            std::vector<field_type>& dots)
+    {
+      Imp::startCommunicationDots(communication,pairs,dots,0);
+    }
+
+    //! Wait for the dot products started by startDots().
+    virtual void waitDots ()
+    {
+      Imp::waitCommunicationDots(communication,0);
+    }
+
+    /*! \brief Dot products of many pairs of vectors.
+
+       The local parts of all products are summed up over the processes
+       by a single reduction.
+     */
+    virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                           std::vector<field_type>& dots)
+    {
+      Imp::startCommunicationDots(communication,pairs,dots,0);
+      Imp::waitCommunicationDots(communication,0);
+    }
+
     /*! \brief make additive vector consistent
      */
     void make_consistent (X& x) const
@@ -8,8 +8,13 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <type_traits>
+
+#include <dune/common/exceptions.hh>
 
 #include "solvercategory.hh"
+#include "scalarproducts.hh"
+#include "threadexecutor.hh"
 
 
 namespace Dune {
@@ -40,6 +45,24 @@ namespace Dune {
   // Abstract operator interface
   //=====================================================================
 
+  namespace Imp {
+
+    // The scalar product of x and y, provided that both have the domain type.
+    template<class X, class Y>
+    auto scalarProductDot (ScalarProduct<X>& sp, const X& x, const Y& y, int)
+      -> decltype(sp.dot(x,y))
+    {
+      return sp.dot(x,y);
+    }
+
+    template<class X, class Y>
+    typename X::field_type scalarProductDot (ScalarProduct<X>&, const X&, const Y&, long)
+    {
+      DUNE_THROW(NotImplemented,"applyDot requires range and domain of the same type");
+    }
+
+  } // end namespace Imp
+
 
   /*!
      @brief A linear operator.
@@ -77,6 +100,19 @@ namespace Dune {
     //! apply operator to x, scale and add:  \f$ y = y + \alpha A(x) \f$
     virtual void applyscaleadd (field_type alpha, const X& x, Y& y) const = 0;
 
+    /*! \brief apply operator to x and return the scalar product with the
+          result: \f$ y = A(x) \f$, returns \f$ sp(x,y) \f$
+
+       Operators that can compute the scalar product while applying
+       themselves override this for the scalar products they know,
+       saving a pass over x and y. The default calls apply() and sp.dot().
+     */
+    virtual field_type applyDot (const X& x, Y& y, ScalarProduct<X>& sp) const
+    {
+      apply(x,y);
+      return Imp::scalarProductDot(sp,x,y,0);
+    }
+
     //! every abstract base class has a virtual destructor
     virtual ~LinearOperator () {}
   };
@@ -112,10 +148,61 @@ namespace Dune {
   // Implementation for ISTL-matrix based operator
   //=====================================================================
 
+  namespace Imp {
+
+    // Use the threaded matrix-vector products if the matrix provides them,
+    // fall back to the serial ones otherwise.
+    template<class M, class X, class Y>
+    auto adapterMV (const M& A, const X& x, Y& y, const ThreadExecutor& exec, int)
+      -> decltype(A.mv(x,y,exec))
+    {
+      return A.mv(x,y,exec);
+    }
+
+    template<class M, class X, class Y>
+    void adapterMV (const M& A, const X& x, Y& y, const ThreadExecutor&, long)
+    {
+      A.mv(x,y);
+    }
+
+    template<class M, class F, class X, class Y>
+    auto adapterUSMV (const M& A, const F& alpha, const X& x, Y& y, const ThreadExecutor& exec, int)
+      -> decltype(A.usmv(alpha,x,y,exec))
+    {
+      return A.usmv(alpha,x,y,exec);
+    }
+
+    template<class M, class F, class X, class Y>
+    void adapterUSMV (const M& A, const F& alpha, const X& x, Y& y, const ThreadExecutor&, long)
+    {
+      A.usmv(alpha,x,y);
+    }
+
+    // Use the fused product and scalar product if the matrix provides it.
+    template<class M, class X, class Y, class SP>
+    auto adapterMVDot (const M& A, const X& x, Y& y, SP&, const ThreadExecutor& exec, int)
+      -> typename std::enable_if<std::is_same<X,Y>::value,decltype(A.mvdot(x,y,exec))>::type
+    {
+      return A.mvdot(x,y,exec);
+    }
+
+    template<class M, class X, class Y, class SP>
+    typename X::field_type adapterMVDot (const M& A, const X& x, Y& y, SP& sp, const ThreadExecutor& exec, long)
+    {
+      adapterMV(A,x,y,exec,0);
+      return scalarProductDot(sp,x,y,0);
+    }
+
+  } // end namespace Imp
+
   /*!
      \brief Adapter to turn a matrix into a linear operator.
 
-     Adapts a matrix to the assembled linear operator interface
+     Adapts a matrix to the assembled linear operator interface.
+
+     If the matrix provides matrix-vector products taking a ThreadExecutor
+     (like BCRSMatrix), these are used with the executor given to the
+     constructor, or ThreadExecutor::global() if none was given.
    */
   template<class M, class X, class Y>
   class MatrixAdapter : public AssembledLinearOperator<M,X,Y>
@@ -131,18 +218,41 @@ namespace Dune {
     enum {category=SolverCategory::sequential};
 
     //! constructor: just store a reference to a matrix
-    explicit MatrixAdapter (const M& A) : _A_(A) {}
+    explicit MatrixAdapter (const M& A)
+      : _A_(A), _exec(&ThreadExecutor::global())
+    {}
+
+    //! constructor: store a reference to a matrix and the executor to use
+    MatrixAdapter (const M& A, const ThreadExecutor& exec)
+      : _A_(A), _exec(&exec)
+    {}
 
     //! apply operator to x:  \f$ y = A(x) \f$
     virtual void apply (const X& x, Y& y) const
     {
-      _A_.mv(x,y);
+      Imp::adapterMV(_A_,x,y,*_exec,0);
     }
 
     //! apply operator to x, scale and add:  \f$ y = y + \alpha A(x) \f$
     virtual void applyscaleadd (field_type alpha, const X& x, Y& y) const
     {
-      _A_.usmv(alpha,x,y);
+      Imp::adapterUSMV(_A_,alpha,x,y,*_exec,0);
+    }
+
+    /*! \brief apply operator to x and return the scalar product with the result
+
+       If sp.fusable(), like for SeqScalarProduct with serial reductions,
+       the scalar product is computed together with the matrix-vector
+       product, if the matrix provides mvdot(). Otherwise, and if the
+       rows are distributed over several threads, it is computed by
+       sp.dot() after apply(). The partial sums of the threads would make
+       the result depend on their number.
+     */
+    virtual field_type applyDot (const X& x, Y& y, ScalarProduct<X>& sp) const
+    {
+      if (sp.fusable() && !_exec->parallel(_A_.N()))
+        return Imp::adapterMVDot(_A_,x,y,sp,*_exec,0);
+      return AssembledLinearOperator<M,X,Y>::applyDot(x,y,sp);
     }
 
     //! get matrix via *
@@ -153,6 +263,7 @@ namespace Dune {
 
   private:
     const M& _A_;
+    const ThreadExecutor* _exec;
   };
 
   /** @} end documentation */
@@ -10,6 +10,7 @@
 #include <map>
 #include <set>
 #include <tuple>
+#include <type_traits>
 
 #include "cmath"
 
@@ -25,6 +26,7 @@
 #include <dune/common/parallel/communicator.hh>
 #include <dune/common/parallel/remoteindices.hh>
 #include <dune/common/parallel/mpicollectivecommunication.hh>
+#include <dune/common/parallel/mpitraits.hh>
 #endif
 
 #include "solvercategory.hh"
@@ -392,25 +394,37 @@ namespace Dune {
 
 
     /**
-     * @brief Compute a global dot product of two vectors.
+     * @brief The weights of the local indices in global scalar products.
      *
-     * @param x The first vector of the product.
-     * @param y The second vector of the product.
-     * @param result Reference to store the result in.
+     * The weight is one for indices owned by this process and zero
+     * for all others.
+     * @param size The number of local indices.
      */
-    template<class T1, class T2>
-    void dot (const T1& x, const T1& y, T2& result) const
+    const std::vector<double>& ownerMask (std::size_t size) const
     {
-      // set up mask vector
-      if (mask.size()!=static_cast<typename std::vector<double>::size_type>(x.size()))
+      if (mask.size()!=size)
       {
-        mask.resize(x.size());
+        mask.resize(size);
         for (typename std::vector<double>::size_type i=0; i<mask.size(); i++)
           mask[i] = 1;
         for (typename PIS::const_iterator i=pis.begin(); i!=pis.end(); ++i)
           if (i->local().attribute()!=OwnerOverlapCopyAttributeSet::owner)
             mask[i->local().local()] = 0;
       }
+      return mask;
+    }
+
+    /**
+     * @brief Compute a global dot product of two vectors.
+     *
+     * @param x The first vector of the product.
+     * @param y The second vector of the product.
+     * @param result Reference to store the result in.
+     */
+    template<class T1, class T2>
+    void dot (const T1& x, const T1& y, T2& result) const
+    {
+      ownerMask(x.size());
       result = T2(0.0);
 
       for (typename T1::size_type i=0; i<x.size(); i++)
@@ -428,22 +442,40 @@ namespace Dune {
     template<class T1>
     typename FieldTraits<typename T1::field_type>::real_type norm (const T1& x) const
     {
-      // set up mask vector
-      if (mask.size()!=static_cast<typename std::vector<double>::size_type>(x.size()))
-      {
-        mask.resize(x.size());
-        for (typename std::vector<double>::size_type i=0; i<mask.size(); i++)
-          mask[i] = 1;
-        for (typename PIS::const_iterator i=pis.begin(); i!=pis.end(); ++i)
-          if (i->local().attribute()!=OwnerOverlapCopyAttributeSet::owner)
-            mask[i->local().local()] = 0;
-      }
+      ownerMask(x.size());
       typename T1::field_type result = typename T1::field_type(0.0);
       for (typename T1::size_type i=0; i<x.size(); i++)
         result += x[i].two_norm2()*mask[i];
       return static_cast<double>(sqrt(cc.sum(result)));
     }
 
+    /**
+     * @brief Start summing up values over all processes, without waiting for the result.
+     *
+     * The values are replaced by their sums over all processes once
+     * waitSum() returns, they must not be accessed before. Only one sum
+     * can be pending at a time. With MPI-3, sums of floating point
+     * values are computed by a nonblocking MPI_Iallreduce, which other
+     * work of this process can overlap. All other sums are computed
+     * right away.
+     *
+     * @param values The local values, which are overwritten by the sums.
+     * @param count The number of values.
+     */
+    template<class T>
+    void startSum (T* values, int count) const
+    {
+      startSum(values,count,std::is_floating_point<T>());
+    }
+
+    /**
+     * @brief Wait for the sum started by startSum().
+     */
+    void waitSum () const
+    {
+      MPI_Wait(&sumRequest,MPI_STATUS_IGNORE);
+    }
+
     typedef Dune::EnumItem<AttributeSet,OwnerOverlapCopyAttributeSet::copy> CopyFlags;
 
     /** @brief The type of the parallel index set. */
@@ -558,7 +590,7 @@ namespace Dune {
       : comm(comm_), cc(comm_), pis(), ri(pis,pis,comm_),
         OwnerToAllInterfaceBuilt(false), OwnerOverlapToAllInterfaceBuilt(false),
         OwnerCopyToAllInterfaceBuilt(false), OwnerCopyToOwnerCopyInterfaceBuilt(false),
-        CopyToAllInterfaceBuilt(false), globalLookup_(0), category(cat_),
+        CopyToAllInterfaceBuilt(false), sumRequest(MPI_REQUEST_NULL), globalLookup_(0), category(cat_),
         freecomm(freecomm_)
     {}
 
@@ -574,7 +606,7 @@ namespace Dune {
       : comm(MPI_COMM_WORLD), cc(MPI_COMM_WORLD), pis(), ri(pis,pis,MPI_COMM_WORLD),
         OwnerToAllInterfaceBuilt(false), OwnerOverlapToAllInterfaceBuilt(false),
         OwnerCopyToAllInterfaceBuilt(false), OwnerCopyToOwnerCopyInterfaceBuilt(false),
-        CopyToAllInterfaceBuilt(false), globalLookup_(0), category(cat_), freecomm(false)
+        CopyToAllInterfaceBuilt(false), sumRequest(MPI_REQUEST_NULL), globalLookup_(0), category(cat_), freecomm(false)
     {}
 
     /**
@@ -591,7 +623,7 @@ namespace Dune {
       : comm(comm_), cc(comm_), OwnerToAllInterfaceBuilt(false),
         OwnerOverlapToAllInterfaceBuilt(false), OwnerCopyToAllInterfaceBuilt(false),
         OwnerCopyToOwnerCopyInterfaceBuilt(false), CopyToAllInterfaceBuilt(false),
-        globalLookup_(0), category(cat_), freecomm(freecomm_)
+        sumRequest(MPI_REQUEST_NULL), globalLookup_(0), category(cat_), freecomm(freecomm_)
     {
       // set up an ISTL index set
       pis.beginResize();
@@ -675,6 +707,23 @@ namespace Dune {
   private:
     OwnerOverlapCopyCommunication (const OwnerOverlapCopyCommunication&)
     {}
+
+    template<class T>
+    void startSum (T* values, int count, std::true_type) const
+    {
+#if MPI_VERSION >= 3
+      MPI_Iallreduce(MPI_IN_PLACE,values,count,MPITraits<T>::getType(),MPI_SUM,comm,&sumRequest);
+#else
+      cc.sum(values,count);
+#endif
+    }
+
+    template<class T>
+    void startSum (T* values, int count, std::false_type) const
+    {
+      cc.sum(values,count);
+    }
+
     MPI_Comm comm;
     CollectiveCommunication<MPI_Comm> cc;
     PIS pis;
@@ -690,6 +739,7 @@ namespace Dune {
     mutable IF CopyToAllInterface;
     mutable bool CopyToAllInterfaceBuilt;
     mutable std::vector<double> mask;
+    mutable MPI_Request sumRequest;
     int oldseqNo;
     GlobalLookupIndexSet* globalLookup_;
     SolverCategory::Category category;
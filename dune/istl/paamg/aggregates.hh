@@ -9,6 +9,8 @@
 #include "properties.hh"
 #include "combinedfunctor.hh"
 
+#include <dune/istl/memoryusage.hh>
+
 #include <dune/common/timer.hh>
 #include <dune/common/stdstreams.hh>
 #include <dune/common/poolallocator.hh>
@@ -688,6 +690,14 @@ namespace Dune
        */
       std::size_t noVertices() const;
 
+      /**
+       * @brief The memory used by the mapping of the vertices onto the aggregates.
+       */
+      MemoryUsage memoryUsage() const
+      {
+        return MemoryUsage(noVertices_*sizeof(AggregateDescriptor), noVertices_*sizeof(AggregateDescriptor));
+      }
+
       /**
        * @brief Free the allocated memory.
        */
@@ -169,6 +169,16 @@ namespace Dune
        */
       bool usesDirectCoarseLevelSolver() const;
 
+      /**
+       * @brief Get the memory used on each level of the multigrid hierarchy.
+       *
+       * The work vectors are only allocated between pre() and post().
+       * The smoother used by an iterative coarse solver is counted on the
+       * coarsest level, the coarse solver itself is not included.
+       * @return The memory used on each level, from the finest to the coarsest.
+       */
+      std::vector<LevelMemoryUsage> memoryUsage() const;
+
     private:
       /**
        * @brief Create matrix and smoother hierarchies.
@@ -754,6 +764,28 @@ namespace Dune
       return IsDirectSolver< CoarseSolver>::value;
     }
 
+    template<class M, class X, class S, class PI, class A>
+    std::vector<LevelMemoryUsage> AMG<M,X,S,PI,A>::memoryUsage() const
+    {
+      std::vector<LevelMemoryUsage> usage = matrices_->memoryUsage();
+      auto add = [&usage](const std::vector<MemoryUsage>& levels, MemoryUsage LevelMemoryUsage::* component) {
+                   for(std::size_t level=0; level<levels.size() && level<usage.size(); ++level)
+                     usage[level].*component += levels[level];
+                 };
+      if(smoothers_)
+        add(smoothers_->memoryUsage(), &LevelMemoryUsage::smoother);
+      if(coarseSmoother_ && !usage.empty())
+        usage.back().smoother += MemoryUsage(sizeof(Smoother), sizeof(Smoother))
+                                 + Dune::memoryUsage(*coarseSmoother_);
+      if(lhs_)
+        add(lhs_->memoryUsage(), &LevelMemoryUsage::vectors);
+      if(rhs_)
+        add(rhs_->memoryUsage(), &LevelMemoryUsage::vectors);
+      if(update_)
+        add(update_->memoryUsage(), &LevelMemoryUsage::vectors);
+      return usage;
+    }
+
     template<class M, class X, class S, class PI, class A>
     void AMG<M,X,S,PI,A>::mgc(LevelContext& levelContext){
       if(levelContext.matrix == matrices_->matrices().coarsest() && levels()==maxlevels()) {
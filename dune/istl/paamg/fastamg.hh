@@ -158,6 +158,16 @@ namespace Dune
        */
       bool usesDirectCoarseLevelSolver() const;
 
+      /**
+       * @brief Get the memory used on each level of the multigrid hierarchy.
+       *
+       * The work vectors are only allocated between pre() and post().
+       * The smoother used by an iterative coarse solver is counted on the
+       * coarsest level, the coarse solver itself is not included.
+       * @return The memory used on each level, from the finest to the coarsest.
+       */
+      std::vector<LevelMemoryUsage> memoryUsage() const;
+
     private:
       /**
        * @brief Create matrix and smoother hierarchies.
@@ -664,6 +674,26 @@ namespace Dune
       return IsDirectSolver< CoarseSolver>::value;
     }
 
+    template<class M, class X, class PI, class A>
+    std::vector<LevelMemoryUsage> FastAMG<M,X,PI,A>::memoryUsage() const
+    {
+      std::vector<LevelMemoryUsage> usage = matrices_->memoryUsage();
+      auto add = [&usage](const std::vector<MemoryUsage>& levels) {
+                   for(std::size_t level=0; level<levels.size() && level<usage.size(); ++level)
+                     usage[level].vectors += levels[level];
+                 };
+      if(coarseSmoother_ && !usage.empty())
+        usage.back().smoother += MemoryUsage(sizeof(Smoother), sizeof(Smoother))
+                                 + Dune::memoryUsage(*coarseSmoother_);
+      if(lhs_)
+        add(lhs_->memoryUsage());
+      if(rhs_)
+        add(rhs_->memoryUsage());
+      if(residual_)
+        add(residual_->memoryUsage());
+      return usage;
+    }
+
     template<class M, class X, class PI, class A>
     void FastAMG<M,X,PI,A>::mgc(LevelContext& levelContext, Domain& v, const Range& b){
 
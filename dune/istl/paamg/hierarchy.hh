@@ -8,6 +8,7 @@
 #include <limits>
 #include <algorithm>
 #include <tuple>
+#include <vector>
 #include "aggregates.hh"
 #include "graph.hh"
 #include "galerkin.hh"
@@ -20,6 +21,7 @@
 #include <dune/istl/bvector.hh>
 #include <dune/common/parallel/indexset.hh>
 #include <dune/istl/matrixutils.hh>
+#include <dune/istl/memoryusage.hh>
 #include <dune/istl/matrixredistribute.hh>
 #include <dune/istl/paamg/dependency.hh>
 #include <dune/istl/paamg/graph.hh>
@@ -55,6 +57,27 @@ namespace Dune
       MAX_PROCESSES = 72000
     };
 
+    /**
+     * @brief The memory used on one level of a multigrid hierarchy, by component.
+     */
+    struct LevelMemoryUsage
+    {
+      /** @brief The matrix, including a redistributed copy. */
+      MemoryUsage matrix;
+      /** @brief The mapping of the unknowns onto the aggregates of the next coarser level. */
+      MemoryUsage aggregates;
+      /** @brief The smoother. */
+      MemoryUsage smoother;
+      /** @brief The vectors used during the cycle. */
+      MemoryUsage vectors;
+
+      /** @brief The sum of all components. */
+      MemoryUsage total() const
+      {
+        return matrix + aggregates + smoother + vectors;
+      }
+    };
+
     /**
      * @brief A hierarchy of coantainers (e.g. matrices or vectors)
      *
@@ -134,6 +157,21 @@ namespace Dune
        * @brief Copy constructor.
        */
       Hierarchy(const Hierarchy& other);
+
+      /**
+       * @brief Move constructor.
+       *
+       * Takes over the levels of other, which is left empty.
+       */
+      Hierarchy(Hierarchy&& other) noexcept;
+
+      /**
+       * @brief Move assignment.
+       *
+       * Frees the own levels and takes over the ones of other, which is
+       * left empty.
+       */
+      Hierarchy& operator=(Hierarchy&& other) noexcept;
       /**
        * @brief Add an element on a coarser level.
        * @param args The arguments needed for the construction.
@@ -290,6 +328,14 @@ namespace Dune
        */
       std::size_t levels() const;
 
+      /**
+       * @brief Get the memory used on each level, from the finest to the coarsest.
+       *
+       * Each stored object, including a redistributed version, counts with
+       * its size and the memory reported by Dune::memoryUsage().
+       */
+      std::vector<MemoryUsage> memoryUsage() const;
+
       /** @brief Destructor. */
       ~Hierarchy();
 
@@ -360,6 +406,22 @@ namespace Dune
       MatrixHierarchy(const MatrixOperator& fineMatrix,
                       const ParallelInformation& pinfo=ParallelInformation());
 
+      /**
+       * @brief Move constructor.
+       *
+       * Takes over all levels and aggregates maps of other without
+       * copying any matrix. other is left empty and may only be destroyed
+       * or assigned to.
+       */
+      MatrixHierarchy(MatrixHierarchy&& other) noexcept;
+
+      /**
+       * @brief Move assignment.
+       *
+       * Frees the coarse levels of this hierarchy and takes over the ones
+       * of other, which is left empty.
+       */
+      MatrixHierarchy& operator=(MatrixHierarchy&& other) noexcept;
 
       ~MatrixHierarchy();
 
@@ -442,6 +504,16 @@ namespace Dune
        */
       const RedistributeInfoList& redistributeInformation() const;
 
+      /**
+       * @brief Get the memory used by the matrices and aggregates maps on each level.
+       *
+       * The smoother and vector components of the result are empty, the
+       * AMG fills them in. The matrix on the finest level is counted even
+       * though it is owned by the user.
+       * @return The memory used on each level, from the finest to the coarsest.
+       */
+      std::vector<LevelMemoryUsage> memoryUsage() const;
+
 
       typename MatrixOperator::field_type getProlongationDampingFactor() const
       {
@@ -660,7 +732,8 @@ namespace Dune
     MatrixHierarchy<M,IS,A>::MatrixHierarchy(const MatrixOperator& fineOperator,
                                              const ParallelInformation& pinfo)
       : matrices_(const_cast<MatrixOperator&>(fineOperator)),
-        parallelInformation_(const_cast<ParallelInformation&>(pinfo))
+        parallelInformation_(const_cast<ParallelInformation&>(pinfo)),
+        built_(false), maxlevels_(0)
     {
       static_assert((static_cast<int>(MatrixOperator::category) ==
                        static_cast<int>(SolverCategory::sequential)
@@ -1118,7 +1191,40 @@ namespace Dune
         if(level.isRedistributed())
           delete &(level.getRedistributed().getmat());
       }
-      delete *amap;
+      if(!aggregatesMaps_.empty())
+        delete *amap;
+    }
+
+    template<class M, class IS, class A>
+    MatrixHierarchy<M,IS,A>::MatrixHierarchy(MatrixHierarchy&& other) noexcept
+      : aggregatesMaps_(std::move(other.aggregatesMaps_)),
+        redistributes_(std::move(other.redistributes_)),
+        matrices_(std::move(other.matrices_)),
+        parallelInformation_(std::move(other.parallelInformation_)),
+        built_(other.built_), maxlevels_(other.maxlevels_),
+        prolongDamp_(other.prolongDamp_)
+    {
+      other.aggregatesMaps_.clear();
+      other.redistributes_.clear();
+      other.built_ = false;
+      other.maxlevels_ = 0;
+    }
+
+    template<class M, class IS, class A>
+    MatrixHierarchy<M,IS,A>& MatrixHierarchy<M,IS,A>::operator=(MatrixHierarchy&& other) noexcept
+    {
+      if(&other != this) {
+        // the old levels are freed by the destructor of tmp
+        MatrixHierarchy tmp(std::move(other));
+        std::swap(aggregatesMaps_, tmp.aggregatesMaps_);
+        std::swap(redistributes_, tmp.redistributes_);
+        std::swap(matrices_, tmp.matrices_);
+        std::swap(parallelInformation_, tmp.parallelInformation_);
+        std::swap(built_, tmp.built_);
+        std::swap(maxlevels_, tmp.maxlevels_);
+        std::swap(prolongDamp_, tmp.prolongDamp_);
+      }
+      return *this;
     }
 
     template<class M, class IS, class A>
@@ -1221,6 +1327,24 @@ namespace Dune
       return matrices_.levels();
     }
 
+    template<class M, class IS, class A>
+    std::vector<LevelMemoryUsage> MatrixHierarchy<M,IS,A>::memoryUsage() const
+    {
+      std::vector<LevelMemoryUsage> usage(levels());
+      typename ParallelMatrixHierarchy::ConstIterator matrix = matrices_.finest();
+      for(std::size_t level=0; level<usage.size(); ++level, ++matrix) {
+        usage[level].matrix = Dune::memoryUsage(matrix->getmat());
+        if(matrix.isRedistributed())
+          usage[level].matrix += Dune::memoryUsage(matrix.getRedistributed().getmat());
+      }
+
+      typename AggregatesMapList::const_iterator aggregates = aggregatesMaps_.begin();
+      for(std::size_t level=0; level<usage.size() && aggregates!=aggregatesMaps_.end(); ++level, ++aggregates)
+        usage[level].aggregates = MemoryUsage(sizeof(AggregatesMap), sizeof(AggregatesMap))
+                                  + (*aggregates)->memoryUsage();
+      return usage;
+    }
+
     template<class M, class IS, class A>
     std::size_t MatrixHierarchy<M,IS,A>::maxlevels() const
     {
@@ -1323,12 +1447,50 @@ namespace Dune
       coarsest_=current_;
     }
 
+    template<class T, class A>
+    Hierarchy<T,A>::Hierarchy(Hierarchy&& other) noexcept
+      : finest_(other.finest_), coarsest_(other.coarsest_),
+        nonAllocated_(other.nonAllocated_), allocator_(std::move(other.allocator_)),
+        levels_(other.levels_)
+    {
+      other.finest_ = other.coarsest_ = other.nonAllocated_ = nullptr;
+      other.levels_ = 0;
+    }
+
+    template<class T, class A>
+    Hierarchy<T,A>& Hierarchy<T,A>::operator=(Hierarchy&& other) noexcept
+    {
+      if(&other != this) {
+        // the old levels are freed by the destructor of tmp
+        Hierarchy tmp(std::move(other));
+        std::swap(finest_, tmp.finest_);
+        std::swap(coarsest_, tmp.coarsest_);
+        std::swap(nonAllocated_, tmp.nonAllocated_);
+        std::swap(allocator_, tmp.allocator_);
+        std::swap(levels_, tmp.levels_);
+      }
+      return *this;
+    }
+
     template<class T, class A>
     std::size_t Hierarchy<T,A>::levels() const
     {
       return levels_;
     }
 
+    template<class T, class A>
+    std::vector<MemoryUsage> Hierarchy<T,A>::memoryUsage() const
+    {
+      std::vector<MemoryUsage> usage(levels());
+      ConstIterator level = finest();
+      for(std::size_t i=0; i<usage.size(); ++i, ++level) {
+        usage[i] = MemoryUsage(sizeof(T), sizeof(T)) + Dune::memoryUsage(*level);
+        if(level.isRedistributed())
+          usage[i] += MemoryUsage(sizeof(T), sizeof(T)) + Dune::memoryUsage(level.getRedistributed());
+      }
+      return usage;
+    }
+
     template<class T, class A>
     void Hierarchy<T,A>::addRedistributedOnCoarsest(Arguments& args)
     {
@@ -158,6 +158,14 @@ void testAMG(int N, int coarsenTarget, int ml)
   std::cout<<"AMG building took "<<(buildtime/r.elapsed*r.iterations)<<" iterations"<<std::endl;
   std::cout<<"AMG building together with solving took "<<buildtime+solvetime<<std::endl;
 
+  std::vector<Dune::Amg::LevelMemoryUsage> memory = amg.memoryUsage();
+  for(std::size_t level=0; level<memory.size(); ++level)
+    std::cout<<"Level "<<level<<": matrix "<<memory[level].matrix
+             <<", aggregates "<<memory[level].aggregates
+             <<", smoother "<<memory[level].smoother<<std::endl;
+  if(memory.size()!=amg.levels() || memory[0].matrix.used==0)
+    DUNE_THROW(Dune::ISTLError, "wrong memory usage reported for the AMG hierarchy");
+
   /*
      watch.reset();
      cg.apply(x,b,r);
@@ -66,6 +66,17 @@ void testHierarchy(int N)
   std::vector<std::size_t> data;
 
   hierarchy.getCoarsestAggregatesOnFinest(data);
+
+  // moving the hierarchies must not copy any level
+  const std::size_t levels = hierarchy.levels();
+  const BCRSMat* coarsest = &hierarchy.matrices().coarsest()->getmat();
+  Hierarchy moved(std::move(hierarchy));
+  VHierarchy vmoved(std::move(vh));
+  if(moved.levels() != levels || hierarchy.levels() != 0
+     || &moved.matrices().coarsest()->getmat() != coarsest
+     || vmoved.levels() != levels || vh.levels() != 0)
+    DUNE_THROW(Dune::ISTLError, "Moving the hierarchy copied or lost levels");
+  moved.recalculateGalerkin(OverlapFlags());
 }
 
 
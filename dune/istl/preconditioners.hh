@@ -16,6 +16,7 @@
 #include "solvercategory.hh"
 #include "istlexception.hh"
 #include "matrixutils.hh"
+#include "memoryusage.hh"
 #include "gsetc.hh"
 #include "ilu.hh"
 
@@ -547,6 +548,12 @@ namespace Dune {
       DUNE_UNUSED_PARAMETER(x);
     }
 
+    //! \brief The memory held by the stored decomposition.
+    MemoryUsage memoryUsage () const
+    {
+      return Dune::memoryUsage(ILU);
+    }
+
   private:
     //! \brief The relaxation factor to use.
     field_type _w;
@@ -633,6 +640,12 @@ namespace Dune {
       DUNE_UNUSED_PARAMETER(x);
     }
 
+    //! \brief The memory held by the stored decomposition.
+    MemoryUsage memoryUsage () const
+    {
+      return Dune::memoryUsage(ILU);
+    }
+
   private:
     //! \brief ILU(n) decomposition of the matrix we operate on.
     matrix_type ILU;
@@ -716,6 +729,99 @@ namespace Dune {
   };
 
 
+  /*!
+     \brief Applies a preconditioner for single vectors to each column of a multi-vector.
+
+     Turns e.g. SeqSSOR, SeqILU0 or AMG for BlockVectors into a
+     preconditioner for a MultiBlockVector, as needed by BlockCGSolver.
+     Each column is copied into a vector of the preconditioner, which is
+     applied to it, and copied back. pre() and post() of the
+     preconditioner are called for each column, too.
+
+     \tparam P Type of the preconditioner for single vectors.
+     \tparam X Type of the update, with a column for each vector, like MultiBlockVector.
+     \tparam Y Type of the defect.
+   */
+  template<class P, class X, class Y=X>
+  class ColumnPreconditioner : public Preconditioner<X,Y> {
+  public:
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=P::category
+    };
+
+    /*! \brief Constructor.
+
+       \param prec The preconditioner for single vectors, it has to
+       outlive this object.
+     */
+    explicit ColumnPreconditioner (P& prec)
+      : _prec(prec)
+    {}
+
+    /*!
+       \brief Prepare the preconditioner.
+
+       \copydoc Preconditioner::pre(X&,Y&)
+     */
+    virtual void pre (X& x, Y& b)
+    {
+      for (std::size_t c=0; c<x.columns(); ++c)
+      {
+        x.getColumn(c,_v);
+        b.getColumn(c,_d);
+        _prec.pre(_v,_d);
+        x.setColumn(c,_v);
+        b.setColumn(c,_d);
+      }
+    }
+
+    /*!
+       \brief Apply the precondioner.
+
+       \copydoc Preconditioner::apply(X&,const Y&)
+     */
+    virtual void apply (X& v, const Y& d)
+    {
+      for (std::size_t c=0; c<d.columns(); ++c)
+      {
+        v.getColumn(c,_v);
+        d.getColumn(c,_d);
+        _prec.apply(_v,_d);
+        v.setColumn(c,_v);
+      }
+    }
+
+    /*!
+       \brief Clean up.
+
+       \copydoc Preconditioner::post(X&)
+     */
+    virtual void post (X& x)
+    {
+      for (std::size_t c=0; c<x.columns(); ++c)
+      {
+        x.getColumn(c,_v);
+        _prec.post(_v);
+        x.setColumn(c,_v);
+      }
+    }
+
+  private:
+    P& _prec;
+    // the current column, kept to reuse the memory
+    typename P::domain_type _v;
+    typename P::range_type _d;
+  };
+
 
   /** @} end documentation */
 
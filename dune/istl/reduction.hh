@@ -0,0 +1,134 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_REDUCTION_HH
+#define DUNE_ISTL_REDUCTION_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "threadexecutor.hh"
+
+/*! \file
+ * \brief Threaded sums whose result does not depend on the number of threads.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  //! How the threaded reductions of the vectors add up their terms.
+  enum class Summation {
+    //! Plain floating point sums in a fixed order.
+    plain,
+    /**
+     * Kahan's compensated summation, for sums with much cancellation.
+     * About four times as many additions, and only effective if the
+     * compiler does not reassociate, e.g. without -ffast-math.
+     */
+    kahan
+  };
+
+  namespace Imp {
+
+    //! The number of terms summed up by one task of reproducibleSum().
+    constexpr std::size_t reductionSegment = 1024;
+
+    //! A running sum with Kahan's compensation of the rounding errors.
+    template<class R>
+    struct KahanSum
+    {
+      R sum = R(0);
+      R compensation = R(0);
+
+      void add (const R& x)
+      {
+        const R y = x - compensation;
+        const R t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+      }
+    };
+
+    //! The sum of f(i) for i in [begin,end), in an order that only depends on begin and end.
+    template<class R, class F>
+    R segmentSum (F& f, std::size_t begin, std::size_t end, Summation summation)
+    {
+      if (summation == Summation::kahan)
+      {
+        KahanSum<R> sum;
+        for (std::size_t i=begin; i<end; ++i)
+          sum.add(R(f(i)));
+        return sum.sum;
+      }
+
+      // four independent sums, which the compiler can keep in one SIMD register
+      R s0(0), s1(0), s2(0), s3(0);
+      std::size_t i = begin;
+      for (; i+4<=end; i+=4)
+      {
+        s0 += R(f(i));
+        s1 += R(f(i+1));
+        s2 += R(f(i+2));
+        s3 += R(f(i+3));
+      }
+      for (; i<end; ++i)
+        s0 += R(f(i));
+      return (s0 + s1) + (s2 + s3);
+    }
+
+    //! The sum of the partial sums [begin,end), added as a balanced binary tree.
+    template<class R>
+    R pairwiseSum (const std::vector<R>& partial, std::size_t begin, std::size_t end)
+    {
+      if (end-begin == 1)
+        return partial[begin];
+      const std::size_t middle = begin + (end-begin)/2;
+      return pairwiseSum(partial,begin,middle) + pairwiseSum(partial,middle,end);
+    }
+
+    /**
+     * @brief The sum of f(i) for i in [0,n), bitwise the same for any number of threads.
+     *
+     * The terms are split into segments of reductionSegment terms,
+     * whose sums are computed by the threads of exec. The segment sums
+     * are then added up on the calling thread, pairwise for plain sums
+     * and in order for Kahan sums. As neither step depends on the
+     * distribution of the segments to the threads, neither does the
+     * result.
+     */
+    template<class R, class F>
+    R reproducibleSum (std::size_t n, F&& f, const ThreadExecutor& exec, Summation summation)
+    {
+      const std::size_t segments = (n + reductionSegment - 1)/reductionSegment;
+      if (segments <= 1)
+        return segmentSum<R>(f,0,n,summation);
+
+      std::vector<R> partial(segments);
+      const RowPartition partition(segments, exec.parallel(n) ? exec.threads() : 1);
+      exec.run(partition, [&](std::size_t begin, std::size_t end) {
+          for (std::size_t k=begin; k<end; ++k)
+            partial[k] = segmentSum<R>(f, k*reductionSegment,
+                                       std::min(n,(k+1)*reductionSegment), summation);
+        });
+
+      if (summation == Summation::kahan)
+      {
+        KahanSum<R> sum;
+        for (const R& p : partial)
+          sum.add(p);
+        return sum.sum;
+      }
+      return pairwiseSum(partial,0,segments);
+    }
+
+  } // end namespace Imp
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
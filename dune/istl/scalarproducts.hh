@@ -7,7 +7,10 @@
 #include <complex>
 #include <iostream>
 #include <iomanip>
+#include <initializer_list>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "bvector.hh"
 #include "solvercategory.hh"
@@ -59,6 +62,73 @@ namespace Dune {
      */
     virtual real_type norm (const X& x) = 0;
 
+    /*! \brief Whether fused kernels may compute the products of dot() and norm().
+
+       The fused kernels of axpyNorm(), multiDot() and of the applyDot()
+       of the operators compute the products in the same pass as vector
+       updates or matrix-vector products, without calling dot() or
+       norm(). A scalar product opts in by returning true, which
+       SeqScalarProduct does for its serial reductions. A derived class
+       which overrides dot() or norm() has to return false.
+     */
+    virtual bool fusable () const
+    {
+      return false;
+    }
+
+    /*! \brief Update x += a*p and r -= a*q, then return the norm of r.
+
+       This is the update of the iterate and the defect followed by the
+       convergence check in CG-like solvers. Implementations may fuse the
+       three operations into one pass over the vectors.
+     */
+    virtual real_type axpyNorm (X& x, const field_type& a, const X& p, X& r, const X& q)
+    {
+      x.axpy(a,p);
+      r.axpy(-a,q);
+      return norm(r);
+    }
+
+    /*! \brief Start computing the dot products of several pairs of vectors.
+
+       The split-phase form of dot(): the product of the k-th pair is
+       stored in dots[k] once waitDots() returns, dots must not be
+       accessed before. Parallel scalar products sum up the local parts
+       of all products by a single nonblocking reduction, so that the
+       caller can apply the operator or the preconditioner in the
+       meantime. The vectors may be modified after startDots() returns.
+       Only one computation can be pending at a time.
+
+       The default computes the products right away by dot().
+     */
+    virtual void startDots (std::initializer_list<std::pair<const X*,const X*> > pairs,
+                            std::vector<field_type>& dots)
+    {
+      dots.resize(pairs.size());
+      std::size_t k = 0;
+      for (const auto& pair : pairs)
+        dots[k++] = dot(*pair.first,*pair.second);
+    }
+
+    //! Wait for the dot products started by startDots().
+    virtual void waitDots ()
+    {}
+
+    /*! \brief Dot products of many pairs of vectors, like a batch of dot() calls.
+
+       The product of the k-th pair is stored in dots[k]. Parallel
+       scalar products sum up the local parts of all products by a
+       single global reduction, e.g. for the Gram matrices of the
+       s-step solvers. The default computes the products by dot().
+     */
+    virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                           std::vector<field_type>& dots)
+    {
+      dots.resize(pairs.size());
+      for (std::size_t k=0; k<pairs.size(); ++k)
+        dots[k] = dot(*pairs[k].first,*pairs[k].second);
+    }
+
     //! every abstract base class has a virtual destructor
     virtual ~ScalarProduct () {}
   };
@@ -86,6 +156,53 @@ namespace Dune {
 
 
 
+  namespace Imp {
+
+    // Start the dot products of the pairs for the parallel scalar
+    // products. If the communication can sum up values without blocking,
+    // like OwnerOverlapCopyCommunication, the local parts of all products
+    // are summed up by a single reduction. Otherwise the products are
+    // computed right away.
+    template<class C, class Pairs, class F>
+    auto startCommunicationDots (const C& com, const Pairs& pairs, std::vector<F>& dots, int)
+      -> decltype(com.ownerMask(std::size_t()), com.startSum(dots.data(),0))
+    {
+      dots.resize(pairs.size());
+      std::size_t k = 0;
+      for (const auto& pair : pairs)
+      {
+        const auto& x = *pair.first;
+        const auto& y = *pair.second;
+        const std::vector<double>& mask = com.ownerMask(x.size());
+        F sum(0);
+        for (std::size_t i=0; i<x.size(); ++i)
+          sum += x[i].dot(y[i])*mask[i];
+        dots[k++] = sum;
+      }
+      return com.startSum(dots.data(),static_cast<int>(dots.size()));
+    }
+
+    template<class C, class Pairs, class F>
+    void startCommunicationDots (const C& com, const Pairs& pairs, std::vector<F>& dots, long)
+    {
+      dots.resize(pairs.size());
+      std::size_t k = 0;
+      for (const auto& pair : pairs)
+        com.dot(*pair.first,*pair.second,dots[k++]);
+    }
+
+    template<class C>
+    auto waitCommunicationDots (const C& com, int) -> decltype(com.waitSum())
+    {
+      return com.waitSum();
+    }
+
+    template<class C>
+    void waitCommunicationDots (const C&, long)
+    {}
+
+  } // end namespace Imp
+
   //=====================================================================
   // Implementation for ISTL-matrix based operator
   //=====================================================================
@@ -103,22 +220,130 @@ namespace Dune {
     //! define the category
     enum {category=SolverCategory::sequential};
 
+    //! Use the serial reductions of the vectors.
+    SeqScalarProduct () = default;
+
+    /*! \brief Use the threaded reductions of BlockVector.
+
+       Their results are bitwise the same for any number of threads of
+       exec, see BlockVector::dot(). The executor has to outlive the
+       scalar product.
+     */
+    explicit SeqScalarProduct (const ThreadExecutor& exec, Summation summation = Summation::plain)
+      : exec_(&exec), summation_(summation)
+    {
+      static_assert(Imp::IsBlockVector<X>::value, "threaded reductions need a BlockVector");
+    }
+
+    /*! \brief Whether fused kernels may compute the products, true for the serial reductions.
+
+       The threaded reductions are not fused, to keep their results
+       independent of the number of threads. Derived classes which
+       override dot() or norm() have to override this to return false.
+     */
+    virtual bool fusable () const
+    {
+      return !exec_;
+    }
+
     /*! \brief Dot product of two vectors. In the complex case, the first argument is conjugated.
        It is assumed that the vectors are consistent on the interior+border
        partition.
      */
     virtual field_type dot (const X& x, const X& y)
     {
-      return x.dot(y);
+      return exec_ ? threadedDot(Imp::IsBlockVector<X>(),x,y) : x.dot(y);
     }
 
     /*! \brief Norm of a right-hand side vector.
        The vector must be consistent on the interior+border partition
      */
     virtual real_type norm (const X& x)
+    {
+      return exec_ ? threadedNorm(Imp::IsBlockVector<X>(),x) : x.two_norm();
+    }
+
+    /*! \brief Update x += a*p and r -= a*q, then return the norm of r.
+
+       For BlockVectors this is done in a single pass by fusedAxpyNorm2(),
+       with the same operations in the same order as the separate updates.
+       If fusable() is false, the updates are followed by norm().
+     */
+    virtual real_type axpyNorm (X& x, const field_type& a, const X& p, X& r, const X& q)
+    {
+      if (!fusable())
+        return ScalarProduct<X>::axpyNorm(x,a,p,r,q);
+      return fusedAxpyNorm(Imp::IsBlockVector<X>(),x,a,p,r,q);
+    }
+
+    /*! \brief Dot products of many pairs of vectors.
+
+       If all pairs of BlockVectors have the same second vector, like
+       the projections of the Gram-Schmidt method, the products are
+       computed by fusedDots() in a single pass over that vector, with
+       the results of dot(). If fusable() is false, each product is
+       computed by dot().
+     */
+    virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                           std::vector<field_type>& dots)
+    {
+      if (!fusable() || pairs.empty())
+        return ScalarProduct<X>::multiDot(pairs,dots);
+      for (const auto& pair : pairs)
+        if (pair.second != pairs.front().second)
+          return ScalarProduct<X>::multiDot(pairs,dots);
+      fusedMultiDot(Imp::IsBlockVector<X>(),pairs,dots);
+    }
+
+  private:
+    void fusedMultiDot (std::true_type, const std::vector<std::pair<const X*,const X*> >& pairs,
+                        std::vector<field_type>& dots)
+    {
+      std::vector<const X*> vs(pairs.size());
+      for (std::size_t k=0; k<pairs.size(); ++k)
+        vs[k] = pairs[k].first;
+      fusedDots(vs,*pairs.front().second,dots);
+    }
+
+    void fusedMultiDot (std::false_type, const std::vector<std::pair<const X*,const X*> >& pairs,
+                        std::vector<field_type>& dots)
+    {
+      ScalarProduct<X>::multiDot(pairs,dots);
+    }
+
+    field_type threadedDot (std::true_type, const X& x, const X& y)
+    {
+      return x.dot(y,*exec_,summation_);
+    }
+
+    field_type threadedDot (std::false_type, const X& x, const X& y)
+    {
+      return x.dot(y);
+    }
+
+    real_type threadedNorm (std::true_type, const X& x)
+    {
+      return x.two_norm(*exec_,summation_);
+    }
+
+    real_type threadedNorm (std::false_type, const X& x)
     {
       return x.two_norm();
     }
+
+    real_type fusedAxpyNorm (std::true_type, X& x, const field_type& a, const X& p, X& r, const X& q)
+    {
+      using std::sqrt;
+      return sqrt(fusedAxpyNorm2(x,a,p,r,q));
+    }
+
+    real_type fusedAxpyNorm (std::false_type, X& x, const field_type& a, const X& p, X& r, const X& q)
+    {
+      return ScalarProduct<X>::axpyNorm(x,a,p,r,q);
+    }
+
+    const ThreadExecutor* exec_ = nullptr;
+    Summation summation_ = Summation::plain;
   };
 
   template<class X, class C>
@@ -7,6 +7,7 @@
 #include <fstream>               // for input/output to files
 #include <vector>                // STL vector class
 #include <sstream>
+#include <type_traits>
 
 #include <cmath>                // Yes, we do some math here
 
@@ -47,6 +48,36 @@ namespace Dune {
    * Currently only data parallel versions are shipped with dune-istl. Domain
    * decomposition can be found in module dune-dd.
    */
+  template<class X, class C>
+  class OverlappingSchwarzScalarProduct;
+
+  namespace Imp {
+
+    // Compute the local part of the global scalar product together with
+    // the matrix-vector product if both the matrix and the communication
+    // support it. The local results are summed up by a single reduction.
+    template<class M, class C, class X, class Y, class SP>
+    auto overlappingMVDot (const M& A, const C& com, const X& x, Y& y, SP&, int)
+      -> typename std::enable_if<std::is_same<X,Y>::value,
+                                 decltype(A.mvdot(x,y,com.ownerMask(x.size())),
+                                          com.communicator().sum(typename X::field_type()))>::type
+    {
+      const typename X::field_type local = A.mvdot(x,y,com.ownerMask(x.size()));
+      com.project(y);
+      return com.communicator().sum(local);
+    }
+
+    template<class M, class C, class X, class Y, class SP>
+    typename X::field_type overlappingMVDot (const M& A, const C& com, const X& x, Y& y, SP& sp, long)
+    {
+      y = 0;
+      A.umv(x,y);
+      com.project(y);
+      return scalarProductDot(sp,x,y,0);
+    }
+
+  } // end namespace Imp
+
   /**
      @addtogroup ISTL_Operators
      @{
@@ -131,6 +162,19 @@ namespace Dune {
                                     // since there d is const!
     }
 
+    /*! \brief apply operator to x and return the scalar product with the result
+
+       If sp.fusable(), like for OverlappingSchwarzScalarProduct, the
+       local part of the scalar product is computed together with the
+       matrix-vector product and then summed up over all processes.
+     */
+    virtual field_type applyDot (const X& x, Y& y, ScalarProduct<X>& sp) const
+    {
+      if (sp.fusable())
+        return Imp::overlappingMVDot(_A_,communication,x,y,sp,0);
+      return AssembledLinearOperator<M,X,Y>::applyDot(x,y,sp);
+    }
+
     //! get the sequential assembled linear operator.
     virtual const matrix_type& getmat () const
     {
@@ -207,6 +251,46 @@ namespace Dune {
       return communication.norm(x);
     }
 
+    /*! \brief The owner-masked local products, summed up over the processes, may be fused.
+
+       Derived classes which override dot() or norm() have to override
+       this to return false.
+     */
+    virtual bool fusable () const
+    {
+      return true;
+    }
+
+    /*! \brief Start computing the dot products of several pairs of vectors.
+
+       The local parts of all products are summed up over the processes
+       by a single reduction, which is nonblocking if the communication
+       object supports it, see OwnerOverlapCopyCommunication::startSum().
+     */
+    virtual void startDots (std::initializer_list<std::pair<const X*,const X*> > pairs,
+                            std::vector<field_type>& dots)
+    {
+      Imp::startCommunicationDots(communication,pairs,dots,0);
+    }
+
+    //! Wait for the dot products started by startDots().
+    virtual void waitDots ()
+    {
+      Imp::waitCommunicationDots(communication,0);
+    }
+
+    /*! \brief Dot products of many pairs of vectors.
+
+       The local parts of all products are summed up over the processes
+       by a single reduction.
+     */
+    virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                           std::vector<field_type>& dots)
+    {
+      Imp::startCommunicationDots(communication,pairs,dots,0);
+      Imp::waitCommunicationDots(communication,0);
+    }
+
   private:
     const communication_type& communication;
   };
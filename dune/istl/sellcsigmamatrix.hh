@@ -0,0 +1,338 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_SELLCSIGMAMATRIX_HH
+#define DUNE_ISTL_SELLCSIGMAMATRIX_HH
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "istlexception.hh"
+#include "bcrsmatrix.hh"
+#include "threadexecutor.hh"
+
+/*! \file
+ * \brief A read-only sliced ELLPACK (SELL-C-sigma) copy of a BCRSMatrix.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief A read-only sparse matrix in SELL-C-\f$\sigma\f$ format.
+   *
+   * The rows of the matrix are grouped into chunks of C consecutive rows.
+   * Within a chunk all rows are padded to the length of the longest row and
+   * the entries are stored column by column, i.e. the k-th entries of the
+   * C rows of a chunk are adjacent in memory. The matrix-vector products
+   * thus process C rows at once in their innermost loop, which the compiler
+   * can map onto SIMD lanes even for scalar blocks such as
+   * FieldMatrix<double,1,1>.
+   *
+   * To reduce the padding the rows are sorted by decreasing length within
+   * windows of \f$\sigma\f$ rows before they are grouped into chunks. The
+   * sorting only affects the internal storage, the matrix is indexed by
+   * the original row numbers.
+   *
+   * Padding entries are zero blocks referring to a valid column, so they
+   * contribute exact zeros as long as the input vector is finite.
+   *
+   * The matrix is built from a fully built BCRSMatrix and does not support
+   * changing the values or the pattern afterwards. Use it with
+   * MatrixAdapter to obtain a LinearOperator for the iterative solvers:
+   * \code
+   * Dune::SellCSigmaMatrix<Dune::FieldMatrix<double,1,1> > S(A);
+   * Dune::MatrixAdapter<decltype(S),Vector,Vector> op(S);
+   * Dune::CGSolver<Vector> solver(op,prec,1e-8,100,0);
+   * \endcode
+   *
+   * \tparam B The block type.
+   * \tparam C The number of rows per chunk, usually the SIMD width.
+   * \tparam A The allocator used for the blocks.
+   */
+  template<class B, int C = 8, class A=std::allocator<B> >
+  class SellCSigmaMatrix
+  {
+  public:
+    //! export the type representing the field
+    typedef typename B::field_type field_type;
+
+    //! export the type representing the components
+    typedef B block_type;
+
+    //! export the allocator type
+    typedef A allocator_type;
+
+    //! The type for the index access and the size
+    typedef typename A::size_type size_type;
+
+    enum {
+      //! The number of blocklevels the matrix contains.
+      blocklevel = B::blocklevel+1,
+      //! The number of rows per chunk.
+      chunkSize = C
+    };
+
+    static_assert(C>0, "The chunk size has to be positive");
+
+    //! An empty matrix.
+    SellCSigmaMatrix ()
+      : n_(0), m_(0), nnz_(0), sigma_(1), chunkOffset_(1,0)
+    {}
+
+    /**
+     * @brief Build from a BCRSMatrix.
+     *
+     * @param mat The matrix to copy, it has to be fully built.
+     * @param sigma The size of the windows in which the rows are sorted by
+     * length. 1 disables the sorting.
+     */
+    template<class OtherA>
+    explicit SellCSigmaMatrix (const BCRSMatrix<B,OtherA>& mat, size_type sigma = 32*C)
+      : SellCSigmaMatrix()
+    {
+      assign(mat,sigma);
+    }
+
+    //! Rebuild from a BCRSMatrix, discarding the previous content.
+    template<class OtherA>
+    void assign (const BCRSMatrix<B,OtherA>& mat, size_type sigma = 32*C)
+    {
+      typedef BCRSMatrix<B,OtherA> Matrix;
+      if (mat.buildStage() != Matrix::built)
+        DUNE_THROW(BCRSMatrixError,"SellCSigmaMatrix can only be built from a fully built BCRSMatrix");
+
+      n_ = mat.N();
+      m_ = mat.M();
+      sigma_ = std::max(sigma,size_type(1));
+      nnz_ = 0;
+
+      std::vector<size_type> rowLength(n_);
+      for (auto row = mat.begin(); row != mat.end(); ++row)
+      {
+        rowLength[row.index()] = row->size();
+        nnz_ += row->size();
+      }
+
+      // sort by decreasing row length within each window of sigma rows
+      perm_.resize(n_);
+      std::iota(perm_.begin(),perm_.end(),size_type(0));
+      for (size_type begin=0; begin<n_; begin+=sigma_)
+      {
+        const size_type end = std::min(begin+sigma_,n_);
+        std::stable_sort(perm_.begin()+begin,perm_.begin()+end,
+                         [&](size_type a, size_type b) { return rowLength[a] > rowLength[b]; });
+      }
+
+      // compute the chunk widths and offsets
+      const size_type chunks = (n_+C-1)/C;
+      chunkOffset_.assign(chunks+1,0);
+      for (size_type c=0; c<chunks; ++c)
+      {
+        size_type width = 0;
+        for (size_type lane=0; lane<C && c*C+lane<n_; ++lane)
+          width = std::max(width,rowLength[perm_[c*C+lane]]);
+        chunkOffset_[c+1] = chunkOffset_[c] + width*C;
+      }
+
+      // fill in the entries column by column, padding with zeros
+      values_.assign(chunkOffset_[chunks],B(0));
+      columns_.assign(chunkOffset_[chunks],0);
+      for (size_type c=0; c<chunks; ++c)
+        for (size_type lane=0; lane<C && c*C+lane<n_; ++lane)
+        {
+          const auto& row = mat[perm_[c*C+lane]];
+          size_type k = chunkOffset_[c]+lane;
+          for (auto col = row.begin(); col != row.end(); ++col, k+=C)
+          {
+            values_[k] = *col;
+            columns_[k] = col.index();
+          }
+        }
+    }
+
+    //===== linear maps
+
+    //! y = A x
+    template<class X, class Y>
+    void mv (const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      mvChunks(x,y,0,chunkOffset_.size()-1);
+    }
+
+    //! y = A x, with the chunks distributed over the threads of exec
+    template<class X, class Y>
+    void mv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      if (!exec.parallel(n_))
+        return mvChunks(x,y,0,chunkOffset_.size()-1);
+      exec.run(chunkPartition(exec.threads()),
+               [&](size_type begin, size_type end) { mvChunks(x,y,begin,end); });
+    }
+
+    //! y += A x
+    template<class X, class Y>
+    void umv (const X& x, Y& y) const
+    {
+      usmv(field_type(1),x,y);
+    }
+
+    //! y -= A x
+    template<class X, class Y>
+    void mmv (const X& x, Y& y) const
+    {
+      usmv(field_type(-1),x,y);
+    }
+
+    //! y += alpha A x
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      usmvChunks(alpha,x,y,0,chunkOffset_.size()-1);
+    }
+
+    //! y += alpha A x, with the chunks distributed over the threads of exec
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#endif
+      if (!exec.parallel(n_))
+        return usmvChunks(alpha,x,y,0,chunkOffset_.size()-1);
+      exec.run(chunkPartition(exec.threads()),
+               [&](size_type begin, size_type end) { usmvChunks(alpha,x,y,begin,end); });
+    }
+
+    //===== sizes
+
+    //! number of rows (counted in blocks)
+    size_type N () const
+    {
+      return n_;
+    }
+
+    //! number of columns (counted in blocks)
+    size_type M () const
+    {
+      return m_;
+    }
+
+    //! number of nonzero blocks of the original matrix
+    size_type nonzeroes () const
+    {
+      return nnz_;
+    }
+
+    //! number of stored blocks, including the padding
+    size_type storedBlocks () const
+    {
+      return values_.size();
+    }
+
+    //! the size of the sorting windows
+    size_type sigma () const
+    {
+      return sigma_;
+    }
+
+  private:
+    // The accumulator for C rows is kept in a local array, so that the
+    // innermost loop runs over the rows of a chunk.
+    template<class X, class Y>
+    void mvChunks (const X& x, Y& y, size_type begin, size_type end) const
+    {
+      typename Y::block_type acc[C];
+      for (size_type c=begin; c<end; ++c)
+      {
+        computeChunk(c,x,acc);
+        for (size_type lane=0; lane<C && c*C+lane<n_; ++lane)
+          y[perm_[c*C+lane]] = acc[lane];
+      }
+    }
+
+    template<class X, class Y, class F>
+    void usmvChunks (const F& alpha, const X& x, Y& y, size_type begin, size_type end) const
+    {
+      typename Y::block_type acc[C];
+      for (size_type c=begin; c<end; ++c)
+      {
+        computeChunk(c,x,acc);
+        for (size_type lane=0; lane<C && c*C+lane<n_; ++lane)
+          y[perm_[c*C+lane]].axpy(alpha,acc[lane]);
+      }
+    }
+
+    template<class X, class YB>
+    void computeChunk (size_type c, const X& x, YB* acc) const
+    {
+      for (int lane=0; lane<C; ++lane)
+        acc[lane] = 0;
+      const B* a = values_.data() + chunkOffset_[c];
+      const size_type* j = columns_.data() + chunkOffset_[c];
+      const B* aend = values_.data() + chunkOffset_[c+1];
+      for (; a!=aend; a+=C, j+=C)
+        for (int lane=0; lane<C; ++lane)
+          a[lane].umv(x[j[lane]],acc[lane]);
+    }
+
+    // split the chunks such that every thread gets the same number of stored blocks
+    RowPartition chunkPartition (size_type threads) const
+    {
+      const size_type chunks = chunkOffset_.size()-1;
+      std::vector<size_type> offsets(threads+1,chunks);
+      offsets[0] = 0;
+      for (size_type t=1; t<threads; ++t)
+      {
+        // weight empty chunks as well to distribute the write-back of y
+        auto work = [&](size_type c) { return chunkOffset_[c] + c*C; };
+        const size_type target = (work(chunks)*t)/threads;
+        size_type lo = offsets[t-1], hi = chunks;
+        while (lo<hi)
+        {
+          const size_type mid = (lo+hi)/2;
+          if (work(mid)<target)
+            lo = mid+1;
+          else
+            hi = mid;
+        }
+        offsets[t] = lo;
+      }
+      return RowPartition(std::move(offsets));
+    }
+
+    size_type n_;
+    size_type m_;
+    size_type nnz_;
+    size_type sigma_;
+    // chunkOffset_[c] is the position of the first entry of chunk c
+    std::vector<size_type> chunkOffset_;
+    // perm_[k] is the original index of the k-th stored row
+    std::vector<size_type> perm_;
+    std::vector<size_type> columns_;
+    std::vector<B,A> values_;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
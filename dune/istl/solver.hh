@@ -6,6 +6,7 @@
 
 #include <iomanip>
 #include <ostream>
+#include <vector>
 #include "solvertype.hh"
 
 namespace Dune
@@ -63,6 +64,35 @@ namespace Dune
     double elapsed;
   };
 
+  /**
+      \brief Statistics about the solution for several right-hand sides
+
+      In addition to the statistics of all columns together, this holds
+      those of each column of a block solver like BlockCGSolver. The
+      iterations and the reduction of all columns are the largest ones of
+      the columns, and they have converged if all columns have converged.
+   */
+  struct BlockInverseOperatorResult : public InverseOperatorResult
+  {
+    /** \brief Resets all data */
+    void clear ()
+    {
+      InverseOperatorResult::clear();
+      columnIterations.clear();
+      columnReductions.clear();
+      columnConverged.clear();
+    }
+
+    /** \brief Number of iterations until each column has converged */
+    std::vector<int> columnIterations;
+
+    /** \brief Reduction achieved for each column */
+    std::vector<double> columnReductions;
+
+    /** \brief True for the columns that met the convergence criterion */
+    std::vector<bool> columnConverged;
+  };
+
 
   //=====================================================================
   /*!
@@ -4,16 +4,20 @@
 #ifndef DUNE_ISTL_SOLVERS_HH
 #define DUNE_ISTL_SOLVERS_HH
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <array>
 #include <type_traits>
 
+#include "denseutils.hh"
 #include "istlexception.hh"
 #include "operators.hh"
 #include "scalarproducts.hh"
@@ -38,10 +42,153 @@ namespace Dune {
       This file provides various preconditioned Krylov methods.
    */
 
+  namespace Imp {
+
+    //! p = beta*p + q, in a single pass for BlockVectors
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& q, std::true_type)
+    {
+      typedef typename X::field_type K;
+      fusedForEach([&beta](K& pk, const K& qk) {
+          pk *= beta;
+          pk += qk;
+        }, p, q);
+    }
+
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& q, std::false_type)
+    {
+      p *= beta;
+      p += q;
+    }
+
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& q)
+    {
+      scaleAdd(p,beta,q,IsBlockVector<X>());
+    }
+
+    //! p = beta*(p - omega*v) + r, in a single pass for BlockVectors
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& r,
+                   const typename X::field_type& omega, const X& v, std::true_type)
+    {
+      typedef typename X::field_type K;
+      const K minusOmega = -omega;
+      fusedForEach([&](K& pk, const K& rk, const K& vk) {
+          pk += minusOmega*vk;
+          pk *= beta;
+          pk += rk;
+        }, p, r, v);
+    }
+
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& r,
+                   const typename X::field_type& omega, const X& v, std::false_type)
+    {
+      p.axpy(-omega,v);
+      p *= beta;
+      p += r;
+    }
+
+    template<class X>
+    void scaleAdd (X& p, const typename X::field_type& beta, const X& r,
+                   const typename X::field_type& omega, const X& v)
+    {
+      scaleAdd(p,beta,r,omega,v,IsBlockVector<X>());
+    }
+
+    //! The recurrences of one iteration of PipelinedCGSolver, in a single pass for BlockVectors
+    template<class X>
+    void pipelinedCGUpdate (const typename X::field_type& alpha, const typename X::field_type& beta,
+                            X& x, X& r, X& u, X& w, X& z, X& q, X& s, X& p,
+                            const X& m, const X& n, std::true_type)
+    {
+      typedef typename X::field_type K;
+      fusedForEach([&](K& xk, K& rk, K& uk, K& wk, K& zk, K& qk, K& sk, K& pk,
+                       const K& mk, const K& nk) {
+          zk *= beta;
+          zk += nk;
+          qk *= beta;
+          qk += mk;
+          sk *= beta;
+          sk += wk;
+          pk *= beta;
+          pk += uk;
+          xk += alpha*pk;
+          rk -= alpha*sk;
+          uk -= alpha*qk;
+          wk -= alpha*zk;
+        }, x, r, u, w, z, q, s, p, m, n);
+    }
+
+    template<class X>
+    void pipelinedCGUpdate (const typename X::field_type& alpha, const typename X::field_type& beta,
+                            X& x, X& r, X& u, X& w, X& z, X& q, X& s, X& p,
+                            const X& m, const X& n, std::false_type)
+    {
+      scaleAdd(z,beta,n,std::false_type());
+      scaleAdd(q,beta,m,std::false_type());
+      scaleAdd(s,beta,w,std::false_type());
+      scaleAdd(p,beta,u,std::false_type());
+      x.axpy(alpha,p);
+      r.axpy(-alpha,s);
+      u.axpy(-alpha,q);
+      w.axpy(-alpha,z);
+    }
+
+  } // end namespace Imp
+
   //=====================================================================
   // Implementation of this interface
   //=====================================================================
 
+  /**
+     \brief Shifts for the Newton basis of SStepCGSolver and SStepGMResSolver.
+
+     Returns count Chebyshev points of the interval [lmin,lmax] in the
+     Leja ordering, where each point maximizes the product of its
+     distances to the previous ones. If the interval encloses the
+     spectrum of the preconditioned operator, the Newton basis built
+     with these shifts is much better conditioned than the monomial one.
+   */
+  template<class R>
+  std::vector<R> newtonShifts (const R& lmin, const R& lmax, int count)
+  {
+    using std::abs;
+    using std::cos;
+    using std::log;
+    const R pi = std::acos(R(-1));
+    std::vector<R> points(count), shifts;
+    for (int i=0; i<count; ++i)
+      points[i] = (lmin+lmax)/2 + (lmax-lmin)/2*cos(pi*(2*i+1)/(2*count));
+
+    std::vector<bool> used(count,false);
+    for (int k=0; k<count; ++k)
+    {
+      int best = -1;
+      R bestValue = 0;
+      for (int i=0; i<count; ++i)
+      {
+        if (used[i])
+          continue;
+        // the logarithm of the product, which could overflow
+        R value = (k==0) ? log(abs(points[i])) : R(0);
+        for (const R& shift : shifts)
+          value += log(abs(points[i]-shift));
+        if (best<0 || value>bestValue)
+        {
+          best = i;
+          bestValue = value;
+        }
+      }
+      used[best] = true;
+      shifts.push_back(points[best]);
+    }
+    return shifts;
+  }
+
+
   /*!
      \brief Preconditioned loop solver.
 
@@ -303,10 +450,9 @@ namespace Dune {
         _prec.apply(p,b);           // apply preconditioner
         _op.apply(p,q);             // q=Ap
         lambda = _sp.dot(p,b)/_sp.dot(q,p); // minimization
-        x.axpy(lambda,p);           // update solution
-        b.axpy(-lambda,q);          // update defect
 
-        real_type defnew=_sp.norm(b); // comp defect norm
+        // update solution and defect, comp defect norm
+        real_type defnew=_sp.axpyNorm(x,lambda,p,b,q);
         if (_verbose>1)             // print
           this->printOutput(std::cout,i,defnew,def);
 
@@ -474,14 +620,11 @@ namespace Dune {
       for ( ; i<=_maxit; i++ )
       {
         // minimize in given search direction p
-        _op.apply(p,q);             // q=Ap
-        alpha = _sp.dot(p,q);       // scalar product
+        alpha = _op.applyDot(p,q,_sp); // q=Ap and scalar product
         lambda = rholast/alpha;     // minimization
-        x.axpy(lambda,p);           // update solution
-        b.axpy(-lambda,q);          // update defect
 
-        // convergence test
-        real_type defnew=_sp.norm(b); // comp defect norm
+        // update solution and defect, convergence test
+        real_type defnew=_sp.axpyNorm(x,lambda,p,b,q); // comp defect norm
 
         if (_verbose>1)             // print
           this->printOutput(std::cout,i,defnew,def);
@@ -507,8 +650,7 @@ namespace Dune {
         _prec.apply(q,b);           // apply preconditioner
         rho = _sp.dot(q,b);         // orthogonalization
         beta = rho/rholast;         // scaling factor
-        p *= beta;                  // scale old search direction
-        p += q;                     // orthogonalization with correction
+        Imp::scaleAdd(p,beta,q);    // p = beta*p + q, orthogonalization with correction
         rholast = rho;              // remember rho for recurrence
       }
 
@@ -564,43 +706,57 @@ namespace Dune {
   };
 
 
-  // Ronald Kriemanns BiCG-STAB implementation from Sumo
-  //! \brief Bi-conjugate Gradient Stabilized (BiCG-STAB)
+  /**
+     \brief Pipelined preconditioned conjugate gradient method.
+
+     The variant of CG by Ghysels and Vanroose, "Hiding global
+     synchronization latency in the preconditioned Conjugate Gradient
+     algorithm", Parallel Computing 40 (2014). All scalar products of an
+     iteration, including the norm of the defect, are computed by a
+     single call of ScalarProduct::startDots(). With the parallel scalar
+     products, their global reduction then overlaps the application of
+     the preconditioner and of the operator.
+
+     In exact arithmetic, the iterates are those of CGSolver. The
+     additional recurrences for the preconditioned defect and its image
+     under the operator need four more vectors and accumulate more
+     rounding errors, so the attainable accuracy can be somewhat lower.
+     The convergence test uses the norm of the recursively updated
+     defect.
+   */
   template<class X>
-  class BiCGSTABSolver : public InverseOperator<X,X> {
+  class PipelinedCGSolver : public InverseOperator<X,X> {
   public:
     //! \brief The domain type of the operator to be inverted.
     typedef X domain_type;
     //! \brief The range type of the operator to be inverted.
     typedef X range_type;
-    //! \brief The field type of the operator to be inverted
+    //! \brief The field type of the operator to be inverted.
     typedef typename X::field_type field_type;
     //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
     typedef typename FieldTraits<field_type>::real_type real_type;
 
     /*!
-       \brief Set up solver.
+       \brief Set up pipelined conjugate gradient solver.
 
        \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
      */
     template<class L, class P>
-    BiCGSTABSolver (L& op, P& prec,
-                    real_type reduction, int maxit, int verbose) :
+    PipelinedCGSolver (L& op, P& prec, real_type reduction, int maxit, int verbose) :
       ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
     {
       static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
-                    "L and P must be of the same category!");
+                    "L and P must have the same category!");
       static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
                     "L must be sequential!");
     }
     /*!
-       \brief Set up solver.
+       \brief Set up pipelined conjugate gradient solver.
 
        \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
      */
     template<class L, class S, class P>
-    BiCGSTABSolver (L& op, S& sp, P& prec,
-                    real_type reduction, int maxit, int verbose) :
+    PipelinedCGSolver (L& op, S& sp, P& prec, real_type reduction, int maxit, int verbose) :
       _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
     {
       static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
@@ -614,214 +770,153 @@ namespace Dune {
 
        \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
 
-       \note Currently, the BiCGSTABSolver aborts when it detects a breakdown.
+       \note Like CGSolver, the solver aborts when a NaN or infinite defect
+             is detected.
      */
     virtual void apply (X& x, X& b, InverseOperatorResult& res)
     {
-      using std::abs;
-      const real_type EPSILON=1e-80;
-      using std::abs;
-      double it;
-      field_type rho, rho_new, alpha, beta, h, omega;
-      real_type norm, norm_old, norm_0;
-
-      //
-      // get vectors and matrix
-      //
-      X& r=b;
-      X p(x);
-      X v(x);
-      X t(x);
-      X y(x);
-      X rt(x);
-
-      //
-      // begin iteration
-      //
+      using std::isfinite;
+      using std::sqrt;
+      using std::real;
 
-      // r = r - Ax; rt = r
-      res.clear();                // clear solver statistics
+      res.clear();                  // clear solver statistics
       Timer watch;                // start a timer
-      _prec.pre(x,r);             // prepare preconditioner
-      _op.applyscaleadd(-1,x,r);  // overwrite b with defect
-
-      rt=r;
-
-      norm = norm_old = norm_0 = _sp.norm(r);
-
-      p=0;
-      v=0;
-
-      rho   = 1;
-      alpha = 1;
-      omega = 1;
-
-      if (_verbose>0)             // printing
+      _prec.pre(x,b);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,b);  // overwrite b with defect r
+
+      X u(x);              // the preconditioned defect u = M^{-1} r
+      X w(x);              // w = A u
+      X m(x);              // m = M^{-1} w
+      X n(x);              // n = A m
+      X p(x), s(x), q(x), z(x); // the search direction p and s = A p, q = M^{-1} s, z = A q
+      p = 0;
+      s = 0;
+      q = 0;
+      z = 0;
+
+      u = 0;
+      _prec.apply(u,b);
+      _op.apply(u,w);
+
+      // the loop, iteration i starts with the reduction for the defect of the previous one
+      std::vector<field_type> dots;
+      real_type def0 = 0, def = 0;
+      field_type gamma, gammalast = 0, delta, alpha = 0, beta;
+      int i=0;
+      for ( ; ; i++ )
       {
-        std::cout << "=== BiCGSTABSolver" << std::endl;
-        if (_verbose>1)
+        _sp.startDots({{&b,&u},{&w,&u},{&b,&b}},dots); // (r,u), (w,u), (r,r)
+        m = 0;
+        _prec.apply(m,w);
+        _op.apply(m,n);
+        _sp.waitDots();
+        gamma = dots[0];
+        delta = dots[1];
+        const real_type defnew = sqrt(real(dots[2]));
+
+        if (i==0)
         {
-          this->printHeader(std::cout);
-          this->printOutput(std::cout,0,norm_0);
-          //std::cout << " Iter       Defect         Rate" << std::endl;
-          //std::cout << "    0" << std::setw(14) << norm_0 << std::endl;
-        }
-      }
-
-      if ( all_true(norm < (_reduction * norm_0))  || max_value(norm)<1E-30)
-      {
-        res.converged = 1;
-        _prec.post(x);                  // postprocess preconditioner
-        res.iterations = 0;             // fill statistics
-        res.reduction = 0;
-        res.conv_rate  = 0;
-        res.elapsed = watch.elapsed();
-        return;
-      }
-
-      //
-      // iteration
-      //
-
-      for (it = 0.5; it < _maxit; it+=.5)
-      {
-        //
-        // preprocess, set vecsizes etc.
-        //
-
-        // rho_new = < rt , r >
-        rho_new = _sp.dot(rt,r);
-
-        // look if breakdown occurred
-        if (all_true(abs(rho) <= EPSILON))
-          DUNE_THROW(SolverAbort,"breakdown in BiCGSTAB - rho "
-                     << rho << " <= EPSILON " << max_value(EPSILON)
-                     << " after " << it << " iterations");
-        if (all_true(abs(omega) <= EPSILON))
-          DUNE_THROW(SolverAbort,"breakdown in BiCGSTAB - omega "
-                     << omega << " <= EPSILON " << max_value(EPSILON)
-                     << " after " << it << " iterations");
+          def0 = def = defnew;
+          if (!all_true(isfinite(def0))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== PipelinedCGSolver: abort due to infinite or NaN initial defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort, "PipelinedCGSolver: initial defect=" << def0
+                       << " is infinite or NaN");
+          }
 
+          if (max_value(def0)<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            res.iterations = 0;               // fill statistics
+            res.reduction = 0;
+            res.conv_rate  = 0;
+            res.elapsed=0;
+            if (_verbose>0)                 // final print
+              std::cout << "=== rate=" << res.conv_rate
+                        << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                        << ", IT=0" << std::endl;
+            return;
+          }
 
-        if (it<1)
-          p = r;
+          if (_verbose>0)             // printing
+          {
+            std::cout << "=== PipelinedCGSolver" << std::endl;
+            if (_verbose>1) {
+              this->printHeader(std::cout);
+              this->printOutput(std::cout,0,def0);
+            }
+          }
+        }
         else
         {
-          beta = ( rho_new / rho ) * ( alpha / omega );
-          p.axpy(-omega,v); // p = r + beta (p - omega*v)
-          p *= beta;
-          p += r;
-        }
-
-        // y = W^-1 * p
-        y = 0;
-        _prec.apply(y,p);           // apply preconditioner
-
-        // v = A * y
-        _op.apply(y,v);
-
-        // alpha = rho_new / < rt, v >
-        h = _sp.dot(rt,v);
-
-        if ( all_true(abs(h) < EPSILON) )
-          DUNE_THROW(SolverAbort,"abs(h) < EPSILON in BiCGSTAB - abs(h) "
-                     << abs(h) << " < EPSILON " << max_value(EPSILON)
-                     << " after " << it << " iterations");
-
-        alpha = rho_new / h;
-
-        // apply first correction to x
-        // x <- x + alpha y
-        x.axpy(alpha,y);
-
-        // r = r - alpha*v
-        r.axpy(-alpha,v);
-
-        //
-        // test stop criteria
-        //
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,defnew,def);
 
-        norm = _sp.norm(r);
+          def = defnew;               // update norm
+          if (!all_true(isfinite(def))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== PipelinedCGSolver: abort due to infinite or NaN defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort,
+                       "PipelinedCGSolver: defect=" << def << " is infinite or NaN");
+          }
 
-        if (_verbose>1) // print
-        {
-          this->printOutput(std::cout,it,norm,norm_old);
+          if (all_true(def<def0*_reduction) || max_value(def)<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
         }
-
-        if ( all_true(norm < (_reduction * norm_0)) )
-        {
-          res.converged = 1;
+        if (i==_maxit)
           break;
-        }
-        it+=.5;
-
-        norm_old = norm;
 
-        // y = W^-1 * r
-        y = 0;
-        _prec.apply(y,r);
-
-        // t = A * y
-        _op.apply(y,t);
-
-        // omega = < t, r > / < t, t >
-        omega = _sp.dot(t,r)/_sp.dot(t,t);
-
-        // apply second correction to x
-        // x <- x + omega y
-        x.axpy(omega,y);
-
-        // r = s - omega*t (remember : r = s)
-        r.axpy(-omega,t);
-
-        rho = rho_new;
-
-        //
-        // test stop criteria
-        //
-
-        norm = _sp.norm(r);
-
-        if (_verbose > 1)             // print
+        // the coefficients of CG, from the scalar products of the pipelined vectors
+        if (i==0)
         {
-          this->printOutput(std::cout,it,norm,norm_old);
+          beta = 0;
+          alpha = gamma/delta;
         }
-
-        if ( all_true(norm < (_reduction * norm_0))  || max_value(norm)<1E-30)
+        else
         {
-          res.converged = 1;
-          break;
+          beta = gamma/gammalast;
+          alpha = gamma/(delta - beta*gamma/alpha);
         }
+        gammalast = gamma;
 
-        norm_old = norm;
-      } // end for
+        Imp::pipelinedCGUpdate(alpha,beta,x,b,u,w,z,q,s,p,m,n,Imp::IsBlockVector<X>());
+      }
 
       //correct i which is wrong if convergence was not achieved.
-      it=std::min(static_cast<double>(_maxit),it);
+      i=std::max(1,i);
 
       if (_verbose==1)                // printing for non verbose
-        this->printOutput(std::cout,it,norm);
+        this->printOutput(std::cout,i,def);
 
       _prec.post(x);                  // postprocess preconditioner
-      res.iterations = static_cast<int>(std::ceil(it));              // fill statistics
-      res.reduction = static_cast<double>(max_value(norm/norm_0));
-      res.conv_rate  = pow(res.reduction,1.0/it);
+      res.iterations = i;             // fill statistics
+      res.reduction = static_cast<double>(max_value(max_value(def/def0)));
+      res.conv_rate  = pow(res.reduction,1.0/i);
       res.elapsed = watch.elapsed();
+
       if (_verbose>0)                 // final print
+      {
         std::cout << "=== rate=" << res.conv_rate
                   << ", T=" << res.elapsed
-                  << ", TIT=" << res.elapsed/it
-                  << ", IT=" << it << std::endl;
+                  << ", TIT=" << res.elapsed/i
+                  << ", IT=" << i << std::endl;
+      }
     }
 
     /*!
        \brief Apply inverse operator with given reduction factor.
 
        \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
-
-       \note Currently, the BiCGSTABSolver aborts when it detects a breakdown.
      */
-    virtual void apply (X& x, X& b, double reduction, InverseOperatorResult& res)
+    virtual void apply (X& x, X& b, double reduction,
+                        InverseOperatorResult& res)
     {
       real_type saved_reduction = _reduction;
       _reduction = reduction;
@@ -839,14 +934,32 @@ namespace Dune {
     int _verbose;
   };
 
-  /*! \brief Minimal Residual Method (MINRES)
 
-     Symmetrically Preconditioned MINRES as in A. Greenbaum, 'Iterative Methods for Solving Linear Systems', pp. 121
-     Iterative solver for symmetric indefinite operators.
-     Note that in order to ensure the (symmetrically) preconditioned system to remain symmetric, the preconditioner has to be spd.
+  /**
+     \brief s-step (communication-avoiding) preconditioned conjugate gradient method.
+
+     The s-step CG method of Chronopoulos and Gear, "s-step iterative
+     methods for symmetric linear systems", J. Comput. Appl. Math. 25
+     (1989). Each outer iteration builds the s basis vectors
+     \f$ v_0 = M^{-1}r \f$, \f$ v_{j+1} = M^{-1}Av_j - \theta_j v_j \f$ of the
+     Krylov space of the preconditioned operator and computes all
+     scalar products needed for the next s steps of CG by a single call
+     of ScalarProduct::multiDot(). This reduces the number of global
+     reductions by a factor of s. The block of s search directions is
+     made A-conjugate to the previous block, and the iterate then
+     minimizes the energy norm of the error over both blocks. For s=1
+     this is CGSolver.
+
+     Without shifts \f$ \theta_j \f$, the monomial basis becomes ill
+     conditioned for larger s, about s>5. Shifts for the Newton basis
+     from an estimate of the spectrum are computed by newtonShifts().
+     Directions that are numerically dependent on the previous ones are
+     dropped, so that an outer iteration may do less than s steps. The
+     defect is checked for convergence once per outer iteration, the
+     iterations are counted in steps of CG.
    */
   template<class X>
-  class MINRESSolver : public InverseOperator<X,X> {
+  class SStepCGSolver : public InverseOperator<X,X> {
   public:
     //! \brief The domain type of the operator to be inverted.
     typedef X domain_type;
@@ -858,235 +971,2162 @@ namespace Dune {
     typedef typename FieldTraits<field_type>::real_type real_type;
 
     /*!
-       \brief Set up MINRES solver.
+       \brief Set up s-step conjugate gradient solver.
 
        \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+       \param s The number of steps per outer iteration.
+       \param shifts The shifts of the Newton basis, used cyclically. If empty, the monomial basis is used.
      */
     template<class L, class P>
-    MINRESSolver (L& op, P& prec, real_type reduction, int maxit, int verbose) :
-      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    SStepCGSolver (L& op, P& prec, real_type reduction, int maxit, int verbose, int s,
+                   const std::vector<real_type>& shifts = std::vector<real_type>()) :
+      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _s(s), _shifts(shifts)
     {
       static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
                     "L and P must have the same category!");
       static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
                     "L must be sequential!");
+      checkSteps();
     }
     /*!
-       \brief Set up MINRES solver.
+       \brief Set up s-step conjugate gradient solver.
 
        \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+       \param s The number of steps per outer iteration.
+       \param shifts The shifts of the Newton basis, used cyclically. If empty, the monomial basis is used.
      */
     template<class L, class S, class P>
-    MINRESSolver (L& op, S& sp, P& prec, real_type reduction, int maxit, int verbose) :
-      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    SStepCGSolver (L& op, S& sp, P& prec, real_type reduction, int maxit, int verbose, int s,
+                   const std::vector<real_type>& shifts = std::vector<real_type>()) :
+      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _s(s), _shifts(shifts)
     {
       static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
                     "L and P must have the same category!");
       static_assert(static_cast<int>(L::category) == static_cast<int>(S::category),
                     "L and S must have the same category!");
+      checkSteps();
     }
 
     /*!
        \brief Apply inverse operator.
 
        \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+
+       \note Like CGSolver, the solver aborts when a NaN or infinite defect
+             is detected.
      */
     virtual void apply (X& x, X& b, InverseOperatorResult& res)
     {
-      using std::sqrt;
+      using std::isfinite;
+      using std::min;
+      using std::real;
+      using std::sqrt;
+      using std::swap;
+      typedef std::vector<std::vector<field_type> > DenseMatrix;
+
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec.pre(x,b);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,b);  // overwrite b with defect r
+
+      const std::size_t s = _s;
+      std::vector<X> V(s,x), W(s,x);   // the basis and its image W = A V
+      std::vector<X> P(s,x), AP(s,x);  // the block of search directions and its image
+      DenseMatrix G(s,std::vector<field_type>(s));  // V^H A V, then P^H A P
+      DenseMatrix L(s,std::vector<field_type>(s));  // the Cholesky factor of the previous P^H A P
+      DenseMatrix C(s,std::vector<field_type>(s));  // (AP)^H V for the previous block, then B
+      std::vector<field_type> g(s), column(s), dots;
+      std::vector<std::pair<const X*,const X*> > pairs;
+      const real_type tol = 100*std::numeric_limits<real_type>::epsilon();
+
+      std::size_t kprev = 0;        // the number of previous search directions
+      real_type def0 = 0, def = 0;
+      int i=0;                      // the number of CG steps done
+      for ( ; ; )
+      {
+        // the basis of the Krylov space and its image
+        for (std::size_t j=0; j<s; ++j)
+        {
+          V[j] = 0;
+          _prec.apply(V[j], j==0 ? b : W[j-1]);
+          if (j>0 && shift(j-1)!=real_type(0))
+            V[j].axpy(-shift(j-1),V[j-1]);
+          _op.apply(V[j],W[j]);
+        }
+
+        // all scalar products of the outer iteration by a single reduction
+        pairs.clear();
+        for (std::size_t l=0; l<s; ++l)
+          for (std::size_t m=0; m<=l; ++m)
+            pairs.emplace_back(&V[l],&W[m]);
+        for (std::size_t l=0; l<kprev; ++l)
+          for (std::size_t m=0; m<s; ++m)
+            pairs.emplace_back(&AP[l],&V[m]);
+        for (std::size_t l=0; l<s; ++l)
+          pairs.emplace_back(&V[l],&b);
+        pairs.emplace_back(&b,&b);
+        _sp.multiDot(pairs,dots);
+
+        std::size_t d = 0;
+        for (std::size_t l=0; l<s; ++l)
+          for (std::size_t m=0; m<=l; ++m)
+            G[l][m] = dots[d++];
+        for (std::size_t l=0; l<kprev; ++l)
+          for (std::size_t m=0; m<s; ++m)
+            C[l][m] = dots[d++];
+        for (std::size_t l=0; l<s; ++l)
+          g[l] = dots[d++];
+        const real_type defnew = sqrt(real(dots[d]));
+
+        if (i==0)
+        {
+          def0 = def = defnew;
+          if (!all_true(isfinite(def0))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== SStepCGSolver: abort due to infinite or NaN initial defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort, "SStepCGSolver: initial defect=" << def0
+                       << " is infinite or NaN");
+          }
+
+          if (max_value(def0)<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            res.iterations = 0;               // fill statistics
+            res.reduction = 0;
+            res.conv_rate  = 0;
+            res.elapsed=0;
+            if (_verbose>0)                 // final print
+              std::cout << "=== rate=" << res.conv_rate
+                        << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                        << ", IT=0" << std::endl;
+            return;
+          }
+
+          if (_verbose>0)             // printing
+          {
+            std::cout << "=== SStepCGSolver" << std::endl;
+            if (_verbose>1) {
+              this->printHeader(std::cout);
+              this->printOutput(std::cout,0,def0);
+            }
+          }
+        }
+        else
+        {
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,defnew,def);
+
+          def = defnew;               // update norm
+          if (!all_true(isfinite(def))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== SStepCGSolver: abort due to infinite or NaN defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort,
+                       "SStepCGSolver: defect=" << def << " is infinite or NaN");
+          }
+
+          if (all_true(def<def0*_reduction) || max_value(def)<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+        }
+        if (i>=_maxit)
+          break;
+
+        // B = -(P^H A P)^{-1} (AP)^H V makes the new directions A-conjugate to the previous ones
+        for (std::size_t m=0; m<s; ++m)
+        {
+          for (std::size_t l=0; l<kprev; ++l)
+            column[l] = -C[l][m];
+          Imp::choleskySolve(L,kprev,column);
+          // P^H A P = V^H A V + V^H (AP) B for the new directions
+          for (std::size_t l=m; l<s; ++l)
+            for (std::size_t t=0; t<kprev; ++t)
+              G[l][m] += Imp::conjugate(C[t][l])*column[t];
+          for (std::size_t l=0; l<kprev; ++l)
+            C[l][m] = column[l];
+        }
+        const std::size_t k = min(Imp::choleskyFactor(G,s,tol),static_cast<std::size_t>(_maxit-i));
+        if (k==0)
+          DUNE_THROW(SolverAbort,
+                     "breakdown in SStepCGSolver - no A-conjugate search direction after " << i << " iterations");
+
+        // the new search directions P = V + P B and their images
+        for (std::size_t m=0; m<k; ++m)
+          for (std::size_t t=0; t<kprev; ++t)
+          {
+            V[m].axpy(C[t][m],P[t]);
+            W[m].axpy(C[t][m],AP[t]);
+          }
+        swap(P,V);
+        swap(AP,W);
+        swap(L,G);
+        kprev = k;
+
+        // minimize the energy norm of the error over the new directions, P^H r = V^H r
+        for (std::size_t m=0; m<k; ++m)
+          column[m] = g[m];
+        Imp::choleskySolve(L,k,column);
+        for (std::size_t m=0; m<k; ++m)
+        {
+          x.axpy(column[m],P[m]);
+          b.axpy(-column[m],AP[m]);
+        }
+        i += k;
+      }
+
+      i=std::max(1,i);
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
+
+      _prec.post(x);                  // postprocess preconditioner
+      res.iterations = i;             // fill statistics
+      res.reduction = static_cast<double>(max_value(max_value(def/def0)));
+      res.conv_rate  = pow(res.reduction,1.0/i);
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/i
+                  << ", IT=" << i << std::endl;
+      }
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, double reduction,
+                        InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+  private:
+    void checkSteps () const
+    {
+      if (_s<1)
+        DUNE_THROW(ISTLError,"SStepCGSolver: the number of steps has to be positive");
+    }
+
+    real_type shift (std::size_t j) const
+    {
+      return _shifts.empty() ? real_type(0) : _shifts[j%_shifts.size()];
+    }
+
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    ScalarProduct<X>& _sp;
+    real_type _reduction;
+    int _maxit;
+    int _verbose;
+    int _s;
+    std::vector<real_type> _shifts;
+  };
+
+
+  /**
+     \brief Block conjugate gradient method for several right-hand sides.
+
+     The block CG method by O'Leary, "The block conjugate gradient
+     algorithm and related methods", Linear Algebra Appl. 29 (1980), for
+     a symmetric positive definite operator and several right-hand
+     sides. X is a vector type with a column for each right-hand side,
+     like MultiBlockVector. The search space of all columns is shared,
+     so the columns converge in fewer iterations than with CGSolver for
+     each of them, and each iteration applies the operator and the
+     preconditioner to all columns at once, e.g. as a single sparse
+     matrix product with a MultiBlockVector. The scalar products of the
+     columns are the small dense matrices of
+     MultiBlockVector::columnProducts().
+
+     The search directions are made A-conjugate by the Hestenes-Stiefel
+     form of the recurrence, which does not require the same number of
+     search directions and defects. A column whose defect has met the
+     convergence criterion is removed from the iteration, so the
+     remaining iterations only work on the columns that have not
+     converged. Search directions that have become linearly dependent
+     are dropped, too, e.g. for linearly dependent right-hand sides.
+
+     X needs N(), columns(), operator()(i,c) for the block in row i and
+     column c, resize(), selectColumns(), columnNorms(), columnProducts()
+     and addProduct() of MultiBlockVector. The reductions are those of
+     the multi-vector, so the solver is sequential. The defect printed
+     for each iteration is the largest one of the columns iterated.
+
+     The preconditioner acts on the multi-vectors, too. Preconditioners
+     for single vectors, like SeqSSOR, SeqILU0 or AMG, are applied to
+     each column by ColumnPreconditioner:
+     \code
+     typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+     typedef Dune::MultiBlockVector<Dune::FieldVector<double,1> > MultiVector;
+     Dune::MatrixAdapter<Matrix,MultiVector,MultiVector> op(A);
+     Dune::SeqSSOR<Matrix,Vector,Vector> ssor(A,1,1.0);
+     Dune::ColumnPreconditioner<Dune::SeqSSOR<Matrix,Vector,Vector>,MultiVector> prec(ssor);
+     Dune::BlockCGSolver<MultiVector> solver(op,prec,1e-8,1000,1);
+     \endcode
+   */
+  template<class X>
+  class BlockCGSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    /*!
+       \brief Set up block conjugate gradient solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+
+       The reduction is required for the defect of each column.
+     */
+    template<class L, class P>
+    BlockCGSolver (L& op, P& prec, real_type reduction, int maxit, int verbose) :
+      _op(op), _prec(prec), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      BlockInverseOperatorResult blockRes;
+      apply(x,b,blockRes);
+      res = blockRes;
+    }
+
+    /*!
+       \brief Apply inverse operator, with the statistics of each column.
+
+       \param x The left hand side to store the result in.
+       \param b The right hand side, it is overwritten.
+       \param res Object to store the statistics of all and of each column.
+
+       \throw SolverAbort When a defect is infinite or NaN or when there
+                          is no search direction for a column that has
+                          not converged
+     */
+    void apply (X& x, X& b, BlockInverseOperatorResult& res)
+    {
+      using std::isfinite;
+      using std::max;
+      using std::pow;
+      using std::swap;
+
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec.pre(x,b);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,b);  // overwrite b with defect
+
+      const std::size_t k = x.columns();
+      const std::vector<real_type> def0 = b.columnNorms();
+      res.columnIterations.assign(k,0);
+      res.columnReductions.assign(k,0.0);
+      res.columnConverged.assign(k,false);
+
+      // the columns of x that are still iterated
+      std::vector<std::size_t> active;
+      real_type def = 0;
+      for (std::size_t c=0; c<k; ++c)
+      {
+        if (!isfinite(def0[c])) // check for inf or NaN
+        {
+          if (_verbose>0)
+            std::cout << "=== BlockCGSolver: abort due to infinite or NaN initial defect"
+                      << std::endl;
+          DUNE_THROW(SolverAbort, "BlockCGSolver: initial defect=" << def0[c]
+                     << " of column " << c << " is infinite or NaN");
+        }
+        if (def0[c]<1E-30)          // convergence check
+          res.columnConverged[c] = true;
+        else
+        {
+          active.push_back(c);
+          def = max(def,def0[c]);
+        }
+      }
+
+      if (_verbose>0)             // printing
+      {
+        std::cout << "=== BlockCGSolver with " << k << " right hand sides" << std::endl;
+        if (_verbose>1) {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,def);
+        }
+      }
+
+      // the solutions and defects of the active columns
+      X xa(x), r(b);
+      xa.selectColumns(active);
+      r.selectColumns(active);
+
+      // the search directions, their images and temporary vectors
+      X p, q, z, t;
+      DenseMatrix G, C;
+      std::vector<real_type> scale;
+      if (!active.empty())
+      {
+        p.resize(r.N(),r.columns());
+        p = 0;
+        _prec.apply(p,r);
+      }
+
+      int i=1;
+      for ( ; i<=_maxit && !active.empty(); i++)
+      {
+        q.resize(p.N(),p.columns());
+        _op.apply(p,q);
+        G = p.columnProducts(q);
+        factorize(G,scale,p,q);
+        if (p.columns()==0)
+          DUNE_THROW(SolverAbort,
+                     "breakdown in BlockCGSolver - no A-conjugate search direction after " << i << " iterations");
+
+        // minimize the energy norm of the errors, alpha = (P^H A P)^{-1} P^H R
+        C = p.columnProducts(r);
+        solve(G,scale,C);
+        xa.addProduct(p,C);
+        for (auto& row : C)
+          for (field_type& entry : row)
+            entry = -entry;
+        r.addProduct(q,C);
+
+        // convergence test of each column, the converged ones are removed
+        const std::vector<real_type> defs = r.columnNorms();
+        const real_type defold = def;
+        std::vector<std::size_t> remaining, remainingColumns;
+        def = 0;
+        for (std::size_t c=0; c<active.size(); ++c)
+        {
+          const std::size_t column = active[c];
+          if (!isfinite(defs[c])) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== BlockCGSolver: abort due to infinite or NaN defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort, "BlockCGSolver: defect=" << defs[c]
+                       << " of column " << column << " is infinite or NaN");
+          }
+          res.columnIterations[column] = i;
+          res.columnReductions[column] = static_cast<double>(defs[c]/def0[column]);
+          def = max(def,defs[c]);
+          if (defs[c]<def0[column]*_reduction || defs[c]<1E-30)
+          {
+            res.columnConverged[column] = true;
+            copyColumn(xa,c,x,column);
+          }
+          else
+          {
+            remaining.push_back(c);
+            remainingColumns.push_back(column);
+          }
+        }
+
+        if (_verbose>1)             // print
+          this->printOutput(std::cout,i,def,defold);
+
+        if (remaining.size()<active.size())
+        {
+          xa.selectColumns(remaining);
+          r.selectColumns(remaining);
+          swap(active,remainingColumns);
+        }
+        if (active.empty() || i==_maxit)
+          break;
+
+        // the new search directions P = Z + P B, with B = -(P^H A P)^{-1} (AP)^H Z
+        // they are A-conjugate to the previous ones
+        z.resize(r.N(),r.columns());
+        z = 0;
+        _prec.apply(z,r);
+        C = q.columnProducts(z);
+        solve(G,scale,C);
+        for (auto& row : C)
+          for (field_type& entry : row)
+            entry = -entry;
+        t = z;
+        t.addProduct(p,C);
+        swap(p,t);
+      }
+
+      // the columns that have not converged
+      for (std::size_t c=0; c<active.size(); ++c)
+        copyColumn(xa,c,x,active[c]);
+
+      i = 0;
+      res.converged = true;
+      res.reduction = 0;
+      for (std::size_t c=0; c<k; ++c)
+      {
+        i = max(i,res.columnIterations[c]);
+        res.converged = res.converged && res.columnConverged[c];
+        res.reduction = max(res.reduction,res.columnReductions[c]);
+      }
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
+
+      _prec.post(x);                  // postprocess preconditioner
+      res.iterations = i;             // fill statistics
+      res.conv_rate  = i>0 ? pow(res.reduction,1.0/i) : 0;
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/max(i,1)
+                  << ", IT=" << i << std::endl;
+      }
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, double reduction,
+                        InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor, with the statistics of each column.
+     */
+    void apply (X& x, X& b, double reduction, BlockInverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+  private:
+    typedef std::vector<std::vector<field_type> > DenseMatrix;
+
+    // Cholesky factorization of G = P^H A P, scaled to a unit diagonal so
+    // that directions of very different lengths are kept. A direction
+    // whose pivot fails is linearly dependent on the previous ones, it is
+    // removed from P and AP and the factorization is repeated.
+    void factorize (DenseMatrix& G, std::vector<real_type>& scale, X& p, X& q) const
+    {
+      using std::real;
+      using std::sqrt;
+      using std::swap;
+      // directions with an angle below about 1e-4 to the others are dropped
+      const real_type tol = sqrt(std::numeric_limits<real_type>::epsilon());
+      while (true)
+      {
+        const std::size_t n = G.size();
+        std::size_t drop = n;
+        scale.resize(n);
+        for (std::size_t a=0; a<n && drop==n; ++a)
+        {
+          scale[a] = sqrt(real(G[a][a]));
+          if (!(scale[a]>0))
+            drop = a;
+        }
+        if (drop==n)
+        {
+          DenseMatrix L(G);
+          for (std::size_t a=0; a<n; ++a)
+            for (std::size_t c=0; c<n; ++c)
+              L[a][c] /= scale[a]*scale[c];
+          drop = Imp::choleskyFactor(L,n,tol);
+          if (drop==n)
+          {
+            swap(G,L);
+            return;
+          }
+        }
+
+        std::vector<std::size_t> kept;
+        for (std::size_t a=0; a<n; ++a)
+          if (a!=drop)
+            kept.push_back(a);
+        p.selectColumns(kept);
+        q.selectColumns(kept);
+        G.erase(G.begin()+drop);
+        for (auto& row : G)
+          row.erase(row.begin()+drop);
+      }
+    }
+
+    // C = G^{-1} C with the factor of factorize(), for each column of C
+    void solve (const DenseMatrix& L, const std::vector<real_type>& scale, DenseMatrix& C) const
+    {
+      const std::size_t n = L.size();
+      const std::size_t m = n>0 ? C[0].size() : 0;
+      std::vector<field_type> column(n);
+      for (std::size_t c=0; c<m; ++c)
+      {
+        for (std::size_t a=0; a<n; ++a)
+          column[a] = C[a][c]/scale[a];
+        Imp::choleskySolve(L,n,column);
+        for (std::size_t a=0; a<n; ++a)
+          C[a][c] = column[a]/scale[a];
+      }
+    }
+
+    static void copyColumn (const X& from, std::size_t c, X& to, std::size_t d)
+    {
+      for (std::size_t i=0; i<from.N(); ++i)
+        to(i,d) = from(i,c);
+    }
+
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    real_type _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
+
+  /**
+     \brief Conjugate gradient method that recycles a deflation space between solves.
+
+     For sequences of systems with the same or a slowly changing
+     symmetric positive definite operator, like in implicit time
+     stepping. The solver object keeps a deflation space W of
+     approximate eigenvectors of the preconditioned operator for the
+     smallest eigenvalues, which slow down CG the most, from one call of
+     apply() to the next.
+
+     Each solve starts with the Galerkin projection of the initial guess
+     onto W and then runs the deflated CG method of Saad, Yeung, Erhel
+     and Guyomarc'h, "A deflated version of the conjugate gradient
+     algorithm", SIAM J. Sci. Comput. 21 (2000), whose search directions
+     are A-orthogonal to W. This needs the recycled vectors W and AW and
+     one batched scalar product with them in each iteration.
+
+     After each solve, W is replaced by the Ritz vectors of the smallest
+     Ritz values of the preconditioned operator in the space spanned by
+     W and the first search directions, as in eigCG by Stathopoulos and
+     Orginos, SIAM J. Sci. Comput. 32 (2010). The projected matrices follow
+     from the coefficients of CG, so the update only costs the linear
+     combinations of the stored directions.
+
+     If the operator or the preconditioner changes, updateOperator() has
+     to be called before the next solve. It recomputes AW with one
+     application of the operator per recycled vector. With an outdated AW,
+     the search directions are not A-orthogonal to W and the iteration
+     can diverge
+
+     RecyclingGMResSolver recycles a space for nonsymmetric operators.
+   */
+  template<class X>
+  class RecyclingCGSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    /*!
+       \brief Set up recycling conjugate gradient solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+       \param recycle The dimension of the recycled deflation space.
+       \param directions The number of search directions of each solve
+                         used to update the deflation space, twice the
+                         dimension by default. They are stored during the
+                         solve.
+     */
+    template<class L, class P>
+    RecyclingCGSolver (L& op, P& prec, real_type reduction, int maxit, int verbose,
+                       int recycle, int directions=0) :
+      ssp(), _op(&op), _prec(&prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _recycle(recycle), _directions(directions>0 ? directions : 2*recycle)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+      checkDimension();
+    }
+
+    /*!
+       \brief Set up recycling conjugate gradient solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+       \param recycle The dimension of the recycled deflation space.
+       \param directions The number of search directions of each solve
+                         used to update the deflation space, twice the
+                         dimension by default.
+     */
+    template<class L, class S, class P>
+    RecyclingCGSolver (L& op, S& sp, P& prec, real_type reduction, int maxit, int verbose,
+                       int recycle, int directions=0) :
+      _op(&op), _prec(&prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _recycle(recycle), _directions(directions>0 ? directions : 2*recycle)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(S::category),
+                    "L and S must have the same category!");
+      checkDimension();
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+
+       The reduction is that of the defect of the initial guess, before
+       its projection onto the deflation space.
+     */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      using std::isfinite;
+      using std::real;
+
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec->pre(x,b);            // prepare preconditioner
+      _op->applyscaleadd(-1,x,b); // overwrite b with defect
+
+      X p(x);              // the search direction
+      X q(x);              // a temporary vector
+      X z(x);              // the preconditioned defect
+
+      real_type def0 = _sp.norm(b); // compute norm
+
+      if (!all_true(isfinite(def0))) // check for inf or NaN
+      {
+        if (_verbose>0)
+          std::cout << "=== RecyclingCGSolver: abort due to infinite or NaN initial defect"
+                    << std::endl;
+        DUNE_THROW(SolverAbort, "RecyclingCGSolver: initial defect=" << def0
+                   << " is infinite or NaN");
+      }
+
+      if (max_value(def0)<1E-30)    // convergence check
+      {
+        _prec->post(x);
+        res.converged  = true;
+        res.iterations = 0;               // fill statistics
+        res.reduction = 0;
+        res.conv_rate  = 0;
+        res.elapsed=0;
+        if (_verbose>0)                 // final print
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                    << ", IT=0" << std::endl;
+        return;
+      }
+
+      if (_verbose>0)             // printing
+      {
+        std::cout << "=== RecyclingCGSolver with " << _w.size() << " recycled vectors" << std::endl;
+        if (_verbose>1) {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,def0);
+        }
+      }
+
+      // the preconditioned images of AW for the next update of the deflation space
+      if (_stale)
+        updatePreconditionedProducts(z);
+
+      // the Galerkin projection onto the deflation space, x += W (W^H A W)^{-1} W^H r
+      real_type def = def0;
+      if (!_w.empty())
+      {
+        std::vector<field_type> c = products(_w,b);
+        Imp::choleskySolve(_l,_w.size(),c);
+        for (std::size_t l=0; l<_w.size(); ++l)
+        {
+          x.axpy(c[l],_w[l]);
+          b.axpy(-c[l],_aw[l]);
+        }
+        def = _sp.norm(b);
+        if (_verbose>1)
+          this->printOutput(std::cout,0,def,def0);
+      }
+
+      // the coefficients and the first search directions for the update of the deflation space
+      std::vector<X> directions, images;
+      std::vector<real_type> alphas, gammas, rhos;
+      std::vector<std::vector<field_type> > cs;
+
+      // determine initial search direction, deflated to be A-orthogonal to W
+      real_type rholast;
+      std::vector<field_type> c;
+      int i=0;
+      if (!(all_true(def<def0*_reduction) || max_value(def)<1E-30))
+      {
+        z = 0;                          // clear correction
+        _prec->apply(z,b);              // apply preconditioner
+        rholast = preconditionedProducts(z,b,c);
+        rhos.push_back(rholast);
+        cs.push_back(c);
+        p = z;
+        deflate(p,c);
+
+        // the loop
+        for (i=1; i<=_maxit; i++)
+        {
+          // minimize in given search direction p
+          const real_type gamma = real(_op->applyDot(p,q,_sp)); // q=Ap and scalar product
+          const real_type lambda = rholast/gamma; // minimization
+          if (directions.size()<static_cast<std::size_t>(_directions))
+          {
+            directions.push_back(p);
+            images.push_back(q);
+            alphas.push_back(lambda);
+            gammas.push_back(gamma);
+          }
+
+          // update solution and defect, convergence test
+          real_type defnew=_sp.axpyNorm(x,lambda,p,b,q); // comp defect norm
+
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,defnew,def);
+
+          def = defnew;               // update norm
+          if (!all_true(isfinite(def))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== RecyclingCGSolver: abort due to infinite or NaN defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort,
+                       "RecyclingCGSolver: defect=" << def << " is infinite or NaN");
+          }
+
+          if (all_true(def<def0*_reduction) || max_value(def)<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+
+          // determine new search direction
+          z = 0;                      // clear correction
+          _prec->apply(z,b);          // apply preconditioner
+          const real_type rho = preconditionedProducts(z,b,c);
+          if (rhos.size()<=directions.size())
+          {
+            rhos.push_back(rho);
+            cs.push_back(c);
+          }
+          const real_type beta = rho/rholast; // scaling factor
+          Imp::scaleAdd(p,beta,z);    // p = beta*p + z, orthogonalization with correction
+          deflate(p,c);               // p -= W (W^H A W)^{-1} (AW)^H z
+          rholast = rho;              // remember rho for recurrence
+        }
+
+        //correct i which is wrong if convergence was not achieved.
+        i=std::min(_maxit,i);
+      }
+      else
+        res.converged = true;
+
+      // a direction can be used when the next preconditioned defect is known
+      if (directions.size()+1>rhos.size())
+      {
+        const std::size_t complete = rhos.empty() ? 0 : rhos.size()-1;
+        directions.erase(directions.begin()+complete,directions.end());
+        images.erase(images.begin()+complete,images.end());
+      }
+      if (!directions.empty())
+        updateDeflationSpace(directions,images,alphas,gammas,rhos,cs);
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
+
+      _prec->post(x);                 // postprocess preconditioner
+      res.iterations = i;             // fill statistics
+      res.reduction = static_cast<double>(max_value(max_value(def/def0)));
+      res.conv_rate  = i>0 ? pow(res.reduction,1.0/i) : 0;
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/std::max(i,1)
+                  << ", IT=" << i << std::endl;
+      }
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, double reduction,
+                        InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+    /*!
+       \brief Adapt the deflation space to a changed operator or preconditioner.
+
+       Recomputes AW and W^H A W with one application of the operator
+       for each recycled vector. The preconditioner is applied to AW at
+       the beginning of the next solve.
+     */
+    void updateOperator ()
+    {
+      for (std::size_t l=0; l<_w.size(); ++l)
+        _op->apply(_w[l],_aw[l]);
+      factorizeProjection();
+      _stale = true;
+    }
+
+    /*!
+       \brief Continue with a new operator and preconditioner, keeping the deflation space.
+
+       The new objects replace those passed to the constructor, e.g. for a
+       new incomplete factorization of the changed matrix.
+     */
+    template<class L, class P>
+    void updateOperator (L& op, P& prec)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      _op = &op;
+      _prec = &prec;
+      updateOperator();
+    }
+
+    //! The dimension of the current deflation space.
+    std::size_t recycledDimension () const
+    {
+      return _w.size();
+    }
+
+    //! Discard the deflation space, e.g. for an unrelated system.
+    void clearDeflationSpace ()
+    {
+      _w.clear();
+      _aw.clear();
+      _l.clear();
+      _h.clear();
+      _stale = false;
+    }
+
+  private:
+    typedef std::vector<std::vector<field_type> > DenseMatrix;
+
+    void checkDimension () const
+    {
+      if (_recycle<1)
+        DUNE_THROW(ISTLError,"RecyclingCGSolver: the dimension of the deflation space has to be positive");
+    }
+
+    // W^H y by a single reduction
+    std::vector<field_type> products (const std::vector<X>& w, const X& y)
+    {
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (const X& wl : w)
+        pairs.emplace_back(&wl,&y);
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+      return dots;
+    }
+
+    // c = (AW)^H z and returns r^H z, by a single reduction
+    real_type preconditionedProducts (const X& z, const X& r, std::vector<field_type>& c)
+    {
+      using std::real;
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (const X& awl : _aw)
+        pairs.emplace_back(&awl,&z);
+      pairs.emplace_back(&r,&z);
+      _sp.multiDot(pairs,c);
+      const real_type rho = real(c.back());
+      c.pop_back();
+      return rho;
+    }
+
+    // p -= W (W^H A W)^{-1} c
+    void deflate (X& p, std::vector<field_type> c) const
+    {
+      if (_w.empty())
+        return;
+      Imp::choleskySolve(_l,_w.size(),c);
+      for (std::size_t l=0; l<_w.size(); ++l)
+        p.axpy(-c[l],_w[l]);
+    }
+
+    // the Cholesky factor of W^H A W, vectors of W that are linearly dependent are dropped
+    void factorizeProjection ()
+    {
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (std::size_t l=0; l<_w.size(); ++l)
+        for (std::size_t m=0; m<=l; ++m)
+          pairs.emplace_back(&_w[m],&_aw[l]);
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+      const std::size_t k = _w.size();
+      _l.assign(k,std::vector<field_type>(k,field_type(0)));
+      std::size_t d = 0;
+      for (std::size_t l=0; l<k; ++l)
+        for (std::size_t m=0; m<=l; ++m, ++d)
+        {
+          _l[m][l] = dots[d];
+          _l[l][m] = Imp::conjugate(dots[d]);
+        }
+      const real_type tol = 100*std::numeric_limits<real_type>::epsilon();
+      const std::size_t rank = Imp::choleskyFactor(_l,k,tol);
+      _w.erase(_w.begin()+rank,_w.end());
+      _aw.erase(_aw.begin()+rank,_aw.end());
+      _h.resize(rank);
+      for (auto& row : _h)
+        row.resize(rank);
+    }
+
+    // (AW)^H M^{-1} AW, with one application of the preconditioner for each vector of W
+    void updatePreconditionedProducts (const X& y)
+    {
+      std::vector<X> t(_aw.size(),y);
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (std::size_t l=0; l<_aw.size(); ++l)
+      {
+        t[l] = 0;
+        _prec->apply(t[l],_aw[l]);
+        for (std::size_t m=0; m<=l; ++m)
+          pairs.emplace_back(&_aw[m],&t[l]);
+      }
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+      const std::size_t k = _aw.size();
+      _h.assign(k,std::vector<field_type>(k,field_type(0)));
+      std::size_t d = 0;
+      for (std::size_t l=0; l<k; ++l)
+        for (std::size_t m=0; m<=l; ++m, ++d)
+        {
+          _h[m][l] = dots[d];
+          _h[l][m] = Imp::conjugate(dots[d]);
+        }
+      _stale = false;
+    }
+
+    /*
+     * Replace W by the Ritz vectors of the smallest Ritz values of
+     * M^{-1}A in span{W,P} with the A inner product, i.e. of the
+     * generalized eigenvalue problem (AZ)^H M^{-1} AZ y = theta Z^H A Z y
+     * for Z = [W P]. With AP_j = (r_j - r_{j+1})/alpha_j and
+     * M^{-1}AP_j = (z_j - z_{j+1})/alpha_j, the M^{-1}-orthogonality of
+     * the defects and the A-orthogonality of the directions to W and to
+     * each other, both matrices follow from the coefficients of CG.
+     */
+    void updateDeflationSpace (const std::vector<X>& directions, const std::vector<X>& images,
+                               const std::vector<real_type>& alphas, const std::vector<real_type>& gammas,
+                               const std::vector<real_type>& rhos,
+                               const std::vector<std::vector<field_type> >& cs)
+    {
+      const std::size_t k = _w.size();
+      const std::size_t m = directions.size();
+      std::size_t n = k+m;
+
+      // G = Z^H A Z is block diagonal with the factor of W^H A W
+      DenseMatrix L(n,std::vector<field_type>(n,field_type(0)));
+      for (std::size_t a=0; a<k; ++a)
+        for (std::size_t b=0; b<=a; ++b)
+          L[a][b] = _l[a][b];
+      using std::sqrt;
+      for (std::size_t j=0; j<m; ++j)
+        L[k+j][k+j] = sqrt(gammas[j]);
+
+      DenseMatrix H(n,std::vector<field_type>(n,field_type(0)));
+      for (std::size_t a=0; a<k; ++a)
+        for (std::size_t b=0; b<k; ++b)
+          H[a][b] = _h[a][b];
+      for (std::size_t j=0; j<m; ++j)
+      {
+        for (std::size_t a=0; a<k; ++a)
+        {
+          H[a][k+j] = (cs[j][a] - cs[j+1][a])/alphas[j];
+          H[k+j][a] = Imp::conjugate(H[a][k+j]);
+        }
+        H[k+j][k+j] = (rhos[j] + rhos[j+1])/(alphas[j]*alphas[j]);
+        if (j+1<m)
+          H[k+j][k+j+1] = H[k+j+1][k+j] = -rhos[j+1]/(alphas[j]*alphas[j+1]);
+      }
+
+      // the standard eigenvalue problem of L^{-1} H L^{-H}
+      for (std::size_t b=0; b<n; ++b)
+      {
+        std::vector<field_type> column(n);
+        for (std::size_t a=0; a<n; ++a)
+          column[a] = H[a][b];
+        Imp::forwardSubstitution(L,n,column);
+        for (std::size_t a=0; a<n; ++a)
+          H[a][b] = column[a];
+      }
+      for (std::size_t a=0; a<n; ++a)
+      {
+        std::vector<field_type> row(n);
+        for (std::size_t b=0; b<n; ++b)
+          row[b] = Imp::conjugate(H[a][b]);
+        Imp::forwardSubstitution(L,n,row);
+        for (std::size_t b=0; b<n; ++b)
+          H[a][b] = Imp::conjugate(row[b]);
+      }
+      std::vector<real_type> theta;
+      DenseMatrix U;
+      Imp::hermitianEigen(H,n,theta,U);
+
+      // the coefficients Y = L^{-H} U of the smallest Ritz values
+      std::vector<std::size_t> order(n);
+      for (std::size_t a=0; a<n; ++a)
+        order[a] = a;
+      std::sort(order.begin(),order.end(),
+                [&theta](std::size_t a, std::size_t b) { return theta[a]<theta[b]; });
+      const std::size_t kNew = std::min(n,static_cast<std::size_t>(_recycle));
+      std::vector<X> w(kNew,directions.front()), aw(kNew,directions.front());
+      for (std::size_t s=0; s<kNew; ++s)
+      {
+        std::vector<field_type> y(n);
+        for (std::size_t a=0; a<n; ++a)
+          y[a] = U[a][order[s]];
+        Imp::backSubstitution(L,n,y);
+        w[s] = 0;
+        aw[s] = 0;
+        for (std::size_t a=0; a<k; ++a)
+        {
+          w[s].axpy(y[a],_w[a]);
+          aw[s].axpy(y[a],_aw[a]);
+        }
+        for (std::size_t j=0; j<m; ++j)
+        {
+          w[s].axpy(y[k+j],directions[j]);
+          aw[s].axpy(y[k+j],images[j]);
+        }
+      }
+      std::swap(_w,w);
+      std::swap(_aw,aw);
+
+      // the Ritz vectors are A-orthonormal up to rounding, W^H A W is recomputed
+      factorizeProjection();
+      for (std::size_t s=0; s<_w.size(); ++s)
+        for (std::size_t t=0; t<_w.size(); ++t)
+          _h[s][t] = (s==t) ? field_type(theta[order[s]]) : field_type(0);
+    }
+
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>* _op;
+    Preconditioner<X,X>* _prec;
+    ScalarProduct<X>& _sp;
+    real_type _reduction;
+    int _maxit;
+    int _verbose;
+    int _recycle;
+    int _directions;
+    // the deflation space W, AW, the Cholesky factor of W^H A W and (AW)^H M^{-1} AW
+    std::vector<X> _w, _aw;
+    DenseMatrix _l, _h;
+    // true if _h has to be computed for a changed operator
+    bool _stale = false;
+  };
+
+
+  // Ronald Kriemanns BiCG-STAB implementation from Sumo
+  //! \brief Bi-conjugate Gradient Stabilized (BiCG-STAB)
+  template<class X>
+  class BiCGSTABSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    /*!
+       \brief Set up solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+     */
+    template<class L, class P>
+    BiCGSTABSolver (L& op, P& prec,
+                    real_type reduction, int maxit, int verbose) :
+      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must be of the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+    }
+    /*!
+       \brief Set up solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+     */
+    template<class L, class S, class P>
+    BiCGSTABSolver (L& op, S& sp, P& prec,
+                    real_type reduction, int maxit, int verbose) :
+      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(S::category),
+                    "L and S must have the same category!");
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+
+       \note Currently, the BiCGSTABSolver aborts when it detects a breakdown.
+     */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      using std::abs;
+      const real_type EPSILON=1e-80;
+      using std::abs;
+      double it;
+      field_type rho, rho_new, alpha, beta, h, omega;
+      real_type norm, norm_old, norm_0;
+
+      //
+      // get vectors and matrix
+      //
+      X& r=b;
+      X p(x);
+      X v(x);
+      X t(x);
+      X y(x);
+      X rt(x);
+
+      //
+      // begin iteration
+      //
+
+      // r = r - Ax; rt = r
+      res.clear();                // clear solver statistics
+      Timer watch;                // start a timer
+      _prec.pre(x,r);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,r);  // overwrite b with defect
+
+      rt=r;
+
+      norm = norm_old = norm_0 = _sp.norm(r);
+
+      p=0;
+      v=0;
+
+      rho   = 1;
+      alpha = 1;
+      omega = 1;
+
+      if (_verbose>0)             // printing
+      {
+        std::cout << "=== BiCGSTABSolver" << std::endl;
+        if (_verbose>1)
+        {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,norm_0);
+          //std::cout << " Iter       Defect         Rate" << std::endl;
+          //std::cout << "    0" << std::setw(14) << norm_0 << std::endl;
+        }
+      }
+
+      if ( all_true(norm < (_reduction * norm_0))  || max_value(norm)<1E-30)
+      {
+        res.converged = 1;
+        _prec.post(x);                  // postprocess preconditioner
+        res.iterations = 0;             // fill statistics
+        res.reduction = 0;
+        res.conv_rate  = 0;
+        res.elapsed = watch.elapsed();
+        return;
+      }
+
+      //
+      // iteration
+      //
+
+      for (it = 0.5; it < _maxit; it+=.5)
+      {
+        //
+        // preprocess, set vecsizes etc.
+        //
+
+        // rho_new = < rt , r >
+        rho_new = _sp.dot(rt,r);
+
+        // look if breakdown occurred
+        if (all_true(abs(rho) <= EPSILON))
+          DUNE_THROW(SolverAbort,"breakdown in BiCGSTAB - rho "
+                     << rho << " <= EPSILON " << max_value(EPSILON)
+                     << " after " << it << " iterations");
+        if (all_true(abs(omega) <= EPSILON))
+          DUNE_THROW(SolverAbort,"breakdown in BiCGSTAB - omega "
+                     << omega << " <= EPSILON " << max_value(EPSILON)
+                     << " after " << it << " iterations");
+
+
+        if (it<1)
+          p = r;
+        else
+        {
+          beta = ( rho_new / rho ) * ( alpha / omega );
+          Imp::scaleAdd(p,beta,r,omega,v); // p = r + beta (p - omega*v)
+        }
+
+        // y = W^-1 * p
+        y = 0;
+        _prec.apply(y,p);           // apply preconditioner
+
+        // v = A * y
+        _op.apply(y,v);
+
+        // alpha = rho_new / < rt, v >
+        h = _sp.dot(rt,v);
+
+        if ( all_true(abs(h) < EPSILON) )
+          DUNE_THROW(SolverAbort,"abs(h) < EPSILON in BiCGSTAB - abs(h) "
+                     << abs(h) << " < EPSILON " << max_value(EPSILON)
+                     << " after " << it << " iterations");
+
+        alpha = rho_new / h;
+
+        // apply first correction in one sweep:
+        // x <- x + alpha y, r <- r - alpha v, norm = ||r||
+        norm = _sp.axpyNorm(x,alpha,y,r,v);
+
+        if (_verbose>1) // print
+        {
+          this->printOutput(std::cout,it,norm,norm_old);
+        }
+
+        if ( all_true(norm < (_reduction * norm_0)) )
+        {
+          res.converged = 1;
+          break;
+        }
+        it+=.5;
+
+        norm_old = norm;
+
+        // y = W^-1 * r
+        y = 0;
+        _prec.apply(y,r);
+
+        // t = A * y
+        _op.apply(y,t);
+
+        // omega = < t, r > / < t, t >
+        omega = _sp.dot(t,r)/_sp.dot(t,t);
+
+        // apply second correction in one sweep (remember : r = s):
+        // x <- x + omega y, r <- r - omega t, norm = ||r||
+        norm = _sp.axpyNorm(x,omega,y,r,t);
+
+        rho = rho_new;
+
+        if (_verbose > 1)             // print
+        {
+          this->printOutput(std::cout,it,norm,norm_old);
+        }
+
+        if ( all_true(norm < (_reduction * norm_0))  || max_value(norm)<1E-30)
+        {
+          res.converged = 1;
+          break;
+        }
+
+        norm_old = norm;
+      } // end for
+
+      //correct i which is wrong if convergence was not achieved.
+      it=std::min(static_cast<double>(_maxit),it);
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,it,norm);
+
+      _prec.post(x);                  // postprocess preconditioner
+      res.iterations = static_cast<int>(std::ceil(it));              // fill statistics
+      res.reduction = static_cast<double>(max_value(norm/norm_0));
+      res.conv_rate  = pow(res.reduction,1.0/it);
+      res.elapsed = watch.elapsed();
+      if (_verbose>0)                 // final print
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/it
+                  << ", IT=" << it << std::endl;
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+
+       \note Currently, the BiCGSTABSolver aborts when it detects a breakdown.
+     */
+    virtual void apply (X& x, X& b, double reduction, InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+  private:
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    ScalarProduct<X>& _sp;
+    real_type _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
+  /*! \brief Minimal Residual Method (MINRES)
+
+     Symmetrically Preconditioned MINRES as in A. Greenbaum, 'Iterative Methods for Solving Linear Systems', pp. 121
+     Iterative solver for symmetric indefinite operators.
+     Note that in order to ensure the (symmetrically) preconditioned system to remain symmetric, the preconditioner has to be spd.
+   */
+  template<class X>
+  class MINRESSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    /*!
+       \brief Set up MINRES solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+     */
+    template<class L, class P>
+    MINRESSolver (L& op, P& prec, real_type reduction, int maxit, int verbose) :
+      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+    }
+    /*!
+       \brief Set up MINRES solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+     */
+    template<class L, class S, class P>
+    MINRESSolver (L& op, S& sp, P& prec, real_type reduction, int maxit, int verbose) :
+      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(S::category),
+                    "L and S must have the same category!");
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      using std::sqrt;
+      using std::abs;
+      // clear solver statistics
+      res.clear();
+      // start a timer
+      Dune::Timer watch;
+      watch.reset();
+      // prepare preconditioner
+      _prec.pre(x,b);
+      // overwrite rhs with defect
+      _op.applyscaleadd(-1,x,b);
+
+      // compute residual norm
+      real_type def0 = _sp.norm(b);
+
+      // printing
+      if(_verbose > 0) {
+        std::cout << "=== MINRESSolver" << std::endl;
+        if(_verbose > 1) {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,def0);
+        }
+      }
+
+      // check for convergence
+      if( max_value(def0) < 1e-30 ) {
+        res.converged = true;
+        res.iterations = 0;
+        res.reduction = 0;
+        res.conv_rate = 0;
+        res.elapsed = 0.0;
+        // final print
+        if(_verbose > 0)
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed
+                    << ", TIT=" << res.elapsed
+                    << ", IT=" << res.iterations
+                    << std::endl;
+        return;
+      }
+
+      // the defect norm
+      real_type def = def0;
+      // recurrence coefficients as computed in Lanczos algorithm
+      field_type alpha, beta;
+      // diagonal entries of givens rotation
+      std::array<real_type,2> c{{0.0,0.0}};
+      // off-diagonal entries of givens rotation
+      std::array<field_type,2> s{{0.0,0.0}};
+
+      // recurrence coefficients (column k of tridiag matrix T_k)
+      std::array<field_type,3> T{{0.0,0.0,0.0}};
+
+      // the rhs vector of the min problem
+      std::array<field_type,2> xi{{1.0,0.0}};
+
+      // some temporary vectors
+      X z(b), dummy(b);
+
+      // initialize and clear correction
+      z = 0.0;
+      _prec.apply(z,b);
+
+      // beta is real and positive in exact arithmetic
+      // since it is the norm of the basis vectors (in unpreconditioned case)
+      beta = sqrt(_sp.dot(b,z));
+      field_type beta0 = beta;
+
+      // the search directions
+      std::array<X,3> p{{b,b,b}};
+      p[0] = 0.0;
+      p[1] = 0.0;
+      p[2] = 0.0;
+
+      // orthonormal basis vectors (in unpreconditioned case)
+      std::array<X,3> q{{b,b,b}};
+      q[0] = 0.0;
+      q[1] *= 1.0/beta;
+      q[2] = 0.0;
+
+      z *= 1.0/beta;
+
+      // the loop
+      int i = 1;
+      for( ; i<=_maxit; i++) {
+
+        dummy = z;
+        int i1 = i%3,
+          i0 = (i1+2)%3,
+          i2 = (i1+1)%3;
+
+        // symmetrically preconditioned Lanczos algorithm (see Greenbaum p.121)
+        _op.apply(z,q[i2]); // q[i2] = Az
+        q[i2].axpy(-beta,q[i0]);
+        // alpha is real since it is the diagonal entry of the hermitian tridiagonal matrix
+        // from the Lanczos Algorithm
+        // so the order in the scalar product doesn't matter even for the complex case
+        alpha = _sp.dot(z,q[i2]);
+        q[i2].axpy(-alpha,q[i1]);
+
+        z = 0.0;
+        _prec.apply(z,q[i2]);
+
+        // beta is real and positive in exact arithmetic
+        // since it is the norm of the basis vectors (in unpreconditioned case)
+        beta = sqrt(_sp.dot(q[i2],z));
+
+        q[i2] *= 1.0/beta;
+        z *= 1.0/beta;
+
+        // QR Factorization of recurrence coefficient matrix
+        // apply previous givens rotations to last column of T
+        T[1] = T[2];
+        if(i>2) {
+          T[0] = s[i%2]*T[1];
+          T[1] = c[i%2]*T[1];
+        }
+        if(i>1) {
+          T[2] = c[(i+1)%2]*alpha - s[(i+1)%2]*T[1];
+          T[1] = c[(i+1)%2]*T[1] + s[(i+1)%2]*alpha;
+        }
+        else
+          T[2] = alpha;
+
+        // update QR factorization
+        generateGivensRotation(T[2],beta,c[i%2],s[i%2]);
+        // to last column of T_k
+        T[2] = c[i%2]*T[2] + s[i%2]*beta;
+        // and to the rhs xi of the min problem
+        xi[i%2] = -s[i%2]*xi[(i+1)%2];
+        xi[(i+1)%2] *= c[i%2];
+
+        // compute correction direction
+        p[i2] = dummy;
+        p[i2].axpy(-T[1],p[i1]);
+        p[i2].axpy(-T[0],p[i0]);
+        p[i2] *= 1.0/T[2];
+
+        // apply correction/update solution
+        x.axpy(beta0*xi[(i+1)%2],p[i2]);
+
+        // remember beta_old
+        T[2] = beta;
+
+        // check for convergence
+        // the last entry in the rhs of the min-problem is the residual
+        real_type defnew = abs(beta0*xi[i%2]);
+
+          if(_verbose > 1)
+            this->printOutput(std::cout,i,defnew,def);
+
+          def = defnew;
+          if(all_true(def < def0*_reduction)
+              || max_value(def) < 1e-30 || i == _maxit ) {
+            res.converged = true;
+            break;
+          }
+        } // end for
+
+        if(_verbose == 1)
+          this->printOutput(std::cout,i,def);
+
+        // postprocess preconditioner
+        _prec.post(x);
+        // fill statistics
+        res.iterations = i;
+        res.reduction = static_cast<double>(max_value(def/def0));
+        res.conv_rate = pow(res.reduction,1.0/i);
+        res.elapsed = watch.elapsed();
+
+        // final print
+        if(_verbose > 0) {
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed
+                    << ", TIT=" << res.elapsed/i
+                    << ", IT=" << i << std::endl;
+        }
+    }
+
+    /*!
+       \brief Apply inverse operator with given reduction factor.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, double reduction, InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
+
+  private:
+
+    // helper function to extract the real value of a real or complex number
+    inline
+    real_type to_real(const real_type & v)
+    {
+      return v;
+    }
+
+    inline
+    real_type to_real(const std::complex<real_type> & v)
+    {
+      return v.real();
+    }
+
+    void generateGivensRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
+    {
+      using std::sqrt;
       using std::abs;
-      // clear solver statistics
-      res.clear();
-      // start a timer
+      using std::max;
+      using std::min;
+      const real_type eps = 1e-15;
+      real_type norm_dx = abs(dx);
+      real_type norm_dy = abs(dy);
+      real_type norm_max = max(norm_dx, norm_dy);
+      real_type norm_min = min(norm_dx, norm_dy);
+      real_type temp = norm_min/norm_max;
+      // we rewrite the code in a vectorizable fashion
+      cs = cond(norm_dy < eps,
+        real_type(1.0),
+        cond(norm_dx < eps,
+          real_type(0.0),
+          cond(norm_dy > norm_dx,
+            real_type(1.0)/sqrt(1.0 + temp*temp)*temp,
+            // dy and dx are real in exact arithmetic
+            // thus dx*dy is real so we can explicitly enforce it
+            real_type(1.0)/sqrt(1.0 + temp*temp)*to_real(dx*dy)/norm_dx/norm_dy)));
+      sn = cond(norm_dy < eps,
+        field_type(0.0),
+        cond(norm_dx < eps,
+          field_type(1.0),
+          cond(norm_dy > norm_dx,
+            field_type(1.0)/sqrt(1.0 + temp*temp),
+            // dy and dx is real in exact arithmetic
+            // so we don't have to conjugate both of them
+            field_type(1.0)/sqrt(1.0 + temp*temp)*dy/dx)));
+    }
+
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    ScalarProduct<X>& _sp;
+    real_type _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
+  //! The orthogonalization of the Krylov basis in RestartedGMResSolver.
+  enum class GMResOrthogonalization {
+    //! Modified Gram-Schmidt, one reduction for each basis vector.
+    modifiedGramSchmidt,
+    /**
+     * Classical Gram-Schmidt, done twice for the stability of modified
+     * Gram-Schmidt. Each pass computes all projections by a single
+     * ScalarProduct::multiDot(), so there are two reductions per
+     * iteration.
+     */
+    classicalGramSchmidt2
+  };
+
+  /**
+     \brief implements the Generalized Minimal Residual (GMRes) method
+
+     GMRes solves the unsymmetric linear system Ax = b using the
+     Generalized Minimal Residual method as described the SIAM Templates
+     book (http://www.netlib.org/templates/templates.pdf).
+
+     \tparam X trial vector, vector type of the solution
+     \tparam Y test vector, vector type of the RHS
+     \tparam F vector type for orthonormal basis of Krylov space
+
+   */
+
+  template<class X, class Y=X, class F = Y>
+  class RestartedGMResSolver : public InverseOperator<X,Y>
+  {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef Y range_type;
+    //! \brief The field type of the operator to be inverted
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+    //! \brief The field type of the basis vectors
+    typedef F basis_type;
+
+    template<class L, class P>
+    DUNE_DEPRECATED_MSG("recalc_defect is a unused parameter! Use RestartedGMResSolver(L& op, P& prec, real_type reduction, int restart, int maxit, int verbose) instead")
+    RestartedGMResSolver (L& op, P& prec, real_type reduction, int restart, int maxit, int verbose, bool recalc_defect)
+      : _A(op)
+      , _W(prec)
+      , ssp()
+      , _sp(ssp)
+      , _restart(restart)
+      , _reduction(reduction)
+      , _maxit(maxit)
+      , _verbose(verbose)
+    {
+      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+                    "P and L must be the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+    }
+
+
+    /*!
+       \brief Set up solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+       \param restart number of GMRes cycles before restart
+       \param orthogonalization The orthogonalization of the basis,
+       classicalGramSchmidt2 needs X, Y and F to be the same type.
+     */
+    template<class L, class P>
+    RestartedGMResSolver (L& op, P& prec, real_type reduction, int restart, int maxit, int verbose,
+                          GMResOrthogonalization orthogonalization = GMResOrthogonalization::modifiedGramSchmidt) :
+      _A(op), _W(prec),
+      ssp(), _sp(ssp), _restart(restart),
+      _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _orthogonalization(orthogonalization)
+    {
+      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+                    "P and L must be the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+      checkOrthogonalization();
+    }
+
+    template<class L, class S, class P>
+    DUNE_DEPRECATED_MSG("recalc_defect is a unused parameter! Use RestartedGMResSolver(L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose) instead")
+    RestartedGMResSolver(L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose, bool recalc_defect)
+      : _A(op)
+      , _W(prec)
+      , _sp(sp)
+      , _restart(restart)
+      , _reduction(reduction)
+      , _maxit(maxit)
+      , _verbose(verbose)
+    {
+      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+                    " P and L must have the same category!");
+      static_assert(static_cast<int>(P::category) == static_cast<int>(S::category),
+                    "P and S must have the same category!");
+    }
+
+    /*!
+       \brief Set up solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+       \param restart number of GMRes cycles before restart
+       \param orthogonalization The orthogonalization of the basis,
+       classicalGramSchmidt2 needs X, Y and F to be the same type.
+     */
+    template<class L, class S, class P>
+    RestartedGMResSolver (L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose,
+                          GMResOrthogonalization orthogonalization = GMResOrthogonalization::modifiedGramSchmidt) :
+      _A(op), _W(prec),
+      _sp(sp), _restart(restart),
+      _reduction(reduction), _maxit(maxit), _verbose(verbose),
+      _orthogonalization(orthogonalization)
+    {
+      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+                    "P and L must have the same category!");
+      static_assert(static_cast<int>(P::category) == static_cast<int>(S::category),
+                    "P and S must have the same category!");
+      checkOrthogonalization();
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+
+       \note Currently, the RestartedGMResSolver aborts when it detects a
+             breakdown.
+     */
+    virtual void apply (X& x, Y& b, InverseOperatorResult& res)
+    {
+      apply(x,b,max_value(_reduction),res);
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+
+       \note Currently, the RestartedGMResSolver aborts when it detects a
+             breakdown.
+     */
+    virtual void apply (X& x, Y& b, double reduction, InverseOperatorResult& res)
+    {
+      using std::abs;
+      const real_type EPSILON = 1e-80;
+      const int m = _restart;
+      real_type norm, norm_old = 0.0, norm_0;
+      int j = 1;
+      std::vector<field_type> s(m+1), sn(m);
+      std::vector<real_type> cs(m);
+      // need copy of rhs if GMRes has to be restarted
+      Y b2(b);
+      // helper vector
+      Y w(b);
+      std::vector< std::vector<field_type> > H(m+1,s);
+      std::vector<F> v(m+1,b);
+
+      // start timer
       Dune::Timer watch;
       watch.reset();
-      // prepare preconditioner
-      _prec.pre(x,b);
-      // overwrite rhs with defect
-      _op.applyscaleadd(-1,x,b);
 
-      // compute residual norm
-      real_type def0 = _sp.norm(b);
+      // clear solver statistics and set res.converged to false
+      res.clear();
+      _W.pre(x,b);
 
-      // printing
-      if(_verbose > 0) {
-        std::cout << "=== MINRESSolver" << std::endl;
-        if(_verbose > 1) {
-          this->printHeader(std::cout);
-          this->printOutput(std::cout,0,def0);
+      // calculate defect and overwrite rhs with it
+      _A.applyscaleadd(-1.0,x,b); // b -= Ax
+      // calculate preconditioned defect
+      v[0] = 0.0; _W.apply(v[0],b); // r = W^-1 b
+      norm_0 = _sp.norm(v[0]);
+      norm = norm_0;
+      norm_old = norm;
+
+      // print header
+      if(_verbose > 0)
+        {
+          std::cout << "=== RestartedGMResSolver" << std::endl;
+          if(_verbose > 1) {
+            this->printHeader(std::cout);
+            this->printOutput(std::cout,0,norm_0);
+          }
         }
-      }
 
-      // check for convergence
-      if( max_value(def0) < 1e-30 ) {
+      if(all_true(norm_0 < EPSILON)) {
+        _W.post(x);
         res.converged = true;
-        res.iterations = 0;
-        res.reduction = 0;
-        res.conv_rate = 0;
-        res.elapsed = 0.0;
-        // final print
-        if(_verbose > 0)
-          std::cout << "=== rate=" << res.conv_rate
-                    << ", T=" << res.elapsed
-                    << ", TIT=" << res.elapsed
-                    << ", IT=" << res.iterations
-                    << std::endl;
-        return;
+        if(_verbose > 0) // final print
+          print_result(res);
       }
 
-      // the defect norm
-      real_type def = def0;
-      // recurrence coefficients as computed in Lanczos algorithm
-      field_type alpha, beta;
-      // diagonal entries of givens rotation
-      std::array<real_type,2> c{{0.0,0.0}};
-      // off-diagonal entries of givens rotation
-      std::array<field_type,2> s{{0.0,0.0}};
-
-      // recurrence coefficients (column k of tridiag matrix T_k)
-      std::array<field_type,3> T{{0.0,0.0,0.0}};
-
-      // the rhs vector of the min problem
-      std::array<field_type,2> xi{{1.0,0.0}};
+      while(j <= _maxit && res.converged != true) {
 
-      // some temporary vectors
-      X z(b), dummy(b);
+        int i = 0;
+        v[0] *= 1.0/norm;
+        s[0] = norm;
+        for(i=1; i<m+1; i++)
+          s[i] = 0.0;
 
-      // initialize and clear correction
-      z = 0.0;
-      _prec.apply(z,b);
+        for(i=0; i < m && j <= _maxit && res.converged != true; i++, j++) {
+          w = 0.0;
+          // use v[i+1] as temporary vector
+          v[i+1] = 0.0;
+          // do Arnoldi algorithm
+          _A.apply(v[i],v[i+1]);
+          _W.apply(w,v[i+1]);
+          if(_orthogonalization == GMResOrthogonalization::classicalGramSchmidt2)
+            orthogonalizeCGS2(w,v,i,H,
+                              std::integral_constant<bool,std::is_same<X,Y>::value && std::is_same<X,F>::value>());
+          else {
+            for(int k=0; k<i+1; k++) {
+              // notice that _sp.dot(v[k],w) = v[k]\adjoint w
+              // so one has to pay attention to the order
+              // in the scalar product for the complex case
+              // doing the modified Gram-Schmidt algorithm
+              H[k][i] = _sp.dot(v[k],w);
+              // w -= H[k][i] * v[k]
+              w.axpy(-H[k][i],v[k]);
+            }
+            H[i+1][i] = _sp.norm(w);
+          }
+          if(all_true(abs(H[i+1][i]) < EPSILON))
+            DUNE_THROW(SolverAbort,
+                       "breakdown in GMRes - |w| == 0.0 after " << j << " iterations");
 
-      // beta is real and positive in exact arithmetic
-      // since it is the norm of the basis vectors (in unpreconditioned case)
-      beta = sqrt(_sp.dot(b,z));
-      field_type beta0 = beta;
+          // normalize new vector
+          v[i+1] = w; v[i+1] *= 1.0/H[i+1][i];
 
-      // the search directions
-      std::array<X,3> p{{b,b,b}};
-      p[0] = 0.0;
-      p[1] = 0.0;
-      p[2] = 0.0;
+          // update QR factorization
+          for(int k=0; k<i; k++)
+            applyPlaneRotation(H[k][i],H[k+1][i],cs[k],sn[k]);
 
-      // orthonormal basis vectors (in unpreconditioned case)
-      std::array<X,3> q{{b,b,b}};
-      q[0] = 0.0;
-      q[1] *= 1.0/beta;
-      q[2] = 0.0;
+          // compute new givens rotation
+          generatePlaneRotation(H[i][i],H[i+1][i],cs[i],sn[i]);
+          // finish updating QR factorization
+          applyPlaneRotation(H[i][i],H[i+1][i],cs[i],sn[i]);
+          applyPlaneRotation(s[i],s[i+1],cs[i],sn[i]);
 
-      z *= 1.0/beta;
+          // norm of the defect is the last component the vector s
+          norm = abs(s[i+1]);
 
-      // the loop
-      int i = 1;
-      for( ; i<=_maxit; i++) {
+          // print current iteration statistics
+          if(_verbose > 1) {
+            this->printOutput(std::cout,j,norm,norm_old);
+          }
 
-        dummy = z;
-        int i1 = i%3,
-          i0 = (i1+2)%3,
-          i2 = (i1+1)%3;
+          norm_old = norm;
 
-        // symmetrically preconditioned Lanczos algorithm (see Greenbaum p.121)
-        _op.apply(z,q[i2]); // q[i2] = Az
-        q[i2].axpy(-beta,q[i0]);
-        // alpha is real since it is the diagonal entry of the hermitian tridiagonal matrix
-        // from the Lanczos Algorithm
-        // so the order in the scalar product doesn't matter even for the complex case
-        alpha = _sp.dot(z,q[i2]);
-        q[i2].axpy(-alpha,q[i1]);
+          // check convergence
+          if(all_true(norm < reduction * norm_0))
+            res.converged = true;
 
-        z = 0.0;
-        _prec.apply(z,q[i2]);
+        } // end for
 
-        // beta is real and positive in exact arithmetic
-        // since it is the norm of the basis vectors (in unpreconditioned case)
-        beta = sqrt(_sp.dot(q[i2],z));
+        // calculate update vector
+        w = 0.0;
+        update(w,i,H,s,v);
+        // and current iterate
+        x += w;
 
-        q[i2] *= 1.0/beta;
-        z *= 1.0/beta;
+        // restart GMRes if convergence was not achieved,
+        // i.e. linear defect has not reached desired reduction
+        // and if j < _maxit
+        if( res.converged != true && j <= _maxit ) {
 
-        // QR Factorization of recurrence coefficient matrix
-        // apply previous givens rotations to last column of T
-        T[1] = T[2];
-        if(i>2) {
-          T[0] = s[i%2]*T[1];
-          T[1] = c[i%2]*T[1];
-        }
-        if(i>1) {
-          T[2] = c[(i+1)%2]*alpha - s[(i+1)%2]*T[1];
-          T[1] = c[(i+1)%2]*T[1] + s[(i+1)%2]*alpha;
+          if(_verbose > 0)
+            std::cout << "=== GMRes::restart" << std::endl;
+          // get saved rhs
+          b = b2;
+          // calculate new defect
+          _A.applyscaleadd(-1.0,x,b); // b -= Ax;
+          // calculate preconditioned defect
+          v[0] = 0.0;
+          _W.apply(v[0],b);
+          norm = _sp.norm(v[0]);
+          norm_old = norm;
         }
-        else
-          T[2] = alpha;
 
-        // update QR factorization
-        generateGivensRotation(T[2],beta,c[i%2],s[i%2]);
-        // to last column of T_k
-        T[2] = c[i%2]*T[2] + s[i%2]*beta;
-        // and to the rhs xi of the min problem
-        xi[i%2] = -s[i%2]*xi[(i+1)%2];
-        xi[(i+1)%2] *= c[i%2];
+      } //end while
 
-        // compute correction direction
-        p[i2] = dummy;
-        p[i2].axpy(-T[1],p[i1]);
-        p[i2].axpy(-T[0],p[i0]);
-        p[i2] *= 1.0/T[2];
+      // postprocess preconditioner
+      _W.post(x);
 
-        // apply correction/update solution
-        x.axpy(beta0*xi[(i+1)%2],p[i2]);
+      // save solver statistics
+      res.iterations = j-1; // it has to be j-1!!!
+      res.reduction = static_cast<double>(max_value(norm/norm_0));
+      res.conv_rate = pow(res.reduction,1.0/(j-1));
+      res.elapsed = watch.elapsed();
 
-        // remember beta_old
-        T[2] = beta;
+      if(_verbose>0)
+        print_result(res);
 
-        // check for convergence
-        // the last entry in the rhs of the min-problem is the residual
-        real_type defnew = abs(beta0*xi[i%2]);
+    }
 
-          if(_verbose > 1)
-            this->printOutput(std::cout,i,defnew,def);
+  protected :
 
-          def = defnew;
-          if(all_true(def < def0*_reduction)
-              || max_value(def) < 1e-30 || i == _maxit ) {
-            res.converged = true;
-            break;
-          }
-        } // end for
+    void print_result(const InverseOperatorResult& res) const {
+      int k = res.iterations>0 ? res.iterations : 1;
+      std::cout << "=== rate=" << res.conv_rate
+                << ", T=" << res.elapsed
+                << ", TIT=" << res.elapsed/k
+                << ", IT=" << res.iterations
+                << std::endl;
+    }
 
-        if(_verbose == 1)
-          this->printOutput(std::cout,i,def);
+    // Classical Gram-Schmidt with reorthogonalization: each pass computes
+    // the projections h = V^H w by a single multiDot() and then w -= V h in
+    // one pass over w. The second pass also computes |w|^2, from which the
+    // norm of the orthogonalized w follows by Pythagoras, unless too much
+    // of w is cancelled for that to be accurate.
+    template<class Basis>
+    void orthogonalizeCGS2(X& w, const Basis& v, int i,
+                           std::vector<std::vector<field_type> >& H, std::true_type)
+    {
+      using std::abs;
+      using std::real;
+      using std::sqrt;
+      std::vector<std::pair<const X*,const X*> > pairs;
+      std::vector<field_type> h, h2;
+      for(int k=0; k<i+1; k++)
+        pairs.emplace_back(&v[k],&w);
+      _sp.multiDot(pairs,h);
+      subtractProjections(w,v,h,i+1,Imp::IsBlockVector<X>());
+
+      pairs.emplace_back(&w,&w);
+      _sp.multiDot(pairs,h2);
+      subtractProjections(w,v,h2,i+1,Imp::IsBlockVector<X>());
+
+      const real_type ww = real(h2[i+1]);
+      real_type norm2 = ww;
+      for(int k=0; k<i+1; k++) {
+        H[k][i] = h[k] + h2[k];
+        norm2 -= abs(h2[k])*abs(h2[k]);
+      }
+      if(norm2 > 0.5*ww)
+        H[i+1][i] = sqrt(norm2);
+      else
+        H[i+1][i] = _sp.norm(w);
+    }
 
-        // postprocess preconditioner
-        _prec.post(x);
-        // fill statistics
-        res.iterations = i;
-        res.reduction = static_cast<double>(max_value(def/def0));
-        res.conv_rate = pow(res.reduction,1.0/i);
-        res.elapsed = watch.elapsed();
+    // never called, the constructors reject classical Gram-Schmidt for these types
+    template<class Basis>
+    void orthogonalizeCGS2(Y&, const Basis&, int,
+                           std::vector<std::vector<field_type> >&, std::false_type)
+    {
+      DUNE_THROW(NotImplemented,"classical Gram-Schmidt needs the same domain, range and basis types");
+    }
 
-        // final print
-        if(_verbose > 0) {
-          std::cout << "=== rate=" << res.conv_rate
-                    << ", T=" << res.elapsed
-                    << ", TIT=" << res.elapsed/i
-                    << ", IT=" << i << std::endl;
-        }
+    void checkOrthogonalization() const
+    {
+      if(_orthogonalization == GMResOrthogonalization::classicalGramSchmidt2
+         && !(std::is_same<X,Y>::value && std::is_same<X,F>::value))
+        DUNE_THROW(NotImplemented,
+                   "RestartedGMResSolver: classical Gram-Schmidt needs the same domain, range and basis types");
     }
 
-    /*!
-       \brief Apply inverse operator with given reduction factor.
+    // w -= sum_k h[k] v[k] for k < count
+    template<class Basis>
+    void subtractProjections(X& w, const Basis& v, const std::vector<field_type>& h, int count, std::true_type)
+    {
+      std::vector<const X*> vs;
+      std::vector<field_type> a;
+      for(int k=0; k<count; k++) {
+        vs.push_back(&v[k]);
+        a.push_back(-h[k]);
+      }
+      fusedAxpys(w,a,vs);
+    }
 
-       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
-     */
-    virtual void apply (X& x, X& b, double reduction, InverseOperatorResult& res)
+    template<class Basis>
+    void subtractProjections(X& w, const Basis& v, const std::vector<field_type>& h, int count, std::false_type)
     {
-      real_type saved_reduction = _reduction;
-      _reduction = reduction;
-      (*this).apply(x,b,res);
-      _reduction = saved_reduction;
+      for(int k=0; k<count; k++)
+        w.axpy(-h[k],v[k]);
+    }
+
+    void update(X& w, int i,
+                const std::vector<std::vector<field_type> >& H,
+                const std::vector<field_type>& s,
+                const std::vector<X>& v) {
+      // solution vector of the upper triangular system
+      std::vector<field_type> y(s);
+
+      // backsolve
+      for(int a=i-1; a>=0; a--) {
+        field_type rhs(s[a]);
+        for(int b=a+1; b<i; b++)
+          rhs -= H[a][b]*y[b];
+        y[a] = rhs/H[a][a];
+
+        // compute update on the fly
+        // w += y[a]*v[a]
+        w.axpy(y[a],v[a]);
+      }
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<field_type,real_type>::value,T>::type conjugate(const T& t) {
+      return t;
+    }
+
+    template<typename T>
+    typename std::enable_if<!std::is_same<field_type,real_type>::value,T>::type conjugate(const T& t) {
+      using std::conj;
+      return conj(t);
     }
 
-  private:
-
     // helper function to extract the real value of a real or complex number
     inline
     real_type to_real(const real_type & v)
@@ -1100,7 +3140,8 @@ namespace Dune {
       return v.real();
     }
 
-    void generateGivensRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
+    void
+    generatePlaneRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
     {
       using std::sqrt;
       using std::abs;
@@ -1119,165 +3160,137 @@ namespace Dune {
           real_type(0.0),
           cond(norm_dy > norm_dx,
             real_type(1.0)/sqrt(1.0 + temp*temp)*temp,
-            // dy and dx are real in exact arithmetic
-            // thus dx*dy is real so we can explicitly enforce it
-            real_type(1.0)/sqrt(1.0 + temp*temp)*to_real(dx*dy)/norm_dx/norm_dy)));
+            real_type(1.0)/sqrt(1.0 + temp*temp)*to_real(dx*conjugate(dy))/norm_dx/norm_dy)));
       sn = cond(norm_dy < eps,
         field_type(0.0),
         cond(norm_dx < eps,
           field_type(1.0),
           cond(norm_dy > norm_dx,
             field_type(1.0)/sqrt(1.0 + temp*temp),
-            // dy and dx is real in exact arithmetic
-            // so we don't have to conjugate both of them
-            field_type(1.0)/sqrt(1.0 + temp*temp)*dy/dx)));
+            field_type(1.0)/sqrt(1.0 + temp*temp)*conjugate(dy/dx))));
     }
 
+
+    void
+    applyPlaneRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
+    {
+      field_type temp  =  cs * dx + sn * dy;
+      dy = -conjugate(sn) * dx + cs * dy;
+      dx = temp;
+    }
+
+    LinearOperator<X,Y>& _A;
+    Preconditioner<X,Y>& _W;
     SeqScalarProduct<X> ssp;
-    LinearOperator<X,X>& _op;
-    Preconditioner<X,X>& _prec;
     ScalarProduct<X>& _sp;
+    int _restart;
     real_type _reduction;
     int _maxit;
     int _verbose;
+    GMResOrthogonalization _orthogonalization = GMResOrthogonalization::modifiedGramSchmidt;
   };
 
-  /**
-     \brief implements the Generalized Minimal Residual (GMRes) method
 
-     GMRes solves the unsymmetric linear system Ax = b using the
-     Generalized Minimal Residual method as described the SIAM Templates
-     book (http://www.netlib.org/templates/templates.pdf).
+  /**
+     \brief s-step (communication-avoiding) GMRes method, restarted after every s steps.
+
+     The Newton basis GMRes of Bai, Hu and Reichel, "A Newton basis
+     GMRES implementation", IMA J. Numer. Anal. 14 (1994). Each cycle
+     builds the s+1 basis vectors \f$ v_0 = r/\|r\| \f$,
+     \f$ v_{j+1} = M^{-1}Av_j - \theta_j v_j \f$ of the Krylov space of the
+     preconditioned operator, without orthogonalizing them. Their Gram
+     matrix is computed by a single call of ScalarProduct::multiDot()
+     and its Cholesky factor R is the triangular factor of the QR
+     decomposition of the basis. As \f$ M^{-1}A V_s = V_{s+1} B \f$ with
+     the bidiagonal matrix B of the shifts, the defect is minimized by
+     the small least squares problem with the Hessenberg matrix RB. A
+     cycle of s steps thus needs one global reduction instead of the
+     about s^2/2 of the modified Gram-Schmidt orthogonalization of
+     RestartedGMResSolver.
+
+     Like RestartedGMResSolver, the norm of the preconditioned defect is
+     checked for convergence. At each restart the preconditioned defect
+     is recomputed from b - Ax, which costs an application of the
+     operator and the preconditioner, but no reduction, as its norm is
+     taken from the Gram matrix of the next cycle. Without shifts the
+     monomial basis becomes ill conditioned for larger s, shifts for the
+     Newton basis are computed by newtonShifts(). If the basis vectors
+     are numerically dependent, a cycle does less than s steps.
 
      \tparam X trial vector, vector type of the solution
      \tparam Y test vector, vector type of the RHS
-     \tparam F vector type for orthonormal basis of Krylov space
-
+     \tparam F vector type for the basis of Krylov space
    */
-
   template<class X, class Y=X, class F = Y>
-  class RestartedGMResSolver : public InverseOperator<X,Y>
+  class SStepGMResSolver : public RestartedGMResSolver<X,Y,F>
   {
+    typedef RestartedGMResSolver<X,Y,F> Base;
   public:
-    //! \brief The domain type of the operator to be inverted.
-    typedef X domain_type;
-    //! \brief The range type of the operator to be inverted.
-    typedef Y range_type;
     //! \brief The field type of the operator to be inverted
     typedef typename X::field_type field_type;
     //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
     typedef typename FieldTraits<field_type>::real_type real_type;
-    //! \brief The field type of the basis vectors
-    typedef F basis_type;
-
-    template<class L, class P>
-    DUNE_DEPRECATED_MSG("recalc_defect is a unused parameter! Use RestartedGMResSolver(L& op, P& prec, real_type reduction, int restart, int maxit, int verbose) instead")
-    RestartedGMResSolver (L& op, P& prec, real_type reduction, int restart, int maxit, int verbose, bool recalc_defect)
-      : _A(op)
-      , _W(prec)
-      , ssp()
-      , _sp(ssp)
-      , _restart(restart)
-      , _reduction(reduction)
-      , _maxit(maxit)
-      , _verbose(verbose)
-    {
-      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
-                    "P and L must be the same category!");
-      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
-                    "L must be sequential!");
-    }
-
 
     /*!
        \brief Set up solver.
 
        \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
-       \param restart number of GMRes cycles before restart
+       \param s The number of steps per cycle, i.e. the restart length.
+       \param shifts The shifts of the Newton basis, used cyclically. If empty, the monomial basis is used.
      */
     template<class L, class P>
-    RestartedGMResSolver (L& op, P& prec, real_type reduction, int restart, int maxit, int verbose) :
-      _A(op), _W(prec),
-      ssp(), _sp(ssp), _restart(restart),
-      _reduction(reduction), _maxit(maxit), _verbose(verbose)
-    {
-      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
-                    "P and L must be the same category!");
-      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
-                    "L must be sequential!");
-    }
-
-    template<class L, class S, class P>
-    DUNE_DEPRECATED_MSG("recalc_defect is a unused parameter! Use RestartedGMResSolver(L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose) instead")
-    RestartedGMResSolver(L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose, bool recalc_defect)
-      : _A(op)
-      , _W(prec)
-      , _sp(sp)
-      , _restart(restart)
-      , _reduction(reduction)
-      , _maxit(maxit)
-      , _verbose(verbose)
+    SStepGMResSolver (L& op, P& prec, real_type reduction, int s, int maxit, int verbose,
+                      const std::vector<real_type>& shifts = std::vector<real_type>()) :
+      Base(op,prec,reduction,s,maxit,verbose), _shifts(shifts)
     {
-      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
-                    " P and L must have the same category!");
-      static_assert(static_cast<int>(P::category) == static_cast<int>(S::category),
-                    "P and S must have the same category!");
+      checkSteps();
     }
 
     /*!
        \brief Set up solver.
 
        \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
-       \param restart number of GMRes cycles before restart
+       \param s The number of steps per cycle, i.e. the restart length.
+       \param shifts The shifts of the Newton basis, used cyclically. If empty, the monomial basis is used.
      */
     template<class L, class S, class P>
-    RestartedGMResSolver (L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose) :
-      _A(op), _W(prec),
-      _sp(sp), _restart(restart),
-      _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    SStepGMResSolver (L& op, S& sp, P& prec, real_type reduction, int s, int maxit, int verbose,
+                      const std::vector<real_type>& shifts = std::vector<real_type>()) :
+      Base(op,sp,prec,reduction,s,maxit,verbose), _shifts(shifts)
     {
-      static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
-                    "P and L must have the same category!");
-      static_assert(static_cast<int>(P::category) == static_cast<int>(S::category),
-                    "P and S must have the same category!");
+      checkSteps();
     }
 
-    /*!
-       \brief Apply inverse operator.
-
-       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
-
-       \note Currently, the RestartedGMResSolver aborts when it detects a
-             breakdown.
-     */
-    virtual void apply (X& x, Y& b, InverseOperatorResult& res)
-    {
-      apply(x,b,max_value(_reduction),res);
-    }
+    using Base::apply;
 
     /*!
        \brief Apply inverse operator.
 
        \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
 
-       \note Currently, the RestartedGMResSolver aborts when it detects a
-             breakdown.
+       \note The solver aborts if the first two basis vectors of a cycle
+             are numerically dependent.
      */
     virtual void apply (X& x, Y& b, double reduction, InverseOperatorResult& res)
     {
       using std::abs;
+      using std::min;
+      using std::real;
+      using std::sqrt;
       const real_type EPSILON = 1e-80;
-      const int m = _restart;
-      real_type norm, norm_old = 0.0, norm_0;
-      int j = 1;
-      std::vector<field_type> s(m+1), sn(m);
-      std::vector<real_type> cs(m);
-      // need copy of rhs if GMRes has to be restarted
-      Y b2(b);
-      // helper vector
+      const real_type tol = 100*std::numeric_limits<real_type>::epsilon();
+      const std::size_t s = this->_restart;
+      typedef std::vector<std::vector<field_type> > DenseMatrix;
+
+      DenseMatrix G(s+1,std::vector<field_type>(s+1));  // the Gram matrix, then its Cholesky factor
+      DenseMatrix H(s+1,std::vector<field_type>(s));    // the Hessenberg matrix RB
+      std::vector<field_type> rhs(s+1), sn(s), dots;
+      std::vector<real_type> cs(s);
+      std::vector<std::pair<const F*,const F*> > pairs;
       Y w(b);
-      std::vector< std::vector<field_type> > H(m+1,s);
-      std::vector<F> v(m+1,b);
+      std::vector<F> v(s+1,b);
+      F r(b);
+      X dx(x);
 
       // start timer
       Dune::Timer watch;
@@ -1285,236 +3298,825 @@ namespace Dune {
 
       // clear solver statistics and set res.converged to false
       res.clear();
-      _W.pre(x,b);
+      this->_W.pre(x,b);
 
       // calculate defect and overwrite rhs with it
-      _A.applyscaleadd(-1.0,x,b); // b -= Ax
+      this->_A.applyscaleadd(-1.0,x,b); // b -= Ax
       // calculate preconditioned defect
-      v[0] = 0.0; _W.apply(v[0],b); // r = W^-1 b
-      norm_0 = _sp.norm(v[0]);
-      norm = norm_0;
-      norm_old = norm;
+      r = 0.0; this->_W.apply(r,b); // r = W^-1 b
+      const real_type norm_0 = this->_sp.norm(r);
+      real_type norm = norm_0;
 
       // print header
-      if(_verbose > 0)
+      if(this->_verbose > 0)
         {
-          std::cout << "=== RestartedGMResSolver" << std::endl;
-          if(_verbose > 1) {
+          std::cout << "=== SStepGMResSolver" << std::endl;
+          if(this->_verbose > 1) {
             this->printHeader(std::cout);
             this->printOutput(std::cout,0,norm_0);
           }
         }
 
-      if(all_true(norm_0 < EPSILON)) {
-        _W.post(x);
+      if(all_true(norm_0 < EPSILON))
         res.converged = true;
-        if(_verbose > 0) // final print
-          print_result(res);
-      }
 
-      while(j <= _maxit && res.converged != true) {
-
-        int i = 0;
-        v[0] *= 1.0/norm;
-        s[0] = norm;
-        for(i=1; i<m+1; i++)
-          s[i] = 0.0;
+      int j = 0;
+      while(j < this->_maxit && res.converged != true) {
 
-        for(i=0; i < m && j <= _maxit && res.converged != true; i++, j++) {
+        // the basis of the Krylov space, starting with the defect
+        v[0] = r;
+        for(std::size_t l=0; l<s; l++) {
           w = 0.0;
-          // use v[i+1] as temporary vector
-          v[i+1] = 0.0;
-          // do Arnoldi algorithm
-          _A.apply(v[i],v[i+1]);
-          _W.apply(w,v[i+1]);
-          for(int k=0; k<i+1; k++) {
-            // notice that _sp.dot(v[k],w) = v[k]\adjoint w
-            // so one has to pay attention to the order
-            // in the scalar product for the complex case
-            // doing the modified Gram-Schmidt algorithm
-            H[k][i] = _sp.dot(v[k],w);
-            // w -= H[k][i] * v[k]
-            w.axpy(-H[k][i],v[k]);
+          // use v[l+1] as temporary vector
+          v[l+1] = 0.0;
+          this->_A.apply(v[l],v[l+1]);
+          this->_W.apply(w,v[l+1]);
+          v[l+1] = w;
+          if(shift(l) != real_type(0))
+            v[l+1].axpy(-shift(l),v[l]);
+        }
+
+        // its Gram matrix by a single reduction, and R^H R = V^H V
+        pairs.clear();
+        for(std::size_t l=0; l<=s; l++)
+          for(std::size_t m=0; m<=l; m++)
+            pairs.emplace_back(&v[l],&v[m]);
+        this->_sp.multiDot(pairs,dots);
+        std::size_t d = 0;
+        for(std::size_t l=0; l<=s; l++)
+          for(std::size_t m=0; m<=l; m++)
+            G[l][m] = dots[d++];
+
+        // the norm of the recomputed defect
+        norm = sqrt(real(G[0][0]));
+        if(j > 0 && all_true(norm < reduction * norm_0)) {
+          res.converged = true;
+          break;
+        }
+
+        const std::size_t rank = Imp::choleskyFactor(G,s+1,tol);
+        if(rank < 2)
+          DUNE_THROW(SolverAbort,
+                     "breakdown in s-step GMRes - dependent basis after " << j << " iterations");
+        const std::size_t k = min(rank-1,static_cast<std::size_t>(this->_maxit-j));
+
+        // H = R B, where column l of B is theta_l e_l + e_{l+1}, and the right hand side R e_0 |r|
+        for(std::size_t m=0; m<k; m++)
+          for(std::size_t l=0; l<=k; l++)
+            H[l][m] = (l<=m ? Imp::conjugate(G[m][l])*shift(m) : field_type(0.0))
+                      + (l<=m+1 ? Imp::conjugate(G[m+1][l]) : field_type(0.0));
+        rhs[0] = G[0][0];
+        for(std::size_t l=1; l<=k; l++)
+          rhs[l] = 0.0;
+
+        // the QR factorization of H by plane rotations
+        std::size_t steps = k;
+        real_type norm_old = norm;
+        for(std::size_t m=0; m<k; m++) {
+          for(std::size_t l=0; l<m; l++)
+            this->applyPlaneRotation(H[l][m],H[l+1][m],cs[l],sn[l]);
+          this->generatePlaneRotation(H[m][m],H[m+1][m],cs[m],sn[m]);
+          this->applyPlaneRotation(H[m][m],H[m+1][m],cs[m],sn[m]);
+          this->applyPlaneRotation(rhs[m],rhs[m+1],cs[m],sn[m]);
+
+          // the norm of the defect is the last component of rhs
+          const real_type norm_new = abs(rhs[m+1]);
+          if(this->_verbose > 1)
+            this->printOutput(std::cout,j+m+1,norm_new,norm_old);
+          norm_old = norm_new;
+          if(all_true(norm_new < reduction * norm_0)) {
+            res.converged = true;
+            steps = m+1;
+            break;
           }
-          H[i+1][i] = _sp.norm(w);
-          if(all_true(abs(H[i+1][i]) < EPSILON))
-            DUNE_THROW(SolverAbort,
-                       "breakdown in GMRes - |w| == 0.0 after " << j << " iterations");
+        }
+
+        // backsolve for the coefficients y and x += V y
+        for(std::size_t a=steps; a-->0; ) {
+          for(std::size_t c=a+1; c<steps; c++)
+            rhs[a] -= H[a][c]*rhs[c];
+          rhs[a] /= H[a][a];
+        }
+        dx = 0.0;
+        for(std::size_t m=0; m<steps; m++)
+          dx.axpy(rhs[m],v[m]);
+        x += dx;
+        norm = norm_old;
+        j += steps;
+
+        // the preconditioned defect r = W^-1 (b - Ax) for the next cycle
+        if(j < this->_maxit && res.converged != true) {
+          this->_A.applyscaleadd(-1.0,dx,b);
+          r = 0.0; this->_W.apply(r,b);
+        }
+      }
+
+      // postprocess preconditioner
+      this->_W.post(x);
+
+      // save solver statistics
+      res.iterations = j;
+      res.reduction = static_cast<double>(max_value(norm/norm_0));
+      res.conv_rate = pow(res.reduction,1.0/std::max(1,j));
+      res.elapsed = watch.elapsed();
+
+      if(this->_verbose>0)
+        this->print_result(res);
+    }
+
+  private:
+    void checkSteps () const
+    {
+      if (this->_restart<1)
+        DUNE_THROW(ISTLError,"SStepGMResSolver: the number of steps has to be positive");
+    }
+
+    real_type shift (std::size_t l) const
+    {
+      return _shifts.empty() ? real_type(0) : _shifts[l%_shifts.size()];
+    }
+
+    std::vector<real_type> _shifts;
+  };
+
+  /**
+     \brief GMRes method that recycles a subspace between cycles and solves.
+
+     The GCRO-DR method of Parks, de Sturler, Mackey, Johnson and Maiti,
+     "Recycling Krylov subspaces for sequences of linear systems", SIAM
+     J. Sci. Comput. 28 (2006), for sequences of systems with the same or
+     a slowly changing nonsymmetric operator, like in implicit time
+     stepping. Like RestartedGMResSolver, it minimizes the norm of the
+     preconditioned defect \f$ M^{-1}(b-Ax) \f$. The solver object keeps
+     a space U together with \f$ C = M^{-1}AU \f$, whose vectors are
+     orthonormal, from one cycle and one call of apply() to the next.
+
+     Each cycle projects the defect onto the orthogonal complement of C,
+     which adds \f$ UC^Hr \f$ to the iterate, and then runs Arnoldi steps
+     with \f$ (I-CC^H)M^{-1}A \f$, so that the defect is minimized over U
+     and the new Krylov space together. With k recycled vectors, a cycle
+     has restart-k steps, the first cycle of the first solve is a plain
+     GMRes cycle. The basis is orthogonalized by classical Gram-Schmidt
+     done twice, by two calls of ScalarProduct::multiDot() per step.
+
+     After each cycle, U is replaced by the harmonic Ritz vectors of
+     \f$ M^{-1}A \f$ in the space searched by the cycle for the harmonic
+     Ritz values of smallest modulus, which slow down GMRes the most.
+     They follow from a small generalized eigenvalue problem, which is
+     solved by the QR method. For real field types, the real and
+     imaginary parts of complex Ritz vectors are recycled.
+
+     At each restart the preconditioned defect is recomputed from b - Ax.
+     If the operator or the preconditioner changes, updateOperator() has
+     to be called before the next solve. It recomputes AU with one
+     application of the operator per recycled vector, the preconditioner
+     is applied at the beginning of the next solve.
+   */
+  template<class X>
+  class RecyclingGMResSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+    //! \brief The real type of the field type (is the same if using real numbers, but differs for std::complex)
+    typedef typename FieldTraits<field_type>::real_type real_type;
+
+    /*!
+       \brief Set up recycling GMRes solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+       \param restart The dimension of the search space of a cycle, including the recycled space.
+       \param recycle The dimension of the recycled space, less than restart.
+     */
+    template<class L, class P>
+    RecyclingGMResSolver (L& op, P& prec, real_type reduction, int restart, int maxit, int verbose,
+                          int recycle) :
+      ssp(), _op(&op), _prec(&prec), _sp(ssp), _reduction(reduction), _restart(restart),
+      _maxit(maxit), _verbose(verbose), _recycle(recycle)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+                    "L must be sequential!");
+      checkDimension();
+    }
+
+    /*!
+       \brief Set up recycling GMRes solver.
+
+       \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+       \param restart The dimension of the search space of a cycle, including the recycled space.
+       \param recycle The dimension of the recycled space, less than restart.
+     */
+    template<class L, class S, class P>
+    RecyclingGMResSolver (L& op, S& sp, P& prec, real_type reduction, int restart, int maxit, int verbose,
+                          int recycle) :
+      _op(&op), _prec(&prec), _sp(sp), _reduction(reduction), _restart(restart),
+      _maxit(maxit), _verbose(verbose), _recycle(recycle)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      static_assert(static_cast<int>(L::category) == static_cast<int>(S::category),
+                    "L and S must have the same category!");
+      checkDimension();
+    }
+
+    /*!
+       \brief Apply inverse operator.
+
+       \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+
+       The reduction is that of the preconditioned defect of the initial
+       guess, before its projection.
+     */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      using std::abs;
+      using std::isfinite;
+      const std::size_t m = _restart;
+
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec->pre(x,b);            // prepare preconditioner
+      _op->applyscaleadd(-1,x,b); // overwrite b with defect
+
+      X r(x);              // the preconditioned defect
+      X w(x);              // the new basis vector
+      X dx(x);             // the correction of a cycle
+      r = 0;
+      _prec->apply(r,b);
+      const real_type def0 = _sp.norm(r); // compute norm
+
+      if (!all_true(isfinite(def0))) // check for inf or NaN
+      {
+        if (_verbose>0)
+          std::cout << "=== RecyclingGMResSolver: abort due to infinite or NaN initial defect"
+                    << std::endl;
+        DUNE_THROW(SolverAbort, "RecyclingGMResSolver: initial defect=" << def0
+                   << " is infinite or NaN");
+      }
+
+      if (max_value(def0)<1E-30)    // convergence check
+      {
+        _prec->post(x);
+        res.converged  = true;
+        res.iterations = 0;               // fill statistics
+        res.reduction = 0;
+        res.conv_rate  = 0;
+        res.elapsed=0;
+        if (_verbose>0)                 // final print
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                    << ", IT=0" << std::endl;
+        return;
+      }
+
+      if (_verbose>0)             // printing
+      {
+        std::cout << "=== RecyclingGMResSolver with " << _u.size() << " recycled vectors" << std::endl;
+        if (_verbose>1) {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,def0);
+        }
+      }
 
-          // normalize new vector
-          v[i+1] = w; v[i+1] *= 1.0/H[i+1][i];
+      // C = M^{-1}AU for a changed operator
+      if (_stale)
+        updatePreconditionedImages();
 
-          // update QR factorization
-          for(int k=0; k<i; k++)
-            applyPlaneRotation(H[k][i],H[k+1][i],cs[k],sn[k]);
+      // the Krylov basis, the least squares matrix G = [I B; 0 H] of the
+      // cycle and G reduced to triangular form by plane rotations
+      std::vector<X> v(m+1,x);
+      DenseMatrix G(m+1,std::vector<field_type>(m)), T(G);
+      std::vector<field_type> rhs(m+1), sn(m), h, h2;
+      std::vector<real_type> cs(m);
+      std::vector<std::pair<const X*,const X*> > pairs;
+      std::vector<const X*> basis;
 
-          // compute new givens rotation
-          generatePlaneRotation(H[i][i],H[i+1][i],cs[i],sn[i]);
-          // finish updating QR factorization
-          applyPlaneRotation(H[i][i],H[i+1][i],cs[i],sn[i]);
-          applyPlaneRotation(s[i],s[i+1],cs[i],sn[i]);
+      real_type def = def0;
+      int i = 0;
+      while (true)
+      {
+        const std::size_t k = _u.size();
 
-          // norm of the defect is the last component the vector s
-          norm = abs(s[i+1]);
+        // the projection onto the complement of C, x += U C^H r
+        dx = 0;
+        if (k>0)
+        {
+          std::vector<field_type> c = products(_c,r);
+          for (std::size_t l=0; l<k; ++l)
+          {
+            dx.axpy(c[l],_u[l]);
+            r.axpy(-c[l],_c[l]);
+          }
+        }
+        if (k>0 || i>0)
+        {
+          def = _sp.norm(r);
+          if (_verbose>1 && i==0)
+            this->printOutput(std::cout,0,def,def0);
+        }
+        if (all_true(def<def0*_reduction) || max_value(def)<1E-30)    // convergence check
+        {
+          x += dx;
+          res.converged = true;
+          break;
+        }
+        if (i>=_maxit)
+        {
+          x += dx;
+          break;
+        }
 
-          // print current iteration statistics
-          if(_verbose > 1) {
-            this->printOutput(std::cout,j,norm,norm_old);
+        v[0] = r;
+        v[0] *= real_type(1)/def;
+        for (auto& row : G)
+          std::fill(row.begin(),row.end(),field_type(0));
+        for (std::size_t a=0; a<k; ++a)
+          G[a][a] = 1;
+        T = G;
+        std::fill(rhs.begin(),rhs.end(),field_type(0));
+        rhs[k] = def;
+
+        // the Arnoldi steps with (I - C C^H) M^{-1} A
+        std::size_t j = 0;
+        real_type defOld = def;
+        while (k+j<m && i<_maxit)
+        {
+          v[j+1] = 0;
+          _op->apply(v[j],v[j+1]);
+          w = 0;
+          _prec->apply(w,v[j+1]);
+
+          // classical Gram-Schmidt against C and V done twice, the second
+          // pass computes |w|^2 for the norm of the orthogonalized w
+          pairs.clear();
+          basis.clear();
+          for (const X& cl : _c)
+            basis.push_back(&cl);
+          for (std::size_t l=0; l<=j; ++l)
+            basis.push_back(&v[l]);
+          for (const X* q : basis)
+            pairs.emplace_back(q,&w);
+          _sp.multiDot(pairs,h);
+          subtractProjections(w,basis,h,Imp::IsBlockVector<X>());
+          pairs.emplace_back(&w,&w);
+          _sp.multiDot(pairs,h2);
+          subtractProjections(w,basis,h2,Imp::IsBlockVector<X>());
+
+          using std::real;
+          using std::sqrt;
+          const real_type ww = real(h2.back());
+          real_type norm2 = ww;
+          for (std::size_t l=0; l<basis.size(); ++l)
+          {
+            G[l][k+j] = h[l] + h2[l];
+            norm2 -= abs(h2[l])*abs(h2[l]);
           }
+          const real_type norm = (norm2 > 0.5*ww) ? sqrt(norm2) : _sp.norm(w);
+          G[k+j+1][k+j] = norm;
+          v[j+1] = w;
+          if (norm>real_type(0))
+            v[j+1] *= real_type(1)/norm;
+
+          // the rotations only act on the rows of V, the rows of C are triangular
+          for (std::size_t a=0; a<=k+j+1; ++a)
+            T[a][k+j] = G[a][k+j];
+          for (std::size_t l=k; l<k+j; ++l)
+            Imp::applyGivens(T[l][k+j],T[l+1][k+j],cs[l],sn[l]);
+          Imp::givensRotation(T[k+j][k+j],T[k+j+1][k+j],cs[k+j],sn[k+j]);
+          Imp::applyGivens(T[k+j][k+j],T[k+j+1][k+j],cs[k+j],sn[k+j]);
+          Imp::applyGivens(rhs[k+j],rhs[k+j+1],cs[k+j],sn[k+j]);
+          ++j;
+          ++i;
+
+          // the norm of the defect is the last component of rhs
+          def = abs(rhs[k+j]);
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,def,defOld);
+          defOld = def;
+          if (!all_true(isfinite(def))) // check for inf or NaN
+          {
+            if (_verbose>0)
+              std::cout << "=== RecyclingGMResSolver: abort due to infinite or NaN defect"
+                        << std::endl;
+            DUNE_THROW(SolverAbort,
+                       "RecyclingGMResSolver: defect=" << def << " is infinite or NaN");
+          }
+          if (all_true(def<def0*_reduction) || max_value(def)<1E-30)    // convergence check
+          {
+            res.converged = true;
+            break;
+          }
+          if (!(norm>real_type(0)))   // the Krylov space is invariant
+            break;
+        }
 
-          norm_old = norm;
+        // backsolve for the coefficients y and x += [U V] y
+        const std::size_t n = k+j;
+        std::vector<field_type> y(rhs.begin(),rhs.begin()+n);
+        for (std::size_t a=n; a-->0; )
+        {
+          for (std::size_t c=a+1; c<n; ++c)
+            y[a] -= T[a][c]*y[c];
+          y[a] /= T[a][a];
+        }
+        for (std::size_t a=0; a<k; ++a)
+          dx.axpy(y[a],_u[a]);
+        for (std::size_t l=0; l<j; ++l)
+          dx.axpy(y[k+l],v[l]);
+        x += dx;
+
+        updateRecycledSpace(v,j,G);
+        if (res.converged || i>=_maxit)
+          break;
 
-          // check convergence
-          if(all_true(norm < reduction * norm_0))
-            res.converged = true;
+        // the preconditioned defect r = M^{-1} (b - Ax) for the next cycle
+        _op->applyscaleadd(-1,dx,b);
+        r = 0;
+        _prec->apply(r,b);
+      }
 
-        } // end for
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
 
-        // calculate update vector
-        w = 0.0;
-        update(w,i,H,s,v);
-        // and current iterate
-        x += w;
+      _prec->post(x);                 // postprocess preconditioner
+      res.iterations = i;             // fill statistics
+      res.reduction = static_cast<double>(max_value(max_value(def/def0)));
+      res.conv_rate  = i>0 ? pow(res.reduction,1.0/i) : 0;
+      res.elapsed = watch.elapsed();
 
-        // restart GMRes if convergence was not achieved,
-        // i.e. linear defect has not reached desired reduction
-        // and if j < _maxit
-        if( res.converged != true && j <= _maxit ) {
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/std::max(i,1)
+                  << ", IT=" << i << std::endl;
+      }
+    }
 
-          if(_verbose > 0)
-            std::cout << "=== GMRes::restart" << std::endl;
-          // get saved rhs
-          b = b2;
-          // calculate new defect
-          _A.applyscaleadd(-1.0,x,b); // b -= Ax;
-          // calculate preconditioned defect
-          v[0] = 0.0;
-          _W.apply(v[0],b);
-          norm = _sp.norm(v[0]);
-          norm_old = norm;
-        }
+    /*!
+       \brief Apply inverse operator with given reduction factor.
 
-      } //end while
+       \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    virtual void apply (X& x, X& b, double reduction,
+                        InverseOperatorResult& res)
+    {
+      real_type saved_reduction = _reduction;
+      _reduction = reduction;
+      (*this).apply(x,b,res);
+      _reduction = saved_reduction;
+    }
 
-      // postprocess preconditioner
-      _W.post(x);
+    /*!
+       \brief Adapt the recycled space to a changed operator or preconditioner.
 
-      // save solver statistics
-      res.iterations = j-1; // it has to be j-1!!!
-      res.reduction = static_cast<double>(max_value(norm/norm_0));
-      res.conv_rate = pow(res.reduction,1.0/(j-1));
-      res.elapsed = watch.elapsed();
+       Recomputes AU with one application of the operator for each
+       recycled vector. The preconditioner is applied to AU and the
+       result orthonormalized at the beginning of the next solve.
+     */
+    void updateOperator ()
+    {
+      for (std::size_t l=0; l<_u.size(); ++l)
+      {
+        _c[l] = 0;
+        _op->apply(_u[l],_c[l]);
+      }
+      _stale = !_u.empty();
+    }
 
-      if(_verbose>0)
-        print_result(res);
+    /*!
+       \brief Continue with a new operator and preconditioner, keeping the recycled space.
 
+       The new objects replace those passed to the constructor, e.g. for a
+       new incomplete factorization of the changed matrix.
+     */
+    template<class L, class P>
+    void updateOperator (L& op, P& prec)
+    {
+      static_assert(static_cast<int>(L::category) == static_cast<int>(P::category),
+                    "L and P must have the same category!");
+      _op = &op;
+      _prec = &prec;
+      updateOperator();
     }
 
-  private :
+    //! The dimension of the current recycled space.
+    std::size_t recycledDimension () const
+    {
+      return _u.size();
+    }
 
-    void print_result(const InverseOperatorResult& res) const {
-      int k = res.iterations>0 ? res.iterations : 1;
-      std::cout << "=== rate=" << res.conv_rate
-                << ", T=" << res.elapsed
-                << ", TIT=" << res.elapsed/k
-                << ", IT=" << res.iterations
-                << std::endl;
+    //! Discard the recycled space, e.g. for an unrelated system.
+    void clearDeflationSpace ()
+    {
+      _u.clear();
+      _c.clear();
+      _stale = false;
     }
 
-    void update(X& w, int i,
-                const std::vector<std::vector<field_type> >& H,
-                const std::vector<field_type>& s,
-                const std::vector<X>& v) {
-      // solution vector of the upper triangular system
-      std::vector<field_type> y(s);
+  private:
+    typedef std::vector<std::vector<field_type> > DenseMatrix;
+    typedef std::complex<real_type> Complex;
+    typedef std::vector<std::vector<Complex> > ComplexMatrix;
 
-      // backsolve
-      for(int a=i-1; a>=0; a--) {
-        field_type rhs(s[a]);
-        for(int b=a+1; b<i; b++)
-          rhs -= H[a][b]*y[b];
-        y[a] = rhs/H[a][a];
+    void checkDimension () const
+    {
+      if (_recycle<1 || _restart<=_recycle)
+        DUNE_THROW(ISTLError,"RecyclingGMResSolver: the dimension of the recycled space has to be "
+                   "positive and less than the restart");
+    }
 
-        // compute update on the fly
-        // w += y[a]*v[a]
-        w.axpy(y[a],v[a]);
-      }
+    // W^H y by a single reduction
+    std::vector<field_type> products (const std::vector<X>& w, const X& y)
+    {
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (const X& wl : w)
+        pairs.emplace_back(&wl,&y);
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+      return dots;
     }
 
-    template<typename T>
-    typename std::enable_if<std::is_same<field_type,real_type>::value,T>::type conjugate(const T& t) {
-      return t;
+    // w -= sum_l h[l] basis[l]
+    static void subtractProjections (X& w, const std::vector<const X*>& basis,
+                                     const std::vector<field_type>& h, std::true_type)
+    {
+      std::vector<field_type> a(basis.size());
+      for (std::size_t l=0; l<basis.size(); ++l)
+        a[l] = -h[l];
+      fusedAxpys(w,a,basis);
     }
 
-    template<typename T>
-    typename std::enable_if<!std::is_same<field_type,real_type>::value,T>::type conjugate(const T& t) {
-      using std::conj;
-      return conj(t);
+    static void subtractProjections (X& w, const std::vector<const X*>& basis,
+                                     const std::vector<field_type>& h, std::false_type)
+    {
+      for (std::size_t l=0; l<basis.size(); ++l)
+        w.axpy(-h[l],*basis[l]);
     }
 
-    // helper function to extract the real value of a real or complex number
-    inline
-    real_type to_real(const real_type & v)
+    // C = M^{-1}AU, orthonormalized
+    void updatePreconditionedImages ()
     {
-      return v;
+      X t(_c.front());
+      for (std::size_t l=0; l<_c.size(); ++l)
+      {
+        t = _c[l];
+        _c[l] = 0;
+        _prec->apply(_c[l],t);
+      }
+      // twice, for the stability of the Cholesky QR factorization
+      orthonormalize();
+      orthonormalize();
+      _stale = false;
     }
 
-    inline
-    real_type to_real(const std::complex<real_type> & v)
+    // C = Q L^H by the Cholesky factorization of C^H C, then C = Q and
+    // U = U L^{-H}, vectors of C that are linearly dependent are dropped
+    void orthonormalize ()
     {
-      return v.real();
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (std::size_t l=0; l<_c.size(); ++l)
+        for (std::size_t m=0; m<=l; ++m)
+          pairs.emplace_back(&_c[l],&_c[m]);
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+      const std::size_t k = _c.size();
+      DenseMatrix L(k,std::vector<field_type>(k,field_type(0)));
+      std::size_t d = 0;
+      for (std::size_t l=0; l<k; ++l)
+        for (std::size_t m=0; m<=l; ++m, ++d)
+          L[l][m] = dots[d];
+      const real_type tol = 100*std::numeric_limits<real_type>::epsilon();
+      const std::size_t rank = Imp::choleskyFactor(L,k,tol);
+      _u.erase(_u.begin()+rank,_u.end());
+      _c.erase(_c.begin()+rank,_c.end());
+      for (std::size_t s=0; s<rank; ++s)
+      {
+        for (std::size_t t=0; t<s; ++t)
+        {
+          _c[s].axpy(-Imp::conjugate(L[s][t]),_c[t]);
+          _u[s].axpy(-Imp::conjugate(L[s][t]),_u[t]);
+        }
+        _c[s] *= real_type(1)/std::real(L[s][s]);
+        _u[s] *= real_type(1)/std::real(L[s][s]);
+      }
     }
 
-    void
-    generatePlaneRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
+    /*
+     * Replace U by the harmonic Ritz vectors of the cycle with the basis
+     * W = [UD V] of the search space, where D normalizes the columns of
+     * U, and M^{-1}AW = [C V'] G' with G' = G diag(D,I) and V' = [V v].
+     * With Z = [C V']^H W, the harmonic Ritz vectors are Wp for the
+     * eigenvectors p of G'^H G' p = theta G'^H Z p of the smallest |theta|.
+     * For the coefficients P of these vectors and G'P = QR, U = WPR^{-1}
+     * and C = [C V']Q are orthonormal with M^{-1}AU = C.
+     */
+    void updateRecycledSpace (const std::vector<X>& v, std::size_t steps, const DenseMatrix& G)
     {
+      using std::abs;
+      using std::real;
       using std::sqrt;
+      if (steps==0)
+        return;
+      const std::size_t k = _u.size();
+      const std::size_t n = k+steps;
+
+      // C^H U, V'^H U and the norms of U by a single reduction
+      std::vector<std::pair<const X*,const X*> > pairs;
+      for (std::size_t b=0; b<k; ++b)
+      {
+        for (std::size_t a=0; a<k; ++a)
+          pairs.emplace_back(&_c[a],&_u[b]);
+        for (std::size_t l=0; l<=steps; ++l)
+          pairs.emplace_back(&v[l],&_u[b]);
+        pairs.emplace_back(&_u[b],&_u[b]);
+      }
+      std::vector<field_type> dots;
+      _sp.multiDot(pairs,dots);
+
+      DenseMatrix Gs(n+1,std::vector<field_type>(n,field_type(0))), Z(Gs);
+      std::vector<real_type> scale(k);
+      std::size_t d = 0;
+      for (std::size_t b=0; b<k; ++b, d+=k+steps+2)
+      {
+        scale[b] = real_type(1)/sqrt(real(dots[d+k+steps+1]));
+        for (std::size_t a=0; a<=n; ++a)
+          Z[a][b] = dots[d+a]*scale[b];
+      }
+      for (std::size_t l=0; l<steps; ++l)
+        Z[k+l][k+l] = 1;
+      for (std::size_t a=0; a<=n; ++a)
+        for (std::size_t b=0; b<n; ++b)
+          Gs[a][b] = b<k ? G[a][b]*scale[b] : G[a][b];
+
+      // the standard eigenvalue problem of (G'^H Z)^{-1} G'^H G'
+      ComplexMatrix lhs(n,std::vector<Complex>(n,Complex(0))), rhs(lhs);
+      for (std::size_t a=0; a<n; ++a)
+        for (std::size_t b=0; b<n; ++b)
+          for (std::size_t r=0; r<=n; ++r)
+          {
+            lhs[a][b] += Complex(Imp::conjugate(Gs[r][a])*Gs[r][b]);
+            rhs[a][b] += Complex(Imp::conjugate(Gs[r][a])*Z[r][b]);
+          }
+      std::vector<Complex> theta;
+      ComplexMatrix eigenvectors;
+      if (!Imp::luSolve(rhs,n,lhs) || !Imp::generalEigen(lhs,n,theta,eigenvectors))
+        return;
+      const DenseMatrix P = ritzCoefficients(theta,eigenvectors,std::is_same<field_type,real_type>());
+
+      // Q and E = P R^{-1} by modified Gram-Schmidt done twice, dependent columns are dropped
+      const real_type tol = sqrt(std::numeric_limits<real_type>::epsilon());
+      DenseMatrix Q, E;
+      for (const std::vector<field_type>& p : P)
+      {
+        std::vector<field_type> q(n+1,field_type(0)), e(p);
+        for (std::size_t a=0; a<=n; ++a)
+          for (std::size_t b=0; b<n; ++b)
+            q[a] += Gs[a][b]*p[b];
+        const real_type norm0 = euclideanNorm(q);
+        for (int pass=0; pass<2; ++pass)
+          for (std::size_t t=0; t<Q.size(); ++t)
+          {
+            field_type r = 0;
+            for (std::size_t a=0; a<=n; ++a)
+              r += Imp::conjugate(Q[t][a])*q[a];
+            for (std::size_t a=0; a<=n; ++a)
+              q[a] -= r*Q[t][a];
+            for (std::size_t b=0; b<n; ++b)
+              e[b] -= r*E[t][b];
+          }
+        const real_type norm = euclideanNorm(q);
+        if (!(norm > tol*norm0))
+          continue;
+        for (field_type& qa : q)
+          qa /= norm;
+        for (field_type& eb : e)
+          eb /= norm;
+        Q.push_back(q);
+        E.push_back(e);
+      }
+      if (Q.empty())
+        return;
+
+      std::vector<X> u(Q.size(),v.front()), c(Q.size(),v.front());
+      for (std::size_t s=0; s<Q.size(); ++s)
+      {
+        u[s] = 0;
+        c[s] = 0;
+        for (std::size_t a=0; a<k; ++a)
+        {
+          u[s].axpy(E[s][a]*scale[a],_u[a]);
+          c[s].axpy(Q[s][a],_c[a]);
+        }
+        for (std::size_t l=0; l<steps; ++l)
+          u[s].axpy(E[s][k+l],v[l]);
+        for (std::size_t l=0; l<=steps; ++l)
+          c[s].axpy(Q[s][k+l],v[l]);
+      }
+      std::swap(_u,u);
+      std::swap(_c,c);
+    }
+
+    // the coefficients of the eigenvectors of the smallest |theta|, the
+    // real and imaginary parts of a complex pair count as two vectors
+    DenseMatrix ritzCoefficients (const std::vector<Complex>& theta, const ComplexMatrix& V,
+                                  std::true_type) const
+    {
       using std::abs;
-      using std::max;
-      using std::min;
-      const real_type eps = 1e-15;
-      real_type norm_dx = abs(dx);
-      real_type norm_dy = abs(dy);
-      real_type norm_max = max(norm_dx, norm_dy);
-      real_type norm_min = min(norm_dx, norm_dy);
-      real_type temp = norm_min/norm_max;
-      // we rewrite the code in a vectorizable fashion
-      cs = cond(norm_dy < eps,
-        real_type(1.0),
-        cond(norm_dx < eps,
-          real_type(0.0),
-          cond(norm_dy > norm_dx,
-            real_type(1.0)/sqrt(1.0 + temp*temp)*temp,
-            real_type(1.0)/sqrt(1.0 + temp*temp)*to_real(dx*conjugate(dy))/norm_dx/norm_dy)));
-      sn = cond(norm_dy < eps,
-        field_type(0.0),
-        cond(norm_dx < eps,
-          field_type(1.0),
-          cond(norm_dy > norm_dx,
-            field_type(1.0)/sqrt(1.0 + temp*temp),
-            field_type(1.0)/sqrt(1.0 + temp*temp)*conjugate(dy/dx))));
+      const std::size_t n = theta.size();
+      const std::size_t k = static_cast<std::size_t>(_recycle);
+      const real_type tol = std::sqrt(std::numeric_limits<real_type>::epsilon());
+      DenseMatrix P;
+      for (std::size_t i : smallest(theta))
+      {
+        if (P.size()>=k)
+          break;
+        if (abs(theta[i].imag()) <= tol*abs(theta[i]))
+        {
+          // the eigenvector of a real eigenvalue is real up to a phase
+          std::size_t largest = 0;
+          for (std::size_t a=1; a<n; ++a)
+            if (abs(V[a][i]) > abs(V[largest][i]))
+              largest = a;
+          const Complex phase = std::conj(V[largest][i])/abs(V[largest][i]);
+          std::vector<field_type> p(n);
+          for (std::size_t a=0; a<n; ++a)
+            p[a] = (phase*V[a][i]).real();
+          P.push_back(p);
+        }
+        else if (theta[i].imag() > 0 && P.size()+2<=k)
+        {
+          std::vector<field_type> re(n), im(n);
+          for (std::size_t a=0; a<n; ++a)
+          {
+            re[a] = V[a][i].real();
+            im[a] = V[a][i].imag();
+          }
+          P.push_back(re);
+          P.push_back(im);
+        }
+      }
+      return P;
+    }
+
+    DenseMatrix ritzCoefficients (const std::vector<Complex>& theta, const ComplexMatrix& V,
+                                  std::false_type) const
+    {
+      const std::size_t n = theta.size();
+      const std::size_t k = static_cast<std::size_t>(_recycle);
+      DenseMatrix P;
+      for (std::size_t i : smallest(theta))
+      {
+        if (P.size()>=k)
+          break;
+        std::vector<field_type> p(n);
+        for (std::size_t a=0; a<n; ++a)
+          p[a] = V[a][i];
+        P.push_back(p);
+      }
+      return P;
     }
 
+    // the indices of theta, sorted by increasing modulus
+    static std::vector<std::size_t> smallest (const std::vector<Complex>& theta)
+    {
+      std::vector<std::size_t> order(theta.size());
+      for (std::size_t a=0; a<order.size(); ++a)
+        order[a] = a;
+      std::sort(order.begin(),order.end(),
+                [&theta](std::size_t a, std::size_t b) { return std::abs(theta[a])<std::abs(theta[b]); });
+      return order;
+    }
 
-    void
-    applyPlaneRotation(field_type &dx, field_type &dy, real_type &cs, field_type &sn)
+    static real_type euclideanNorm (const std::vector<field_type>& q)
     {
-      field_type temp  =  cs * dx + sn * dy;
-      dy = -conjugate(sn) * dx + cs * dy;
-      dx = temp;
+      using std::abs;
+      real_type norm2 = 0;
+      for (const field_type& qa : q)
+        norm2 += abs(qa)*abs(qa);
+      return std::sqrt(norm2);
     }
 
-    LinearOperator<X,Y>& _A;
-    Preconditioner<X,Y>& _W;
     SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>* _op;
+    Preconditioner<X,X>* _prec;
     ScalarProduct<X>& _sp;
-    int _restart;
     real_type _reduction;
+    int _restart;
     int _maxit;
     int _verbose;
+    int _recycle;
+    // the recycled space U and C = M^{-1}AU with orthonormal vectors
+    std::vector<X> _u, _c;
+    // true if _c holds AU for a changed operator
+    bool _stale = false;
   };
 
-
   /**
    * @brief Generalized preconditioned conjugate gradient solver.
    *
@@ -1630,14 +4232,11 @@ namespace Dune {
       *(p[0]) = 0;                              // clear correction
       _prec.apply(*(p[0]),b);                   // apply preconditioner
       rho = _sp.dot(*(p[0]),b);             // orthogonalization
-      _op.apply(*(p[0]),q);                 // q=Ap
-      pp[0] = _sp.dot(*(p[0]),q);           // scalar product
+      pp[0] = _op.applyDot(*(p[0]),q,_sp);  // q=Ap and scalar product
       lambda = rho/pp[0];         // minimization
-      x.axpy(lambda,*(p[0]));               // update solution
-      b.axpy(-lambda,q);              // update defect
 
-      // convergence test
-      real_type defnew=_sp.norm(b);    // comp defect norm
+      // update solution and defect, convergence test
+      real_type defnew=_sp.axpyNorm(x,lambda,*(p[0]),b,q);    // comp defect norm
       if (_verbose>1)                 // print
         this->printOutput(std::cout,++i,defnew,def);
       def = defnew;                   // update norm
@@ -1673,15 +4272,12 @@ namespace Dune {
           }
 
           // minimize in given search direction
-          _op.apply(*(p[ii]),q);                     // q=Ap
-          pp[ii] = _sp.dot(*(p[ii]),q);               // scalar product
+          pp[ii] = _op.applyDot(*(p[ii]),q,_sp);      // q=Ap and scalar product
           rho = _sp.dot(*(p[ii]),b);                 // orthogonalization
           lambda = rho/pp[ii];             // minimization
-          x.axpy(lambda,*(p[ii]));                   // update solution
-          b.axpy(-lambda,q);                  // update defect
 
-          // convergence test
-          real_type defNew=_sp.norm(b);        // comp defect norm
+          // update solution and defect, convergence test
+          real_type defNew=_sp.axpyNorm(x,lambda,*(p[ii]),b,q);        // comp defect norm
 
           if (_verbose>1)                     // print
             this->printOutput(std::cout,++i,defNew,def);
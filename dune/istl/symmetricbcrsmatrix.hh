@@ -0,0 +1,585 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_SYMMETRICBCRSMATRIX_HH
+#define DUNE_ISTL_SYMMETRICBCRSMATRIX_HH
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dune/common/unused.hh>
+
+#include "istlexception.hh"
+#include "bcrsmatrix.hh"
+#include "blockkernels.hh"
+#include "gsetc.hh"
+#include "preconditioners.hh"
+#include "threadexecutor.hh"
+
+/*! \file
+ * \brief A sparse symmetric matrix storing only its upper triangle.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief A symmetric sparse block matrix storing the diagonal and the upper triangle.
+   *
+   * The blocks \f$A_{ij}\f$ with \f$j\geq i\f$ are stored in a BCRSMatrix,
+   * the lower triangle is given by \f$A_{ji}=A_{ij}^T\f$. This halves
+   * the memory and the memory traffic of the matrix-vector products,
+   * which add the transposed contributions of each block in the same
+   * pass over the matrix. The diagonal blocks have to be symmetric.
+   *
+   * The stored triangle can be built directly through upper(), with any
+   * build mode of BCRSMatrix, or extracted from a full matrix:
+   * \code
+   * Dune::SymmetricBCRSMatrix<Dune::FieldMatrix<double,1,1> > S(A);
+   * Dune::MatrixAdapter<decltype(S),Vector,Vector> op(S);
+   * Dune::SeqSSOR<decltype(S),Vector,Vector> ssor(S,1,1.0);
+   * Dune::CGSolver<Vector> solver(op,ssor,1e-8,100,0);
+   * \endcode
+   * The Jacobi, Gauss-Seidel, SOR and SSOR preconditioners work on the
+   * stored triangle directly. SeqILU0 and SeqILUn factorize a full copy
+   * of the matrix, see fullMatrix().
+   *
+   * \tparam B The block type.
+   * \tparam A The allocator used for the blocks.
+   */
+  template<class B, class A=std::allocator<B> >
+  class SymmetricBCRSMatrix
+  {
+  public:
+    //! The type of the stored triangle.
+    typedef BCRSMatrix<B,A> upper_type;
+
+    //! export the type representing the field
+    typedef typename B::field_type field_type;
+
+    //! export the type representing the components
+    typedef B block_type;
+
+    //! export the allocator type
+    typedef A allocator_type;
+
+    //! The type for the index access and the size
+    typedef typename upper_type::size_type size_type;
+
+    //! The iterator over the rows of the stored triangle.
+    typedef typename upper_type::ConstRowIterator ConstRowIterator;
+
+    //! The iterator over the blocks of a row of the stored triangle.
+    typedef typename upper_type::ConstColIterator ConstColIterator;
+
+    enum {
+      //! The number of blocklevels the matrix contains.
+      blocklevel = B::blocklevel+1
+    };
+
+    //! An empty matrix, build the upper triangle through upper().
+    SymmetricBCRSMatrix ()
+    {}
+
+    /**
+     * @brief Copy the diagonal and the upper triangle of a full matrix.
+     *
+     * The lower triangle of mat is ignored, mat has to be fully built.
+     */
+    template<class OtherA>
+    explicit SymmetricBCRSMatrix (const BCRSMatrix<B,OtherA>& mat)
+    {
+      typedef BCRSMatrix<B,OtherA> Matrix;
+      if (mat.buildStage() != Matrix::built)
+        DUNE_THROW(BCRSMatrixError,"SymmetricBCRSMatrix can only be built from a fully built BCRSMatrix");
+      if (mat.N() != mat.M())
+        DUNE_THROW(BCRSMatrixError,"a symmetric matrix has to be square");
+
+      size_type nnz = 0;
+      for (auto row = mat.begin(); row != mat.end(); ++row)
+        for (auto col = row->begin(); col != row->end(); ++col)
+          if (col.index() >= row.index())
+            ++nnz;
+
+      upper_.setSize(mat.N(),mat.M(),nnz);
+      upper_.setBuildMode(upper_type::row_wise);
+      for (auto row = upper_.createbegin(); row != upper_.createend(); ++row)
+        for (auto col = mat[row.index()].begin(); col != mat[row.index()].end(); ++col)
+          if (col.index() >= row.index())
+            row.insert(col.index());
+      for (auto row = upper_.begin(); row != upper_.end(); ++row)
+        for (auto col = row->begin(); col != row->end(); ++col)
+          *col = mat[row.index()][col.index()];
+    }
+
+    //! The stored triangle, e.g. to build it.
+    upper_type& upper ()
+    {
+      return upper_;
+    }
+
+    //! The stored triangle.
+    const upper_type& upper () const
+    {
+      return upper_;
+    }
+
+    //! A BCRSMatrix holding both triangles.
+    upper_type fullMatrix () const
+    {
+      const size_type n = N();
+      upper_type full(n,n,upper_type::random);
+      for (size_type i=0; i<n; ++i)
+        full.setrowsize(i,upper_[i].size());
+      for (auto row = upper_.begin(); row != upper_.end(); ++row)
+        for (auto col = row->begin(); col != row->end(); ++col)
+          if (col.index() != row.index())
+            full.incrementrowsize(col.index());
+      full.endrowsizes();
+      for (auto row = upper_.begin(); row != upper_.end(); ++row)
+        for (auto col = row->begin(); col != row->end(); ++col)
+        {
+          full.addindex(row.index(),col.index());
+          full.addindex(col.index(),row.index());
+        }
+      full.endindices();
+      for (auto row = upper_.begin(); row != upper_.end(); ++row)
+        for (auto col = row->begin(); col != row->end(); ++col)
+        {
+          full[row.index()][col.index()] = *col;
+          if (col.index() != row.index())
+            transposeBlock(*col,full[col.index()][row.index()]);
+        }
+      return full;
+    }
+
+    //===== linear maps
+
+    //! y = A x
+    template<class X, class Y>
+    void mv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      y = 0;
+      usmvRows(field_type(1),x,y,0,N(),noBuffer<Y>());
+    }
+
+    //! y = A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void mv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      usmvThreaded(field_type(1),x,y,exec,true);
+    }
+
+    //! y += A x
+    template<class X, class Y>
+    void umv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      usmvRows(field_type(1),x,y,0,N(),noBuffer<Y>());
+    }
+
+    //! y += A x, with the rows distributed over the threads of exec
+    template<class X, class Y>
+    void umv (const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      usmvThreaded(field_type(1),x,y,exec,false);
+    }
+
+    //! y -= A x
+    template<class X, class Y>
+    void mmv (const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      usmvRows(field_type(-1),x,y,0,N(),noBuffer<Y>());
+    }
+
+    //! y += alpha A x
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y) const
+    {
+      checkSizes(x,y);
+      usmvRows(alpha,x,y,0,N(),noBuffer<Y>());
+    }
+
+    //! y += alpha A x, with the rows distributed over the threads of exec
+    template<class X, class Y, class F>
+    void usmv (const F& alpha, const X& x, Y& y, const ThreadExecutor& exec) const
+    {
+      checkSizes(x,y);
+      usmvThreaded(alpha,x,y,exec,false);
+    }
+
+    //! y = A^T x, the same as mv()
+    template<class X, class Y>
+    void mtv (const X& x, Y& y) const
+    {
+      mv(x,y);
+    }
+
+    //! y += A^T x, the same as umv()
+    template<class X, class Y>
+    void umtv (const X& x, Y& y) const
+    {
+      umv(x,y);
+    }
+
+    //! y -= A^T x, the same as mmv()
+    template<class X, class Y>
+    void mmtv (const X& x, Y& y) const
+    {
+      mmv(x,y);
+    }
+
+    //! y += alpha A^T x, the same as usmv()
+    template<class X, class Y, class F>
+    void usmtv (const F& alpha, const X& x, Y& y) const
+    {
+      usmv(alpha,x,y);
+    }
+
+    //===== sizes and iterators
+
+    //! number of rows (counted in blocks)
+    size_type N () const
+    {
+      return upper_.N();
+    }
+
+    //! number of columns (counted in blocks)
+    size_type M () const
+    {
+      return upper_.M();
+    }
+
+    //! number of stored nonzero blocks, the diagonal and the upper triangle
+    size_type nonzeroes () const
+    {
+      return upper_.nonzeroes();
+    }
+
+    //! iterator to the first row of the stored triangle
+    ConstRowIterator begin () const
+    {
+      return upper_.begin();
+    }
+
+    //! iterator past the last row of the stored triangle
+    ConstRowIterator end () const
+    {
+      return upper_.end();
+    }
+
+    //! iterator to the last row of the stored triangle
+    ConstRowIterator beforeEnd () const
+    {
+      return upper_.beforeEnd();
+    }
+
+    //! iterator before the first row of the stored triangle
+    ConstRowIterator beforeBegin () const
+    {
+      return upper_.beforeBegin();
+    }
+
+  private:
+    //! The row kernels used for vectors of type X and Y.
+    template<class X, class Y>
+    using Kernel = Imp::BlockKernel<B,
+                                    typename std::decay<decltype(std::declval<const X&>()[0])>::type,
+                                    typename std::decay<decltype(std::declval<Y&>()[0])>::type>;
+
+    template<class Y>
+    using Buffer = std::vector<typename std::decay<decltype(std::declval<Y&>()[0])>::type>;
+
+    template<class Y>
+    static Buffer<Y>& noBuffer ()
+    {
+      static Buffer<Y> empty;
+      return empty;
+    }
+
+    static void transposeBlock (const B& a, B& t)
+    {
+      for (int r=0; r<B::rows; ++r)
+        for (int c=0; c<B::cols; ++c)
+          t[c][r] = a[r][c];
+    }
+
+    /**
+     * @brief y += alpha A x for the stored rows [begin,end).
+     *
+     * Adds the rows and the transposed contributions of their off-diagonal
+     * blocks. Contributions to rows beyond end go to buffer, whose entry
+     * k belongs to row end+k.
+     */
+    template<class F, class X, class Y>
+    void usmvRows (const F& alpha, const X& x, Y& y, size_type begin, size_type end, Buffer<Y>& buffer) const
+    {
+      for (size_type i=begin; i<end; ++i)
+      {
+        const auto& row = upper_[i];
+        const B* a = row.getptr();
+        const size_type* j = row.getindexptr();
+        const size_type count = row.getsize();
+        Kernel<X,Y>::usmvRow(alpha,a,j,count,x,y[i]);
+        for (size_type k=0; k<count; ++k)
+        {
+          if (j[k] == i)
+            continue;
+          if (j[k] < end)
+            Kernel<X,Y>::usmtv(alpha,a[k],x[i],y[j[k]]);
+          else
+            Kernel<X,Y>::usmtv(alpha,a[k],x[i],buffer[j[k]-end]);
+        }
+      }
+    }
+
+    /**
+     * Each thread writes the rows of its chunk and keeps the transposed
+     * contributions to rows of later chunks in a private buffer, which
+     * only covers the rows up to the largest column index of the chunk.
+     * The buffers are added in a second pass in the order of the chunks,
+     * so the result does not depend on the scheduling of the threads.
+     */
+    template<class F, class X, class Y>
+    void usmvThreaded (const F& alpha, const X& x, Y& y, const ThreadExecutor& exec, bool zero) const
+    {
+      const size_type n = N();
+      if (!exec.parallel(n))
+      {
+        if (zero)
+          y = 0;
+        return usmvRows(alpha,x,y,0,n,noBuffer<Y>());
+      }
+
+      typename Buffer<Y>::value_type zeroBlock = y[0];
+      zeroBlock = 0;
+      const RowPartition partition = nnzBalancedPartition(upper_,exec.threads());
+      std::vector<Buffer<Y> > buffers(partition.chunks());
+      exec.runIndexed(partition, [&](size_type k, size_type begin, size_type end) {
+          if (zero)
+            for (size_type i=begin; i<end; ++i)
+              y[i] = 0;
+          buffers[k].assign(columnReach(begin,end)-end,zeroBlock);
+          usmvRows(alpha,x,y,begin,end,buffers[k]);
+        });
+      exec.run(partition, [&](size_type begin, size_type end) {
+          for (size_type k=0; k<partition.chunks() && partition.end(k)<=begin; ++k)
+          {
+            const size_type reach = std::min(end,partition.end(k)+buffers[k].size());
+            for (size_type i=begin; i<reach; ++i)
+              y[i] += buffers[k][i-partition.end(k)];
+          }
+        });
+    }
+
+    //! One past the largest column index stored in the rows [begin,end), at least end.
+    size_type columnReach (size_type begin, size_type end) const
+    {
+      size_type reach = end;
+      for (size_type i=begin; i<end; ++i)
+      {
+        const auto& row = upper_[i];
+        if (row.getsize() > 0)
+          reach = std::max(reach,row.getindexptr()[row.getsize()-1]+1);
+      }
+      return reach;
+    }
+
+    template<class X, class Y>
+    void checkSizes (const X& x, const Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(BCRSMatrixError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(BCRSMatrixError,"index out of range");
+#else
+      DUNE_UNUSED_PARAMETER(x);
+      DUNE_UNUSED_PARAMETER(y);
+#endif
+    }
+
+    upper_type upper_;
+  };
+
+  /**
+   * @brief Iteration steps for the symmetric storage.
+   *
+   * The lower triangle is applied column-wise from the stored rows: the
+   * forward sweeps add the transposed contributions of each updated
+   * block to the rows below, the backward sweep computes the lower part
+   * of the residual in advance, as the values it uses do not change
+   * during the sweep. Every row has to store its diagonal block.
+   */
+  template<int I, class B, class TA>
+  struct algmeta_itsteps<I,SymmetricBCRSMatrix<B,TA> >
+  {
+    typedef SymmetricBCRSMatrix<B,TA> M;
+    typedef typename M::size_type size_type;
+    typedef typename M::ConstColIterator ConstColIterator;
+
+    //! The diagonal block of row i, the first block stored in the row.
+    template<class Row>
+    static ConstColIterator diagonal (const Row& row, size_type i)
+    {
+      ConstColIterator diag = row.begin();
+      if (diag == row.end() || diag.index() != i)
+        DUNE_THROW(BCRSMatrixError,"row " << i << " of the symmetric matrix does not store its diagonal block");
+      return diag;
+    }
+
+    template<class X, class Y, class K>
+    static void dbgs (const M& A, X& x, const Y& b, const K& w)
+    {
+      typename Y::block_type rhs;
+      X xold(x);     // remember old x
+      Y lower(b);    // lower_i = sum_{j<i} a_ij * xnew_j
+      lower = 0;
+
+      const auto& U = A.upper();
+      for (size_type i=0; i<U.N(); ++i)
+      {
+        const auto& row = U[i];
+        rhs = b[i];
+        rhs -= lower[i];
+        auto diag = diagonal(row,i);
+        for (auto j = std::next(diag); j != row.end(); ++j)
+          (*j).mmv(x[j.index()],rhs);              // rhs -= sum_{j>i} a_ij * xold_j
+        algmeta_itsteps<I-1,typename M::block_type>::dbgs(*diag,x[i],rhs,w);
+        for (auto j = std::next(diag); j != row.end(); ++j)
+          (*j).umtv(x[i],lower[j.index()]);
+      }
+      x *= w;
+      x.axpy(K(1)-w,xold);
+    }
+
+    template<class X, class Y, class K>
+    static void bsorf (const M& A, X& x, const Y& b, const K& w)
+    {
+      typename Y::block_type rhs;
+      typename X::block_type v;
+      if (A.N()>0)
+        v = x[0];
+      Y lower(b);    // lower_i = sum_{j<i} a_ij * xnew_j
+      lower = 0;
+
+      const auto& U = A.upper();
+      for (size_type i=0; i<U.N(); ++i)
+      {
+        const auto& row = U[i];
+        rhs = b[i];
+        rhs -= lower[i];
+        auto diag = diagonal(row,i);
+        for (auto j = diag; j != row.end(); ++j)
+          (*j).mmv(x[j.index()],rhs);              // rhs -= sum_{j>=i} a_ij * xold_j
+        algmeta_itsteps<I-1,typename M::block_type>::bsorf(*diag,v,rhs,w);
+        x[i].axpy(w,v);
+        for (auto j = std::next(diag); j != row.end(); ++j)
+          (*j).umtv(x[i],lower[j.index()]);
+      }
+    }
+
+    template<class X, class Y, class K>
+    static void bsorb (const M& A, X& x, const Y& b, const K& w)
+    {
+      typename Y::block_type rhs;
+      typename X::block_type v;
+      if (A.N()>0)
+        v = x[0];
+
+      // lower_i = sum_{j<i} a_ij * x_j, the x_j are not changed before row i
+      Y lower(b);
+      lower = 0;
+      const auto& U = A.upper();
+      for (auto row = U.begin(); row != U.end(); ++row)
+        for (auto j = std::next(diagonal(*row,row.index())); j != row->end(); ++j)
+          (*j).umtv(x[row.index()],lower[j.index()]);
+
+      for (size_type i=U.N(); i-->0; )
+      {
+        const auto& row = U[i];
+        rhs = b[i];
+        rhs -= lower[i];
+        auto diag = diagonal(row,i);
+        for (auto j = diag; j != row.end(); ++j)
+          (*j).mmv(x[j.index()],rhs);
+        algmeta_itsteps<I-1,typename M::block_type>::bsorb(*diag,v,rhs,w);
+        x[i].axpy(w,v);
+      }
+    }
+
+    template<class X, class Y, class K>
+    static void dbjac (const M& A, X& x, const Y& b, const K& w)
+    {
+      X v(x);     // allocate with same size
+      Y rhs(b);
+      A.mmv(x,rhs);
+
+      const auto& U = A.upper();
+      for (size_type i=0; i<U.N(); ++i)
+        algmeta_itsteps<I-1,typename M::block_type>::dbjac(*diagonal(U[i],i),v[i],rhs[i],w);
+      x.axpy(w,v);
+    }
+  };
+
+  /**
+   * @brief ILU(0) preconditioner for a SymmetricBCRSMatrix.
+   *
+   * The incomplete factors are not symmetric, so the factorization
+   * works on a full copy of the matrix.
+   */
+  template<class B, class A, class X, class Y, int l>
+  class SeqILU0<SymmetricBCRSMatrix<B,A>,X,Y,l>
+    : public SeqILU0<BCRSMatrix<B,A>,X,Y,l>
+  {
+  public:
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    /*! \brief Constructor.
+
+       \param mat The matrix to operate on.
+       \param w The relaxation factor.
+     */
+    SeqILU0 (const SymmetricBCRSMatrix<B,A>& mat, field_type w)
+      : SeqILU0<BCRSMatrix<B,A>,X,Y,l>(mat.fullMatrix(),w)
+    {}
+  };
+
+  /**
+   * @brief ILU(n) preconditioner for a SymmetricBCRSMatrix.
+   *
+   * The factorization works on a full copy of the matrix.
+   */
+  template<class B, class A, class X, class Y, int l>
+  class SeqILUn<SymmetricBCRSMatrix<B,A>,X,Y,l>
+    : public SeqILUn<BCRSMatrix<B,A>,X,Y,l>
+  {
+  public:
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    /*! \brief Constructor.
+
+       \param mat The matrix to operate on.
+       \param n The number of iterations to perform.
+       \param w The relaxation factor.
+     */
+    SeqILUn (const SymmetricBCRSMatrix<B,A>& mat, int n, field_type w)
+      : SeqILUn<BCRSMatrix<B,A>,X,Y,l>(mat.fullMatrix(),n,w)
+    {}
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
@@ -0,0 +1,191 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+template<class Vector>
+bool equal(const Vector& a, const Vector& b)
+{
+  for (typename Vector::size_type i=0; i<a.N(); ++i)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+// A scalar product which must not be fused, so applyDot has to use it.
+template<class X>
+class ScaledScalarProduct : public Dune::SeqScalarProduct<X>
+{
+public:
+  virtual typename X::field_type dot (const X& x, const X& y)
+  {
+    return 2.0*x.dot(y);
+  }
+
+  virtual bool fusable () const
+  {
+    return false;
+  }
+};
+
+template<int BS>
+int testApplyDot(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,BS,BS> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      *col *= 1.0 + 1e-3*((row.index()*7 + col.index()*13) % 17);
+
+  Vector x(A.M()), y(A.N()), z(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+
+  int ret = 0;
+
+  // the fused product has to give exactly the same result as mv and dot
+  A.mv(x,y);
+  const double ref = x.dot(y);
+  const double fused = A.mvdot(x,z);
+  if (fused != ref || !equal(z,y))
+  {
+    std::cerr << "Error: mvdot differs from mv and dot" << std::endl;
+    ++ret;
+  }
+
+  for (std::size_t threads : {1, 2, 5})
+  {
+    Dune::ThreadExecutor exec(threads,1);
+    z = 0;
+    const double threaded = A.mvdot(x,z,exec);
+    if (std::abs(threaded-ref) > 1e-12*std::abs(ref) || !equal(z,y))
+    {
+      std::cerr << "Error: threaded mvdot is wrong for " << threads << " threads" << std::endl;
+      ++ret;
+    }
+  }
+
+  std::vector<double> w(A.N());
+  double weightedRef = 0;
+  for (std::size_t i=0; i<w.size(); ++i)
+  {
+    w[i] = i%3 ? 1.0 : 0.0;
+    weightedRef += w[i]*x[i].dot(y[i]);
+  }
+  if (std::abs(A.mvdot(x,z,w)-weightedRef) > 1e-12*std::abs(weightedRef))
+  {
+    std::cerr << "Error: weighted mvdot is wrong" << std::endl;
+    ++ret;
+  }
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqScalarProduct<Vector> sp;
+  ScaledScalarProduct<Vector> scaled;
+  z = 0;
+  if (op.applyDot(x,z,sp) != ref || !equal(z,y))
+  {
+    std::cerr << "Error: MatrixAdapter::applyDot is wrong" << std::endl;
+    ++ret;
+  }
+  z = 0;
+  if (op.applyDot(x,z,scaled) != 2.0*ref || !equal(z,y))
+  {
+    std::cerr << "Error: MatrixAdapter::applyDot ignores the scalar product" << std::endl;
+    ++ret;
+  }
+
+  return ret;
+}
+
+int testSolvers(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> ssor(A,1,1.0);
+
+  int ret = 0;
+  {
+    Vector x(A.N()), b(A.N());
+    x = 1.0;
+    b = 0.0;
+    Dune::InverseOperatorResult r;
+    Dune::CGSolver<Vector> solver(op,ssor,1e-8,500,0);
+    solver.apply(x,b,r);
+    if (!r.converged)
+    {
+      std::cerr << "Error: CGSolver did not converge" << std::endl;
+      ++ret;
+    }
+  }
+  {
+    Vector x(A.N()), b(A.N());
+    x = 1.0;
+    b = 0.0;
+    Dune::InverseOperatorResult r;
+    Dune::GeneralizedPCGSolver<Vector> solver(op,ssor,1e-8,500,0,10);
+    solver.apply(x,b,r);
+    if (!r.converged)
+    {
+      std::cerr << "Error: GeneralizedPCGSolver did not converge" << std::endl;
+      ++ret;
+    }
+  }
+  // the iterates do not depend on the number of threads of the operator
+  Vector e(A.N()), b(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0/(1.0 + i%17);
+  A.mv(e,b);
+  auto solve = [&](std::size_t threads) {
+    const Dune::ThreadExecutor exec(threads,1);
+    Dune::MatrixAdapter<Matrix,Vector,Vector> threadedOp(A,exec);
+    Dune::SeqScalarProduct<Vector> sp;
+    Dune::CGSolver<Vector> solver(threadedOp,sp,ssor,1e-8,500,0);
+    Dune::InverseOperatorResult r;
+    Vector x(A.N()), rhs(b);
+    x = 0.0;
+    solver.apply(x,rhs,r);
+    return x;
+  };
+  if (!equal(solve(1),solve(4)))
+  {
+    std::cerr << "Error: CGSolver depends on the number of threads of the operator" << std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testApplyDot<1>(20);
+    ret += testApplyDot<3>(10);
+    ret += testSolvers(20);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,178 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+typedef Dune::FieldMatrix<double,1,1> Block;
+typedef Dune::BCRSMatrix<Block> Matrix;
+typedef Dune::BCRSMatrixView<Block> View;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+// The CSR arrays of a legacy code
+template<class Index>
+struct CSR
+{
+  std::vector<Index> rowptr, colind;
+  std::vector<double> val;
+
+  explicit CSR(const Matrix& A)
+  {
+    rowptr.push_back(0);
+    for (auto row = A.begin(); row != A.end(); ++row)
+    {
+      for (auto col = row->begin(); col != row->end(); ++col)
+      {
+        colind.push_back(col.index());
+        val.push_back(*col);
+      }
+      rowptr.push_back(colind.size());
+    }
+  }
+
+  Block* values()
+  {
+    return reinterpret_cast<Block*>(val.data());
+  }
+};
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+template<class Index>
+int testView(const Matrix& A)
+{
+  int ret = 0;
+  CSR<Index> csr(A);
+  View V(A.N(), A.M(), csr.rowptr.data(), csr.colind.data(), csr.values());
+
+  ret += check(V.N() == A.N() && V.M() == A.M() && V.nonzeroes() == A.nonzeroes(),
+               "the view has the wrong size");
+  ret += check(&V[3][3] == csr.values() + (&A[3][3]-&A[0][0]), "the view does not use the values in place");
+
+  Vector x(A.M()), y(A.N()), z(A.N());
+  for (std::size_t i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+  A.mv(x,y);
+  V.mv(x,z);
+  z -= y;
+  ret += check(z.infinity_norm() == 0.0, "the view computes a different product");
+
+  // changes of the external values are visible in the view
+  csr.val[0] += 1.0;
+  ret += check(V[0][0][0][0] == A[0][0][0][0] + 1.0, "the view copied the values");
+  csr.val[0] -= 1.0;
+
+  // the view owns the rows and converted column indices, copies own all of their memory
+  const bool external = std::is_same<Index,Matrix::size_type>::value;
+  ret += check(V.memoryUsage().allocated == A.N()*sizeof(Matrix::row_type)
+               + (external ? 0 : A.nonzeroes()*sizeof(Matrix::size_type)),
+               "the view owns the external arrays");
+  Matrix C(V);
+  ret += check(&C[0][0] != &V[0][0] && C.memoryUsage().used == A.memoryUsage().used,
+               "a copy of the view does not own its memory");
+  ret += check(external == (C[0].getindexptr() != V[0].getindexptr()),
+               "a copy shares the external indices");
+  return ret;
+}
+
+int testSolvers(const Matrix& A)
+{
+  int ret = 0;
+  CSR<std::size_t> csr(A);
+  View V(A.N(), A.M(), csr.rowptr.data(), csr.colind.data(), csr.values());
+
+  // the solver components only refer to the view as a BCRSMatrix
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(V);
+  Dune::SeqILU0<Matrix,Vector,Vector> ilu(V,1.0);
+  Dune::SeqSSOR<Matrix,Vector,Vector> ssor(V,1,1.0);
+
+  Vector e(A.N()), b(A.N()), x(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0 + 0.1*(i%7);
+  A.mv(e,b);
+
+  Dune::CGSolver<Vector> cgILU(op, ilu, 1e-10, 500, 0);
+  Dune::CGSolver<Vector> cgSSOR(op, ssor, 1e-10, 500, 0);
+  for (Dune::InverseOperator<Vector,Vector>* solver : {static_cast<Dune::InverseOperator<Vector,Vector>*>(&cgILU),
+                                                       static_cast<Dune::InverseOperator<Vector,Vector>*>(&cgSSOR)})
+  {
+    Dune::InverseOperatorResult r;
+    Vector rhs(b);
+    x = 0.0;
+    solver->apply(x,rhs,r);
+    x -= e;
+    ret += check(r.converged && x.two_norm() < 1e-6*e.two_norm(), "a solve with the view fails");
+  }
+  return ret;
+}
+
+int testReuse(const Matrix& A)
+{
+  int ret = 0;
+  CSR<int> csr(A);
+  View V;
+  V.set(A.N(), A.M(), csr.rowptr.data(), csr.colind.data(), csr.values());
+
+  // moving keeps referring to the arrays
+  View W(std::move(V));
+  ret += check(&W[1][1] == &csr.values()[&A[1][1]-&A[0][0]] && V.N() == 0,
+               "moving the view fails");
+
+  // a new pattern releases the arrays
+  const std::vector<double> val(csr.val);
+  W.setSize(2,2,2);
+  W.setBuildMode(Matrix::row_wise);
+  for (auto row = W.createbegin(); row != W.createend(); ++row)
+    row.insert(row.index());
+  W = 3.0;
+  ret += check(csr.val == val && W.nonzeroes() == 2, "rebuilding the view changed the arrays");
+
+  const std::vector<int> rowptr = {0, 1, 0};
+  bool thrown = false;
+  try {
+    View X(2, 2, rowptr.data(), csr.colind.data(), csr.values());
+  }
+  catch (Dune::BCRSMatrixError&) {
+    thrown = true;
+  }
+  ret += check(thrown, "decreasing row starts are accepted");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    Matrix A;
+    setupLaplacian(A,20);
+    ret += testView<std::size_t>(A);
+    ret += testView<int>(A);
+    ret += testSolvers(A);
+    ret += testReuse(A);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
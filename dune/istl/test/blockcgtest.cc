@@ -0,0 +1,220 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/multiblockvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Counts the applications of the column-wise preconditioner
+template<class Prec, class MultiVector>
+class CountingPreconditioner : public Dune::ColumnPreconditioner<Prec,MultiVector>
+{
+public:
+  explicit CountingPreconditioner (Prec& prec)
+    : Dune::ColumnPreconditioner<Prec,MultiVector>(prec)
+  {}
+
+  virtual void apply (MultiVector& v, const MultiVector& d)
+  {
+    Dune::ColumnPreconditioner<Prec,MultiVector>::apply(v,d);
+    ++applications;
+  }
+
+  int applications = 0;
+};
+
+template<class MultiVector>
+void fill (MultiVector& x)
+{
+  for (std::size_t i=0; i<x.N(); ++i)
+    for (std::size_t c=0; c<x.columns(); ++c)
+      x(i,c) = std::sin(0.01*(c+1)*i) + 1.0/(1.0 + (i+c)%13);
+}
+
+// All columns converge, in fewer iterations than CG needs for each of them
+int testConvergence()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  typedef Dune::MultiBlockVector<Dune::FieldVector<double,1> > MultiVector;
+  typedef Dune::SeqSSOR<Matrix,Vector,Vector> SSOR;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,30);
+  const std::size_t k = 8;
+  Dune::MatrixAdapter<Matrix,MultiVector,MultiVector> op(A);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> singleOp(A);
+  SSOR ssor(A,1,1.0);
+  CountingPreconditioner<SSOR,MultiVector> prec(ssor);
+
+  MultiVector b(A.N(),k), x(A.N(),k), rhs(A.N(),k);
+  fill(b);
+  x = 0.0;
+  rhs = b;
+  Dune::BlockInverseOperatorResult res;
+  Dune::BlockCGSolver<MultiVector> solver(op,prec,1e-8,1000,0);
+  solver.apply(x,rhs,res);
+
+  ret += check(res.converged && res.columnConverged.size() == k, "block CG does not converge");
+  ret += check(prec.applications == res.iterations,
+               "block CG does not apply the preconditioner once per iteration");
+
+  // the defect of each column
+  MultiVector d(b);
+  A.mmv(x,d);
+  const std::vector<double> defs = d.columnNorms();
+  const std::vector<double> defs0 = b.columnNorms();
+  Vector bc, xc;
+  int maxCG = 0;
+  bool reduced = true, fewer = true;
+  for (std::size_t c=0; c<k; ++c)
+  {
+    reduced = reduced && res.columnConverged[c] && defs[c] <= 1e-7*defs0[c]
+              && res.columnIterations[c] <= res.iterations;
+    Dune::InverseOperatorResult resCG;
+    b.getColumn(c,bc);
+    xc.resize(bc.N());
+    xc = 0.0;
+    Dune::CGSolver<Vector> cg(singleOp,ssor,1e-8,1000,0);
+    cg.apply(xc,bc,resCG);
+    maxCG = std::max(maxCG,resCG.iterations);
+    fewer = fewer && res.columnIterations[c] <= resCG.iterations;
+  }
+  ret += check(reduced, "block CG does not reduce the defect of each column");
+  ret += check(fewer && res.iterations < maxCG, "block CG needs more iterations than CG");
+
+  // the interface of the InverseOperator
+  Dune::InverseOperatorResult plainRes;
+  Dune::InverseOperator<MultiVector,MultiVector>& inverse = solver;
+  x = 0.0;
+  rhs = b;
+  inverse.apply(x,rhs,plainRes);
+  ret += check(plainRes.converged && plainRes.iterations == res.iterations,
+               "block CG differs through the interface of the InverseOperator");
+
+  // without convergence, the solver stops after the maximal number of iterations
+  x = 0.0;
+  rhs = b;
+  Dune::BlockCGSolver<MultiVector> limited(op,prec,1e-8,3,0);
+  limited.apply(x,rhs,res);
+  bool stopped = !res.converged && res.iterations == 3;
+  for (std::size_t c=0; c<k; ++c)
+    stopped = stopped && !res.columnConverged[c] && res.columnIterations[c] == 3
+              && res.columnReductions[c] < 1.0;
+  ret += check(stopped, "block CG does not stop at the maximal number of iterations");
+  return ret;
+}
+
+// Converged columns are removed, as are the directions of linearly dependent columns
+int testDeflation()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,2,2> > Matrix;
+  typedef Dune::MultiBlockVector<Dune::FieldVector<double,2> > MultiVector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<Matrix,MultiVector,MultiVector> op(A);
+  Dune::Richardson<MultiVector,MultiVector> prec(1.0);
+
+  // a zero right-hand side, one that is a multiple of another one and
+  // an eigenvector of the Laplacian, which converges in one iteration
+  const int N = 20;
+  const double pi = std::acos(-1.0);
+  MultiVector b(A.N(),5), x(A.N(),5), rhs(A.N(),5);
+  fill(b);
+  for (std::size_t i=0; i<b.N(); ++i)
+  {
+    b(i,0) = 0.0;
+    b(i,2) = b(i,3);
+    b(i,2) *= 1e-3;
+    b(i,4) = std::sin(pi*(i%N+1)/(N+1))*std::sin(pi*(i/N+1)/(N+1));
+  }
+
+  x = 0.0;
+  rhs = b;
+  Dune::BlockInverseOperatorResult res;
+  Dune::BlockCGSolver<MultiVector> solver(op,prec,1e-8,1000,0);
+  solver.apply(x,rhs,res);
+
+  MultiVector d(b);
+  A.mmv(x,d);
+  const std::vector<double> defs = d.columnNorms();
+  const std::vector<double> defs0 = b.columnNorms();
+  ret += check(res.converged, "block CG with deflation does not converge");
+  ret += check(res.columnIterations[0] == 0 && defs[0] == 0.0,
+               "a zero right-hand side is iterated");
+  ret += check(std::abs(res.columnIterations[2] - res.columnIterations[3]) <= 1,
+               "linearly dependent columns converge differently");
+  ret += check(res.columnIterations[4] == 1, "an eigenvector needs more than one iteration");
+  bool reduced = true;
+  for (std::size_t c=1; c<5; ++c)
+    reduced = reduced && defs[c] <= 1e-7*defs0[c];
+  ret += check(reduced, "block CG with deflation does not reduce the defects");
+  return ret;
+}
+
+int testComplex()
+{
+  typedef std::complex<double> K;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > Matrix;
+  typedef Dune::MultiBlockVector<Dune::FieldVector<K,1> > MultiVector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,15);
+  Dune::MatrixAdapter<Matrix,MultiVector,MultiVector> op(A);
+  Dune::Richardson<MultiVector,MultiVector> prec(1.0);
+
+  MultiVector e(A.N(),3), b(A.N(),3), x(A.N(),3);
+  for (std::size_t i=0; i<e.N(); ++i)
+    for (std::size_t c=0; c<e.columns(); ++c)
+      e(i,c) = K(1.0 + c, 0.1*((i+c)%5));
+  A.mv(e,b);
+  x = 0.0;
+  Dune::BlockInverseOperatorResult res;
+  Dune::BlockCGSolver<MultiVector> solver(op,prec,1e-10,1000,0);
+  solver.apply(x,b,res);
+  x -= e;
+  ret += check(res.converged && x.infinity_norm() <= 1e-6, "the complex block CG is wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testConvergence();
+    ret += testDeflation();
+    ret += testComplex();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
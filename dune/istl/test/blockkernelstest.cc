@@ -0,0 +1,126 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#include "laplacian.hh"
+
+// Reference products computed block by block with the FieldMatrix methods
+template<class Matrix, class Vector>
+void referenceMv(const Matrix& A, const Vector& x, Vector& y)
+{
+  y = 0;
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      col->umv(x[col.index()],y[row.index()]);
+}
+
+template<class Matrix, class Vector>
+void referenceMtv(const Matrix& A, const Vector& x, Vector& y)
+{
+  y = 0;
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      col->umtv(x[row.index()],y[col.index()]);
+}
+
+template<class Vector>
+int compare(const Vector& a, const Vector& b, const char* what, int BS)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > 1e-13*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " is wrong for block size " << BS << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+template<int BS>
+int testKernels(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,BS,BS> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+
+  // fill the blocks with distinct, unsymmetric values
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      for (int r=0; r<BS; ++r)
+        for (int c=0; c<BS; ++c)
+          (*col)[r][c] = 1.0 + ((row.index()*7 + col.index()*13 + r*5 + c*3) % 23) - 0.1*c;
+
+  Vector x(A.M()), y(A.N()), ref(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    for (int k=0; k<BS; ++k)
+      x[i][k] = 1.0/(i+k+1.0);
+
+  int ret = 0;
+  referenceMv(A,x,ref);
+
+  A.mv(x,y);
+  ret += compare(ref,y,"mv",BS);
+
+  y = ref;
+  A.umv(x,y);
+  y *= 0.5;
+  ret += compare(ref,y,"umv",BS);
+
+  y = 0.0;
+  A.mmv(x,y);
+  y *= -1.0;
+  ret += compare(ref,y,"mmv",BS);
+
+  y = 0.0;
+  A.usmv(0.5,x,y);
+  y *= 2.0;
+  ret += compare(ref,y,"usmv",BS);
+
+  referenceMtv(A,x,ref);
+
+  A.mtv(x,y);
+  ret += compare(ref,y,"mtv",BS);
+
+  y = ref;
+  A.umtv(x,y);
+  y *= 0.5;
+  ret += compare(ref,y,"umtv",BS);
+
+  y = 0.0;
+  A.mmtv(x,y);
+  y *= -1.0;
+  ret += compare(ref,y,"mmtv",BS);
+
+  y = 0.0;
+  A.usmtv(0.5,x,y);
+  y *= 2.0;
+  ret += compare(ref,y,"usmtv",BS);
+
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testKernels<1>(10);
+    ret += testKernels<2>(10);
+    ret += testKernels<3>(10);
+    ret += testKernels<4>(10);
+    ret += testKernels<5>(6);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
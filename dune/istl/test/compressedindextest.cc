@@ -0,0 +1,170 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/compressedindexmatrix.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+template<class Vector>
+int compare(const Vector& a, const Vector& b, const char* what)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > 1e-13*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " differs from the BCRSMatrix result" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// A matrix with a band around the diagonal and some rows coupling to
+// columns far away, so that both index widths are used.
+template<class MatrixBlock>
+void setupMixedMatrix(Dune::BCRSMatrix<MatrixBlock>& A, std::size_t n, std::size_t far)
+{
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  A.setSize(n,n,4*n);
+  A.setBuildMode(Matrix::row_wise);
+  for (auto row = A.createbegin(); row != A.createend(); ++row)
+  {
+    const std::size_t i = row.index();
+    row.insert(i);
+    if (i>0)
+      row.insert(i-1);
+    if (i+1<n)
+      row.insert(i+1);
+    if (i%7==0)
+      row.insert((i+far)%n);
+  }
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+    {
+      *col = 1.0 + 1e-3*((row.index()*7 + col.index()*13) % 17);
+      if (col.index()==row.index())
+        *col *= 4.0;
+    }
+}
+
+template<int BS>
+int testProducts(const Dune::BCRSMatrix<Dune::FieldMatrix<double,BS,BS> >& A, bool expectWide)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::CompressedIndexMatrix<MatrixBlock> CompressedMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  CompressedMatrix C(A);
+  int ret = 0;
+  if (C.N()!=A.N() || C.M()!=A.M() || C.nonzeroes()!=A.nonzeroes()
+      || (C.wideEntries()>0) != expectWide)
+  {
+    std::cerr << "Error: wrong sizes of CompressedIndexMatrix" << std::endl;
+    ++ret;
+  }
+
+  Vector x(A.M()), ya(A.N()), yc(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+
+  Dune::ThreadExecutor exec(3,1);
+
+  A.mv(x,ya);
+  C.mv(x,yc);
+  ret += compare(ya,yc,"mv");
+  C.mv(x,yc,exec);
+  ret += compare(ya,yc,"threaded mv");
+
+  A.umv(x,ya);
+  C.umv(x,yc,exec);
+  ret += compare(ya,yc,"threaded umv");
+
+  A.mmv(x,ya);
+  C.mmv(x,yc);
+  ret += compare(ya,yc,"mmv");
+
+  A.usmv(0.3,x,ya);
+  C.usmv(0.3,x,yc);
+  ret += compare(ya,yc,"usmv");
+
+  Dune::MatrixAdapter<CompressedMatrix,Vector,Vector> op(C);
+  op.applyscaleadd(-2.0,x,yc);
+  A.usmv(-2.0,x,ya);
+  ret += compare(ya,yc,"MatrixAdapter::applyscaleadd");
+
+  return ret;
+}
+
+int testSolver(int N)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::CompressedIndexMatrix<MatrixBlock> CompressedMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  CompressedMatrix C(A);
+  if (C.indexBytes() >= A.nonzeroes()*sizeof(Matrix::size_type))
+  {
+    std::cerr << "Error: the compressed indices are not smaller" << std::endl;
+    return 1;
+  }
+
+  Dune::MatrixAdapter<CompressedMatrix,Vector,Vector> op(C);
+  Dune::SeqJac<Matrix,Vector,Vector> jac(A,1,1.0);
+  Vector x(A.N()), b(A.N());
+  x = 1.0;
+  b = 0.0;
+  Dune::InverseOperatorResult r;
+  Dune::CGSolver<Vector> solver(op,jac,1e-8,500,0);
+  solver.apply(x,b,r);
+  if (!r.converged)
+  {
+    std::cerr << "Error: CGSolver did not converge with CompressedIndexMatrix" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    {
+      Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > A;
+      setupLaplacian(A,20);
+      ret += testProducts<1>(A,false);
+    }
+    {
+      Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > A;
+      setupMixedMatrix(A,70000,40000);
+      ret += testProducts<1>(A,true);
+    }
+    {
+      Dune::BCRSMatrix<Dune::FieldMatrix<double,2,2> > A;
+      setupMixedMatrix(A,40000,35000);
+      ret += testProducts<2>(A,true);
+    }
+    {
+      Dune::BCRSMatrix<Dune::FieldMatrix<double,3,3> > A;
+      setupLaplacian(A,10);
+      ret += testProducts<3>(A,false);
+    }
+    ret += testSolver(20);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,153 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/threadexecutor.hh>
+
+typedef Dune::FieldMatrix<double,2,2> Block;
+typedef Dune::BCRSMatrix<Block> Matrix;
+typedef std::pair<std::size_t,std::size_t> Edge;
+
+// The edges of an N x N grid, each edge couples its two vertices like a
+// linear finite element on an interval.
+std::vector<Edge> gridEdges(std::size_t N)
+{
+  std::vector<Edge> edges;
+  for (std::size_t y=0; y<N; ++y)
+    for (std::size_t x=0; x<N; ++x)
+    {
+      if (x+1<N)
+        edges.emplace_back(y*N+x,y*N+x+1);
+      if (y+1<N)
+        edges.emplace_back(y*N+x,(y+1)*N+x);
+    }
+  return edges;
+}
+
+Block edgeBlock(const Edge& e, bool diagonal)
+{
+  Block b(0.0);
+  b[0][0] = diagonal ? 1.0 : -1.0;
+  b[1][1] = diagonal ? 2.0 : -2.0;
+  b[0][1] = double((e.first+e.second)%5);
+  return b;
+}
+
+// Compare pattern and values of two matrices
+bool sameMatrix(const Matrix& A, const Matrix& B)
+{
+  if (A.N()!=B.N() || A.M()!=B.M() || A.nonzeroes()!=B.nonzeroes())
+    return false;
+  for (Matrix::size_type i=0; i<A.N(); ++i)
+  {
+    if (A[i].getsize()!=B[i].getsize())
+      return false;
+    for (Matrix::size_type k=0; k<A[i].getsize(); ++k)
+      if (A[i].getindexptr()[k]!=B[i].getindexptr()[k] || A[i].getptr()[k]!=B[i].getptr()[k])
+        return false;
+  }
+  return true;
+}
+
+void assembleSerial(Matrix& A, const std::vector<Edge>& edges, std::size_t n, std::size_t avg)
+{
+  A.setBuildMode(Matrix::implicit);
+  A.setImplicitBuildModeParameters(avg,2.0);
+  A.setSize(n,n);
+  for (const Edge& e : edges)
+  {
+    A.entry(e.first,e.first) += edgeBlock(e,true);
+    A.entry(e.first,e.second) += edgeBlock(e,false);
+    A.entry(e.second,e.first) += edgeBlock(e,false);
+    A.entry(e.second,e.second) += edgeBlock(e,true);
+  }
+}
+
+int testConcurrentBuild(std::size_t N, std::size_t threads, std::size_t avg)
+{
+  const std::vector<Edge> edges = gridEdges(N);
+  const std::size_t n = N*N;
+
+  Matrix ref;
+  assembleSerial(ref,edges,n,avg);
+  Matrix::CompressionStatistics refStats = ref.compress();
+
+  // the threads work on interleaved edges, so all rows are shared
+  Matrix A;
+  Dune::ConcurrentImplicitMatrixBuilder<Matrix> builder(A,n,n,avg,0.5,threads);
+  std::vector<std::thread> workers;
+  for (std::size_t k=0; k<threads; ++k)
+    workers.emplace_back([&,k] {
+        auto inserter = builder.inserter(k);
+        for (std::size_t l=k; l<edges.size(); l+=threads)
+        {
+          const Edge& e = edges[l];
+          inserter.add(e.first,e.first,edgeBlock(e,true));
+          inserter.add(e.first,e.second,edgeBlock(e,false));
+          inserter.add(e.second,e.first,edgeBlock(e,false));
+          inserter.add(e.second,e.second,edgeBlock(e,true));
+        }
+      });
+  for (auto& w : workers)
+    w.join();
+
+  Dune::ThreadExecutor exec(threads,1);
+  Matrix::CompressionStatistics stats = builder.compress(exec);
+
+  int ret = 0;
+  if (A.buildStage()!=Matrix::built || !sameMatrix(A,ref))
+  {
+    std::cerr << "Error: concurrent build with " << threads << " threads differs from the serial build" << std::endl;
+    ++ret;
+  }
+  if (stats.maximum!=refStats.maximum || stats.avg!=refStats.avg)
+  {
+    std::cerr << "Error: wrong compression statistics of the concurrent build" << std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+// The parallel compress of the matrix has to give the same matrix as the serial one.
+int testParallelCompress(std::size_t N, std::size_t threads)
+{
+  const std::vector<Edge> edges = gridEdges(N);
+  Matrix ref, A;
+  assembleSerial(ref,edges,N*N,3);
+  assembleSerial(A,edges,N*N,3);
+  ref.compress();
+  Matrix::CompressionStatistics stats = A.compress(Dune::ThreadExecutor(threads,1));
+
+  if (!sameMatrix(A,ref) || stats.overflow_total==0)
+  {
+    std::cerr << "Error: parallel compress differs from compress" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    for (std::size_t threads : {1, 2, 4})
+    {
+      // enough room in the rows, and rows overflowing into the per-thread areas
+      ret += testConcurrentBuild(12,threads,5);
+      ret += testConcurrentBuild(12,threads,2);
+      ret += testParallelCompress(10,threads);
+    }
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,173 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/cooimport.hh>
+
+typedef Dune::FieldMatrix<double,2,2> Block;
+typedef Dune::BCRSMatrix<Block> Matrix;
+
+struct Triplets
+{
+  std::vector<std::size_t> rows, cols;
+  std::vector<Block> values;
+
+  void add(std::size_t i, std::size_t j, const Block& b)
+  {
+    rows.push_back(i);
+    cols.push_back(j);
+    values.push_back(b);
+  }
+};
+
+Block edgeBlock(std::size_t i, std::size_t j, bool diagonal)
+{
+  Block b(0.0);
+  b[0][0] = diagonal ? 1.0 : -1.0;
+  b[1][1] = diagonal ? 2.0 : -2.0;
+  b[0][1] = double((i+j)%5);
+  return b;
+}
+
+// Compare pattern and values of two matrices
+bool sameMatrix(const Matrix& A, const Matrix& B)
+{
+  if (A.N()!=B.N() || A.M()!=B.M() || A.nonzeroes()!=B.nonzeroes())
+    return false;
+  for (Matrix::size_type i=0; i<A.N(); ++i)
+  {
+    if (A[i].getsize()!=B[i].getsize())
+      return false;
+    for (Matrix::size_type k=0; k<A[i].getsize(); ++k)
+      if (A[i].getindexptr()[k]!=B[i].getindexptr()[k] || A[i].getptr()[k]!=B[i].getptr()[k])
+        return false;
+  }
+  return true;
+}
+
+// Assemble the edges of an N x N grid, once through entry() and once as
+// shuffled triplets with all the duplicates of the element-wise assembly.
+int testGrid(std::size_t N, std::size_t threads)
+{
+  const std::size_t n = N*N;
+  Matrix ref(n,n,5,0.5,Matrix::implicit);
+  Triplets t;
+  for (std::size_t y=0; y<N; ++y)
+    for (std::size_t x=0; x<N; ++x)
+      for (std::size_t other : {y*N+x+1, (y+1)*N+x})
+      {
+        const std::size_t i = y*N+x;
+        if ((other==i+1 && x+1==N) || other>=n)
+          continue;
+        for (std::size_t a : {i, other})
+          for (std::size_t b : {i, other})
+          {
+            ref.entry(a,b) += edgeBlock(i,other,a==b);
+            t.add(a,b,edgeBlock(i,other,a==b));
+          }
+      }
+  ref.compress();
+
+  // a fixed shuffle, applied to all three arrays
+  std::vector<std::size_t> perm(t.values.size());
+  std::size_t seed = 4711;
+  for (std::size_t k=0; k<perm.size(); ++k)
+    perm[k] = k;
+  for (std::size_t k=perm.size(); k>1; --k)
+  {
+    seed = (seed*1103515245 + 12345) % 2147483648u;
+    std::swap(perm[k-1], perm[seed % k]);
+  }
+  Triplets s;
+  for (std::size_t k : perm)
+    s.add(t.rows[k],t.cols[k],t.values[k]);
+
+  int ret = 0;
+  Matrix A;
+  Dune::importCOO(A,n,n,s.rows,s.cols,s.values,Dune::DuplicateEntries::sum,Dune::ThreadExecutor(threads,1));
+  if (!sameMatrix(A,ref))
+  {
+    std::cerr << "Error: importCOO with " << threads << " threads does not match implicit assembly" << std::endl;
+    ++ret;
+  }
+
+  // the previous content of the matrix is discarded
+  Dune::importCOO(A,n,n,t.rows,t.cols,t.values);
+  if (!sameMatrix(A,ref))
+  {
+    std::cerr << "Error: importCOO into a built matrix fails" << std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int testScalarsAndErrors()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > ScalarMatrix;
+  int ret = 0;
+
+  // rows 1 and 4 and column 2 stay empty
+  const std::vector<int> i = {3, 0, 5, 3, 0, 2};
+  const std::vector<int> j = {1, 0, 3, 1, 4, 0};
+  const std::vector<double> v = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  ScalarMatrix A;
+  Dune::importCOO(A,6,5,i,j,v);
+  if (A.N()!=6 || A.M()!=5 || A.nonzeroes()!=5 || A[1].getsize()!=0 || A[4].getsize()!=0
+      || A[3][1]!=5.0 || A[0][0]!=2.0 || A[0][4]!=5.0 || !A.exists(5,3))
+  {
+    std::cerr << "Error: wrong matrix from scalar triplets" << std::endl;
+    ++ret;
+  }
+
+  ScalarMatrix E;
+  Dune::importCOO(E,3,3,std::vector<int>(),std::vector<int>(),std::vector<double>());
+  if (E.N()!=3 || E.nonzeroes()!=0 || E[2].getsize()!=0)
+  {
+    std::cerr << "Error: wrong matrix from no triplets" << std::endl;
+    ++ret;
+  }
+
+  auto throws = [&](const std::vector<int>& ri, const std::vector<int>& ci, Dune::DuplicateEntries d) {
+    try {
+      Dune::importCOO(A,6,5,ri,ci,std::vector<double>(ri.size(),1.0),d);
+    }
+    catch (Dune::BCRSMatrixError&) {
+      return true;
+    }
+    return false;
+  };
+  if (!throws(i,j,Dune::DuplicateEntries::error) || !throws({0, 6},{0, 0},Dune::DuplicateEntries::sum)
+      || !throws({0, -1},{0, 0},Dune::DuplicateEntries::sum) || !throws({0},{5},Dune::DuplicateEntries::sum))
+  {
+    std::cerr << "Error: invalid triplets are accepted" << std::endl;
+    ++ret;
+  }
+  if (A.nonzeroes()!=5 || A[3][1]!=5.0)
+  {
+    std::cerr << "Error: a failed import changed the matrix" << std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testGrid(30,1);
+    ret += testGrid(30,4);
+    ret += testGrid(1,3);
+    ret += testScalarsAndErrors();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,248 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <dune/istl/denseutils.hh>
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// The Cholesky factorization solves G y = b and detects the rank of a semi-definite G
+template<class K>
+int testCholesky(std::size_t n, const K& unit)
+{
+  using std::abs;
+  int ret = 0;
+  // G = W^H W for n vectors of length n+2, the last one a combination of the others
+  std::vector<std::vector<K> > W(n+2,std::vector<K>(n));
+  for (std::size_t i=0; i<n+2; ++i)
+  {
+    for (std::size_t j=0; j+1<n; ++j)
+      W[i][j] = K(std::sin(0.7*(i+1)*(j+2))) + unit*0.5*std::cos(1.3*(i+2)*(j+1));
+    W[i][n-1] = W[i][0] - K(2)*W[i][1];
+  }
+  std::vector<std::vector<K> > G(n,std::vector<K>(n,K(0)));
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j=0; j<n; ++j)
+      for (std::size_t l=0; l<n+2; ++l)
+        G[i][j] += Dune::Imp::conjugate(W[l][i])*W[l][j];
+
+  std::vector<std::vector<K> > L(G);
+  const std::size_t rank = Dune::Imp::choleskyFactor(L,n,1e-12);
+  ret += check(rank == n-1, "the Cholesky factorization misses the rank deficiency");
+
+  std::vector<K> b(rank), y;
+  for (std::size_t i=0; i<rank; ++i)
+    b[i] = K(1.0 + i) + unit*(0.5*i);
+  y = b;
+  Dune::Imp::choleskySolve(L,rank,y);
+  double error = 0;
+  for (std::size_t i=0; i<rank; ++i)
+  {
+    K gy = 0;
+    for (std::size_t j=0; j<rank; ++j)
+      gy += G[i][j]*y[j];
+    error = std::max(error,abs(gy - b[i]));
+  }
+  ret += check(error < 1e-10, "the Cholesky solve is inaccurate");
+  return ret;
+}
+
+// The Givens rotation maps (a,b) to (r,0) and keeps the norm
+template<class K>
+int testGivens(const K& a, const K& b)
+{
+  using std::abs;
+  double c;
+  K s, x = a, y = b;
+  Dune::Imp::givensRotation(a,b,c,s);
+  Dune::Imp::applyGivens(x,y,c,s);
+  const double norm = std::sqrt(abs(a)*abs(a) + abs(b)*abs(b));
+  return check(abs(y) < 1e-14*norm && std::abs(abs(x) - norm) < 1e-14*norm
+               && std::abs(c*c + abs(s)*abs(s) - 1.0) < 1e-14,
+               "the Givens rotation is wrong");
+}
+
+// The eigenvectors of the Jacobi method are orthonormal and A V = V Lambda
+template<class K>
+int testHermitianEigen(std::size_t n, const K& unit)
+{
+  using std::abs;
+  int ret = 0;
+  std::vector<std::vector<K> > A(n,std::vector<K>(n));
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j=0; j<=i; ++j)
+    {
+      A[i][j] = K(std::sin(1.0 + i + 3.0*j));
+      if (i!=j)
+        A[i][j] += unit*0.3*std::cos(1.0*i*j);
+      A[j][i] = Dune::Imp::conjugate(A[i][j]);
+    }
+  std::vector<std::vector<K> > B(A), V;
+  std::vector<double> lambda;
+  Dune::Imp::hermitianEigen(B,n,lambda,V);
+
+  double residual = 0, orthogonality = 0;
+  for (std::size_t c=0; c<n; ++c)
+    for (std::size_t i=0; i<n; ++i)
+    {
+      K av = 0, vv = 0;
+      for (std::size_t j=0; j<n; ++j)
+      {
+        av += A[i][j]*V[j][c];
+        vv += Dune::Imp::conjugate(V[j][i])*V[j][c];
+      }
+      residual = std::max(residual,abs(av - lambda[c]*V[i][c]));
+      orthogonality = std::max(orthogonality,abs(vv - K(i==c ? 1.0 : 0.0)));
+    }
+  ret += check(residual < 1e-12 && orthogonality < 1e-12, "the Jacobi method is inaccurate");
+  return ret;
+}
+
+typedef std::complex<double> Complex;
+typedef std::vector<std::vector<Complex> > ComplexMatrix;
+
+// Runs the QR method on A and checks A V = V Lambda, returns the eigenvalues
+int checkGeneralEigen(const ComplexMatrix& A, std::vector<Complex>& lambda, const char* what)
+{
+  const std::size_t n = A.size();
+  int ret = 0;
+  ComplexMatrix B(A), V;
+  if (!Dune::Imp::generalEigen(B,n,lambda,V))
+    return check(false,what);
+
+  double residual = 0, scale = 0;
+  for (std::size_t c=0; c<n; ++c)
+    for (std::size_t i=0; i<n; ++i)
+    {
+      Complex av = 0;
+      for (std::size_t j=0; j<n; ++j)
+        av += A[i][j]*V[j][c];
+      residual = std::max(residual,std::abs(av - lambda[c]*V[i][c]));
+      scale = std::max(scale,std::abs(A[i][c]));
+    }
+  ret += check(residual < 1e-12*n*scale, what);
+  return ret;
+}
+
+// Every expected eigenvalue is found by the QR method
+int checkSpectrum(const std::vector<Complex>& lambda, const std::vector<Complex>& expected, const char* what)
+{
+  std::vector<bool> used(lambda.size(),false);
+  for (const Complex& mu : expected)
+  {
+    std::size_t best = lambda.size();
+    for (std::size_t i=0; i<lambda.size(); ++i)
+      if (!used[i] && (best == lambda.size() || std::abs(lambda[i]-mu) < std::abs(lambda[best]-mu)))
+        best = i;
+    if (best == lambda.size() || std::abs(lambda[best]-mu) > 1e-10)
+      return check(false,what);
+    used[best] = true;
+  }
+  return 0;
+}
+
+// The QR method finds A V = V Lambda for nonsymmetric matrices with complex eigenvalues
+int testGeneralEigen(std::size_t n, double imaginary)
+{
+  int ret = 0;
+  ComplexMatrix A(n,std::vector<Complex>(n));
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j=0; j<n; ++j)
+      A[i][j] = Complex(std::sin(1.0 + i + 3.0*j) + (j+1==i ? 2.0 : 0.0) - (i+1==j ? 2.0 : 0.0),
+                        imaginary*std::cos(1.0*i*j));
+  std::vector<Complex> lambda;
+  ret += checkGeneralEigen(A,lambda,"the QR method is inaccurate");
+  double imag = 0;
+  for (const Complex& l : lambda)
+    imag = std::max(imag,std::abs(l.imag()));
+  ret += check(imag > 0.1, "the test matrix has no complex eigenvalues");
+
+  // the tridiagonal Toeplitz matrix [-1 2 1] has the eigenvalues 2 + 2i cos(k pi/(n+1))
+  const double pi = std::acos(-1.0);
+  ComplexMatrix T(n,std::vector<Complex>(n,Complex(0)));
+  std::vector<Complex> expected;
+  for (std::size_t i=0; i<n; ++i)
+  {
+    T[i][i] = 2.0;
+    if (i>0)
+      T[i][i-1] = -1.0;
+    if (i+1<n)
+      T[i][i+1] = 1.0;
+    expected.push_back(Complex(2.0,2.0*std::cos((i+1)*pi/(n+1))));
+  }
+  ret += checkGeneralEigen(T,lambda,"the QR method is inaccurate for a Toeplitz matrix");
+  ret += checkSpectrum(lambda,expected,"the QR method misses an eigenvalue of a Toeplitz matrix");
+
+  // the cyclic shift is orthogonal, the plain shifts stall and need the exceptional ones
+  ComplexMatrix P(n,std::vector<Complex>(n,Complex(0)));
+  expected.clear();
+  for (std::size_t i=0; i<n; ++i)
+  {
+    P[(i+1)%n][i] = 1.0;
+    expected.push_back(std::polar(1.0,2.0*pi*i/n));
+  }
+  ret += checkGeneralEigen(P,lambda,"the QR method is inaccurate for a cyclic shift");
+  ret += checkSpectrum(lambda,expected,"the QR method misses a root of unity");
+  return ret;
+}
+
+// The LU factorization solves A X = I and detects a singular matrix
+int testLU(std::size_t n)
+{
+  int ret = 0;
+  ComplexMatrix A(n,std::vector<Complex>(n));
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j=0; j<n; ++j)
+      A[i][j] = Complex(std::sin(1.0 + i + 3.0*j) + (i==j ? 0.5 : 0.0), 0.3*std::cos(1.0*i*j));
+  ComplexMatrix I(n,std::vector<Complex>(n,Complex(0)));
+  for (std::size_t i=0; i<n; ++i)
+    I[i][i] = 1;
+  ComplexMatrix B(A), X(I);
+  ret += check(Dune::Imp::luSolve(B,n,X), "the LU factorization fails");
+  double error = 0;
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j=0; j<n; ++j)
+    {
+      Complex ax = 0;
+      for (std::size_t l=0; l<n; ++l)
+        ax += A[i][l]*X[l][j];
+      error = std::max(error,std::abs(ax - I[i][j]));
+    }
+  ret += check(error < 1e-12, "the LU factorization is inaccurate");
+
+  B = A;
+  B[n/2].assign(n,Complex(0));
+  X = I;
+  ret += check(!Dune::Imp::luSolve(B,n,X), "the LU factorization misses a singular matrix");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  ret += testCholesky<double>(6,1.0);
+  ret += testCholesky<Complex>(5,Complex(0.0,1.0));
+  ret += testGivens<double>(3.0,-4.0);
+  ret += testGivens<double>(0.0,2.0);
+  ret += testGivens<Complex>(Complex(1.0,2.0),Complex(-0.5,0.25));
+  ret += testHermitianEigen<double>(7,1.0);
+  ret += testHermitianEigen<Complex>(6,Complex(0.0,1.0));
+  ret += testGeneralEigen(9,0.0);
+  ret += testGeneralEigen(8,0.7);
+  ret += testLU(7);
+  return ret;
+}
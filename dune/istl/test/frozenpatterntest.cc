@@ -0,0 +1,142 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/frozenpattern.hh>
+
+#include "laplacian.hh"
+
+typedef Dune::FieldMatrix<double,2,2> Block;
+typedef Dune::BCRSMatrix<Block> Matrix;
+typedef std::array<std::size_t,2> Element;
+typedef std::array<std::array<Block,2>,2> ElementMatrix;
+
+// The edges of the N x N grid used by setupLaplacian
+std::vector<Element> gridEdges(std::size_t N)
+{
+  std::vector<Element> edges;
+  for (std::size_t y=0; y<N; ++y)
+    for (std::size_t x=0; x<N; ++x)
+    {
+      if (x+1<N)
+        edges.push_back({{y*N+x,y*N+x+1}});
+      if (y+1<N)
+        edges.push_back({{y*N+x,(y+1)*N+x}});
+    }
+  return edges;
+}
+
+ElementMatrix elementMatrix(const Element& e, double scale)
+{
+  ElementMatrix local;
+  for (int k=0; k<2; ++k)
+    for (int l=0; l<2; ++l)
+    {
+      local[k][l] = 0.0;
+      local[k][l][0][0] = scale*(k==l ? 1.0 : -1.0);
+      local[k][l][1][1] = scale*(k==l ? 2.0 : -2.0);
+      local[k][l][1][0] = scale*double((e[k]+3*e[l])%7);
+    }
+  return local;
+}
+
+// Assemble with operator[] as reference
+void assembleReference(Matrix& A, const std::vector<Element>& edges, double scale)
+{
+  A = 0.0;
+  for (const Element& e : edges)
+  {
+    const ElementMatrix local = elementMatrix(e,scale);
+    for (int k=0; k<2; ++k)
+      for (int l=0; l<2; ++l)
+        A[e[k]][e[l]] += local[k][l];
+  }
+}
+
+// Compare the values of two matrices with the same pattern
+bool sameValues(const Matrix& A, const Matrix& B)
+{
+  for (Matrix::size_type i=0; i<A.N(); ++i)
+    for (Matrix::size_type k=0; k<A[i].getsize(); ++k)
+      if (A[i].getptr()[k] != B[i].getptr()[k])
+        return false;
+  return true;
+}
+
+int main()
+{
+  const std::size_t N = 8;
+  int ret = 0;
+  try {
+    Matrix A, ref;
+    setupLaplacian(A,N);
+    setupLaplacian(ref,N);
+    const std::vector<Element> edges = gridEdges(N);
+
+    Dune::FrozenPattern<Matrix> frozen(A);
+    for (const Element& e : edges)
+      frozen.addElement(e);
+    if (frozen.elements() != edges.size())
+    {
+      std::cerr << "Error: wrong number of elements" << std::endl;
+      ++ret;
+    }
+
+    const Block* values = A.values();
+    const Matrix::size_type* indices = A[0].getindexptr();
+    for (double scale : {1.0, 0.5, 3.0})
+    {
+      A = 0.0;
+      for (std::size_t e=0; e<edges.size(); ++e)
+        frozen.scatterAdd(e,elementMatrix(edges[e],scale));
+      assembleReference(ref,edges,scale);
+
+      if (!sameValues(A,ref))
+      {
+        std::cerr << "Error: scatterAdd gives a wrong matrix for scale " << scale << std::endl;
+        ++ret;
+      }
+    }
+    if (A.values() != values || A[0].getindexptr() != indices)
+    {
+      std::cerr << "Error: reassembly reallocated the matrix" << std::endl;
+      ++ret;
+    }
+
+    // the offsets apply to copies of the matrix, too
+    Matrix B(A);
+    B = 0.0;
+    for (std::size_t e=0; e<edges.size(); ++e)
+      frozen.scatterAdd(B,e,elementMatrix(edges[e],3.0));
+    if (!sameValues(A,B))
+    {
+      std::cerr << "Error: scatterAdd into a copy is wrong" << std::endl;
+      ++ret;
+    }
+
+    // couplings outside of the pattern are rejected
+    bool thrown = false;
+    try {
+      frozen.addElement(Element{{0,N*N-1}});
+    }
+    catch (Dune::BCRSMatrixError&) {
+      thrown = true;
+    }
+    if (!thrown)
+    {
+      std::cerr << "Error: coupling outside of the pattern was accepted" << std::endl;
+      ++ret;
+    }
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,213 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <complex>
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Fill v with values that are not exactly representable
+template<class V>
+void fill (V& v, double offset)
+{
+  double t = offset;
+  Dune::fusedForEach([&t](typename V::field_type& vk) {
+      vk = 1.0/(t += 0.37);
+    }, v);
+}
+
+// Whether a and b agree up to rounding, they are equal without FMA contraction
+template<class T>
+bool same (const T& a, const T& b)
+{
+  using std::abs;
+  return abs(a-b) <= 1e-14*abs(b);
+}
+
+// The fused update has to give the result of the separate operations
+template<class V>
+int testAxpyNorm2(std::size_t n)
+{
+  int ret = 0;
+  typedef typename V::field_type K;
+  V x(n), p(n), r(n), q(n);
+  fill(x,0.1);
+  fill(p,0.2);
+  fill(r,0.3);
+  fill(q,0.4);
+  V x2(x), r2(r);
+  const K a = K(0.7)/K(3.0);
+
+  const auto norm2 = Dune::fusedAxpyNorm2(x,a,p,r,q);
+  x2.axpy(a,p);
+  r2.axpy(-a,q);
+  ret += check(same(norm2,r2.two_norm2()), "the fused norm differs");
+  x2 -= x;
+  r2 -= r;
+  ret += check(x2.infinity_norm() <= 1e-14*x.infinity_norm()
+               && r2.infinity_norm() <= 1e-14*r.infinity_norm(),
+               "the fused update differs");
+  return ret;
+}
+
+int testNested()
+{
+  int ret = 0;
+  typedef Dune::BlockVector<Dune::FieldVector<double,2> > Inner;
+  typedef Dune::BlockVector<Inner> Vector;
+  Vector v(3), w(3);
+  for (std::size_t i=0; i<3; ++i)
+  {
+    v[i].resize(i+1);
+    w[i].resize(i+1);
+  }
+  fill(v,0.5);
+  w = 2.0;
+
+  // w = w - v, then the dot product in the same pass
+  const double dot = Dune::fusedSum<double>([](const double& vk, double& wk) {
+      wk -= vk;
+      return vk*wk;
+    }, v, w);
+  ret += check(same(dot,v.dot(w)), "the fused sum of nested vectors differs");
+
+  std::size_t count = 0;
+  Dune::fusedForEach([&count](double&) { ++count; }, w);
+  ret += check(count == w.dim(), "not all entries of nested vectors are visited");
+  return ret;
+}
+
+// A scalar product without the fused update
+template<class X>
+class PlainScalarProduct : public Dune::ScalarProduct<X>
+{
+public:
+  typedef typename Dune::ScalarProduct<X>::field_type field_type;
+  typedef typename Dune::ScalarProduct<X>::real_type real_type;
+  enum {category=Dune::SolverCategory::sequential};
+
+  field_type dot (const X& x, const X& y) override
+  {
+    return x.dot(y);
+  }
+
+  real_type norm (const X& x) override
+  {
+    return x.two_norm();
+  }
+};
+
+// A weighted norm, which the fused update must not bypass
+template<class X>
+class WeightedScalarProduct : public Dune::SeqScalarProduct<X>
+{
+public:
+  typedef typename Dune::SeqScalarProduct<X>::real_type real_type;
+
+  real_type norm (const X& x) override
+  {
+    ++calls;
+    return 2.0*x.two_norm();
+  }
+
+  bool fusable () const override
+  {
+    return false;
+  }
+
+  int calls = 0;
+};
+
+// The solvers find the same iterates with and without fusion
+int testSolvers()
+{
+  int ret = 0;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  Matrix A;
+  setupLaplacian(A,12);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> prec(A,1,1.0);
+  Dune::SeqScalarProduct<Vector> fused;
+  PlainScalarProduct<Vector> plain;
+
+  Vector e(A.N()), b(A.N());
+  fill(e,1.0);
+  A.mv(e,b);
+
+  const double tolerance = 1e-10*e.infinity_norm();
+  auto solve = [&](Dune::InverseOperator<Vector,Vector>& solver) {
+    Dune::InverseOperatorResult r;
+    Vector x(A.N()), rhs(b);
+    x = 0.0;
+    solver.apply(x,rhs,r);
+    ret += check(r.converged, "a solver does not converge");
+    return x;
+  };
+
+  Dune::CGSolver<Vector> cgFused(op,fused,prec,1e-10,500,0);
+  Dune::CGSolver<Vector> cgPlain(op,plain,prec,1e-10,500,0);
+  Vector x = solve(cgFused);
+  x -= solve(cgPlain);
+  ret += check(x.infinity_norm() <= tolerance, "the fused CG differs");
+
+  Dune::BiCGSTABSolver<Vector> bicgFused(op,fused,prec,1e-10,500,0);
+  Dune::BiCGSTABSolver<Vector> bicgPlain(op,plain,prec,1e-10,500,0);
+  x = solve(bicgFused);
+  x -= solve(bicgPlain);
+  ret += check(x.infinity_norm() <= tolerance, "the fused BiCGSTAB differs");
+
+  Dune::GradientSolver<Vector> gradFused(op,fused,prec,1e-3,500,0);
+  Dune::GradientSolver<Vector> gradPlain(op,plain,prec,1e-3,500,0);
+  x = solve(gradFused);
+  x -= solve(gradPlain);
+  ret += check(x.infinity_norm() <= tolerance, "the fused gradient solver differs");
+
+  // the solvers call the norm() of a derived scalar product for every defect
+  WeightedScalarProduct<Vector> weighted;
+  Dune::CGSolver<Vector> cgWeighted(op,weighted,prec,1e-10,500,0);
+  Dune::InverseOperatorResult r;
+  Vector y(A.N()), rhs(b);
+  y = 0.0;
+  cgWeighted.apply(y,rhs,r);
+  ret += check(r.converged && weighted.calls == r.iterations+1,
+               "the fused update bypasses a derived norm()");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testAxpyNorm2<Dune::BlockVector<Dune::FieldVector<double,1> > >(101);
+    ret += testAxpyNorm2<Dune::BlockVector<Dune::FieldVector<double,3> > >(57);
+    ret += testAxpyNorm2<Dune::BlockVector<Dune::FieldVector<std::complex<double>,2> > >(33);
+    ret += testNested();
+    ret += testSolvers();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,224 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Counts the reductions, i.e. the calls of dot(), norm() and multiDot()
+template<class X>
+class CountingScalarProduct : public Dune::SeqScalarProduct<X>
+{
+  typedef Dune::SeqScalarProduct<X> Base;
+public:
+  typedef typename Base::field_type field_type;
+  typedef typename Base::real_type real_type;
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    ++reductions;
+    return Base::dot(x,y);
+  }
+
+  virtual real_type norm (const X& x)
+  {
+    ++reductions;
+    return Base::norm(x);
+  }
+
+  // one reduction by the fused products of the plain scalar product
+  virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                         std::vector<field_type>& dots)
+  {
+    ++reductions;
+    plain_.multiDot(pairs,dots);
+  }
+
+  int reductions = 0;
+
+private:
+  Base plain_;
+};
+
+// A weighted dot product, which multiDot() must not bypass
+template<class X>
+class WeightedScalarProduct : public Dune::SeqScalarProduct<X>
+{
+public:
+  typedef typename Dune::SeqScalarProduct<X>::field_type field_type;
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    return field_type(2.0)*x.dot(y);
+  }
+
+  virtual bool fusable () const
+  {
+    return false;
+  }
+};
+
+// The fused kernels are bitwise the same as the single dot products and updates
+template<class K, int n>
+int testFusedKernels()
+{
+  typedef Dune::BlockVector<Dune::FieldVector<K,n> > Vector;
+  int ret = 0;
+
+  // more blocks than a chunk, with a partial last chunk
+  const std::size_t size = 1000;
+  std::vector<Vector> vs(5,Vector(size));
+  Vector y(size);
+  for (std::size_t i=0; i<size; ++i)
+  {
+    for (int r=0; r<n; ++r)
+      y[i][r] = K(1.0/(1.0 + i + r));
+    for (std::size_t k=0; k<vs.size(); ++k)
+      for (int r=0; r<n; ++r)
+        vs[k][i][r] = K(std::sin(0.1*i + k + r));
+  }
+  std::vector<const Vector*> pointers;
+  std::vector<K> a;
+  for (std::size_t k=0; k<vs.size(); ++k)
+  {
+    pointers.push_back(&vs[k]);
+    a.push_back(K(0.3 - 0.1*k));
+  }
+
+  std::vector<K> dots;
+  Dune::fusedDots(pointers,y,dots);
+  bool same = dots.size() == vs.size();
+  for (std::size_t k=0; k<vs.size(); ++k)
+    same = same && dots[k] == vs[k].dot(y);
+  ret += check(same, "fusedDots differs from dot");
+
+  Vector z(y);
+  Dune::fusedAxpys(z,a,pointers);
+  for (std::size_t k=0; k<vs.size(); ++k)
+    y.axpy(a[k],vs[k]);
+  z -= y;
+  ret += check(z.infinity_norm() == 0.0, "fusedAxpys differs from axpy");
+
+  // SeqScalarProduct::multiDot uses fusedDots for a common second vector
+  Dune::SeqScalarProduct<Vector> sp;
+  std::vector<std::pair<const Vector*,const Vector*> > pairs;
+  for (const Vector& v : vs)
+    pairs.emplace_back(&v,&y);
+  sp.multiDot(pairs,dots);
+  same = dots.size() == vs.size();
+  for (std::size_t k=0; k<vs.size(); ++k)
+    same = same && dots[k] == vs[k].dot(y);
+  ret += check(same, "multiDot differs from dot");
+
+  WeightedScalarProduct<Vector> weighted;
+  weighted.multiDot(pairs,dots);
+  same = dots.size() == vs.size();
+  for (std::size_t k=0; k<vs.size(); ++k)
+    same = same && dots[k] == weighted.dot(vs[k],y);
+  ret += check(same, "multiDot bypasses a derived dot()");
+  return ret;
+}
+
+// A nonsymmetric system, the Laplacian with an upwind convection term
+template<class Matrix>
+void setupConvection (Matrix& A, int N)
+{
+  typedef typename Matrix::field_type K;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      if (col.index()+1 == row.index())
+        *col -= K(1.0);
+      else if (col.index() == row.index())
+        *col += K(1.0);
+}
+
+// GMRes with CGS2 converges like with modified Gram-Schmidt, with two reductions per iteration
+template<class K>
+int testGMRes()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<K,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupConvection(A,20);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqILU0<Matrix,Vector,Vector> prec(A,1.0);
+
+  Vector e(A.N()), b(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0/(1.0 + i%17);
+  A.mv(e,b);
+
+  for (int restart : {10, 40})
+  {
+    CountingScalarProduct<Vector> spMGS, spCGS2;
+    Dune::InverseOperatorResult resMGS, resCGS2;
+    Vector x(A.N()), y(A.N()), rhs(b);
+    x = 0.0;
+    Dune::RestartedGMResSolver<Vector> mgs(op,spMGS,prec,1e-10,restart,2000,0);
+    mgs.apply(x,rhs,resMGS);
+
+    y = 0.0;
+    rhs = b;
+    Dune::RestartedGMResSolver<Vector> cgs2(op,spCGS2,prec,1e-10,restart,2000,0,
+                                            Dune::GMResOrthogonalization::classicalGramSchmidt2);
+    cgs2.apply(y,rhs,resCGS2);
+
+    ret += check(resMGS.converged && resCGS2.converged, "GMRes does not converge");
+    ret += check(resMGS.iterations == resCGS2.iterations,
+                 "GMRes with CGS2 needs a different number of iterations");
+    ret += check(spCGS2.reductions <= 2*resCGS2.iterations + 2*resCGS2.iterations/restart + 2,
+                 "GMRes with CGS2 does more than two reductions per iteration");
+    ret += check(spMGS.reductions > spCGS2.reductions,
+                 "GMRes with CGS2 does not save reductions");
+
+    x -= e;
+    y -= e;
+    ret += check(y.infinity_norm() <= 10*x.infinity_norm() + 1e-12,
+                 "GMRes with CGS2 is inaccurate");
+  }
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testFusedKernels<double,1>();
+    ret += testFusedKernels<double,3>();
+    ret += testFusedKernels<std::complex<double>,2>();
+    ret += testGMRes<double>();
+    ret += testGMRes<std::complex<double> >();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,128 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/memoryusage.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/vbvector.hh>
+
+#include "laplacian.hh"
+
+typedef Dune::FieldMatrix<double,2,2> Block;
+typedef Dune::BCRSMatrix<Block> Matrix;
+typedef Dune::BlockVector<Dune::FieldVector<double,2> > Vector;
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int testMatrix()
+{
+  int ret = 0;
+  const std::size_t entry = sizeof(Block) + sizeof(Matrix::size_type);
+
+  Matrix empty;
+  ret += check(empty.memoryUsage().allocated == 0, "an empty matrix uses memory");
+
+  Matrix A;
+  setupLaplacian(A,10);
+  const Dune::MemoryUsage usage = A.memoryUsage();
+  // setupLaplacian reserves five blocks for every row
+  ret += check(usage.used > A.nonzeroes()*entry && usage.wasted() == (5*A.N() - A.nonzeroes())*entry,
+               "a row-wise built matrix is not reported exactly");
+
+  // the threaded transposed products cache a transposed pattern
+  Vector x(A.N()), y(A.M());
+  x = 1.0;
+  A.umtv(x,y,Dune::ThreadExecutor(16,1));
+  ret += check(A.memoryUsage().used > usage.used, "the transposed pattern is not counted");
+  Matrix B(A);
+  ret += check(B.memoryUsage().used == usage.used, "a copy does not use the same memory");
+
+  // implicit mode reserves more than needed, the overflow area is counted, too
+  const std::size_t n = 100;
+  Matrix C(n,n,3,0.5,Matrix::implicit);
+  const Dune::MemoryUsage reserved = C.memoryUsage();
+  for (std::size_t i=0; i<n; ++i)
+    for (std::size_t j : {i, (i+1)%n, (i+7)%n, (i+13)%n})
+      C.entry(i,j) = 1.0;
+  const Dune::MemoryUsage building = C.memoryUsage();
+  ret += check(building.allocated > reserved.allocated && building.used > reserved.used,
+               "the overflow area is not counted");
+
+  Matrix::CompressionStatistics stats = C.compress();
+  const Dune::MemoryUsage built = C.memoryUsage();
+  // without the rows, the used fraction is the one compress() reports
+  const double rowBytes = double(built.used - C.nonzeroes()*entry);
+  const double ratio = (built.used - rowBytes) / (built.allocated - rowBytes);
+  ret += check(std::abs(ratio - stats.mem_ratio) < 1e-12 && built.wasted() > 0,
+               "the reserved memory does not match the compression statistics");
+
+  return ret;
+}
+
+int testVectors()
+{
+  int ret = 0;
+  Vector v(10);
+  ret += check(v.memoryUsage().allocated == 10*sizeof(Vector::block_type)
+               && v.memoryUsage().wasted() == 0, "wrong memory of a BlockVector");
+  v.reserve(25);
+  ret += check(v.memoryUsage().allocated == 25*sizeof(Vector::block_type)
+               && v.memoryUsage().used == 10*sizeof(Vector::block_type),
+               "the capacity of a BlockVector is not reported");
+
+  typedef Dune::VariableBlockVector<Dune::FieldVector<double,1> > VBVector;
+  VBVector w(4,3);
+  const Dune::MemoryUsage usage = w.memoryUsage();
+  ret += check(usage.used == usage.allocated && usage.used >= 12*sizeof(double),
+               "wrong memory of a VariableBlockVector");
+  return ret;
+}
+
+int testPreconditioners()
+{
+  int ret = 0;
+  Matrix A;
+  setupLaplacian(A,10);
+
+  Dune::SeqILU0<Matrix,Vector,Vector> ilu(A,1.0);
+  ret += check(Dune::memoryUsage(ilu).used == A.memoryUsage().used,
+               "the ILU0 decomposition is not counted");
+
+  Dune::SeqSSOR<Matrix,Vector,Vector> ssor(A,1,1.0);
+  ret += check(Dune::memoryUsage(ssor).allocated == 0,
+               "a preconditioner referring to the matrix reports memory");
+
+  Dune::MemoryUsage sum = A.memoryUsage() + Dune::memoryUsage(ilu);
+  ret += check(sum.used == 2*A.memoryUsage().used, "the sum of the usages is wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testMatrix();
+    ret += testVectors();
+    ret += testPreconditioners();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,134 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+template<class Vector>
+int compare(const Vector& a, const Vector& b, double tol, const char* what, int BS)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > tol*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " is wrong for block size " << BS << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+template<int BS>
+int testMixedPrecision(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,BS,BS> > Matrix;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<float,BS,BS> > FloatMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      *col *= 1.0 + 1.0/(3.0 + row.index() + col.index());
+
+  FloatMatrix Af(A);
+  // the converted matrix has exactly the float values, so the products of
+  // Ad and Af have to agree up to rounding in double
+  Matrix Ad(Af);
+
+  int ret = 0;
+  if (Af.N()!=A.N() || Af.M()!=A.M() || Af.nonzeroes()!=A.nonzeroes())
+  {
+    std::cerr << "Error: converted matrix has the wrong size" << std::endl;
+    ++ret;
+  }
+  for (typename Matrix::size_type i=0; i<A.N(); ++i)
+    if (A[i].getindexptr() != Af[i].getindexptr() || A[i].getindexptr() != Ad[i].getindexptr())
+    {
+      std::cerr << "Error: column indices of row " << i << " are not shared" << std::endl;
+      ++ret;
+      break;
+    }
+
+  Vector x(A.M()), y(A.N()), yf(A.N()), yd(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    for (int k=0; k<BS; ++k)
+      x[i][k] = 1.0/(i+k+1.0);
+
+  A.mv(x,y);
+  Ad.mv(x,yd);
+  Af.mv(x,yf);
+  ret += compare(yd,yf,1e-14,"mv",BS);
+  ret += compare(y,yf,1e-6,"mv compared to the double matrix",BS);
+
+  Ad.usmv(0.5,x,yd);
+  Af.usmv(0.5,x,yf);
+  ret += compare(yd,yf,1e-14,"usmv",BS);
+
+  Ad.umtv(x,yd);
+  Af.umtv(x,yf);
+  ret += compare(yd,yf,1e-14,"umtv",BS);
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> opd(Ad);
+  Dune::MatrixAdapter<FloatMatrix,Vector,Vector> opf(Af);
+  opd.applyscaleadd(-1.0,x,yd);
+  opf.applyscaleadd(-1.0,x,yf);
+  ret += compare(yd,yf,1e-14,"MatrixAdapter::applyscaleadd",BS);
+
+  return ret;
+}
+
+// Solve in double with a preconditioner using the float copy of the matrix.
+int testSolver(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<float,1,1> > FloatMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  FloatMatrix Af(A);
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqJac<FloatMatrix,Vector,Vector> jac(Af,1,1.0);
+
+  Vector x(A.N()), b(A.N());
+  x = 1.0;
+  b = 0.0;
+  Dune::InverseOperatorResult r;
+  Dune::CGSolver<Vector> solver(op,jac,1e-10,500,0);
+  solver.apply(x,b,r);
+  if (!r.converged)
+  {
+    std::cerr << "Error: CGSolver with float preconditioner did not converge" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testMixedPrecision<1>(10);
+    ret += testMixedPrecision<2>(8);
+    ret += testMixedPrecision<3>(8);
+    ret += testMixedPrecision<4>(6);
+    ret += testMixedPrecision<5>(5);
+    ret += testSolver(20);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,175 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/matrix.hh>
+#include <dune/istl/vbvector.hh>
+
+#include "laplacian.hh"
+
+typedef Dune::FieldMatrix<double,2,2> Block;
+typedef Dune::BCRSMatrix<Block> BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,2> > Vector;
+typedef Dune::VariableBlockVector<Dune::FieldVector<double,1> > VBVector;
+typedef Dune::Matrix<Block> DenseMat;
+
+static_assert(std::is_nothrow_move_constructible<BCRSMat>::value
+              && std::is_nothrow_move_assignable<BCRSMat>::value,
+              "BCRSMatrix cannot be moved without exceptions");
+static_assert(std::is_nothrow_move_constructible<Vector>::value
+              && std::is_nothrow_move_assignable<Vector>::value,
+              "BlockVector cannot be moved without exceptions");
+static_assert(std::is_nothrow_move_constructible<VBVector>::value
+              && std::is_nothrow_move_assignable<VBVector>::value,
+              "VariableBlockVector cannot be moved without exceptions");
+static_assert(std::is_nothrow_move_constructible<DenseMat>::value
+              && std::is_nothrow_move_assignable<DenseMat>::value,
+              "Matrix cannot be moved without exceptions");
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int testBCRSMatrix()
+{
+  int ret = 0;
+  BCRSMat A;
+  setupLaplacian(A,10);
+  const BCRSMat::size_type n = A.N(), nnz = A.nonzeroes();
+  const Block* values = &A[0][0];
+
+  // the threaded transposed products cache a pattern that has to move along
+  Vector x(n), y(n);
+  x = 1.0;
+  y = 0.0;
+  A.umtv(x,y,Dune::ThreadExecutor(16,1));
+  const Dune::MemoryUsage usage = A.memoryUsage();
+
+  BCRSMat B(std::move(A));
+  ret += check(&B[0][0] == values && B.N() == n && B.nonzeroes() == nnz,
+               "the move constructor copied the matrix");
+  ret += check(B.memoryUsage().used == usage.used, "the cached transposed pattern was lost");
+  ret += check(A.N() == 0 && A.M() == 0 && A.nonzeroes() == 0
+               && A.memoryUsage().allocated == 0 && A.buildMode() == BCRSMat::unknown,
+               "a moved-from matrix is not empty");
+
+  // the moved-from matrix can be set up again
+  setupLaplacian(A,4);
+  ret += check(A.N() == 16, "a moved-from matrix cannot be reused");
+
+  BCRSMat C;
+  setupLaplacian(C,3);
+  C = std::move(B);
+  ret += check(&C[0][0] == values && C.nonzeroes() == nnz && B.N() == 0,
+               "the move assignment copied the matrix");
+  Vector z(n);
+  z = 0.0;
+  C.umtv(x,z,Dune::ThreadExecutor(16,1));
+  z -= y;
+  ret += check(z.infinity_norm() == 0.0, "a moved matrix computes a different product");
+
+  // a matrix still being built in implicit mode can be moved, too
+  BCRSMat D(5,5,2,0.5,BCRSMat::implicit);
+  for (std::size_t i=0; i<5; ++i)
+    for (std::size_t j : {i, (i+1)%5, (i+3)%5})
+      D.entry(i,j) = 1.0;
+  BCRSMat E(std::move(D));
+  E.compress();
+  ret += check(E.nonzeroes() == 15 && D.N() == 0, "a matrix in implicit mode was not moved");
+
+  // a std::vector reallocates by moving
+  std::vector<BCRSMat> matrices(1);
+  setupLaplacian(matrices[0],5);
+  values = &matrices[0][0][0];
+  for (int k=0; k<10; ++k)
+    matrices.emplace_back();
+  ret += check(&matrices[0][0][0] == values, "std::vector copies the matrices");
+
+  return ret;
+}
+
+int testVectors()
+{
+  int ret = 0;
+  Vector v(10);
+  v.reserve(20);
+  v = 1.0;
+  const Vector::block_type* blocks = &v[0];
+  Vector w(std::move(v));
+  ret += check(&w[0] == blocks && w.N() == 10 && w.capacity() == 20,
+               "the move constructor copied the BlockVector");
+  ret += check(v.N() == 0 && v.capacity() == 0, "a moved-from BlockVector is not empty");
+  v.resize(3);
+  v = 2.0;
+  w = std::move(v);
+  ret += check(w.N() == 3 && w[2][1] == 2.0 && v.N() == 0,
+               "the move assignment of BlockVector failed");
+
+  VBVector a(4,3);
+  a = 1.0;
+  const VBVector::block_type::value_type* entries = &a[0][0];
+  VBVector b(std::move(a));
+  ret += check(&b[0][0] == entries && b.N() == 4 && b[3].N() == 3,
+               "the move constructor copied the VariableBlockVector");
+  ret += check(a.N() == 0 && a.dim() == 0, "a moved-from VariableBlockVector is not empty");
+  VBVector c(2,2);
+  c = std::move(b);
+  ret += check(&c[0][0] == entries && b.N() == 0, "the move assignment of VariableBlockVector failed");
+
+  return ret;
+}
+
+int testDenseMatrix()
+{
+  int ret = 0;
+  DenseMat A(3,4);
+  A = 1.0;
+  const Block* entries = &A[0][0];
+  DenseMat B(std::move(A));
+  ret += check(&B[0][0] == entries && B.N() == 3 && B.M() == 4,
+               "the move constructor copied the Matrix");
+  ret += check(A.N() == 0 && A.M() == 0, "a moved-from Matrix is not empty");
+
+  DenseMat C(1,1);
+  C = std::move(B);
+  ret += check(&C[0][0] == entries && C.M() == 4 && B.N() == 0 && B.M() == 0,
+               "the move assignment of Matrix failed");
+  A.setSize(2,2);
+  A = 0.0;
+  ret += check(A.N() == 2, "a moved-from Matrix cannot be reused");
+
+  DenseMat D(C);
+  ret += check(&D[0][0] != entries && D.M() == 4 && D[2][3] == C[2][3],
+               "the copy constructor of Matrix does not copy");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testBCRSMatrix();
+    ret += testVectors();
+    ret += testDenseMatrix();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
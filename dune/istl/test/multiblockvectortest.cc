@@ -0,0 +1,247 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/multiblockvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/scalarproducts.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+template<class MV>
+void fill (MV& x, double offset)
+{
+  for (std::size_t i=0; i<x.N(); ++i)
+    for (std::size_t c=0; c<x.columns(); ++c)
+      for (std::size_t r=0; r<x(i,c).N(); ++r)
+        x(i,c)[r] = 1.0/(offset + i + 0.3*c + 0.1*r);
+}
+
+// Every column of the products has to be the product with the BlockVector of that column
+template<int n>
+int testProducts(std::size_t k)
+{
+  typedef Dune::FieldMatrix<double,n,n> Block;
+  typedef Dune::BCRSMatrix<Block> Matrix;
+  typedef Dune::FieldVector<double,n> VB;
+  typedef Dune::BlockVector<VB> Vector;
+  typedef Dune::MultiBlockVector<VB> MultiVector;
+
+  int ret = 0;
+  Matrix A;
+  setupLaplacian(A,30);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      for (int r=0; r<n; ++r)
+        (*col)[r][(r+1)%n] += 0.01*(row.index()%7);
+
+  MultiVector x(A.M(),k), y(A.N(),k), z(A.N(),k), w(A.N(),k);
+  fill(x,1.0);
+  fill(y,2.0);
+  z = y;
+  w = y;
+  A.mv(x,y);
+  A.umv(x,z);
+  A.usmv(0.5,x,w,Dune::ThreadExecutor(4,1));
+
+  Vector xc, yc, zc, wc(A.N()), zRef(A.N()), wRef(A.N());
+  bool same = true;
+  for (std::size_t c=0; c<k; ++c)
+  {
+    x.getColumn(c,xc);
+    y.getColumn(c,yc);
+    z.getColumn(c,zc);
+    MultiVector initial(A.N(),k);
+    fill(initial,2.0);
+    initial.getColumn(c,zRef);
+    wRef = zRef;
+    A.umv(xc,zRef);
+    A.usmv(0.5,xc,wRef);
+    Vector yRef(A.N());
+    A.mv(xc,yRef);
+    w.getColumn(c,wc);
+    yc -= yRef;
+    zc -= zRef;
+    wc -= wRef;
+    // the kernels for small blocks of single vectors round differently
+    same = same && yc.infinity_norm() <= 1e-14*yRef.infinity_norm()
+           && zc.infinity_norm() <= 1e-14*zRef.infinity_norm()
+           && wc.infinity_norm() <= 1e-14*wRef.infinity_norm();
+  }
+  ret += check(same, "the columns of the multi-vector products differ");
+
+  // the threaded products compute every row on one thread, with the same result
+  MultiVector t(A.N(),k);
+  A.mv(x,t,Dune::ThreadExecutor(3,1));
+  t -= y;
+  ret += check(t.infinity_norm() == 0.0, "the threaded product differs");
+  const double norm = y.infinity_norm();
+  A.mmv(x,y);
+  ret += check(y.infinity_norm() <= 1e-14*norm, "mmv does not revert mv");
+  return ret;
+}
+
+int testReductions()
+{
+  typedef Dune::FieldVector<double,2> VB;
+  typedef Dune::MultiBlockVector<VB> MultiVector;
+  int ret = 0;
+
+  MultiVector x(50,3), y(50,3);
+  fill(x,1.0);
+  fill(y,0.5);
+  const std::vector<double> dots = x.columnDots(y);
+  const std::vector<double> norms2 = x.columnNorms2();
+  const std::vector<double> norms = x.columnNorms();
+  Dune::BlockVector<VB> xc, yc;
+  double sum = 0.0;
+  bool same = dots.size() == 3;
+  for (std::size_t c=0; c<3; ++c)
+  {
+    x.getColumn(c,xc);
+    y.getColumn(c,yc);
+    same = same && dots[c] == xc.dot(yc) && norms2[c] == xc.two_norm2()
+           && norms[c] == xc.two_norm();
+    sum += dots[c];
+  }
+  ret += check(same, "the column reductions differ from the single columns");
+  ret += check(std::abs(x.dot(y) - sum) <= 1e-14*sum, "dot() is not the sum over the columns");
+
+  // setColumn writes a single column
+  yc = 7.0;
+  y.setColumn(1,yc);
+  ret += check(y(4,1)[1] == 7.0 && y(4,0)[1] != 7.0 && y(4,2)[1] != 7.0,
+               "setColumn does not set a single column");
+
+  y.axpy(2.0,x);
+  y -= x;
+  y -= x;
+  y.setColumn(1,yc);
+  x.getColumn(0,xc);
+  MultiVector z(50,3);
+  fill(z,0.5);
+  z.setColumn(1,yc);
+  z -= y;
+  ret += check(z.infinity_norm() <= 1e-14, "the vector space operations are wrong");
+  ret += check(z.memoryUsage().used == 150*sizeof(VB) && z.dim() == 300, "wrong sizes");
+  return ret;
+}
+
+// The dense products of the columns and the selection of columns
+int testColumnOperations()
+{
+  typedef Dune::FieldVector<double,2> VB;
+  typedef Dune::MultiBlockVector<VB> MultiVector;
+  int ret = 0;
+
+  MultiVector x(40,3), y(40,2);
+  fill(x,1.0);
+  fill(y,0.5);
+  const std::vector<std::vector<double> > products = x.columnProducts(y);
+  Dune::BlockVector<VB> xc, yc;
+  bool same = products.size() == 3 && products[0].size() == 2;
+  for (std::size_t a=0; a<3; ++a)
+    for (std::size_t c=0; c<2; ++c)
+    {
+      x.getColumn(a,xc);
+      y.getColumn(c,yc);
+      same = same && products[a][c] == xc.dot(yc);
+    }
+  ret += check(same, "columnProducts differs from the scalar products of the columns");
+
+  // y += x m, column by column
+  const std::vector<std::vector<double> > m = {{1.0,-2.0},{0.5,0.0},{0.25,3.0}};
+  MultiVector z(y);
+  z.addProduct(x,m);
+  same = true;
+  for (std::size_t c=0; c<2; ++c)
+  {
+    y.getColumn(c,yc);
+    for (std::size_t a=0; a<3; ++a)
+    {
+      x.getColumn(a,xc);
+      yc.axpy(m[a][c],xc);
+    }
+    Dune::BlockVector<VB> zc;
+    z.getColumn(c,zc);
+    zc -= yc;
+    same = same && zc.infinity_norm() == 0.0;
+  }
+  ret += check(same, "addProduct differs from the axpy of the columns");
+
+  MultiVector w(x);
+  w.selectColumns({0,2});
+  Dune::BlockVector<VB> wc;
+  w.getColumn(1,wc);
+  x.getColumn(2,xc);
+  wc -= xc;
+  ret += check(w.columns() == 2 && w.N() == 40 && w(7,0) == x(7,0) && wc.infinity_norm() == 0.0,
+               "selectColumns does not keep the columns");
+  w.selectColumns({});
+  ret += check(w.columns() == 0 && w.dim() == 0, "selectColumns does not remove all columns");
+  return ret;
+}
+
+// MatrixAdapter and the scalar products work with multi-vectors
+int testAdapter()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::MultiBlockVector<Dune::FieldVector<double,1> > MultiVector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<Matrix,MultiVector,MultiVector> op(A);
+  Dune::SeqScalarProduct<MultiVector> sp;
+
+  MultiVector x(A.N(),4), y(A.N(),4), z(A.N(),4);
+  fill(x,1.0);
+  op.apply(x,y);
+  A.mv(x,z);
+  z -= y;
+  ret += check(z.infinity_norm() == 0.0, "MatrixAdapter::apply differs");
+
+  const double d = op.applyDot(x,z,sp);
+  ret += check(std::abs(d - x.dot(y)) <= 1e-12*std::abs(d), "MatrixAdapter::applyDot differs");
+
+  const double norm = sp.norm(y);
+  op.applyscaleadd(-1.0,x,y);
+  ret += check(sp.norm(y) <= 1e-14*norm, "MatrixAdapter::applyscaleadd differs");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testProducts<1>(5);
+    ret += testProducts<2>(3);
+    ret += testProducts<3>(1);
+    ret += testReductions();
+    ret += testColumnOperations();
+    ret += testAdapter();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,233 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Counts the reductions, i.e. the calls of dot(), norm() and startDots()
+template<class X>
+class CountingScalarProduct : public Dune::SeqScalarProduct<X>
+{
+  typedef Dune::SeqScalarProduct<X> Base;
+public:
+  typedef typename Base::field_type field_type;
+  typedef typename Base::real_type real_type;
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    ++reductions;
+    return Base::dot(x,y);
+  }
+
+  virtual real_type norm (const X& x)
+  {
+    ++reductions;
+    return Base::norm(x);
+  }
+
+  virtual void startDots (std::initializer_list<std::pair<const X*,const X*> > pairs,
+                          std::vector<field_type>& dots)
+  {
+    ++reductions;
+    ++pending;
+    dots.resize(pairs.size());
+    std::size_t k = 0;
+    for (const auto& pair : pairs)
+      dots[k++] = Base::dot(*pair.first,*pair.second);
+  }
+
+  virtual void waitDots ()
+  {
+    --pending;
+  }
+
+  int reductions = 0;
+  int pending = 0;
+};
+
+// The pipelined method needs about as many iterations as CG and a single reduction in each
+template<int n>
+int testSolver()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,n,n> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,n> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,40);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> prec(A,1,1.0);
+
+  Vector e(A.N()), b(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0/(1.0 + i%17);
+  A.mv(e,b);
+
+  Dune::InverseOperatorResult resCG, resPipelined;
+  Vector xCG(A.N()), rhs(b);
+  xCG = 0.0;
+  Dune::CGSolver<Vector> cg(op,prec,1e-10,1000,0);
+  cg.apply(xCG,rhs,resCG);
+
+  CountingScalarProduct<Vector> sp;
+  Vector x(A.N());
+  x = 0.0;
+  rhs = b;
+  Dune::PipelinedCGSolver<Vector> pipelined(op,sp,prec,1e-10,1000,0);
+  pipelined.apply(x,rhs,resPipelined);
+
+  ret += check(resPipelined.converged, "the pipelined CG does not converge");
+  ret += check(std::abs(resPipelined.iterations - resCG.iterations) <= 2,
+               "the pipelined CG needs a different number of iterations than CG");
+  ret += check(sp.reductions == resPipelined.iterations + 1 && sp.pending == 0,
+               "the pipelined CG does not use a single reduction per iteration");
+
+  x -= e;
+  xCG -= e;
+  ret += check(x.infinity_norm() <= 10*xCG.infinity_norm() + 1e-12,
+               "the pipelined CG is inaccurate");
+
+  // without convergence, the solver stops after the maximal number of iterations
+  x = 0.0;
+  rhs = b;
+  Dune::PipelinedCGSolver<Vector> limited(op,prec,1e-10,5,0);
+  limited.apply(x,rhs,resPipelined);
+  ret += check(!resPipelined.converged && resPipelined.iterations == 5,
+               "the pipelined CG does not stop at the maximal number of iterations");
+  return ret;
+}
+
+int testComplex()
+{
+  typedef std::complex<double> K;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<K,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::Richardson<Vector,Vector> prec(1.0);
+
+  Vector e(A.N()), b(A.N()), x(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = K(1.0, 0.1*(i%5));
+  A.mv(e,b);
+  x = 0.0;
+  Dune::InverseOperatorResult res;
+  Dune::PipelinedCGSolver<Vector> solver(op,prec,1e-10,1000,0);
+  solver.apply(x,b,res);
+  x -= e;
+  ret += check(res.converged && x.infinity_norm() <= 1e-6, "the complex pipelined CG is wrong");
+  return ret;
+}
+
+// A communication summing up the local values without blocking, on a single process
+struct NonblockingCommunication
+{
+  const std::vector<double>& ownerMask (std::size_t size) const
+  {
+    mask.assign(size,1.0);
+    mask[0] = 0.0;
+    return mask;
+  }
+
+  template<class T>
+  void startSum (T*, int count) const
+  {
+    started += count;
+  }
+
+  void waitSum () const
+  {
+    ++waited;
+  }
+
+  mutable std::vector<double> mask;
+  mutable int started = 0;
+  mutable int waited = 0;
+};
+
+// A communication with blocking dot products only
+struct BlockingCommunication
+{
+  template<class T1, class T2>
+  void dot (const T1& x, const T1& y, T2& result) const
+  {
+    result = x.dot(y);
+    ++calls;
+  }
+
+  mutable int calls = 0;
+};
+
+int testCommunicationDots()
+{
+  typedef Dune::BlockVector<Dune::FieldVector<double,2> > Vector;
+  int ret = 0;
+  Vector x(10), y(10);
+  for (std::size_t i=0; i<x.N(); ++i)
+  {
+    x[i] = 1.0 + i;
+    y[i] = 2.0;
+  }
+  std::vector<double> dots;
+  const std::initializer_list<std::pair<const Vector*,const Vector*> > pairs = {{&x,&y},{&y,&y}};
+
+  NonblockingCommunication nonblocking;
+  Dune::Imp::startCommunicationDots(nonblocking,pairs,dots,0);
+  Dune::Imp::waitCommunicationDots(nonblocking,0);
+  ret += check(nonblocking.started == 2 && nonblocking.waited == 1,
+               "the dot products are not summed up by a single reduction");
+  ret += check(dots.size() == 2 && dots[0] == x.dot(y) - 4.0 && dots[1] == y.dot(y) - 8.0,
+               "the local parts of the dot products are wrong");
+
+  BlockingCommunication blocking;
+  Dune::Imp::startCommunicationDots(blocking,pairs,dots,0);
+  Dune::Imp::waitCommunicationDots(blocking,0);
+  ret += check(blocking.calls == 2 && dots[0] == x.dot(y) && dots[1] == y.dot(y),
+               "the blocking dot products are wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testSolver<1>();
+    ret += testSolver<2>();
+    ret += testComplex();
+    ret += testCommunicationDots();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,173 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/threadexecutor.hh>
+
+#include "laplacian.hh"
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,2,2> > Matrix;
+typedef Dune::BlockVector<Dune::FieldVector<double,2> > Vector;
+
+// Compare pattern and values of two matrices
+bool sameMatrix(const Matrix& A, const Matrix& B)
+{
+  if (A.N()!=B.N() || A.M()!=B.M() || A.nonzeroes()!=B.nonzeroes())
+    return false;
+  for (Matrix::size_type i=0; i<A.N(); ++i)
+  {
+    if (A[i].getsize()!=B[i].getsize())
+      return false;
+    for (Matrix::size_type k=0; k<A[i].getsize(); ++k)
+      if (A[i].getindexptr()[k]!=B[i].getindexptr()[k] || A[i].getptr()[k]!=B[i].getptr()[k])
+        return false;
+  }
+  return true;
+}
+
+int checkPlaced(const Matrix& A, const Matrix& ref, const Dune::ThreadExecutor& exec, const char* what)
+{
+  int ret = 0;
+  if (A.placement() != Dune::nnzBalancedPartition(A,exec.threads()))
+  {
+    std::cerr << "Error: wrong placement partition after " << what << std::endl;
+    ++ret;
+  }
+  if (!sameMatrix(A,ref))
+  {
+    std::cerr << "Error: placement changed the matrix after " << what << std::endl;
+    ++ret;
+  }
+
+  Vector x(A.M(),A.placement(),exec), y(A.N()), yref(A.N());
+  for (Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+  ref.mv(x,yref);
+  A.mv(x,y,exec);
+  for (Vector::size_type i=0; i<y.N(); ++i)
+    if (y[i]!=yref[i])
+    {
+      std::cerr << "Error: product of the placed matrix is wrong after " << what << std::endl;
+      ++ret;
+      break;
+    }
+  return ret;
+}
+
+// setupLaplacian with the random and implicit build modes
+void setupRandom(Matrix& A, int N)
+{
+  Matrix ref;
+  setupLaplacian(ref,N);
+  A.setBuildMode(Matrix::random);
+  A.setSize(ref.N(),ref.M());
+  for (Matrix::size_type i=0; i<ref.N(); ++i)
+    A.setrowsize(i,ref[i].getsize());
+  A.endrowsizes();
+  for (auto row = ref.begin(); row != ref.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      A.addindex(row.index(),col.index());
+  A.endindices();
+  for (auto row = ref.begin(); row != ref.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      A[row.index()][col.index()] = *col;
+}
+
+void setupImplicit(Matrix& A, int N)
+{
+  Matrix ref;
+  setupLaplacian(ref,N);
+  A.setBuildMode(Matrix::implicit);
+  A.setImplicitBuildModeParameters(5,0.1);
+  A.setSize(ref.N(),ref.M());
+  for (auto row = ref.begin(); row != ref.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      A.entry(row.index(),col.index()) = *col;
+  A.compress();
+}
+
+int main()
+{
+  const int N = 12;
+  int ret = 0;
+  try {
+    Dune::ThreadExecutor exec(3,1);
+    Matrix ref;
+    setupLaplacian(ref,N);
+
+    {
+      Matrix A;
+      A.setPlacement(exec);
+      setupLaplacian(A,N);
+      ret += checkPlaced(A,ref,exec,"row-wise build");
+
+      // copies inherit the placement, assigning an unplaced matrix drops it
+      Matrix B(A);
+      ret += checkPlaced(B,ref,exec,"copy construction");
+      Matrix C;
+      C = A;
+      ret += checkPlaced(C,ref,exec,"assignment");
+      C = ref;
+      if (C.placement().chunks()!=0 || !sameMatrix(C,ref))
+      {
+        std::cerr << "Error: assignment of an unplaced matrix keeps the placement" << std::endl;
+        ++ret;
+      }
+    }
+    {
+      Matrix A;
+      setupRandom(A,N);
+      if (A.placement().chunks()!=0)
+      {
+        std::cerr << "Error: matrix is placed without request" << std::endl;
+        ++ret;
+      }
+      A.setPlacement(exec);
+      ret += checkPlaced(A,ref,exec,"placing a built matrix");
+    }
+    {
+      Matrix A;
+      A.setPlacement(exec);
+      setupImplicit(A,N);
+      ret += checkPlaced(A,ref,exec,"implicit build");
+    }
+    {
+      const Dune::RowPartition partition = Dune::nnzBalancedPartition(ref,exec.threads());
+      Vector x(ref.N(),partition,exec);
+      for (Vector::size_type i=0; i<x.N(); ++i)
+        x[i] = i;
+      Vector y(x);
+      Vector z;
+      z = x;
+      if (y.placement()!=partition || z.placement()!=partition)
+      {
+        std::cerr << "Error: copies of a BlockVector lose the placement" << std::endl;
+        ++ret;
+      }
+      for (Vector::size_type i=0; i<x.N(); ++i)
+        if (y[i]!=x[i] || z[i]!=x[i])
+        {
+          std::cerr << "Error: copies of a placed BlockVector are wrong" << std::endl;
+          ++ret;
+          break;
+        }
+      y.reserve(2*x.N());
+      if (y.placement().chunks()!=0 || y[x.N()-1]!=x[x.N()-1])
+      {
+        std::cerr << "Error: reserve does not drop the placement" << std::endl;
+        ++ret;
+      }
+    }
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,191 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+// A diffusion operator with a slowly changing reaction term
+void shift (Matrix& A, double sigma)
+{
+  for (auto row = A.begin(); row != A.end(); ++row)
+    (*row)[row.index()] += sigma;
+}
+
+void fill (Vector& e, int t)
+{
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = std::sin(0.01*i*(1.0 + 0.1*t)) + 1.0/(1.0 + (i+t)%17);
+}
+
+// The recycled space saves iterations on a sequence of slowly changing systems
+int testSequence()
+{
+  int ret = 0;
+  Matrix A;
+  setupLaplacian(A,40);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> prec(A,1,1.0);
+  Dune::RecyclingCGSolver<Vector> recycling(op,prec,1e-8,1000,0,12,36);
+  Dune::CGSolver<Vector> cg(op,prec,1e-8,1000,0);
+
+  int iterationsCG = 0, iterationsRecycling = 0;
+  double sigma = 0;
+  bool accurate = true;
+  for (int t=0; t<10; ++t)
+  {
+    const double sigmaNew = 0.01*(1.0 + 0.3*std::sin(0.5*t));
+    shift(A,sigmaNew - sigma);
+    sigma = sigmaNew;
+    if (t>0)
+      recycling.updateOperator();
+
+    Vector e(A.N()), b(A.N()), x(A.N()), rhs(A.N());
+    fill(e,t);
+    A.mv(e,b);
+    Dune::InverseOperatorResult resCG, res;
+    x = 0.0;
+    rhs = b;
+    cg.apply(x,rhs,resCG);
+    x = 0.0;
+    rhs = b;
+    recycling.apply(x,rhs,res);
+    accurate = accurate && res.converged;
+
+    rhs = b;
+    A.mmv(x,rhs);
+    accurate = accurate && rhs.two_norm() <= 1e-7*b.two_norm();
+    iterationsCG += resCG.iterations;
+    iterationsRecycling += res.iterations;
+    if (t==0)
+      ret += check(std::abs(res.iterations - resCG.iterations) <= 1,
+                   "the first solve differs from CG");
+  }
+  ret += check(accurate, "the recycling CG is inaccurate");
+  ret += check(recycling.recycledDimension() == 12, "the deflation space has a wrong dimension");
+  ret += check(iterationsRecycling < 0.75*iterationsCG,
+               "the recycling CG does not save iterations");
+
+  // a changed matrix with a new preconditioner
+  shift(A,0.05);
+  Vector e(A.N()), b(A.N()), x(A.N()), rhs(A.N());
+  fill(e,11);
+  A.mv(e,b);
+  Dune::InverseOperatorResult res;
+
+  Dune::SeqILU0<Matrix,Vector,Vector> ilu(A,1.0);
+  recycling.updateOperator(op,ilu);
+  x = 0.0;
+  rhs = b;
+  recycling.apply(x,rhs,res);
+  x -= e;
+  ret += check(res.converged && x.infinity_norm() <= 1e-5,
+               "the recycling CG is wrong with a new preconditioner");
+
+  recycling.clearDeflationSpace();
+  ret += check(recycling.recycledDimension() == 0, "the deflation space is not cleared");
+  return ret;
+}
+
+// Solving the same system again profits from the deflation space
+int testProjection()
+{
+  int ret = 0;
+  Matrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::Richardson<Vector,Vector> prec(1.0);
+  Dune::RecyclingCGSolver<Vector> solver(op,prec,1e-8,1000,0,4);
+
+  Vector e(A.N()), b(A.N()), x(A.N()), rhs(A.N());
+  fill(e,0);
+  A.mv(e,b);
+  Dune::InverseOperatorResult res;
+  x = 0.0;
+  rhs = b;
+  solver.apply(x,rhs,res);
+
+  const int first = res.iterations;
+  x = 0.0;
+  rhs = b;
+  solver.apply(x,rhs,res);
+  ret += check(res.converged && res.iterations < first,
+               "the second solve for the same right-hand side is not faster");
+
+  // a zero defect is not iterated and keeps the deflation space
+  x = 0.0;
+  rhs = 0.0;
+  solver.apply(x,rhs,res);
+  ret += check(res.converged && res.iterations == 0 && x.infinity_norm() == 0.0
+               && solver.recycledDimension() == 4, "a zero right-hand side is iterated");
+  return ret;
+}
+
+int testComplex()
+{
+  typedef std::complex<double> K;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > ComplexMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<K,1> > ComplexVector;
+  int ret = 0;
+
+  ComplexMatrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<ComplexMatrix,ComplexVector,ComplexVector> op(A);
+  Dune::Richardson<ComplexVector,ComplexVector> prec(1.0);
+  Dune::RecyclingCGSolver<ComplexVector> solver(op,prec,1e-10,1000,0,4);
+
+  bool accurate = true;
+  for (int t=0; t<3; ++t)
+  {
+    ComplexVector e(A.N()), b(A.N()), x(A.N());
+    for (std::size_t i=0; i<e.N(); ++i)
+      e[i] = K(1.0 + 0.1*t, 0.1*((i+t)%5));
+    A.mv(e,b);
+    x = 0.0;
+    Dune::InverseOperatorResult res;
+    solver.apply(x,b,res);
+    x -= e;
+    accurate = accurate && res.converged && x.infinity_norm() <= 1e-6;
+  }
+  ret += check(accurate, "the complex recycling CG is wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testSequence();
+    ret += testProjection();
+    ret += testComplex();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,177 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// A nonsymmetric system, the Laplacian with an upwind convection term
+template<class Matrix>
+void setupConvection (Matrix& A, int N, double convection)
+{
+  typedef typename Matrix::field_type K;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      if (col.index()+1 == row.index())
+        *col -= K(convection);
+      else if (col.index() == row.index())
+        *col += K(convection);
+}
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+// A slowly changing reaction term
+void shift (Matrix& A, double sigma)
+{
+  for (auto row = A.begin(); row != A.end(); ++row)
+    (*row)[row.index()] += sigma;
+}
+
+void fill (Vector& e, int t)
+{
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = std::sin(0.01*i*(1.0 + 0.1*t)) + 1.0/(1.0 + (i+t)%17);
+}
+
+// The recycled space saves iterations on a sequence of slowly changing systems
+int testSequence()
+{
+  int ret = 0;
+  Matrix A;
+  setupConvection(A,40,0.5);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> prec(A,1,1.0);
+  Dune::RecyclingGMResSolver<Vector> recycling(op,prec,1e-8,30,2000,0,10);
+  Dune::RestartedGMResSolver<Vector> gmres(op,prec,1e-8,30,2000,0);
+
+  int iterationsGMRes = 0, iterationsRecycling = 0;
+  double sigma = 0;
+  bool accurate = true;
+  for (int t=0; t<10; ++t)
+  {
+    const double sigmaNew = 0.01*(1.0 + 0.3*std::sin(0.5*t));
+    shift(A,sigmaNew - sigma);
+    sigma = sigmaNew;
+    if (t>0)
+      recycling.updateOperator();
+
+    Vector e(A.N()), b(A.N()), x(A.N()), rhs(A.N());
+    fill(e,t);
+    A.mv(e,b);
+    Dune::InverseOperatorResult resGMRes, res;
+    x = 0.0;
+    rhs = b;
+    gmres.apply(x,rhs,resGMRes);
+    x = 0.0;
+    rhs = b;
+    recycling.apply(x,rhs,res);
+    accurate = accurate && res.converged;
+
+    rhs = b;
+    A.mmv(x,rhs);
+    accurate = accurate && rhs.two_norm() <= 1e-6*b.two_norm();
+    iterationsGMRes += resGMRes.iterations;
+    iterationsRecycling += res.iterations;
+  }
+  ret += check(accurate, "the recycling GMRes is inaccurate");
+  ret += check(recycling.recycledDimension() == 10, "the recycled space has a wrong dimension");
+  ret += check(iterationsRecycling < 0.8*iterationsGMRes,
+               "the recycling GMRes does not save iterations");
+
+  // a changed matrix with a new preconditioner
+  shift(A,0.05);
+  Vector e(A.N()), b(A.N()), x(A.N()), rhs(A.N());
+  fill(e,11);
+  A.mv(e,b);
+  Dune::InverseOperatorResult res;
+
+  Dune::SeqILU0<Matrix,Vector,Vector> ilu(A,1.0);
+  recycling.updateOperator(op,ilu);
+  x = 0.0;
+  rhs = b;
+  recycling.apply(x,rhs,res);
+  x -= e;
+  ret += check(res.converged && x.infinity_norm() <= 1e-5,
+               "the recycling GMRes is wrong with a new preconditioner");
+
+  // without convergence, the solver stops after the maximal number of iterations
+  Dune::RecyclingGMResSolver<Vector> limited(op,ilu,1e-12,8,25,0,3);
+  x = 0.0;
+  rhs = b;
+  limited.apply(x,rhs,res);
+  ret += check(!res.converged && res.iterations == 25 && res.reduction < 1.0,
+               "the recycling GMRes does not stop at the maximal number of iterations");
+
+  recycling.clearDeflationSpace();
+  ret += check(recycling.recycledDimension() == 0, "the recycled space is not cleared");
+  return ret;
+}
+
+int testComplex()
+{
+  typedef std::complex<double> K;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > ComplexMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<K,1> > ComplexVector;
+  int ret = 0;
+
+  ComplexMatrix A;
+  setupConvection(A,20,1.0);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    (*row)[row.index()] += K(0.0,0.1);
+  Dune::MatrixAdapter<ComplexMatrix,ComplexVector,ComplexVector> op(A);
+  Dune::Richardson<ComplexVector,ComplexVector> prec(1.0);
+  Dune::RecyclingGMResSolver<ComplexVector> solver(op,prec,1e-10,20,2000,0,5);
+
+  bool accurate = true;
+  for (int t=0; t<3; ++t)
+  {
+    ComplexVector e(A.N()), b(A.N()), x(A.N());
+    for (std::size_t i=0; i<e.N(); ++i)
+      e[i] = K(1.0 + 0.1*t, 0.1*((i+t)%5));
+    A.mv(e,b);
+    x = 0.0;
+    Dune::InverseOperatorResult res;
+    solver.apply(x,b,res);
+    x -= e;
+    accurate = accurate && res.converged && x.infinity_norm() <= 1e-6;
+  }
+  ret += check(accurate && solver.recycledDimension() == 5, "the complex recycling GMRes is wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testSequence();
+    ret += testComplex();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
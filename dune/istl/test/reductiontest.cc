@@ -0,0 +1,164 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <limits>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Values of very different magnitude, so that the order of the sums matters
+template<class V>
+void fill (V& v, double offset)
+{
+  double t = offset;
+  Dune::fusedForEach([&t](typename V::field_type& vk) {
+      t += 0.37;
+      vk = std::pow(10.0, std::fmod(7*t,12.0) - 6.0) * (std::fmod(t,1.0) < 0.5 ? 1.0 : -1.0);
+    }, v);
+}
+
+// The results have to be the same for all numbers of threads
+template<class V>
+int testReproducible(std::size_t n, Dune::Summation summation)
+{
+  int ret = 0;
+  V x(n), y(n);
+  fill(x,0.1);
+  fill(y,0.2);
+
+  const Dune::ThreadExecutor serial;
+  const auto dot = x.dot(y,serial,summation);
+  const auto two = x.two_norm2(serial,summation);
+  const auto one = x.one_norm(serial,summation);
+  for (std::size_t threads : {2, 3, 7, 16})
+  {
+    const Dune::ThreadExecutor exec(threads,1);
+    ret += check(x.dot(y,exec,summation) == dot, "the threaded dot product is not reproducible");
+    ret += check(x.two_norm2(exec,summation) == two, "the threaded two_norm2 is not reproducible");
+    ret += check(x.one_norm(exec,summation) == one, "the threaded one_norm is not reproducible");
+    ret += check(x.infinity_norm(exec) == x.infinity_norm(), "the threaded infinity_norm differs");
+  }
+
+  // the threaded results are only rounded differently than the serial ones
+  using std::abs;
+  ret += check(abs(dot - x.dot(y)) <= 1e-12*abs(x.two_norm()*y.two_norm()),
+               "the threaded dot product is wrong");
+  ret += check(abs(two - x.two_norm2()) <= 1e-12*two, "the threaded two_norm2 is wrong");
+  ret += check(abs(one - x.one_norm()) <= 1e-12*one, "the threaded one_norm is wrong");
+  ret += check(x.two_norm(serial,summation) == std::sqrt(two), "the threaded two_norm is wrong");
+  return ret;
+}
+
+// An ill-conditioned sum, which only the compensated summation gets right
+int testKahan()
+{
+  int ret = 0;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  const std::size_t n = 10000;
+  Vector y(n), z(n);
+  y = 1.0;
+  for (std::size_t i=0; i<n; ++i)
+    z[i] = (i%3 == 0) ? 1.0 : 1e-16;
+
+  const Dune::ThreadExecutor exec(4,1);
+  const double exact = (n/3 + 1)*1.0 + (n - n/3 - 1)*1e-16;
+  const double kahan = z.dot(y,exec,Dune::Summation::kahan);
+  ret += check(std::abs(kahan - exact) <= std::abs(z.dot(y,exec) - exact),
+               "the compensated sum is less accurate");
+  ret += check(std::abs(kahan - exact) <= 1e-15*exact, "the compensated sum is inaccurate");
+  return ret;
+}
+
+int testNaN()
+{
+  int ret = 0;
+  typedef Dune::BlockVector<Dune::FieldVector<double,2> > Vector;
+  Vector x(10000);
+  x = 1.0;
+  x[7777][1] = std::numeric_limits<double>::quiet_NaN();
+  const double norm = x.infinity_norm(Dune::ThreadExecutor(4,1));
+  ret += check(norm != norm, "the threaded infinity_norm drops a NaN");
+  return ret;
+}
+
+// A solver with threaded reductions finds the same iterates for all numbers of threads
+int testSolver()
+{
+  int ret = 0;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  Matrix A;
+  setupLaplacian(A,60);
+  Dune::Richardson<Vector,Vector> prec(1.0);
+
+  Vector e(A.N()), b(A.N());
+  fill(e,1.0);
+  A.mv(e,b);
+
+  // the operator uses the threads, too
+  auto solve = [&](std::size_t threads) {
+    const Dune::ThreadExecutor exec(threads,1);
+    Dune::MatrixAdapter<Matrix,Vector,Vector> op(A,exec);
+    Dune::SeqScalarProduct<Vector> sp(exec,Dune::Summation::kahan);
+    Dune::CGSolver<Vector> cg(op,sp,prec,1e-8,1000,0);
+    Dune::InverseOperatorResult r;
+    Vector x(A.N()), rhs(b);
+    x = 0.0;
+    cg.apply(x,rhs,r);
+    ret += check(r.converged, "CG with threaded reductions does not converge");
+    return x;
+  };
+
+  const Vector x = solve(1);
+  for (std::size_t threads : {3, 8})
+  {
+    Vector y = solve(threads);
+    y -= x;
+    ret += check(y.infinity_norm() == 0.0, "CG with threaded reductions is not reproducible");
+  }
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    for (Dune::Summation s : {Dune::Summation::plain, Dune::Summation::kahan})
+    {
+      ret += testReproducible<Dune::BlockVector<Dune::FieldVector<double,1> > >(100003,s);
+      ret += testReproducible<Dune::BlockVector<Dune::FieldVector<double,3> > >(5000,s);
+      ret += testReproducible<Dune::BlockVector<Dune::FieldVector<std::complex<double>,2> > >(3001,s);
+      ret += testReproducible<Dune::BlockVector<Dune::FieldVector<double,1> > >(77,s);
+    }
+    ret += testKahan();
+    ret += testNaN();
+    ret += testSolver();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,193 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/reordering.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+// A fixed pseudo-random permutation of n indices
+std::vector<std::size_t> shuffled(std::size_t n)
+{
+  std::vector<std::size_t> perm(n);
+  for (std::size_t k=0; k<n; ++k)
+    perm[k] = k;
+  std::size_t seed = 12345;
+  for (std::size_t k=n; k>1; --k)
+  {
+    seed = (seed*1103515245 + 12345) % 2147483648u;
+    std::swap(perm[k-1], perm[seed % k]);
+  }
+  return perm;
+}
+
+template<int BS>
+int testReordering(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  int ret = 0;
+  Matrix L, A, R;
+  setupLaplacian(L,N);
+  for (auto row = L.begin(); row != L.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      (*col)[0][BS-1] += 1e-2*((row.index()*3 + col.index()*5) % 7);
+
+  // destroy the locality of the grid numbering, then restore it
+  Dune::permuteMatrix(A,L,shuffled(L.N()));
+  const std::vector<std::size_t> perm = Dune::reverseCuthillMcKee(A);
+  Dune::permuteMatrix(R,A,perm);
+
+  if (Dune::inversePermutation(perm).size() != A.N() || R.nonzeroes() != A.nonzeroes())
+  {
+    std::cerr << "Error: wrong size of the reordering" << std::endl;
+    ++ret;
+  }
+  if (Dune::bandwidth(R) > std::size_t(2*N) || Dune::bandwidth(A) <= std::size_t(2*N))
+  {
+    std::cerr << "Error: bandwidth " << Dune::bandwidth(R) << " after reordering is too large" << std::endl;
+    ++ret;
+  }
+
+  // (P A P^T) (P x) = P (A x)
+  Vector x(A.M()), px(A.M()), y(A.N()), py(A.N()), z(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    for (int k=0; k<BS; ++k)
+      x[i][k] = 1.0/(i+k+1.0);
+  A.mv(x,y);
+  Dune::permuteVector(px,x,perm);
+  R.mv(px,py);
+  Dune::unpermuteVector(z,py,perm);
+  z -= y;
+  if (z.infinity_norm() > 1e-13*y.infinity_norm())
+  {
+    std::cerr << "Error: the permuted matrix does not match the permuted vectors" << std::endl;
+    ++ret;
+  }
+
+  Dune::ThreadExecutor exec(3,1);
+  Dune::permuteVector(py,y,perm,exec);
+  Dune::unpermuteVector(z,py,perm,exec);
+  z -= y;
+  if (z.infinity_norm() != 0.0)
+  {
+    std::cerr << "Error: threaded unpermuteVector is not the inverse of permuteVector" << std::endl;
+    ++ret;
+  }
+
+  return ret;
+}
+
+int testComponentsAndErrors()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  int ret = 0;
+
+  // two disconnected chains 0-2-4 and 1-3 and the isolated row 5
+  Matrix A(6,6,Matrix::random);
+  const std::vector<std::vector<std::size_t> > neighbours = {{0,2},{1,3},{0,2,4},{1,3},{2,4},{5}};
+  for (std::size_t i=0; i<6; ++i)
+    A.setrowsize(i,neighbours[i].size());
+  A.endrowsizes();
+  for (std::size_t i=0; i<6; ++i)
+    for (std::size_t j : neighbours[i])
+      A.addindex(i,j);
+  A.endindices();
+  A = 1.0;
+
+  std::vector<std::size_t> perm = Dune::reverseCuthillMcKee(A);
+  std::vector<std::size_t> sorted(perm);
+  std::sort(sorted.begin(), sorted.end());
+  for (std::size_t k=0; k<6; ++k)
+    if (sorted[k] != k)
+    {
+      std::cerr << "Error: reverseCuthillMcKee does not number every row once" << std::endl;
+      return 1;
+    }
+  Matrix R;
+  Dune::permuteMatrix(R,A,perm);
+  if (Dune::bandwidth(R) != 1)
+  {
+    std::cerr << "Error: the chains are not numbered consecutively" << std::endl;
+    ++ret;
+  }
+
+  perm[1] = perm[0];
+  bool thrown = false;
+  try {
+    Dune::permuteMatrix(R,A,perm);
+  }
+  catch (Dune::ISTLError&) {
+    thrown = true;
+  }
+  if (!thrown)
+  {
+    std::cerr << "Error: an invalid permutation was accepted" << std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int testSolver(int N)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix L, A, R;
+  setupLaplacian(L,N);
+  Dune::permuteMatrix(A,L,shuffled(L.N()));
+  const std::vector<std::size_t> perm = Dune::reverseCuthillMcKee(A);
+  Dune::permuteMatrix(R,A,perm);
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(R);
+  Dune::SeqILU0<Matrix,Vector,Vector> ilu(R,1.0);
+  Dune::CGSolver<Vector> cg(op,ilu,1e-10,500,0);
+  // the operator keeps its own copy of a temporary permutation
+  Dune::ReorderedInverseOperator<Vector> solver(cg,Dune::reverseCuthillMcKee(A));
+
+  // solve A x = b for a known solution in the original numbering
+  Vector x(A.N()), b(A.N()), e(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0 + 0.1*(i%5);
+  A.mv(e,b);
+  x = 0.0;
+  Dune::InverseOperatorResult r;
+  solver.apply(x,b,r);
+  x -= e;
+  if (!r.converged || x.two_norm() > 1e-6*e.two_norm())
+  {
+    std::cerr << "Error: the reordered solver gives a wrong solution" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testReordering<1>(20);
+    ret += testReordering<2>(12);
+    ret += testComponentsAndErrors();
+    ret += testSolver(20);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,154 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/sellcsigmamatrix.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+template<class Vector>
+int compare(const Vector& a, const Vector& b, const char* what)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > 1e-12*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " differs from the BCRSMatrix result" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Compare the products with those of the original matrix for chunk
+// sizes that do and do not divide the number of rows.
+template<int BS, int C>
+int testProducts(int N, std::size_t sigma, std::size_t threads)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::SellCSigmaMatrix<MatrixBlock,C> SellMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      *col *= 1.0 + 1e-3*((row.index()*7 + col.index()*13) % 17);
+
+  SellMatrix S(A,sigma);
+  int ret = 0;
+  if (S.N()!=A.N() || S.M()!=A.M() || S.nonzeroes()!=A.nonzeroes()
+      || S.storedBlocks()<A.nonzeroes() || S.storedBlocks()%C!=0)
+  {
+    std::cerr << "Error: wrong sizes of SellCSigmaMatrix" << std::endl;
+    ++ret;
+  }
+
+  Vector x(A.M()), ya(A.N()), ys(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+
+  Dune::ThreadExecutor exec(threads,1);
+
+  A.mv(x,ya);
+  S.mv(x,ys);
+  ret += compare(ya,ys,"mv");
+  S.mv(x,ys,exec);
+  ret += compare(ya,ys,"threaded mv");
+
+  A.umv(x,ya);
+  S.umv(x,ys);
+  ret += compare(ya,ys,"umv");
+
+  A.mmv(x,ya);
+  S.mmv(x,ys);
+  ret += compare(ya,ys,"mmv");
+
+  A.usmv(0.3,x,ya);
+  S.usmv(0.3,x,ys,exec);
+  ret += compare(ya,ys,"threaded usmv");
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> opA(A);
+  Dune::MatrixAdapter<SellMatrix,Vector,Vector> opS(S,exec);
+  opA.applyscaleadd(-2.0,x,ya);
+  opS.applyscaleadd(-2.0,x,ys);
+  ret += compare(ya,ys,"MatrixAdapter::applyscaleadd");
+
+  return ret;
+}
+
+// Solve with the SELL-C-sigma matrix as operator and a preconditioner
+// working on the original matrix.
+int testSolvers(int N)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::SellCSigmaMatrix<MatrixBlock> SellMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  SellMatrix S(A);
+
+  Dune::MatrixAdapter<SellMatrix,Vector,Vector> op(S);
+  Dune::SeqJac<Matrix,Vector,Vector> jac(A,1,1.0);
+
+  int ret = 0;
+  {
+    Vector x(A.N()), b(A.N());
+    x = 1.0;
+    b = 0.0;
+    Dune::InverseOperatorResult r;
+    Dune::CGSolver<Vector> solver(op,jac,1e-8,500,0);
+    solver.apply(x,b,r);
+    if (!r.converged)
+    {
+      std::cerr << "Error: CGSolver did not converge with SellCSigmaMatrix" << std::endl;
+      ++ret;
+    }
+  }
+  {
+    Vector x(A.N()), b(A.N());
+    x = 1.0;
+    b = 0.0;
+    Dune::InverseOperatorResult r;
+    Dune::BiCGSTABSolver<Vector> solver(op,jac,1e-8,500,0);
+    solver.apply(x,b,r);
+    if (!r.converged)
+    {
+      std::cerr << "Error: BiCGSTABSolver did not converge with SellCSigmaMatrix" << std::endl;
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    for (std::size_t threads : {1, 3})
+    {
+      ret += testProducts<1,8>(13,1,threads);
+      ret += testProducts<1,8>(13,64,threads);
+      ret += testProducts<1,4>(20,16,threads);
+      ret += testProducts<2,4>(9,8,threads);
+    }
+    ret += testSolvers(20);
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
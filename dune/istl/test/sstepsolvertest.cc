@@ -0,0 +1,279 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/scalarproducts.hh>
+#include <dune/istl/solvers.hh>
+
+#include "laplacian.hh"
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Counts the reductions, i.e. the calls of dot(), norm() and multiDot()
+template<class X>
+class CountingScalarProduct : public Dune::SeqScalarProduct<X>
+{
+  typedef Dune::SeqScalarProduct<X> Base;
+public:
+  typedef typename Base::field_type field_type;
+  typedef typename Base::real_type real_type;
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    ++reductions;
+    return Base::dot(x,y);
+  }
+
+  virtual real_type norm (const X& x)
+  {
+    ++reductions;
+    return Base::norm(x);
+  }
+
+  virtual void multiDot (const std::vector<std::pair<const X*,const X*> >& pairs,
+                         std::vector<field_type>& dots)
+  {
+    ++reductions;
+    dots.resize(pairs.size());
+    for (std::size_t k=0; k<pairs.size(); ++k)
+      dots[k] = Base::dot(*pairs[k].first,*pairs[k].second);
+  }
+
+  int reductions = 0;
+};
+
+template<class Vector>
+void fill (Vector& e)
+{
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = 1.0/(1.0 + i%17);
+}
+
+int testShifts()
+{
+  int ret = 0;
+  const std::vector<double> shifts = Dune::newtonShifts(0.5,4.0,6);
+  bool inside = shifts.size() == 6;
+  for (double shift : shifts)
+    inside = inside && shift > 0.5 && shift < 4.0;
+  ret += check(inside, "the shifts are not in the interval");
+  ret += check(shifts[0] > 3.9 && shifts[1] < 0.6,
+               "the shifts are not in the Leja ordering");
+  return ret;
+}
+
+// s-step CG finds the solution of CG, with one reduction per s steps
+int testCG()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,30);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqSSOR<Matrix,Vector,Vector> prec(A,1,1.0);
+
+  Vector e(A.N()), b(A.N());
+  fill(e);
+  A.mv(e,b);
+
+  Dune::InverseOperatorResult resCG;
+  Vector xCG(A.N()), rhs(b);
+  xCG = 0.0;
+  Dune::CGSolver<Vector> cg(op,prec,1e-10,1000,0);
+  cg.apply(xCG,rhs,resCG);
+  xCG -= e;
+
+  // the spectrum of the SSOR-preconditioned Laplacian is in (0,1]
+  const std::vector<double> shifts = Dune::newtonShifts(0.0,1.0,7);
+  for (int s : {1, 3, 8})
+  {
+    CountingScalarProduct<Vector> sp;
+    Dune::InverseOperatorResult res;
+    Vector x(A.N());
+    x = 0.0;
+    rhs = b;
+    Dune::SStepCGSolver<Vector> solver(op,sp,prec,1e-10,1000,0,s,
+                                       s>4 ? shifts : std::vector<double>());
+    solver.apply(x,rhs,res);
+    x -= e;
+    ret += check(res.converged, "s-step CG does not converge");
+    ret += check(res.iterations <= resCG.iterations + 2*s,
+                 "s-step CG needs many more iterations than CG");
+    ret += check(x.infinity_norm() <= 10*xCG.infinity_norm() + 1e-12, "s-step CG is inaccurate");
+    ret += check(sp.reductions <= (res.iterations + s - 1)/s + 2,
+                 "s-step CG does more than one reduction per outer iteration");
+    if (s==1)
+      ret += check(std::abs(res.iterations - resCG.iterations) <= 1,
+                   "s-step CG with s=1 differs from CG");
+  }
+
+  // without convergence, the solver stops after the maximal number of iterations
+  Dune::InverseOperatorResult res;
+  Vector x(A.N());
+  x = 0.0;
+  rhs = b;
+  Dune::SStepCGSolver<Vector> limited(op,prec,1e-10,10,0,4);
+  limited.apply(x,rhs,res);
+  ret += check(!res.converged && res.iterations == 10,
+               "s-step CG does not stop at the maximal number of iterations");
+  return ret;
+}
+
+int testComplexCG()
+{
+  typedef std::complex<double> K;
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<K,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<K,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupLaplacian(A,20);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::Richardson<Vector,Vector> prec(1.0);
+
+  Vector e(A.N()), b(A.N()), x(A.N());
+  for (std::size_t i=0; i<e.N(); ++i)
+    e[i] = K(1.0, 0.1*(i%5));
+  A.mv(e,b);
+  x = 0.0;
+  Dune::InverseOperatorResult res;
+  Dune::SStepCGSolver<Vector> solver(op,prec,1e-10,1000,0,3);
+  solver.apply(x,b,res);
+  x -= e;
+  ret += check(res.converged && x.infinity_norm() <= 1e-6, "the complex s-step CG is wrong");
+  return ret;
+}
+
+// A nonsymmetric system, the Laplacian with an upwind convection term
+template<class Matrix>
+void setupConvection (Matrix& A, int N)
+{
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      if (col.index()+1 == row.index())
+        *col -= 1.0;
+      else if (col.index() == row.index())
+        *col += 1.0;
+}
+
+// s-step GMRes converges like GMRes, with one reduction per cycle
+int testGMRes()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupConvection(A,20);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqILU0<Matrix,Vector,Vector> prec(A,1.0);
+
+  Vector e(A.N()), b(A.N());
+  fill(e);
+  A.mv(e,b);
+
+  const std::vector<double> shifts = Dune::newtonShifts(0.0,2.0,10);
+  for (int s : {1, 4, 10})
+  {
+    CountingScalarProduct<Vector> sp;
+    Dune::InverseOperatorResult res;
+    Vector x(A.N()), rhs(b);
+    x = 0.0;
+    Dune::SStepGMResSolver<Vector> solver(op,sp,prec,1e-10,s,2000,0,
+                                          s>4 ? shifts : std::vector<double>());
+    solver.apply(x,rhs,res);
+    ret += check(res.converged, "s-step GMRes does not converge");
+
+    rhs = b;
+    A.mmv(x,rhs);
+    ret += check(rhs.two_norm() <= 1e-8*b.two_norm(), "s-step GMRes is inaccurate");
+    ret += check(sp.reductions <= (res.iterations + s - 1)/s + 1,
+                 "s-step GMRes does more than one reduction per cycle");
+
+    // GMRes with the same restart length
+    Dune::InverseOperatorResult resGMRes;
+    Vector y(A.N());
+    y = 0.0;
+    rhs = b;
+    Dune::RestartedGMResSolver<Vector> gmres(op,prec,1e-10,s,2000,0);
+    gmres.apply(y,rhs,resGMRes);
+    ret += check(res.iterations <= resGMRes.iterations + 2*s,
+                 "s-step GMRes needs many more iterations than GMRes");
+  }
+  return ret;
+}
+
+// The reported reduction is the one of the preconditioned defect b - Ax,
+// even with the ill conditioned monomial basis of many steps
+int testGMResDefect()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  int ret = 0;
+
+  Matrix A;
+  setupConvection(A,40);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> op(A);
+  Dune::SeqILU0<Matrix,Vector,Vector> prec(A,1.0);
+
+  Vector e(A.N()), b(A.N()), x(A.N()), rhs(b), d(A.N()), w(A.N());
+  fill(e);
+  A.mv(e,b);
+  x = 0.0;
+  rhs = b;
+  Dune::InverseOperatorResult res;
+  Dune::SStepGMResSolver<Vector> solver(op,prec,1e-10,12,2000,0);
+  solver.apply(x,rhs,res);
+
+  d = b;
+  A.mmv(x,d);
+  w = 0.0;
+  prec.apply(w,d);
+  const double defect = w.two_norm();
+  w = 0.0;
+  prec.apply(w,b);
+  const double reduction = defect/w.two_norm();
+  ret += check(res.converged && std::abs(reduction - res.reduction) <= 1e-2*reduction,
+               "s-step GMRes reports a wrong reduction");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testShifts();
+    ret += testCG();
+    ret += testComplexCG();
+    ret += testGMRes();
+    ret += testGMResDefect();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,253 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/symmetricbcrsmatrix.hh>
+
+#include "laplacian.hh"
+
+template<class Vector>
+int compare(const Vector& a, const Vector& b, const char* what, int BS)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > 1e-12*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " differs from the full matrix for block size " << BS << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// The Laplacian with unsymmetric blocks that still form a symmetric matrix
+template<int BS>
+void setupSymmetric(Dune::BCRSMatrix<Dune::FieldMatrix<double,BS,BS> >& A, int N)
+{
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+    {
+      const std::size_t i = std::min(row.index(),col.index());
+      const std::size_t j = std::max(row.index(),col.index());
+      for (int r=0; r<BS; ++r)
+        for (int c=0; c<BS; ++c)
+        {
+          // entry (r,c) of block (i,j), i<=j
+          const int rr = row.index()<=col.index() ? r : c;
+          const int cc = row.index()<=col.index() ? c : r;
+          double v = 0.05*((i*3 + j*5 + rr*7 + cc*11) % 13);
+          if (i==j)
+            v = 0.05*((i*3 + std::min(rr,cc)*7 + std::max(rr,cc)*11) % 13) + (rr==cc ? 4.0*BS : 0.0);
+          else if (rr==cc)
+            v -= 1.0;
+          (*col)[r][c] = v;
+        }
+    }
+}
+
+template<int BS>
+int testSymmetric(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::SymmetricBCRSMatrix<MatrixBlock> SymmetricMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupSymmetric(A,N);
+  SymmetricMatrix S(A);
+
+  int ret = 0;
+  if (S.N()!=A.N() || S.M()!=A.M() || S.nonzeroes()!=(A.nonzeroes()+A.N())/2)
+  {
+    std::cerr << "Error: wrong sizes of SymmetricBCRSMatrix" << std::endl;
+    ++ret;
+  }
+
+  // the expansion gives back the original matrix
+  Matrix F = S.fullMatrix();
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      if (!F.exists(row.index(),col.index()) || F[row.index()][col.index()] != *col)
+      {
+        std::cerr << "Error: fullMatrix differs from the original matrix" << std::endl;
+        ++ret;
+        break;
+      }
+
+  Vector x(A.M()), ya(A.N()), ys(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    for (int k=0; k<BS; ++k)
+      x[i][k] = 1.0/(i+k+1.0);
+
+  A.mv(x,ya);
+  S.mv(x,ys);
+  ret += compare(ya,ys,"mv",BS);
+
+  A.umv(x,ya);
+  S.umv(x,ys);
+  ret += compare(ya,ys,"umv",BS);
+
+  A.mmv(x,ya);
+  S.mmv(x,ys);
+  ret += compare(ya,ys,"mmv",BS);
+
+  A.usmv(0.3,x,ya);
+  S.usmv(0.3,x,ys);
+  ret += compare(ya,ys,"usmv",BS);
+
+  for (std::size_t threads : {2, 3, 7})
+  {
+    Dune::ThreadExecutor exec(threads,1);
+    A.mv(x,ya);
+    S.mv(x,ys,exec);
+    ret += compare(ya,ys,"threaded mv",BS);
+    A.usmv(-0.7,x,ya);
+    S.usmv(-0.7,x,ys,exec);
+    ret += compare(ya,ys,"threaded usmv",BS);
+  }
+
+  // the relaxation steps have to agree with the ones on the full matrix
+  Vector b(A.N()), va(A.N()), vs(A.N());
+  b = 1.0;
+  Dune::SeqSSOR<Matrix,Vector,Vector> ssorA(A,2,1.2);
+  Dune::SeqSSOR<SymmetricMatrix,Vector,Vector> ssorS(S,2,1.2);
+  va = 0.0; vs = 0.0;
+  ssorA.apply(va,b);
+  ssorS.apply(vs,b);
+  ret += compare(va,vs,"SeqSSOR",BS);
+
+  Dune::SeqSOR<Matrix,Vector,Vector> sorA(A,1,0.8);
+  Dune::SeqSOR<SymmetricMatrix,Vector,Vector> sorS(S,1,0.8);
+  va = 0.0; vs = 0.0;
+  sorA.apply(va,b);
+  sorS.apply(vs,b);
+  ret += compare(va,vs,"SeqSOR",BS);
+
+  Dune::SeqGS<Matrix,Vector,Vector> gsA(A,2,0.9);
+  Dune::SeqGS<SymmetricMatrix,Vector,Vector> gsS(S,2,0.9);
+  va = 0.5; vs = 0.5;
+  gsA.apply(va,b);
+  gsS.apply(vs,b);
+  ret += compare(va,vs,"SeqGS",BS);
+
+  Dune::SeqJac<Matrix,Vector,Vector> jacA(A,3,0.7);
+  Dune::SeqJac<SymmetricMatrix,Vector,Vector> jacS(S,3,0.7);
+  va = 0.0; vs = 0.0;
+  jacA.apply(va,b);
+  jacS.apply(vs,b);
+  ret += compare(va,vs,"SeqJac",BS);
+
+  Dune::SeqILU0<Matrix,Vector,Vector> iluA(A,1.0);
+  Dune::SeqILU0<SymmetricMatrix,Vector,Vector> iluS(S,1.0);
+  iluA.apply(va,b);
+  iluS.apply(vs,b);
+  ret += compare(va,vs,"SeqILU0",BS);
+
+  return ret;
+}
+
+// The sweeps have to reject a row that does not store its diagonal block
+template<class Sweep>
+int testMissingDiagonal(Sweep sweep, const char* name)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::SymmetricBCRSMatrix<MatrixBlock> SymmetricMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  // row 1 starts with an off-diagonal block, row 2 is empty
+  const std::vector<std::vector<std::size_t> > patterns[2] = {
+    { {0,1}, {2}, {2} },
+    { {0,1}, {1}, {} }
+  };
+  int ret = 0;
+  for (const auto& pattern : patterns)
+  {
+    SymmetricMatrix S;
+    auto& U = S.upper();
+    U.setSize(3,3);
+    U.setBuildMode(SymmetricMatrix::upper_type::row_wise);
+    for (auto row = U.createbegin(); row != U.createend(); ++row)
+      for (std::size_t j : pattern[row.index()])
+        row.insert(j);
+    U = 1.0;
+
+    Vector x(3), b(3);
+    x = 0.0;
+    b = 1.0;
+    try {
+      sweep(S,x,b);
+      std::cerr << "Error: " << name << " accepted a row without diagonal block" << std::endl;
+      ++ret;
+    }
+    catch (Dune::BCRSMatrixError&) {}
+  }
+  return ret;
+}
+
+template<class Operator, class Preconditioner>
+int solve(Operator& op, Preconditioner& prec, const char* name)
+{
+  typedef typename Operator::domain_type Vector;
+  Vector x(op.getmat().N()), b(op.getmat().N());
+  x = 1.0;
+  b = 0.0;
+  Dune::InverseOperatorResult r;
+  Dune::CGSolver<Vector> solver(op,prec,1e-8,500,0);
+  solver.apply(x,b,r);
+  if (!r.converged)
+  {
+    std::cerr << "Error: CGSolver with " << name << " did not converge with SymmetricBCRSMatrix" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int testSolver(int N)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::SymmetricBCRSMatrix<MatrixBlock> SymmetricMatrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  SymmetricMatrix S(A);
+  Dune::ThreadExecutor exec(2,1);
+
+  Dune::MatrixAdapter<SymmetricMatrix,Vector,Vector> op(S,exec);
+  Dune::SeqSSOR<SymmetricMatrix,Vector,Vector> ssor(S,1,1.0);
+  Dune::SeqILUn<SymmetricMatrix,Vector,Vector> ilu(S,1,1.0);
+
+  return solve(op,ssor,"SeqSSOR") + solve(op,ilu,"SeqILUn");
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testSymmetric<1>(12);
+    ret += testSymmetric<2>(8);
+    ret += testSymmetric<3>(6);
+    ret += testSolver(20);
+    ret += testMissingDiagonal([](const auto& A, auto& x, const auto& b) { Dune::dbgs(A,x,b,1.0); },"dbgs");
+    ret += testMissingDiagonal([](const auto& A, auto& x, const auto& b) { Dune::bsorf(A,x,b,1.0); },"bsorf");
+    ret += testMissingDiagonal([](const auto& A, auto& x, const auto& b) { Dune::bsorb(A,x,b,1.0); },"bsorb");
+    ret += testMissingDiagonal([](const auto& A, auto& x, const auto& b) { Dune::dbjac(A,x,b,1.0); },"dbjac");
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,310 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/threadexecutor.hh>
+
+#include "laplacian.hh"
+
+// The threaded products have to reproduce the serial ones bit by bit.
+template<class Vector>
+int compare(const Vector& a, const Vector& b, const char* what)
+{
+  for (typename Vector::size_type i=0; i<a.N(); ++i)
+    for (typename Vector::size_type j=0; j<a[i].N(); ++j)
+      if (a[i][j] != b[i][j])
+      {
+        std::cerr << "Error: " << what << " differs in row " << i << std::endl;
+        return 1;
+      }
+  return 0;
+}
+
+// The transposed products with private copies of y may sum in a different order.
+template<class Vector>
+int compareClose(const Vector& a, const Vector& b, const char* what)
+{
+  Vector d(a);
+  d -= b;
+  if (d.infinity_norm() > 1e-13*a.infinity_norm())
+  {
+    std::cerr << "Error: " << what << " differs from the serial product" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int testPartition()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  Matrix A;
+  setupLaplacian(A,20);
+
+  int ret = 0;
+  for (std::size_t chunks : {1, 3, 7, 500})
+  {
+    Dune::RowPartition p = Dune::nnzBalancedPartition(A,chunks);
+    if (p.chunks()!=chunks || p.begin(0)!=0 || p.size()!=A.N())
+    {
+      std::cerr << "Error: partition into " << chunks << " chunks does not cover the matrix" << std::endl;
+      ++ret;
+    }
+    for (std::size_t k=0; k<p.chunks(); ++k)
+      if (p.begin(k)>p.end(k))
+      {
+        std::cerr << "Error: chunk " << k << " is not ordered" << std::endl;
+        ++ret;
+      }
+  }
+  return ret;
+}
+
+// The pool runs every chunk once, on the same thread in every call, and empty chunks on the caller
+int testExecutor()
+{
+  int ret = 0;
+  Dune::ThreadExecutor exec(4,1);
+  const Dune::RowPartition partition(10,7);
+  std::map<std::size_t,std::thread::id> owner;
+  for (int call=0; call<3; ++call)
+  {
+    std::mutex mutex;
+    std::vector<int> count(partition.chunks(),0);
+    exec.runIndexed(partition, [&](std::size_t k, std::size_t begin, std::size_t end) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++count[k];
+        if (begin!=partition.begin(k) || end!=partition.end(k))
+          ++ret;
+        if (call==0)
+          owner[k] = std::this_thread::get_id();
+        else if (owner[k] != std::this_thread::get_id())
+          ++ret;
+      });
+    for (int c : count)
+      if (c!=1)
+        ++ret;
+  }
+  if (ret)
+    std::cerr << "Error: the chunks are not processed once each by the same thread" << std::endl;
+
+  // more chunks than rows, the empty ones do not reach the workers
+  const Dune::RowPartition sparse(3,8);
+  std::size_t calls = 0;
+  std::mutex mutex;
+  exec.runIndexed(sparse, [&](std::size_t, std::size_t begin, std::size_t end) {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++calls;
+      if (begin==end && std::this_thread::get_id()!=owner[0])
+      {
+        std::cerr << "Error: an empty chunk is run by a worker" << std::endl;
+        ++ret;
+      }
+    });
+  if (calls!=sparse.chunks())
+  {
+    std::cerr << "Error: not all chunks are run" << std::endl;
+    ++ret;
+  }
+
+  // a nested call runs on the calling thread
+  std::vector<std::size_t> nested(partition.size(),0);
+  exec.run(partition, [&](std::size_t begin, std::size_t end) {
+      exec.run(Dune::RowPartition(end-begin,3), [&](std::size_t b, std::size_t e) {
+          for (std::size_t i=b; i<e; ++i)
+            ++nested[begin+i];
+        });
+    });
+  for (std::size_t i=0; i<partition.size(); ++i)
+    if (nested[i]!=1)
+    {
+      std::cerr << "Error: the nested call does not cover row " << i << std::endl;
+      ++ret;
+    }
+
+  // exceptions reach the caller, after that the pool can be resized and reused
+  bool caught = false;
+  try {
+    exec.run(partition, [&](std::size_t begin, std::size_t) {
+        if (begin>0)
+          throw std::runtime_error("chunk failed");
+      });
+  }
+  catch (std::runtime_error&) {
+    caught = true;
+  }
+  if (!caught)
+  {
+    std::cerr << "Error: the exception is not rethrown" << std::endl;
+    ++ret;
+  }
+  for (std::size_t threads : {7, 2, 1})
+  {
+    exec.setThreads(threads);
+    std::vector<int> count(partition.chunks(),0);
+    exec.runIndexed(partition, [&](std::size_t k, std::size_t, std::size_t) { ++count[k]; });
+    for (int c : count)
+      if (c!=1)
+      {
+        std::cerr << "Error: the resized pool misses a chunk" << std::endl;
+        ++ret;
+      }
+  }
+  return ret;
+}
+
+template<int BS>
+int testProducts(int N, std::size_t threads)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+
+  // perturb the values to get a result sensitive to the summation order
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      *col *= 1.0 + 1e-3*((row.index()*7 + col.index()*13) % 17);
+
+  Vector x(A.M()), ys(A.N()), yt(A.N());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+
+  Dune::ThreadExecutor exec(threads,1);
+
+  int ret = 0;
+  A.mv(x,ys);
+  A.mv(x,yt,exec);
+  ret += compare(ys,yt,"mv");
+
+  A.umv(x,ys);
+  A.umv(x,yt,exec);
+  ret += compare(ys,yt,"umv");
+
+  A.mmv(x,ys);
+  A.mmv(x,yt,exec);
+  ret += compare(ys,yt,"mmv");
+
+  A.usmv(0.3,x,ys);
+  A.usmv(0.3,x,yt,exec);
+  ret += compare(ys,yt,"usmv");
+
+  Dune::MatrixAdapter<Matrix,Vector,Vector> serialOp(A);
+  Dune::MatrixAdapter<Matrix,Vector,Vector> threadedOp(A,exec);
+  serialOp.apply(x,ys);
+  threadedOp.apply(x,yt);
+  ret += compare(ys,yt,"MatrixAdapter::apply");
+  serialOp.applyscaleadd(-2.0,x,ys);
+  threadedOp.applyscaleadd(-2.0,x,yt);
+  ret += compare(ys,yt,"MatrixAdapter::applyscaleadd");
+
+  return ret;
+}
+
+// Run all transposed products, expecting identical results if exact is set
+template<class Matrix, class X, class Y>
+int testTransposed(const Matrix& A, const X& x, Y& ys, Y& yt,
+                   const Dune::ThreadExecutor& exec, bool exact)
+{
+  auto cmp = [&](const char* what) {
+               return exact ? compare(ys,yt,what) : compareClose(ys,yt,what);
+             };
+  int ret = 0;
+  A.mtv(x,ys);
+  A.mtv(x,yt,exec);
+  ret += cmp("mtv");
+
+  A.umtv(x,ys);
+  A.umtv(x,yt,exec);
+  ret += cmp("umtv");
+
+  A.mmtv(x,ys);
+  A.mmtv(x,yt,exec);
+  ret += cmp("mmtv");
+
+  A.usmtv(-0.7,x,ys);
+  A.usmtv(-0.7,x,yt,exec);
+  ret += cmp("usmtv");
+  return ret;
+}
+
+template<int BS>
+int testTransposedProducts(int N, std::size_t threads)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+
+  Matrix A;
+  setupLaplacian(A,N);
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+      (*col)[0][BS-1] += 1e-3*((row.index()*7 + col.index()*13) % 17);
+
+  Vector x(A.N()), ys(A.M()), yt(A.M());
+  for (typename Vector::size_type i=0; i<x.N(); ++i)
+    x[i] = 1.0/(i+1.0);
+
+  Dune::ThreadExecutor exec(threads,1);
+  // the Laplacian has five blocks per row, with more threads the
+  // columns are gathered through the transposed pattern
+  const bool gather = threads > 5;
+  int ret = testTransposed(A,x,ys,yt,exec,gather);
+
+  // the cached pattern refers to the blocks, changing values is fine
+  A *= 2.0;
+  ret += testTransposed(A,x,ys,yt,exec,gather);
+
+  // a new pattern replaces the cached one
+  Matrix B(A.N(),A.M(),6*A.N(),Matrix::row_wise);
+  for (auto row = B.createbegin(); row != B.createend(); ++row)
+    for (std::size_t k=0; k<6; ++k)
+      row.insert((row.index()*k + 7*k) % B.M());
+  B = 1.0;
+  A = B;
+  ret += testTransposed(A,x,ys,yt,exec,gather);
+
+  // a restriction like matrix with four fine rows per coarse column
+  Matrix P(x.N(),x.N()/4,x.N(),Matrix::row_wise);
+  for (auto row = P.createbegin(); row != P.createend(); ++row)
+    row.insert(std::min(row.index()/4,P.M()-1));
+  P = 0.5;
+  Vector yp(P.M()), ypt(P.M());
+  ret += testTransposed(P,x,yp,ypt,exec,false);
+
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testPartition();
+    ret += testExecutor();
+    for (std::size_t threads : {1, 2, 4, 7})
+    {
+      ret += testProducts<1>(30,threads);
+      ret += testProducts<3>(15,threads);
+      ret += testTransposedProducts<1>(30,threads);
+      ret += testTransposedProducts<2>(16,threads);
+    }
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
@@ -0,0 +1,188 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#include "config.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <limits>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/matrix.hh>
+#include <dune/istl/vbvector.hh>
+
+int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    std::cerr << "Error: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// The block i has 1 + i%4 entries, as for mixed polynomial orders
+std::size_t blockSize(std::size_t i)
+{
+  return 1 + i%4;
+}
+
+template<class V>
+void setup (V& v, std::size_t n, double offset)
+{
+  v.resize(n);
+  for (auto it = v.createbegin(); it != v.createend(); ++it)
+    it.setblocksize(blockSize(it.index()));
+  double t = offset;
+  for (auto& block : v)
+    for (auto& entry : block)
+      for (auto& x : entry)
+        x = 1.0/(t += 0.37);
+}
+
+// The operations on all entries have to match those on the blocks
+template<class V>
+int testFlatOperations()
+{
+  typedef typename V::field_type K;
+  typedef Dune::Imp::block_vector_unmanaged<typename V::block_type::block_type,
+                                            typename V::allocator_type> Blocks;
+  int ret = 0;
+  V x, y, z;
+  setup(x,1000,0.1);
+  setup(y,1000,0.2);
+  z = x;
+  const Blocks& bx = x;
+  const Blocks& by = y;
+  Blocks& bz = z;
+
+  auto same = [&](const char* what) {
+    V d(x);
+    d -= z;
+    ret += check(d.infinity_norm() == 0.0, what);
+  };
+
+  const K a = K(0.7)/K(3.0);
+  x.axpy(a,y);
+  bz.axpy(a,by);
+  same("axpy differs");
+  x += y;
+  bz += by;
+  same("operator+= differs");
+  x -= y;
+  bz -= by;
+  same("operator-= differs");
+  x *= a;
+  bz *= a;
+  same("operator*= differs");
+  x /= a;
+  bz /= a;
+  same("operator/= differs");
+
+  using std::abs;
+  ret += check(abs(x.dot(y) - bx.dot(by)) <= 1e-13*abs(bx.dot(by)), "dot differs");
+  ret += check(abs(x.one_norm() - bx.one_norm()) <= 1e-13*bx.one_norm(), "one_norm differs");
+  ret += check(abs(x.two_norm2() - bx.two_norm2()) <= 1e-13*bx.two_norm2(), "two_norm2 differs");
+  ret += check(abs(x.two_norm() - bx.two_norm()) <= 1e-13*bx.two_norm(), "two_norm differs");
+  ret += check(x.infinity_norm() == bx.infinity_norm(), "infinity_norm differs");
+
+  x = K(2.0);
+  ret += check(x[999][3][0] == K(2.0) && x.one_norm() == 2.0*x.dim(), "assignment differs");
+  x[501][1][0] = std::numeric_limits<double>::quiet_NaN();
+  ret += check(std::isnan(x.infinity_norm()), "infinity_norm drops a NaN");
+  return ret;
+}
+
+typedef Dune::Matrix<Dune::FieldMatrix<double,1,1> > DenseBlock;
+typedef Dune::BCRSMatrix<DenseBlock> Matrix;
+typedef Dune::VariableBlockVector<Dune::FieldVector<double,1> > Vector;
+
+// A periodic chain of blocks, block (i,j) is blockSize(i) x blockSize(j)
+void setupMatrix (Matrix& A, std::size_t n)
+{
+  A.setSize(n,n,3*n);
+  A.setBuildMode(Matrix::row_wise);
+  for (auto row = A.createbegin(); row != A.createend(); ++row)
+  {
+    const std::size_t i = row.index();
+    row.insert(i);
+    row.insert((i+1)%n);
+    row.insert((i+n-1)%n);
+  }
+  for (auto row = A.begin(); row != A.end(); ++row)
+    for (auto col = row->begin(); col != row->end(); ++col)
+    {
+      col->setSize(blockSize(row.index()),blockSize(col.index()));
+      for (std::size_t r=0; r<col->N(); ++r)
+        for (std::size_t c=0; c<col->M(); ++c)
+          (*col)[r][c] = (row.index()==col.index() && r==c) ? 4.0 : -0.1/(1.0+r+c+col.index()%5);
+    }
+}
+
+// y = A x entry by entry, summed in the order of the generic kernels
+void referenceMV (const Matrix& A, const Vector& x, Vector& y)
+{
+  for (auto row = A.begin(); row != A.end(); ++row)
+  {
+    auto& yi = y[row.index()];
+    yi = 0.0;
+    for (auto col = row->begin(); col != row->end(); ++col)
+      for (std::size_t r=0; r<col->N(); ++r)
+        for (std::size_t c=0; c<col->M(); ++c)
+          yi[r][0] += (*col)[r][c][0][0]*x[col.index()][c][0];
+  }
+}
+
+int testSpMV()
+{
+  int ret = 0;
+  const std::size_t n = 500;
+  Matrix A;
+  setupMatrix(A,n);
+  Vector x, y, z, w;
+  setup(x,n,0.3);
+  setup(y,n,0.0);
+  setup(z,n,0.0);
+  setup(w,n,0.0);
+
+  A.mv(x,y);
+  referenceMV(A,x,z);
+  z -= y;
+  // the same up to contractions into fused multiply-adds
+  ret += check(z.infinity_norm() <= 1e-14*y.infinity_norm(),
+               "mv with variable blocks differs from the generic kernel");
+
+  A.mv(x,w,Dune::ThreadExecutor(4,1));
+  w -= y;
+  ret += check(w.infinity_norm() == 0.0, "the threaded mv with variable blocks differs");
+
+  const double norm = y.infinity_norm();
+  A.mmv(x,y);
+  ret += check(y.infinity_norm() <= 1e-14*norm, "mmv does not revert mv");
+
+  y = 0.0;
+  A.usmv(2.0,x,y);
+  A.mv(x,z);
+  z *= 2.0;
+  z -= y;
+  ret += check(z.infinity_norm() <= 1e-14*norm, "usmv with variable blocks is wrong");
+  return ret;
+}
+
+int main()
+{
+  int ret = 0;
+  try {
+    ret += testFlatOperations<Dune::VariableBlockVector<Dune::FieldVector<double,1> > >();
+    ret += testFlatOperations<Dune::VariableBlockVector<Dune::FieldVector<double,3> > >();
+    ret += testFlatOperations<Dune::VariableBlockVector<Dune::FieldVector<std::complex<double>,2> > >();
+    ret += testSpMV();
+  }
+  catch (Dune::Exception& e) {
+    std::cerr << e << std::endl;
+    return 1;
+  }
+  return ret;
+}
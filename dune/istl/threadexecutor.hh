@@ -0,0 +1,391 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_THREADEXECUTOR_HH
+#define DUNE_ISTL_THREADEXECUTOR_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \file
+ * \brief Shared-memory execution of row-wise kernels.
+ *
+ * Provides a partition of a row range into contiguous chunks and an
+ * executor running one chunk per thread. Kernels driven by these
+ * classes write every row from exactly one thread, so their results
+ * do not depend on the number of threads used.
+ */
+
+namespace Dune {
+
+  /**
+              @addtogroup ISTL_SPMV
+              @{
+   */
+
+  /**
+   * @brief A split of the row range [0,n) into contiguous chunks.
+   *
+   * Chunk k covers the rows [begin(k),end(k)). Chunks may be empty.
+   */
+  class RowPartition
+  {
+  public:
+    //! The type used for row indices and sizes.
+    typedef std::size_t size_type;
+
+    //! An empty partition of zero rows.
+    RowPartition ()
+      : offsets_(1,0)
+    {}
+
+    //! Split n rows into the given number of chunks of (almost) equal size.
+    RowPartition (size_type n, size_type chunks)
+      : offsets_(std::max(chunks,size_type(1))+1)
+    {
+      const size_type c = offsets_.size()-1;
+      for (size_type k=0; k<=c; ++k)
+        offsets_[k] = (n*k)/c;
+    }
+
+    //! Construct from the chunk offsets, the first has to be zero.
+    explicit RowPartition (std::vector<size_type> offsets)
+      : offsets_(std::move(offsets))
+    {
+      if (offsets_.empty())
+        offsets_.push_back(0);
+    }
+
+    //! The number of chunks.
+    size_type chunks () const
+    {
+      return offsets_.size()-1;
+    }
+
+    //! The total number of rows covered.
+    size_type size () const
+    {
+      return offsets_.back();
+    }
+
+    //! The first row of chunk k.
+    size_type begin (size_type k) const
+    {
+      return offsets_[k];
+    }
+
+    //! One past the last row of chunk k.
+    size_type end (size_type k) const
+    {
+      return offsets_[k+1];
+    }
+
+    //! The chunk offsets.
+    const std::vector<size_type>& offsets () const
+    {
+      return offsets_;
+    }
+
+    bool operator== (const RowPartition& other) const
+    {
+      return offsets_ == other.offsets_;
+    }
+
+    bool operator!= (const RowPartition& other) const
+    {
+      return offsets_ != other.offsets_;
+    }
+
+  private:
+    std::vector<size_type> offsets_;
+  };
+
+  /**
+   * @brief Partition the rows of a sparse matrix such that each chunk holds
+   * roughly the same number of nonzero blocks.
+   *
+   * Every row is weighted with its number of blocks plus one, so that
+   * long runs of empty rows are distributed, too.
+   *
+   * @param A The matrix, e.g. a BCRSMatrix.
+   * @param chunks The number of chunks to create.
+   */
+  template<class M>
+  RowPartition nnzBalancedPartition (const M& A, std::size_t chunks)
+  {
+    typedef RowPartition::size_type size_type;
+    chunks = std::max(chunks,size_type(1));
+
+    size_type total = 0;
+    for (auto row = A.begin(); row != A.end(); ++row)
+      total += row->size()+1;
+
+    std::vector<size_type> offsets(chunks+1,A.N());
+    offsets[0] = 0;
+    size_type k = 1;
+    size_type work = 0;
+    for (auto row = A.begin(); row != A.end() && k<chunks; ++row)
+    {
+      work += row->size()+1;
+      // close chunk k-1 once its share of the work is reached
+      while (k<chunks && work*chunks >= total*k)
+        offsets[k++] = row.index()+1;
+    }
+    return RowPartition(std::move(offsets));
+  }
+
+  /**
+   * @brief Runs row-wise kernels on several threads.
+   *
+   * The executor keeps a pool of threads()-1 worker threads, which is
+   * created by the constructor and by setThreads() and sleeps while
+   * there is no work. The non-empty chunks of a RowPartition are dealt
+   * out round-robin to the calling thread and the workers, such that
+   * chunk k of a partition is always processed by the same thread.
+   * Empty chunks are handled by the calling thread. With one thread, or
+   * for fewer rows than minRows(), all work happens on the calling thread.
+   *
+   * The pool serves one call at a time. A call made while the workers
+   * are busy, e.g. from within a kernel or concurrently from another
+   * thread, processes all of its chunks on the calling thread.
+   *
+   * A process wide instance is available through global(). It uses a
+   * single thread unless configured otherwise:
+   * \code
+   * Dune::ThreadExecutor::global().setThreads(std::thread::hardware_concurrency());
+   * \endcode
+   */
+  class ThreadExecutor
+  {
+  public:
+    //! The type used for sizes.
+    typedef std::size_t size_type;
+
+    /**
+     * @brief Constructor.
+     * @param threads The number of threads to use.
+     * @param minRows The minimal number of rows for which the
+     * work is actually distributed.
+     */
+    explicit ThreadExecutor (size_type threads = 1, size_type minRows = 4096)
+      : threads_(1), minRows_(minRows)
+    {
+      setThreads(threads);
+    }
+
+    //! Copy the settings, the copy starts a pool of its own.
+    ThreadExecutor (const ThreadExecutor& other)
+      : ThreadExecutor(other.threads_,other.minRows_)
+    {}
+
+    //! Copy the settings of another executor.
+    ThreadExecutor& operator= (const ThreadExecutor& other)
+    {
+      if (this != &other)
+      {
+        setThreads(other.threads_);
+        minRows_ = other.minRows_;
+      }
+      return *this;
+    }
+
+    ~ThreadExecutor ()
+    {
+      stopWorkers();
+    }
+
+    //! The number of threads used.
+    size_type threads () const
+    {
+      return threads_;
+    }
+
+    /**
+     * @brief Set the number of threads to use.
+     *
+     * Restarts the pool of worker threads. Must not be called while
+     * the executor is running a kernel.
+     */
+    void setThreads (size_type threads)
+    {
+      threads = std::max(threads,size_type(1));
+      if (threads == threads_ && workers_.size()+1 == threads)
+        return;
+      stopWorkers();
+      threads_ = threads;
+      stop_ = false;
+      workers_.reserve(threads_-1);
+      const unsigned long seen = generation_;
+      for (size_type w=1; w<threads_; ++w)
+        workers_.emplace_back([this,w,seen] { work(w,seen); });
+    }
+
+    //! The minimal number of rows for which the work is distributed.
+    size_type minRows () const
+    {
+      return minRows_;
+    }
+
+    //! Set the minimal number of rows for which the work is distributed.
+    void setMinRows (size_type minRows)
+    {
+      minRows_ = minRows;
+    }
+
+    //! Whether work on n rows is distributed over several threads.
+    bool parallel (size_type n) const
+    {
+      return threads_>1 && n>=minRows_;
+    }
+
+    /**
+     * @brief Call f(begin,end) for each chunk of the partition.
+     *
+     * Returns after all chunks have been processed. An exception thrown
+     * by f is rethrown on the calling thread.
+     */
+    template<class F>
+    void run (const RowPartition& partition, F&& f) const
+    {
+      runIndexed(partition, [&](size_type, size_type begin, size_type end) { f(begin,end); });
+    }
+
+    /**
+     * @brief Call f(k,begin,end) for each chunk k of the partition.
+     *
+     * Useful for reductions that store one partial result per chunk.
+     * f is called for empty chunks, too, on the calling thread.
+     */
+    template<class F>
+    void runIndexed (const RowPartition& partition, F&& f) const
+    {
+      const size_type chunks = partition.chunks();
+      std::vector<size_type> busy;
+      for (size_type k=0; k<chunks; ++k)
+        if (partition.begin(k) != partition.end(k))
+          busy.push_back(k);
+
+      bool expected = false;
+      if (busy.size()<=1 || workers_.empty() || !running_.compare_exchange_strong(expected,true))
+      {
+        for (size_type k=0; k<chunks; ++k)
+          f(k,partition.begin(k),partition.end(k));
+        return;
+      }
+
+      // participant p processes the busy chunks p, p+active, p+2*active, ...
+      const size_type active = std::min(threads_,busy.size());
+      std::vector<std::exception_ptr> errors(chunks);
+      auto job = [&](size_type p) {
+        for (size_type i=p; i<busy.size(); i+=active)
+        {
+          const size_type k = busy[i];
+          try {
+            f(k,partition.begin(k),partition.end(k));
+          }
+          catch (...) {
+            errors[k] = std::current_exception();
+          }
+        }
+      };
+      typedef decltype(job) Job;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        invoke_ = [](const void* j, size_type p) { (*static_cast<const Job*>(j))(p); };
+        active_ = active;
+        pending_ = active-1;
+        ++generation_;
+      }
+      wake_.notify_all();
+
+      job(0);
+      for (size_type k=0; k<chunks; ++k)
+        if (partition.begin(k) == partition.end(k))
+          try {
+            f(k,partition.begin(k),partition.end(k));
+          }
+          catch (...) {
+            errors[k] = std::current_exception();
+          }
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        job_ = nullptr;
+      }
+      running_ = false;
+
+      for (auto& e : errors)
+        if (e)
+          std::rethrow_exception(e);
+    }
+
+    //! The process wide executor used by default.
+    static ThreadExecutor& global ()
+    {
+      static ThreadExecutor executor;
+      return executor;
+    }
+
+  private:
+    //! The loop of worker w, which is participant w of every call after generation seen.
+    void work (size_type w, unsigned long seen)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true)
+      {
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_)
+          return;
+        seen = generation_;
+        if (w >= active_)
+          continue;
+        const void* job = job_;
+        lock.unlock();
+        invoke_(job,w);
+        lock.lock();
+        if (--pending_ == 0)
+          done_.notify_one();
+      }
+    }
+
+    void stopWorkers ()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for (auto& w : workers_)
+        w.join();
+      workers_.clear();
+    }
+
+    size_type threads_;
+    size_type minRows_;
+
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable wake_;
+    mutable std::condition_variable done_;
+    mutable std::atomic<bool> running_{false};
+    mutable unsigned long generation_ = 0;
+    mutable size_type active_ = 0;
+    mutable size_type pending_ = 0;
+    mutable const void* job_ = nullptr;
+    mutable void (*invoke_)(const void*, size_type) = nullptr;
+    bool stop_ = false;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
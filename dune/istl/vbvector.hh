@@ -3,14 +3,20 @@
 #ifndef DUNE_ISTL_VBVECTOR_HH
 #define DUNE_ISTL_VBVECTOR_HH
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <type_traits>
 
+#include <dune/common/dotproduct.hh>
+#include <dune/common/fvector.hh>
 #include <dune/common/iteratorfacades.hh>
 #include "istlexception.hh"
 #include "bvector.hh"
+#include "reduction.hh"
 
 /** \file
  * \brief ???
@@ -23,6 +29,19 @@ namespace Dune {
               @{
    */
 
+  namespace Imp {
+
+    //! Whether an array of B is a contiguous array of B::field_type.
+    template<class B>
+    struct HasFlatEntries : std::false_type {};
+
+    template<class K, int n>
+    struct HasFlatEntries<FieldVector<K,n> >
+      : std::integral_constant<bool, sizeof(FieldVector<K,n>) == n*sizeof(K)>
+    {};
+
+  } // end namespace Imp
+
   /**
       \brief A Vector of blocks with different blocksizes.
 
@@ -32,6 +51,12 @@ namespace Dune {
 
           VariableBlockVector is a container of containers!
 
+          If B is a FieldVector, the vector space operations, dot() and
+          the norms run over the underlying array of all entries instead
+          of the blocks, in loops the compiler can vectorize. The sums
+          are then added in a different order than for BlockVector, so
+          the results of dot() and the norms may differ by rounding.
+
    */
   template<class B, class A=std::allocator<B> >
   class VariableBlockVector : public Imp::block_vector_unmanaged<B,A>
@@ -208,6 +233,18 @@ namespace Dune {
       initialized = true;
     }
 
+    /**
+     * @brief move constructor
+     *
+     * Takes over the entries and the block windows of a, which is left
+     * empty as if default constructed.
+     */
+    VariableBlockVector (VariableBlockVector&& a) noexcept
+      : VariableBlockVector()
+    {
+      moveFrom(a);
+    }
+
     //! free dynamic memory
     ~VariableBlockVector ()
     {
@@ -386,16 +423,149 @@ namespace Dune {
       return *this;     // Gebe Referenz zurueck damit a=b=c; klappt
     }
 
+    //! move assignment, frees the own memory and takes over the one of a
+    VariableBlockVector& operator= (VariableBlockVector&& a) noexcept
+    {
+      if (&a!=this)
+      {
+        if (this->n>0) {
+          size_type i=this->n;
+          while (i)
+            this->p[--i].~B();
+          allocator_.deallocate(this->p,this->n);
+        }
+        if (nblocks>0) {
+          size_type i=nblocks;
+          while (i)
+            block[--i].~window_type();
+          windowAllocator_.deallocate(block,nblocks);
+        }
+        moveFrom(a);
+      }
+      return *this;
+    }
+
 
     //===== assignment from scalar
 
     //! assign from scalar
     VariableBlockVector& operator= (const field_type& k)
     {
-      (static_cast<Imp::block_vector_unmanaged<B,A>&>(*this)) = k;
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [&k](field_type& x) { x = k; }))
+        (static_cast<Imp::block_vector_unmanaged<B,A>&>(*this)) = k;
+      return *this;
+    }
+
+
+    //===== vector space arithmetic on the array of all entries
+
+    using Imp::block_vector_unmanaged<B,A>::operator+=;
+    using Imp::block_vector_unmanaged<B,A>::operator-=;
+    using Imp::block_vector_unmanaged<B,A>::axpy;
+    using Imp::block_vector_unmanaged<B,A>::dot;
+    using Imp::block_vector_unmanaged<B,A>::one_norm;
+    using Imp::block_vector_unmanaged<B,A>::two_norm;
+    using Imp::block_vector_unmanaged<B,A>::two_norm2;
+    using Imp::block_vector_unmanaged<B,A>::infinity_norm;
+
+    //! vector space addition
+    VariableBlockVector& operator+= (const VariableBlockVector& y)
+    {
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [](field_type& x, const field_type& yk) { x += yk; }, y))
+        Imp::block_vector_unmanaged<B,A>::operator+=(y);
+      return *this;
+    }
+
+    //! vector space subtraction
+    VariableBlockVector& operator-= (const VariableBlockVector& y)
+    {
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [](field_type& x, const field_type& yk) { x -= yk; }, y))
+        Imp::block_vector_unmanaged<B,A>::operator-=(y);
+      return *this;
+    }
+
+    //! vector space multiplication with scalar
+    VariableBlockVector& operator*= (const field_type& a)
+    {
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [&a](field_type& x) { x *= a; }))
+        Imp::block_vector_unmanaged<B,A>::operator*=(a);
+      return *this;
+    }
+
+    //! vector space division by scalar
+    VariableBlockVector& operator/= (const field_type& a)
+    {
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [&a](field_type& x) { x /= a; }))
+        Imp::block_vector_unmanaged<B,A>::operator/=(a);
+      return *this;
+    }
+
+    //! vector space axpy operation
+    VariableBlockVector& axpy (const field_type& a, const VariableBlockVector& y)
+    {
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [&a](field_type& x, const field_type& yk) { x += a*yk; }, y))
+        Imp::block_vector_unmanaged<B,A>::axpy(a,y);
       return *this;
     }
 
+    //! vector dot product, the first argument is conjugated
+    field_type dot (const VariableBlockVector& y) const
+    {
+      field_type sum(0);
+      if (!flatSum(Imp::HasFlatEntries<B>(), sum, [](const field_type& x, const field_type& yk) {
+            return Dune::dot(x,yk);
+          }, y))
+        sum = Imp::block_vector_unmanaged<B,A>::dot(y);
+      return sum;
+    }
+
+    //! one norm (sum over absolute values of entries)
+    typename FieldTraits<field_type>::real_type one_norm () const
+    {
+      typename FieldTraits<field_type>::real_type sum(0);
+      if (!flatSum(Imp::HasFlatEntries<B>(), sum, [](const field_type& x) {
+            using std::abs;
+            return abs(x);
+          }))
+        sum = Imp::block_vector_unmanaged<B,A>::one_norm();
+      return sum;
+    }
+
+    //! two norm sqrt(sum over squared values of entries)
+    typename FieldTraits<field_type>::real_type two_norm () const
+    {
+      using std::sqrt;
+      return sqrt(two_norm2());
+    }
+
+    //! Square of the two-norm (the sum over the squared values of the entries)
+    typename FieldTraits<field_type>::real_type two_norm2 () const
+    {
+      typename FieldTraits<field_type>::real_type sum(0);
+      if (!flatSum(Imp::HasFlatEntries<B>(), sum, [](const field_type& x) { return Imp::absSquare(x); }))
+        sum = Imp::block_vector_unmanaged<B,A>::two_norm2();
+      return sum;
+    }
+
+    //! infinity norm (maximum of absolute values of entries), NaN if an entry is NaN
+    typename FieldTraits<field_type>::real_type infinity_norm () const
+    {
+      typedef typename FieldTraits<field_type>::real_type real_type;
+      real_type norm = 0;
+      bool isNaN = false;
+      if (!flatForEach(Imp::HasFlatEntries<B>(), [&](const field_type& x) {
+            using std::abs;
+            using std::max;
+            const real_type a = abs(x);
+            if (a != a)
+              isNaN = true;
+            else
+              norm = max(a,norm);
+          }))
+        return Imp::block_vector_unmanaged<B,A>::infinity_norm();
+      return isNaN ? std::numeric_limits<real_type>::quiet_NaN() : norm;
+    }
+
 
     //===== the creation interface
 
@@ -694,8 +864,120 @@ namespace Dune {
       return nblocks;
     }
 
+    /**
+     * @brief The memory allocated for the entries and the block windows.
+     *
+     * The entries are allocated exactly, so all allocated memory is used
+     * once the vector is initialized.
+     */
+    MemoryUsage memoryUsage () const
+    {
+      const std::size_t windows = block ? nblocks*sizeof(window_type) : 0;
+      const std::size_t entries = this->p ? this->n*sizeof(B) : 0;
+      return MemoryUsage(windows + entries, windows + (initialized ? entries : 0));
+    }
+
 
   private:
+    // the array of all entries, if B is a FieldVector
+    field_type* flatEntries ()
+    {
+      return this->n>0 ? &this->p[0][0] : nullptr;
+    }
+
+    const field_type* flatEntries () const
+    {
+      return this->n>0 ? &this->p[0][0] : nullptr;
+    }
+
+    template<class F, class... P>
+    static void flatLoop (std::size_t size, F& f, P*... p)
+    {
+      for (std::size_t k=0; k<size; ++k)
+        f(p[k]...);
+    }
+
+    // call f for all entries of v and those of ys
+    template<class V, class F, class... Y>
+    static void flatApply (V& v, F& f, const Y&... ys)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      for (std::size_t n : std::initializer_list<std::size_t>{ys.n...})
+        if (n!=v.n) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+      flatLoop(v.n*B::dimension, f, v.flatEntries(), ys.flatEntries()...);
+    }
+
+    // call f for all entries of the vector and those of ys, false if B is not a FieldVector
+    template<class F, class... Y>
+    bool flatForEach (std::true_type, F&& f, const Y&... ys)
+    {
+      flatApply(*this, f, ys...);
+      return true;
+    }
+
+    template<class F, class... Y>
+    bool flatForEach (std::false_type, F&&, const Y&...)
+    {
+      return false;
+    }
+
+    // the same for read-only access to the entries of the vector
+    template<class F, class... Y>
+    bool flatForEach (std::true_type, F&& f, const Y&... ys) const
+    {
+      flatApply(*this, f, ys...);
+      return true;
+    }
+
+    template<class F, class... Y>
+    bool flatForEach (std::false_type, F&&, const Y&...) const
+    {
+      return false;
+    }
+
+    // the sum of f over all entries, with several independent partial sums
+    template<class R, class F, class... Y>
+    bool flatSum (std::true_type, R& sum, F&& f, const Y&... ys) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      for (std::size_t n : std::initializer_list<std::size_t>{ys.n...})
+        if (n!=this->n) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+      sum = sumEntries<R>(f, flatEntries(), ys.flatEntries()...);
+      return true;
+    }
+
+    template<class R, class F, class... Y>
+    bool flatSum (std::false_type, R&, F&&, const Y&...) const
+    {
+      return false;
+    }
+
+    template<class R, class F, class... P>
+    R sumEntries (F& f, P*... p) const
+    {
+      return Imp::reproducibleSum<R>(this->n*B::dimension, [&](std::size_t k) { return f(p[k]...); },
+                                     ThreadExecutor(), Summation::plain);
+    }
+
+    //! Take over the memory of a and leave it empty. The own memory must be freed.
+    void moveFrom (VariableBlockVector& a)
+    {
+      this->n = a.n;
+      this->p = a.p;
+      nblocks = a.nblocks;
+      block = a.block;
+      initialized = a.initialized;
+      allocator_ = std::move(a.allocator_);
+      windowAllocator_ = std::move(a.windowAllocator_);
+      a.n = 0;
+      a.p = nullptr;
+      a.nblocks = 0;
+      a.block = nullptr;
+      a.initialized = false;
+    }
+
     size_type nblocks;            // number of blocks in vector
     window_type* block;     // array of blocks pointing to the array in the base class
     bool initialized;       // true if vector has been initialized